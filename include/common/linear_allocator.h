@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace engine {
+namespace common {
+
+/// Linear (arena) allocator for per-frame POD data; memory is released only by reset
+class LinearAllocator
+{
+  public:
+    /// Constants
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024; //default size of a memory chunk
+
+    /// Constructor
+    LinearAllocator(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    /// No copy
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator =(const LinearAllocator&) = delete;
+
+    /// Allocate memory block
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /// Allocate array of POD objects (constructors are not called)
+    template <class T> T* allocate(size_t count = 1);
+
+    /// Release all allocations; chunks are kept (and coalesced) for the next frame
+    void reset();
+
+    /// Reserve memory for allocations before the next reset
+    void reserve(size_t size);
+
+    /// Number of allocated bytes since the last reset
+    size_t allocated_size() const;
+
+    /// Total size of chunks
+    size_t capacity() const;
+
+  private:
+    struct Chunk
+    {
+      std::unique_ptr<char[]> data; //chunk memory
+      size_t size; //chunk size
+    };
+
+    void add_chunk(size_t min_size);
+
+  private:
+    std::vector<Chunk> chunks; //memory chunks
+    size_t chunk_size; //default chunk size
+    size_t current_chunk; //index of a chunk for allocations
+    size_t current_offset; //offset in the current chunk
+    size_t allocated_bytes; //number of allocated bytes since the last reset
+};
+
+/// Allocate array of POD objects
+template <class T>
+inline T* LinearAllocator::allocate(size_t count)
+{
+  static_assert(std::is_trivially_destructible<T>::value, "LinearAllocator doesn't call destructors");
+
+  return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+}
+
+}}
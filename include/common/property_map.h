@@ -93,6 +93,9 @@ class PropertyMap
     /// Set property
     template <class T> Property& set(const char* name, const T& value);
 
+    /// Layout identifier; changes when properties are inserted or removed and is unique across all maps
+    size_t layout_id() const;
+
   private:
     struct Impl;
     std::shared_ptr<Impl> impl;
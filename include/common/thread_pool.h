@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine {
+namespace common {
+
+/// Worker threads pool; the calling thread participates in jobs execution
+class ThreadPool
+{
+  public:
+    typedef std::function<void (size_t)> Job;
+
+    /// Constructor (0 - number of hardware threads)
+    ThreadPool(size_t threads_count = 0);
+
+    /// Destructor
+    ~ThreadPool();
+
+    /// No copy
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator =(const ThreadPool&) = delete;
+
+    /// Number of workers
+    size_t workers_count() const { return threads.size() + 1; }
+
+    /// Run jobs [0; count) in parallel and wait for their completion (the first exception of jobs is rethrown)
+    void parallel_for(size_t count, const Job& fn);
+
+  private:
+    void run_jobs(const Job& fn, size_t count);
+    void worker();
+
+  private:
+    std::vector<std::thread> threads; //worker threads
+    std::mutex mutex; //jobs mutex
+    std::condition_variable start_condition; //jobs start condition
+    std::condition_variable finish_condition; //jobs finish condition
+    const Job* job; //current job
+    size_t jobs_count; //number of jobs
+    std::atomic<size_t> next_job; //index of next job
+    size_t active_workers; //number of workers which haven't finished current jobs
+    size_t generation; //jobs generation
+    std::exception_ptr error; //first exception thrown by current jobs
+    bool stop; //stop flag
+};
+
+}}
@@ -19,6 +19,19 @@ struct Vertex
   math::vec2f tex_coord;
 };
 
+/// Packed renderable vertex data (half size of Vertex)
+struct PackedVertex
+{
+  math::vec3f position;
+  uint32_t    normal;        /// signed normalized 10:10:10:2 (xyz)
+  uint8_t     color[4];      /// unsigned normalized RGBA8
+  uint16_t    tex_coord[2];  /// half floats
+};
+
+/// Vertices conversion
+PackedVertex pack_vertex(const Vertex& vertex);
+void pack_vertices(const Vertex* vertices, size_t count, PackedVertex* packed_vertices);
+
 /// Renderable primitive type
 enum PrimitiveType
 {
@@ -42,7 +55,7 @@ struct Primitive
 class Mesh
 {
   public:
-    typedef uint16_t index_type;
+    typedef uint32_t index_type; //indices are relative to base vertex of a primitive
 
     /// Constructor
     Mesh();
@@ -93,7 +106,7 @@ class Mesh
 
     /// Add primitives
     uint32_t add_primitive(const char* material_name, PrimitiveType type, uint32_t first, uint32_t count, uint32_t base_vertex);
-    uint32_t add_primitive(const char* material_name, PrimitiveType type, const Vertex* vertices, index_type vertices_count, const index_type* indices, uint32_t indices_count);
+    uint32_t add_primitive(const char* material_name, PrimitiveType type, const Vertex* vertices, uint32_t vertices_count, const index_type* indices, uint32_t indices_count);
 
     /// Remove primitive
     void remove_primitive(uint32_t primitive_index);
@@ -107,6 +120,13 @@ class Mesh
     /// Return optimized mesh containing only one primitive for each material
     Mesh merge_primitives() const;
 
+    /// Max index of primitives (relative to their base vertices); defines required index width
+    index_type max_index() const;
+
+    /// Return mesh where each primitive references at most max_vertices_count vertices
+    /// (larger primitives are split into several primitives of the same material; shared vertices are duplicated)
+    Mesh split(uint32_t max_vertices_count) const;
+
     /// Clear all data
     void clear();
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 
@@ -33,4 +34,53 @@ class Image
     std::shared_ptr<Impl> impl;
 };
 
+/// Block compression format (blocks of 4x4 pixels)
+enum CompressionFormat
+{
+  CompressionFormat_BC1, //RGB, 8 bytes per block (DXT1)
+  CompressionFormat_BC3, //RGBA, 16 bytes per block (DXT5)
+  CompressionFormat_BC4, //R, 8 bytes per block (RGTC1)
+  CompressionFormat_BC5, //RG, 16 bytes per block (RGTC2, tangent space normal maps)
+
+  CompressionFormat_Num
+};
+
+/// Block compressed image with mip chain
+class CompressedImage
+{
+  public:
+    /// Constants
+    static constexpr unsigned int BLOCK_SIZE = 4; //block width and height in pixels
+
+    /// Compress image and its box filtered mip chain (mips count is clamped to the full chain)
+    CompressedImage(const Image& image, CompressionFormat format, size_t mips_count = (size_t)-1);
+
+    /// Compression format
+    CompressionFormat format() const;
+
+    /// Mips count
+    size_t mips_count() const;
+
+    /// Level dimensions
+    unsigned int width(size_t level = 0) const;
+    unsigned int height(size_t level = 0) const;
+
+    /// Level data
+    const void* data(size_t level) const;
+    size_t data_size(size_t level) const;
+
+    /// Size of a block in bytes
+    static size_t block_bytes(CompressionFormat format);
+
+    /// Size of compressed level in bytes
+    static size_t level_bytes(CompressionFormat format, unsigned int width, unsigned int height);
+
+  private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+/// Decompress blocks of a level to RGBA8 pixels (missing channels are decoded as in OpenGL: 0 for G and B, 255 for A)
+void decompress(CompressionFormat format, unsigned int width, unsigned int height, const void* data, Color* pixels);
+
 }}}
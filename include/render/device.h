@@ -19,11 +19,19 @@ class Window;
 
 }
 
+namespace common {
+
+//forward declarations
+class ThreadPool;
+
+}
+
 namespace render {
 namespace low_level {
 
 using application::Window;
 using media::geometry::Vertex;
+using media::geometry::PackedVertex;
 using media::geometry::PrimitiveType;
 using common::PropertyType;
 using common::Property;
@@ -36,6 +44,7 @@ struct ShaderImpl;
 struct TextureLevelInfo;
 struct RenderBufferInfo;
 struct ProgramParameter;
+struct ProgramUniformBlock;
 
 typedef std::shared_ptr<DeviceContextImpl> DeviceContextPtr;
 
@@ -55,6 +64,7 @@ enum ClearFlags
 enum ShaderType
 {
   ShaderType_Vertex, //vertex shader
+  ShaderType_Geometry, //geometry shader
   ShaderType_Pixel, //pixel shader
 };
 
@@ -64,6 +74,48 @@ enum PixelFormat
   PixelFormat_RGBA8,
   PixelFormat_RGB16F,
   PixelFormat_D24,
+  PixelFormat_BC1, //block compressed RGB (DXT1)
+  PixelFormat_BC3, //block compressed RGBA (DXT5)
+  PixelFormat_BC4, //block compressed R (RGTC1)
+  PixelFormat_BC5, //block compressed RG (RGTC2, tangent space normal maps with reconstructed Z)
+};
+
+/// Buffer usage hint
+enum BufferUsage
+{
+  BufferUsage_Static, //data is loaded once and used for many frames
+  BufferUsage_Dynamic, //data is updated from time to time (full updates orphan the previous storage)
+  BufferUsage_Stream, //data is regenerated every frame (full updates orphan the previous storage)
+
+  BufferUsage_Num
+};
+
+/// Vertex format
+enum VertexFormat
+{
+  VertexFormat_Float, //Vertex (float attributes)
+  VertexFormat_Packed, //PackedVertex (normalized normal & color, half float texture coordinates)
+  VertexFormat_Position, //math::vec3f position stream (for depth-only programs)
+
+  VertexFormat_Num
+};
+
+/// Index format
+enum IndexFormat
+{
+  IndexFormat_UInt16, //16-bit indices
+  IndexFormat_UInt32, //32-bit indices
+
+  IndexFormat_Num
+};
+
+/// Texture type
+enum TextureType
+{
+  TextureType_2D, //2D texture
+  TextureType_2DArray, //array of 2D textures
+
+  TextureType_Num
 };
 
 /// Texture filter
@@ -106,6 +158,25 @@ enum BlendArgument
   BlendArgument_Num
 };
 
+/// Ordering of draws inside of a pass
+enum PassSortMode
+{
+  PassSortMode_None, //insertion order
+  PassSortMode_State, //minimize state changes (material, buffers), then front to back
+  PassSortMode_FrontToBack, //by view depth, nearest first (early depth rejection)
+  PassSortMode_BackToFront, //by view depth, farthest first (blending)
+
+  PassSortMode_Num
+};
+
+/// Device backend
+enum DeviceBackend
+{
+  DeviceBackend_OpenGL, //hardware OpenGL driver
+  DeviceBackend_Null, //headless stub driver which accepts all calls without rendering (for CPU profiling)
+  DeviceBackend_Software, //headless multithreaded CPU rasterizer (G-buffer, shadow and deferred lighting programs)
+};
+
 /// Viewport
 struct Viewport
 {
@@ -120,7 +191,10 @@ class Texture
 {
   public:
     /// Constructor
-    Texture(const DeviceContextPtr& context, size_t width, size_t height, size_t layers, PixelFormat format, size_t mips_count = (size_t)-1);
+    Texture(const DeviceContextPtr& context, TextureType type, size_t width, size_t height, size_t layers, PixelFormat format, size_t mips_count = (size_t)-1);
+
+    /// Texture type
+    TextureType type() const;
 
     /// Texture width
     size_t width() const;
@@ -152,6 +226,18 @@ class Texture
     /// Set texture data
     void set_data(size_t layer, size_t x, size_t y, size_t width, size_t height, const void* data);
 
+    /// Set texture data asynchronously (data is copied and transferred within upload budget of the next frames)
+    void set_data_async(size_t layer, size_t x, size_t y, size_t width, size_t height, const void* data);
+
+    /// Set data of a whole mip level (the only way to update block compressed textures)
+    void set_level_data(size_t layer, size_t level, const void* data);
+
+    /// Set data of a whole mip level asynchronously
+    void set_level_data_async(size_t layer, size_t level, const void* data);
+
+    /// Check whether all asynchronous uploads of the texture have been completed
+    bool is_ready() const;
+
     /// Get texture data
     void get_data(size_t layer, size_t x, size_t y, size_t width, size_t height, void* data);
 
@@ -191,6 +277,9 @@ class TextureList
     /// Get texture by name or throw exception
     Texture& get(const char* name) const;
 
+    /// Layout identifier; changes when textures are inserted or removed and is unique across all lists
+    size_t layout_id() const;
+
   private:
     struct Impl;
     std::shared_ptr<Impl> impl;
@@ -209,6 +298,9 @@ class Material
     /// Properties
     const PropertyMap& properties() const;
 
+    /// Unique identifier (for draws sorting)
+    size_t id() const;
+
   private:
     struct Impl;
     std::shared_ptr<Impl> impl;
@@ -272,6 +364,9 @@ class FrameBuffer
     /// Constructor
     FrameBuffer(const DeviceContextPtr& context, const Window& window);
 
+    /// Window frame buffer stub of headless device context
+    FrameBuffer(const DeviceContextPtr& context, size_t width, size_t height);
+
     /// Set viewport
     void set_viewport(const Viewport& viewport);
 
@@ -299,58 +394,102 @@ class FrameBuffer
     /// Attach render buffer
     void attach_depth_buffer(const RenderBuffer& render_buffer);
 
+    /// Attach all layers of texture array as depth buffer (layer is selected by gl_Layer of geometry shader)
+    void attach_layered_depth_buffer(const Texture& texture, size_t mip_level = 0);
+
     /// Detach depth buffer
     void detach_depth_buffer();
 
     /// Bind framebuffer for rendering to a context
     void bind() const;
 
+    /// Copy depth region of the source frame buffer (this frame buffer is left bound)
+    void copy_depth(const FrameBuffer& source, const Viewport& source_rect, const Viewport& target_rect) const;
+
   private:
     struct Impl;
     std::shared_ptr<Impl> impl;
 };
 
 /// Vertex buffer
-/// (simplification: no streams and layouts)
+/// (simplification: layout is defined by a vertex format; a primitive has a main stream and a position stream)
 class VertexBuffer
 {
   public:
     /// Constructor
-    VertexBuffer(const DeviceContextPtr& context, size_t vertices_count);
+    VertexBuffer(const DeviceContextPtr& context, size_t vertices_count, VertexFormat format = VertexFormat_Float, BufferUsage usage = BufferUsage_Static);
 
     /// Vertices count
     size_t vertices_count() const;
 
-    /// Load data
+    /// Vertices format
+    VertexFormat format() const;
+
+    /// Load data (data type must match buffer format)
     void set_data(size_t offset, size_t count, const Vertex* vertices);
+    void set_data(size_t offset, size_t count, const PackedVertex* vertices);
+    void set_data(size_t offset, size_t count, const math::vec3f* positions);
 
     /// Bind buffer
     void bind() const;
 
+    /// Unique identifier (for draws sorting)
+    size_t id() const;
+
   private:
     std::shared_ptr<BufferImpl> impl;
+    VertexFormat vertex_format;
 };
 
 /// Index buffer
 class IndexBuffer
 {
   public:
-    typedef media::geometry::Mesh::index_type index_type;
-
     /// Constructor
-    IndexBuffer(const DeviceContextPtr& context, size_t indices_count);
+    IndexBuffer(const DeviceContextPtr& context, size_t indices_count, IndexFormat format = IndexFormat_UInt16, BufferUsage usage = BufferUsage_Static);
 
     /// Indices count
     size_t indices_count() const;
 
-    /// Load data
-    void set_data(size_t offset, size_t count, const index_type* indices);
+    /// Indices format
+    IndexFormat format() const;
+
+    /// Load data (data type must match buffer format)
+    void set_data(size_t offset, size_t count, const uint16_t* indices);
+    void set_data(size_t offset, size_t count, const uint32_t* indices);
 
     /// Bind buffer
     void bind() const;
 
+    /// Unique identifier (for draws sorting)
+    size_t id() const;
+
   private:
     std::shared_ptr<BufferImpl> impl;
+    IndexFormat index_format;
+};
+
+/// Allocator of geometry which is regenerated every frame (debug & procedural geometry);
+/// ranges are suballocated from a ring of stream buffers which are fenced per frame, so uploads don't wait for draws of previous frames
+class GeometryStream
+{
+  public:
+    /// Constructor (capacities are per frame; buffers grow if a frame needs more)
+    GeometryStream(const DeviceContextPtr& context,
+                   size_t vertices_capacity,
+                   size_t indices_capacity,
+                   VertexFormat vertex_format = VertexFormat_Float,
+                   IndexFormat index_format = IndexFormat_UInt16);
+
+    /// Allocate vertices for the current frame; data is loaded with VertexBuffer::set_data starting from first_vertex
+    VertexBuffer allocate_vertices(size_t count, size_t& first_vertex);
+
+    /// Allocate indices for the current frame (first_index is aligned to triangles); data is loaded with IndexBuffer::set_data
+    IndexBuffer allocate_indices(size_t count, size_t& first_index);
+
+  private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
 };
 
 /// Shader
@@ -379,6 +518,7 @@ class Program
   public:
     /// Constructor
     Program(const DeviceContextPtr& context, const char* name, const Shader& vertex_shader, const Shader& pixel_shader);
+    Program(const DeviceContextPtr& context, const char* name, const Shader& vertex_shader, const Shader& geometry_shader, const Shader& pixel_shader);
 
     /// Name of the program
     const char* name() const;
@@ -401,6 +541,12 @@ class Program
     /// Parameters
     const ProgramParameter* parameters() const;
 
+    /// Number of uniform blocks
+    size_t uniform_blocks_count() const;
+
+    /// Uniform blocks (block index is used as uniform buffer binding point)
+    const ProgramUniformBlock* uniform_blocks() const;
+
     /// Bind
     void bind() const;
 
@@ -417,6 +563,7 @@ struct Primitive
   size_t first; //first primitive
   size_t count; //number of primitives for rendering
   VertexBuffer vertex_buffer; //vertex buffer
+  VertexBuffer position_buffer; //buffer bound for programs which use only positions (vertex buffer if there is no separate position stream)
   IndexBuffer index_buffer; //index buffer
   Material material; //material
 
@@ -432,6 +579,26 @@ struct Primitive
     , first(first)
     , count(count)
     , vertex_buffer(vb)
+    , position_buffer(vb)
+    , index_buffer(ib)
+    , material(material)
+  {
+  }
+
+  Primitive(const Material& material,
+            PrimitiveType type,
+            const VertexBuffer& vb,
+            const VertexBuffer& position_vb,
+            const IndexBuffer& ib,
+            size_t first,
+            size_t count,
+            size_t base_vertex = 0)
+    : type(type)
+    , base_vertex(base_vertex)
+    , first(first)
+    , count(count)
+    , vertex_buffer(vb)
+    , position_buffer(position_vb)
     , index_buffer(ib)
     , material(material)
   {
@@ -457,7 +624,11 @@ class Mesh
 {
   public:
     /// Constructor
-    Mesh(const DeviceContextPtr& context, const media::geometry::Mesh& mesh, const MaterialList& materials);
+    Mesh(const DeviceContextPtr& context,
+         const media::geometry::Mesh& mesh,
+         const MaterialList& materials,
+         VertexFormat vertex_format = VertexFormat_Packed,
+         bool position_stream = true);
 
     /// Primitives count
     size_t primitives_count() const;
@@ -556,6 +727,9 @@ class BindingContext
     const PropertyMap* properties = nullptr;
 };
 
+//forward declarations
+class DrawList;
+
 /// Pass
 class Pass
 {
@@ -571,6 +745,24 @@ class Pass
     /// Frame buffer
     FrameBuffer& frame_buffer() const;
 
+    /// Set viewport of the pass (overrides viewport of the frame buffer; clearing is limited to the viewport)
+    void set_viewport(const Viewport& viewport);
+
+    /// Use viewport of the frame buffer
+    void reset_viewport();
+
+    /// Viewport of the pass
+    const Viewport& viewport() const;
+
+    /// Set viewports selected by gl_ViewportIndex of geometry shader (the first one is the viewport of the pass)
+    void set_viewports(const Viewport* viewports, size_t count);
+
+    /// Initialize depth of the pass viewport with the region of the source frame buffer instead of clearing it
+    void set_depth_source(const FrameBuffer& frame_buffer, const Viewport& rect);
+
+    /// Clear depth according to clear flags
+    void reset_depth_source();
+
     /// Set program
     void set_program(const Program& program);
 
@@ -601,6 +793,22 @@ class Pass
     /// Get blend state
     const BlendState& blend_state() const;
 
+    /// Set draws ordering
+    void set_sort_mode(PassSortMode mode);
+
+    /// Get draws ordering
+    PassSortMode sort_mode() const;
+
+    /// Enable counting of samples which pass depth test (occlusion query)
+    void set_samples_counting(bool enabled);
+
+    /// Is samples counting enabled
+    bool samples_counting() const;
+
+    /// Number of samples which passed depth test during the latest counted rendering
+    /// results are read without waiting for the GPU, so they lag behind rendering by a few frames
+    size_t samples_passed() const;
+
     /// Pass properties
     PropertyMap& properties() const;
 
@@ -614,6 +822,7 @@ class Pass
     static common::PropertyMap& default_primitive_properties();
 
     /// Add primitive to a pass
+    /// primitive resources and properties are referenced without copying, so they must be alive until Pass::render
     void add_primitive(
       const Primitive& primitive,
       const math::mat4f& model_tm = math::mat4f(1.0f),
@@ -625,6 +834,10 @@ class Pass
       const math::mat4f& model_tm = math::mat4f(1.0f),
       const common::PropertyMap& properties = default_primitive_properties());
 
+    /// Add primitives of a draw list to a pass; packets are linked without copying and the list storage
+    /// is retained by the pass until Pass::render (the list may be added to only one pass before DrawList::clear)
+    void add_draw_list(DrawList& list);
+
     /// Remove all primitives from the pass
     /// will be automaticall called after the Pass::render
     void remove_all_primitives();
@@ -643,15 +856,73 @@ class Pass
     std::shared_ptr<Impl> impl;
 };
 
+/// Draw list; records draws without any rendering API calls so separate lists may be filled concurrently
+/// from worker threads and then merged to a pass with Pass::add_draw_list on the rendering thread
+class DrawList
+{
+  public:
+    /// Constructor
+    DrawList();
+
+    /// Number of added primitives
+    size_t primitives_count() const;
+
+    /// Add primitive to a list
+    /// primitive resources and properties are referenced without copying, so they must be alive until Pass::render
+    void add_primitive(
+      const Primitive& primitive,
+      const math::mat4f& model_tm = math::mat4f(1.0f),
+      const common::PropertyMap& properties = Pass::default_primitive_properties());
+
+    /// Add mesh to a list
+    void add_mesh(
+      const Mesh& mesh,
+      const math::mat4f& model_tm = math::mat4f(1.0f),
+      const common::PropertyMap& properties = Pass::default_primitive_properties());
+
+    /// Remove all primitives from the list
+    void clear();
+
+  private:
+    friend class Pass;
+
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
 /// Device options
 struct DeviceOptions
 {
   bool vsync; //vertical synchronization enabled
   bool debug; //should we check OpenGL errors and output debug messages
+  DeviceBackend backend; //driver backend
+  std::string trace_file_name; //file for commands trace recording (empty - no recording)
+  bool multi_draw_indirect; //use multi draw indirect submission if it's supported by the driver
+  VertexFormat mesh_vertex_format; //vertex format of meshes created by the device
+  bool mesh_position_streams; //create separate position streams for meshes (depth-only programs fetch positions only)
+  size_t texture_upload_budget; //bytes of asynchronous texture uploads transferred per frame
 
   DeviceOptions()
     : vsync(true)
     , debug(true)
+    , backend(DeviceBackend_OpenGL)
+    , multi_draw_indirect(true)
+    , mesh_vertex_format(VertexFormat_Packed)
+    , mesh_position_streams(true)
+    , texture_upload_budget(4 * 1024 * 1024)
+  {
+  }
+};
+
+/// Render state cache statistics
+struct StateCacheStatistics
+{
+  size_t issued_commands_count; //number of state commands passed to the driver
+  size_t filtered_commands_count; //number of redundant state commands which have been filtered
+
+  StateCacheStatistics()
+    : issued_commands_count()
+    , filtered_commands_count()
   {
   }
 };
@@ -663,9 +934,19 @@ class Device
     /// Constructor
     Device(const Window& window, const DeviceOptions& options);
 
+    /// Constructor of headless device for null and software backends (no window and GL context are created)
+    Device(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options);
+
+    /// Has window (false for headless device)
+    bool has_window() const;
+
     /// Window
     Window& window() const;
 
+    /// Size of the window frame buffer
+    int frame_buffer_width() const;
+    int frame_buffer_height() const;
+
     /// Window frame buffer
     FrameBuffer& window_frame_buffer() const;
 
@@ -673,19 +954,29 @@ class Device
     FrameBuffer create_frame_buffer();
 
     /// Create vertex buffer
-    VertexBuffer create_vertex_buffer(size_t count);
+    VertexBuffer create_vertex_buffer(size_t count, VertexFormat format = VertexFormat_Float, BufferUsage usage = BufferUsage_Static);
 
     /// Create index buffer
-    IndexBuffer create_index_buffer(size_t count);
+    IndexBuffer create_index_buffer(size_t count, IndexFormat format = IndexFormat_UInt16, BufferUsage usage = BufferUsage_Static);
+
+    /// Create streaming geometry allocator
+    GeometryStream create_geometry_stream(size_t vertices_capacity,
+                                          size_t indices_capacity,
+                                          VertexFormat vertex_format = VertexFormat_Float,
+                                          IndexFormat index_format = IndexFormat_UInt16);
 
     /// Create vertex shader
     Shader create_vertex_shader(const char* name, const char* source_code);
 
+    /// Create geometry shader
+    Shader create_geometry_shader(const char* name, const char* source_code);
+
     /// Create pixel shader
     Shader create_pixel_shader(const char* name, const char* source_code);
 
     /// Create program
     Program create_program(const char* name, const Shader& vertex_shader, const Shader& pixel_shader);
+    Program create_program(const char* name, const Shader& vertex_shader, const Shader& geometry_shader, const Shader& pixel_shader);
 
     /// Create program from source code
     Program create_program_from_source(const char* name, const char* source_code);
@@ -711,12 +1002,73 @@ class Device
     /// Create texture2d
     Texture create_texture2d(size_t width, size_t height, PixelFormat format, size_t mips_count = 100);
 
-    /// Load texture2d
+    /// Create array of 2D textures (layers are sampled with sampler2DArray and attached to frame buffers separately)
+    Texture create_texture2d_array(size_t width, size_t height, size_t layers, PixelFormat format, size_t mips_count = 100);
+
+    /// Load texture2d (pixels are uploaded asynchronously, see Texture::is_ready)
     Texture create_texture2d(const char* image_path, size_t mips_count = 100);
 
+    /// Load texture2d with the format; mip chain of block compressed formats is encoded on load
+    Texture create_texture2d(const char* image_path, PixelFormat format, size_t mips_count = 100);
+
     /// Create render buffer
     RenderBuffer create_render_buffer(size_t width, size_t height, PixelFormat format);
 
+    /// Notify device about frame completion
+    void end_frame();
+
+    /// Render state cache statistics (accumulated since device creation)
+    const StateCacheStatistics& state_cache_statistics() const;
+
+    /// Worker threads for frame preparation jobs (the pool is not reentrant)
+    common::ThreadPool& thread_pool() const;
+
+  private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+/// Commands trace replaying statistics
+struct TraceStatistics
+{
+  size_t commands_count; //number of replayed commands
+  size_t draw_calls_count; //number of draw calls
+  size_t state_commands_count; //number of state change commands
+  size_t redundant_state_commands_count; //number of state change commands which set already active state
+  size_t uploaded_bytes; //number of bytes uploaded to buffers & textures
+
+  TraceStatistics()
+    : commands_count()
+    , draw_calls_count()
+    , state_commands_count()
+    , redundant_state_commands_count()
+    , uploaded_bytes()
+  {
+  }
+};
+
+/// Commands trace player (replays traces recorded with DeviceOptions::trace_file_name)
+class TracePlayer
+{
+  public:
+    /// Constructor
+    TracePlayer(const Window& window, const DeviceOptions& options, const char* trace_file_name);
+
+    /// Constructor of headless player for null and software backends
+    TracePlayer(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options, const char* trace_file_name);
+
+    /// Number of frames in trace
+    size_t frames_count() const;
+
+    /// Index of the frame after the last replayed one
+    size_t next_frame() const;
+
+    /// Replay frame (frames have to be replayed in order at least once to create objects used by the frame)
+    void play_frame(size_t frame_index, TraceStatistics* statistics = nullptr);
+
+    /// Replay next frames
+    void play_frames(size_t frames_count, TraceStatistics* statistics = nullptr);
+
   private:
     struct Impl;
     std::shared_ptr<Impl> impl;
@@ -3,6 +3,7 @@
 #include <render/device.h>
 #include <scene/camera.h>
 
+#include <functional>
 #include <memory>
 
 namespace engine {
@@ -22,6 +23,60 @@ class FrameNodeList;
 /// Frame identifier
 typedef size_t FrameId;
 
+/// Scene renderer options
+struct SceneRendererOptions
+{
+  bool depth_prepass; //fill G-buffer depth with a depth-only pass, so G-buffer targets are written once per pixel
+  bool front_to_back; //sort G-buffer draws front to back instead of by state (pre-pass is always sorted front to back)
+  size_t shadow_updates_per_frame; //max number of stale shadow maps updated per frame (0 - unlimited; new maps are always rendered)
+  bool shadow_receiver_culling; //skip shadow casters whose shadows can't land inside the camera frustum (shadow maps become view dependent)
+  size_t shadow_texel_budget; //max number of shadow map texels of all visible lights (0 - unlimited; each map keeps at least the minimal tier)
+  bool shadow_layered_rendering; //draw casters of all shadow maps with one layered pass; each caster is submitted once with the mask of affected maps
+
+  SceneRendererOptions()
+    : depth_prepass(false)
+    , front_to_back(false)
+    , shadow_updates_per_frame(0)
+    , shadow_receiver_culling(false)
+    , shadow_texel_budget(0)
+    , shadow_layered_rendering(false)
+  {
+  }
+};
+
+/// Scene renderer statistics (updated by scene passes; samples are counted with a few frames latency)
+struct SceneRendererStatistics
+{
+  size_t depth_prepass_samples_count; //number of samples which passed depth test in the depth pre-pass
+  size_t g_buffer_samples_count; //number of shaded G-buffer samples
+  size_t shadow_map_updates_count; //total number of rendered shadow maps
+  size_t shadow_map_skips_count; //total number of shadow maps which have been reused without rendering
+  size_t shadow_static_updates_count; //total number of static casters depth updates
+  size_t shadow_caster_draws_count; //total number of meshes drawn to shadow maps
+  size_t shadow_culled_casters_count; //total number of casters culled by light (and receivers) frustums
+  size_t shadow_caster_passes_count; //total number of passes which draw shadow casters
+  size_t shadow_map_texels_count; //number of shadow map texels of visible lights in the last frame
+
+  SceneRendererStatistics()
+    : depth_prepass_samples_count()
+    , g_buffer_samples_count()
+    , shadow_map_updates_count()
+    , shadow_map_skips_count()
+    , shadow_static_updates_count()
+    , shadow_caster_draws_count()
+    , shadow_culled_casters_count()
+    , shadow_caster_passes_count()
+    , shadow_map_texels_count()
+  {
+  }
+
+  /// Number of G-buffer samples which would be shaded without the depth pre-pass but have been rejected by it
+  size_t saved_g_buffer_samples_count() const
+  {
+    return depth_prepass_samples_count > g_buffer_samples_count ? depth_prepass_samples_count - g_buffer_samples_count : 0;
+  }
+};
+
 /// Rendering scene passes context
 class ScenePassContext
 {
@@ -44,6 +99,12 @@ class ScenePassContext
     /// Frame properties
     common::PropertyMap& properties() const;
 
+    /// Renderer options
+    const SceneRendererOptions& options() const;
+
+    /// Renderer statistics
+    SceneRendererStatistics& statistics() const;
+
     /// Frame textures
     low_level::TextureList& textures() const;
 
@@ -74,6 +135,13 @@ class ScenePassContext
     /// View & projection TM
     const math::mat4f& view_projection_tm() const;
 
+    /// Draws recorder; runs on a worker thread so it may only fill the draw list (no rendering resources creation)
+    typedef std::function<void (low_level::DrawList&)> DrawsRecorder;
+
+    /// Schedule draws recording for a pass; recorders of all scene passes are run concurrently
+    /// and their draw lists are added to passes in the scheduling order before frame nodes rendering
+    void record_draws(const low_level::Pass& pass, const DrawsRecorder& recorder);
+
   protected:
     /// Constructor
     ScenePassContext(ISceneRenderer&);
@@ -82,6 +150,9 @@ class ScenePassContext
     void bind(const low_level::BindingContext*);
     void unbind(const low_level::BindingContext*);
 
+    /// Run scheduled draws recorders and add recorded draws to passes
+    void flush_draws();
+
   private:
     struct Impl;
     std::shared_ptr<Impl> impl;
@@ -223,11 +294,25 @@ class SceneRenderer
 {
   public:
     /// Constructor
-    SceneRenderer(const application::Window& window, const low_level::DeviceOptions& options);
+    SceneRenderer(const application::Window& window, const low_level::DeviceOptions& options,
+                  const SceneRendererOptions& renderer_options = SceneRendererOptions());
+
+    /// Constructor of headless renderer for null and software backends (no window and GL context are created)
+    SceneRenderer(size_t frame_buffer_width, size_t frame_buffer_height, const low_level::DeviceOptions& options,
+                  const SceneRendererOptions& renderer_options = SceneRendererOptions());
 
     /// Rendering device
     low_level::Device& device() const;
 
+    /// Renderer options
+    const SceneRendererOptions& options() const;
+
+    /// Set renderer options (applied from the next frame)
+    void set_options(const SceneRendererOptions& options);
+
+    /// Renderer statistics
+    const SceneRendererStatistics& statistics() const;
+
     /// Passes count
     size_t passes_count() const;
 
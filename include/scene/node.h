@@ -83,6 +83,9 @@ class Node : public std::enable_shared_from_this<Node>
     /// World space node transformations
     const math::mat4f& world_tm() const;
 
+    /// Version of world transformations (changes each time the node or its parents are moved)
+    size_t transform_version() const;
+
     /// Visit scene
     void traverse(ISceneVisitor&) const;
 
@@ -0,0 +1,24 @@
+#shader vertex
+#version 410 core
+
+layout(std140) uniform Camera
+{
+  mat4 viewProjectionMatrix;
+};
+
+in vec3 vPosition;
+in mat4 vInstanceModelMatrix;
+
+invariant gl_Position; // must match phong_gbuffer.glsl for the G-buffer depth test Equal
+
+void main()
+{
+  gl_Position = viewProjectionMatrix * (vInstanceModelMatrix * vec4(vPosition, 1.0));
+}
+
+#shader pixel
+#version 410 core
+
+void main()
+{
+}
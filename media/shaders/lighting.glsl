@@ -21,7 +21,7 @@ uniform sampler2D positionTexture;
 uniform sampler2D normalTexture;
 uniform sampler2D albedoTexture;
 uniform sampler2D specularTexture;
-uniform sampler2D shadowTexture;
+uniform sampler2DArray shadowTexture; // shadow atlas
 
 in vec2 texCoord;
 out vec4 outColor;
@@ -32,24 +32,29 @@ const float SPECULAR_AMOUNT = 1.0; // specular light multiplier
 const float SHININESS_NORMALIZER = 1000.0f; // workaround for RGBA8 precision for shininess
 
 #define MAX_POINT_LIGHTS 32
-#define MAX_SPOT_LIGHTS 2
+#define MAX_SPOT_LIGHTS 16
 
-uniform vec3 worldViewPosition;
-uniform vec2 shadowMapPixelSize;
-
-uniform vec3 spotLightPositions[MAX_SPOT_LIGHTS];
-uniform vec3 spotLightDirections[MAX_SPOT_LIGHTS];
-uniform vec3 spotLightColors[MAX_SPOT_LIGHTS];
-uniform vec3 spotLightAttenuations[MAX_SPOT_LIGHTS];
-uniform float spotLightRanges[MAX_SPOT_LIGHTS];
-uniform float spotLightAngles[MAX_SPOT_LIGHTS];
-uniform float spotLightExponents[MAX_SPOT_LIGHTS];
-uniform mat4 spotLightShadowMatrices[MAX_SPOT_LIGHTS];
-
-uniform vec3 pointLightPositions[MAX_POINT_LIGHTS];
-uniform vec3 pointLightColors[MAX_POINT_LIGHTS];
-uniform vec3 pointLightAttenuations[MAX_POINT_LIGHTS];
-uniform float pointLightRanges[MAX_POINT_LIGHTS];
+layout(std140) uniform Lights
+{
+  vec3 worldViewPosition;
+  vec2 shadowMapPixelSize;
+
+  vec3 spotLightPositions[MAX_SPOT_LIGHTS];
+  vec3 spotLightDirections[MAX_SPOT_LIGHTS];
+  vec3 spotLightColors[MAX_SPOT_LIGHTS];
+  vec3 spotLightAttenuations[MAX_SPOT_LIGHTS];
+  float spotLightRanges[MAX_SPOT_LIGHTS];
+  float spotLightAngles[MAX_SPOT_LIGHTS];
+  float spotLightExponents[MAX_SPOT_LIGHTS];
+  mat4 spotLightShadowMatrices[MAX_SPOT_LIGHTS];
+  vec4 spotLightShadowRects[MAX_SPOT_LIGHTS]; // offset (xy) and scale (zw) of the shadow map in the atlas layer
+  float spotLightShadowLayers[MAX_SPOT_LIGHTS];
+
+  vec3 pointLightPositions[MAX_POINT_LIGHTS];
+  vec3 pointLightColors[MAX_POINT_LIGHTS];
+  vec3 pointLightAttenuations[MAX_POINT_LIGHTS];
+  float pointLightRanges[MAX_POINT_LIGHTS];
+};
 
 vec3 ComputeDiffuseColor(const in vec3 normal, const in vec3 lightDir, const in vec3 texDiffuseColor)
 {
@@ -63,9 +68,15 @@ vec3 ComputeSpecularColor(const in vec3 normal, const in vec3 lightDir, const in
   return texSpecularColor * specularFactor;
 }
 
-float OffsetLookup(vec4 shadowTexCoord, vec2 offset)
+float OffsetLookup(vec4 shadowTexCoord, vec4 shadowRect, float shadowLayer, vec2 offset)
 {
-  float shadowDepth = texture(shadowTexture, shadowTexCoord.xy + offset * shadowMapPixelSize * shadowTexCoord.w).x + 0.0001;
+  // samples are clamped to the shadow map region so neighbour maps of the atlas aren't fetched
+  vec2 halfPixelSize = shadowMapPixelSize * 0.5;
+  vec2 uv = shadowRect.xy + shadowTexCoord.xy * shadowRect.zw + offset * shadowMapPixelSize * shadowTexCoord.w;
+
+  uv = clamp(uv, shadowRect.xy + halfPixelSize, shadowRect.xy + shadowRect.zw - halfPixelSize);
+
+  float shadowDepth = texture(shadowTexture, vec3(uv, shadowLayer)).x + 0.0001;
 
   if (shadowDepth < shadowTexCoord.z)
   {
@@ -75,7 +86,7 @@ float OffsetLookup(vec4 shadowTexCoord, vec2 offset)
   return 1.0;
 }
 
-float PCF(in vec4 shadowTexCoord)
+float PCF(in vec4 shadowTexCoord, in vec4 shadowRect, in float shadowLayer)
 {
   float sum = 0.0;
   float y = -1.5;
@@ -87,7 +98,7 @@ float PCF(in vec4 shadowTexCoord)
     float x = -1.5;
 
     for (int j=0; j<STEPS_COUNT; j++, x+= 1.5)
-      sum += OffsetLookup(shadowTexCoord, vec2(x, y));
+      sum += OffsetLookup(shadowTexCoord, shadowRect, shadowLayer, vec2(x, y));
   }
 
   return sum / float (STEPS_COUNT * STEPS_COUNT);
@@ -156,7 +167,7 @@ void main()
             shadowTexCoord.y >= 0.0 &&
             shadowTexCoord.y <= 1.0)
         {
-          shadowAttenuation = PCF(shadowTexCoord);
+          shadowAttenuation = PCF(shadowTexCoord, spotLightShadowRects[i], spotLightShadowLayers[i]);
         }
       }
      
@@ -182,7 +193,7 @@ void main()
     //vec4 specular = texture(specularTexture, vec2((texCoord.x - 0.5) * 2.0, texCoord.y * 2.0));
 
     //outColor = vec4(specular.xyz, 1.f);
-    vec4 shadow = texture(shadowTexture, vec2((texCoord.x - 0.5) * 2.0, texCoord.y * 2.0));
+    vec4 shadow = texture(shadowTexture, vec3((texCoord.x - 0.5) * 2.0, texCoord.y * 2.0, 0.0));
 
     outColor = vec4(shadow.x) * 0.5;
   }
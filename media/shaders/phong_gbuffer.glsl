@@ -1,27 +1,31 @@
 #shader vertex
 #version 410 core
 
-uniform mat4 MVP;
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 modelViewMatrix;
-uniform vec3 worldViewPosition;
+layout(std140) uniform Camera
+{
+  mat4 viewProjectionMatrix;
+  vec3 worldViewPosition;
+};
+
 in vec4 vColor;
 in vec3 vPosition;
 in vec3 vNormal;
 in vec2 vTexCoord;
+in mat4 vInstanceModelMatrix;
 out vec4 position;
 out vec4 eyeDirection;
 out vec4 normal;
 out vec4 color;
 out vec2 texCoord;
 
+invariant gl_Position; // must match depth.glsl for the depth test Equal after depth pre-pass
+
 void main()
 {
-  gl_Position = MVP * vec4(vPosition, 1.0);
-  position = modelMatrix * vec4(vPosition, 1.0);
+  position = vInstanceModelMatrix * vec4(vPosition, 1.0);
+  gl_Position = viewProjectionMatrix * position;
   eyeDirection = vec4(worldViewPosition - position.xyz, 0.0);
-  normal = modelMatrix * vec4 (vNormal, 0.0);
+  normal = vInstanceModelMatrix * vec4 (vNormal, 0.0);
   color = vColor;
   texCoord = vTexCoord;
 }
@@ -45,7 +49,11 @@ in vec2 texCoord;
 uniform sampler2D diffuseTexture;
 uniform sampler2D normalTexture;
 uniform sampler2D specularTexture;
-uniform float shininess;
+
+layout(std140) uniform Material
+{
+  float shininess;
+};
 
 mat3 CotangentFrame(const in vec3 N, const in vec3 p, const in vec2 uv)
 {
@@ -75,6 +83,10 @@ void main()
 
   vec3 mappedNormal = texture(normalTexture, texCoord).xyz * 2.0 - 1.0;
 
+  // two-channel normal maps (BC5 / RGTC2) have zero blue channel, so Z is reconstructed
+  if (mappedNormal.z <= -1.0)
+    mappedNormal.z = sqrt(max(1.0 - dot(mappedNormal.xy, mappedNormal.xy), 0.0));
+
   mappedNormal = normalize(tbn * mappedNormal);
 
   outPosition = position.xyz;
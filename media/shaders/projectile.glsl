@@ -21,15 +21,23 @@ layout(location = 1) out vec3 outNormal;
 uniform vec2 shadowMapPixelSize;
 uniform sampler2D positionTexture;
 uniform sampler2D projectileTexture;
-uniform sampler2D shadowTexture;
+uniform sampler2DArray shadowTexture; // shadow atlas
 uniform mat4 shadowMatrix;
+uniform vec4 shadowRect; // offset (xy) and scale (zw) of the shadow map in the atlas layer
+uniform float shadowLayer;
 uniform vec3 projectileColor;
 
 in vec2 texCoord;
 
 float OffsetLookup(vec4 shadowTexCoord, vec2 offset)
 {
-  float shadowDepth = texture(shadowTexture, shadowTexCoord.xy + offset * shadowMapPixelSize * shadowTexCoord.w).x + 0.0001;
+  // samples are clamped to the shadow map region so neighbour maps of the atlas aren't fetched
+  vec2 halfPixelSize = shadowMapPixelSize * 0.5;
+  vec2 uv = shadowRect.xy + shadowTexCoord.xy * shadowRect.zw + offset * shadowMapPixelSize * shadowTexCoord.w;
+
+  uv = clamp(uv, shadowRect.xy + halfPixelSize, shadowRect.xy + shadowRect.zw - halfPixelSize);
+
+  float shadowDepth = texture(shadowTexture, vec3(uv, shadowLayer)).x + 0.0001;
 
   if (shadowDepth < shadowTexCoord.z)
   {
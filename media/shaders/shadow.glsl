@@ -1,12 +1,17 @@
 #shader vertex
 #version 410 core
 
-uniform mat4 MVP;
+layout(std140) uniform Camera
+{
+  mat4 viewProjectionMatrix;
+};
+
 in vec3 vPosition;
+in mat4 vInstanceModelMatrix;
 
 void main()
 {
-  gl_Position = MVP * vec4(vPosition, 1.0);
+  gl_Position = viewProjectionMatrix * (vInstanceModelMatrix * vec4(vPosition, 1.0));
 }
 
 #shader pixel
@@ -0,0 +1,59 @@
+#shader vertex
+#version 410 core
+
+in vec3 vPosition;
+in mat4 vInstanceModelMatrix;
+
+flat out int vViewsMask;
+
+void main()
+{
+  mat4 model_tm = vInstanceModelMatrix;
+
+    //mask of views which the caster affects is packed into the unused element of the model matrix
+
+  vViewsMask = int(model_tm[0][3]);
+  model_tm[0][3] = 0.0;
+
+  gl_Position = model_tm * vec4(vPosition, 1.0);
+}
+
+#shader geometry
+#version 410 core
+
+#define MAX_SHADOW_VIEWS 16
+
+layout(triangles, invocations = MAX_SHADOW_VIEWS) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+uniform mat4 shadowViewProjectionMatrices[MAX_SHADOW_VIEWS];
+uniform float shadowViewLayers[MAX_SHADOW_VIEWS];
+uniform int shadowViewsCount;
+
+flat in int vViewsMask[];
+
+void main()
+{
+  int view = gl_InvocationID;
+
+  if (view >= shadowViewsCount || (vViewsMask[0] & (1 << view)) == 0)
+    return;
+
+  for (int i=0; i<3; i++)
+  {
+    gl_Position = shadowViewProjectionMatrices[view] * gl_in[i].gl_Position;
+    gl_Layer = int(shadowViewLayers[view]);
+    gl_ViewportIndex = view;
+
+    EmitVertex();
+  }
+
+  EndPrimitive();
+}
+
+#shader pixel
+#version 410 core
+
+void main()
+{
+}
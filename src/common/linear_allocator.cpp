@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstdint>
+
+#include <common/linear_allocator.h>
+#include <common/exception.h>
+
+namespace engine {
+namespace common {
+
+LinearAllocator::LinearAllocator(size_t chunk_size)
+  : chunk_size(chunk_size)
+  , current_chunk()
+  , current_offset()
+  , allocated_bytes()
+{
+  engine_check(chunk_size > 0);
+}
+
+void LinearAllocator::add_chunk(size_t min_size)
+{
+  size_t size = std::max(chunk_size, min_size);
+
+  Chunk chunk;
+
+  chunk.data.reset(new char[size]);
+  chunk.size = size;
+
+  chunks.push_back(std::move(chunk));
+}
+
+void* LinearAllocator::allocate(size_t size, size_t alignment)
+{
+  engine_check(alignment && !(alignment & (alignment - 1)));
+
+  for (;;)
+  {
+    if (current_chunk < chunks.size())
+    {
+      Chunk& chunk = chunks[current_chunk];
+      uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+      size_t offset = ((base + current_offset + alignment - 1) & ~uintptr_t(alignment - 1)) - base;
+
+      if (offset + size <= chunk.size)
+      {
+        current_offset = offset + size;
+        allocated_bytes += size;
+
+        return chunk.data.get() + offset;
+      }
+
+        //chunk is exhausted, move to the next one
+
+      if (current_chunk + 1 < chunks.size())
+      {
+        current_chunk++;
+        current_offset = 0;
+        continue;
+      }
+    }
+
+    add_chunk(size + alignment);
+
+    current_chunk = chunks.size() - 1;
+    current_offset = 0;
+  }
+}
+
+void LinearAllocator::reset()
+{
+    //coalesce chunks so the next frame with the same load is served from a single chunk
+
+  if (chunks.size() > 1)
+  {
+    size_t total_size = capacity();
+
+    chunks.clear();
+
+    add_chunk(total_size);
+  }
+
+  current_chunk = 0;
+  current_offset = 0;
+  allocated_bytes = 0;
+}
+
+void LinearAllocator::reserve(size_t size)
+{
+  if (capacity() >= size)
+    return;
+
+  if (!allocated_bytes)
+  {
+    chunks.clear();
+    add_chunk(size);
+    return;
+  }
+
+  add_chunk(size - capacity());
+}
+
+size_t LinearAllocator::allocated_size() const
+{
+  return allocated_bytes;
+}
+
+size_t LinearAllocator::capacity() const
+{
+  size_t result = 0;
+
+  for (const Chunk& chunk : chunks)
+    result += chunk.size;
+
+  return result;
+}
+
+}}
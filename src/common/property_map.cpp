@@ -2,17 +2,36 @@
 #include <common/named_dictionary.h>
 
 #include <vector>
+#include <atomic>
 
 using namespace engine::common;
 
 typedef std::vector<Property> PropertyArray;
 typedef NamedDictionary<size_t> PropertyDict;
 
+namespace
+{
+
+std::atomic<size_t> next_layout_id(1); //layout identifiers generator
+
+}
+
 /// Implementation details of property map
 struct PropertyMap::Impl
 {
   PropertyArray properties;
   PropertyDict dictionary;
+  size_t layout_id;
+
+  Impl()
+    : layout_id(next_layout_id++)
+  {
+  }
+
+  void update_layout()
+  {
+    layout_id = next_layout_id++;
+  }
 };
 
 PropertyMap::PropertyMap()
@@ -79,6 +98,8 @@ size_t PropertyMap::insert(const char* name, const Property& property)
   {
     impl->dictionary.insert(name, index);
 
+    impl->update_layout();
+
     return index;
   }
   catch (...)
@@ -100,10 +121,19 @@ void PropertyMap::erase(const char* name)
 
   impl->properties.erase(impl->properties.begin() + *index);
   impl->dictionary.erase(name);
+
+  impl->update_layout();
 }
 
 void PropertyMap::clear()
 {
   impl->properties.clear();
   impl->dictionary.clear();    
+
+  impl->update_layout();
+}
+
+size_t PropertyMap::layout_id() const
+{
+  return impl->layout_id;
 }
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <exception>
+
+#include <common/thread_pool.h>
+
+namespace engine {
+namespace common {
+
+ThreadPool::ThreadPool(size_t threads_count)
+  : job()
+  , jobs_count()
+  , next_job()
+  , active_workers()
+  , generation()
+  , stop()
+{
+  if (!threads_count)
+    threads_count = std::max(1u, std::thread::hardware_concurrency());
+
+  for (size_t i=1; i<threads_count; i++) //calling thread is a worker too
+    threads.emplace_back([this]() { worker(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop = true;
+  }
+
+  start_condition.notify_all();
+
+  for (auto& thread : threads)
+    thread.join();
+}
+
+void ThreadPool::parallel_for(size_t count, const Job& fn)
+{
+  if (!count)
+    return;
+
+  if (count == 1 || threads.empty())
+  {
+    for (size_t i=0; i<count; i++)
+      fn(i);
+
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    job = &fn;
+    jobs_count = count;
+    next_job = 0;
+    active_workers = threads.size();
+    error = nullptr;
+    generation++;
+  }
+
+  start_condition.notify_all();
+
+  run_jobs(fn, count);
+
+    //workers reference the job, so it has to be completed by all of them even if it has failed
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  finish_condition.wait(lock, [this]() { return active_workers == 0; });
+
+  job = nullptr;
+
+  if (error)
+  {
+    std::exception_ptr job_error = error;
+
+    error = nullptr;
+
+    std::rethrow_exception(job_error);
+  }
+}
+
+void ThreadPool::run_jobs(const Job& fn, size_t count)
+{
+  try
+  {
+    for (size_t index; (index = next_job++) < count;)
+      fn(index);
+  }
+  catch (...)
+  {
+      //the first error is reported by parallel_for; remaining jobs are skipped
+
+    next_job = count;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (!error)
+      error = std::current_exception();
+  }
+}
+
+void ThreadPool::worker()
+{
+  size_t last_generation = 0;
+
+  for (;;)
+  {
+    const Job* current_job = nullptr;
+    size_t count = 0;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      start_condition.wait(lock, [&]() { return stop || generation != last_generation; });
+
+      if (stop)
+        return;
+
+      last_generation = generation;
+      current_job = job;
+      count = jobs_count;
+    }
+
+    run_jobs(*current_job, count);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      if (!--active_workers)
+        finish_condition.notify_one();
+    }
+  }
+}
+
+}}
@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 
 using namespace engine::common;
 using namespace engine::render::scene;
@@ -44,6 +45,8 @@ const float LIGHTS_MIN_RANGE = 10.f;
 const float LIGHTS_MAX_RANGE = 50.f;
 const size_t MESHES_COUNT = 100;
 const float MESHES_POSITION_RADIUS = 3.f;
+const size_t HEADLESS_FRAME_BUFFER_WIDTH = 1280; //frame buffer size for null and software backends
+const size_t HEADLESS_FRAME_BUFFER_HEIGHT = 720;
 
 float frand()
 {
@@ -55,14 +58,100 @@ float crand(float min=-1.0f, float max=1.0f)
   return frand() * (max - min) + min;
 }
 
+void replay_trace(const char* file_name, const DeviceOptions& options, size_t frame, size_t repeat_count)
+{
+  Application app;
+
+    //null and software backends replay without window and GL context
+
+  std::unique_ptr<Window> window;
+  std::unique_ptr<TracePlayer> player_holder;
+
+  if (options.backend == DeviceBackend_OpenGL)
+  {
+    window = std::make_unique<Window>("Trace replay");
+    player_holder = std::make_unique<TracePlayer>(*window, options, file_name);
+  }
+  else
+  {
+    player_holder = std::make_unique<TracePlayer>(HEADLESS_FRAME_BUFFER_WIDTH, HEADLESS_FRAME_BUFFER_HEIGHT, options, file_name);
+  }
+
+  TracePlayer& player = *player_holder;
+
+  if (frame >= player.frames_count())
+    throw Exception::format("Frame %u is out of trace frames range [0; %u)", frame, player.frames_count());
+
+    //replay frames before the measured one to create objects
+
+  player.play_frames(frame);
+
+  TraceStatistics statistics;
+
+  player.play_frame(frame, &statistics);
+
+  engine_log_info("Frame %u statistics:", frame);
+  engine_log_info("...commands:                 %u", statistics.commands_count);
+  engine_log_info("...draw calls:               %u", statistics.draw_calls_count);
+  engine_log_info("...state commands:           %u", statistics.state_commands_count);
+  engine_log_info("...redundant state commands: %u", statistics.redundant_state_commands_count);
+  engine_log_info("...uploaded bytes:           %u", statistics.uploaded_bytes);
+
+    //measure submission throughput
+
+  double start_time = Application::time();
+
+  for (size_t i=0; i<repeat_count; i++)
+    player.play_frame(frame);
+
+  double total_time = Application::time() - start_time;
+
+  engine_log_info("Frame %u has been replayed %u times: %.3fms per frame", frame, repeat_count, total_time * 1000.0 / repeat_count);
+}
+
 }
 
-int main(void)
+int main(int argc, char* argv[])
 {
   try
   {
     engine_log_info("Application has been started");
 
+      //command line parsing
+
+    DeviceOptions render_options;
+    SceneRendererOptions scene_render_options;
+    const char* replay_file_name = nullptr;
+    size_t replay_frame = 0, replay_repeat_count = 1;
+    bool compressed_textures = false;
+
+    for (int i=1; i<argc; i++)
+    {
+      if      (!strcmp(argv[i], "--null"))                   render_options.backend = DeviceBackend_Null;
+      else if (!strcmp(argv[i], "--software"))               render_options.backend = DeviceBackend_Software;
+      else if (!strcmp(argv[i], "--record") && i + 1 < argc) render_options.trace_file_name = argv[++i];
+      else if (!strcmp(argv[i], "--depth-prepass"))          scene_render_options.depth_prepass = true;
+      else if (!strcmp(argv[i], "--front-to-back"))          scene_render_options.front_to_back = true;
+      else if (!strcmp(argv[i], "--shadow-updates") && i + 1 < argc) scene_render_options.shadow_updates_per_frame = size_t(atoi(argv[++i]));
+      else if (!strcmp(argv[i], "--shadow-receiver-culling")) scene_render_options.shadow_receiver_culling = true;
+      else if (!strcmp(argv[i], "--shadow-texel-budget") && i + 1 < argc) scene_render_options.shadow_texel_budget = size_t(atoi(argv[++i])) * 1024;
+      else if (!strcmp(argv[i], "--layered-shadows"))        scene_render_options.shadow_layered_rendering = true;
+      else if (!strcmp(argv[i], "--float-vertices"))         render_options.mesh_vertex_format = VertexFormat_Float;
+      else if (!strcmp(argv[i], "--no-position-streams"))    render_options.mesh_position_streams = false;
+      else if (!strcmp(argv[i], "--texture-upload-budget") && i + 1 < argc) render_options.texture_upload_budget = size_t(atoi(argv[++i])) * 1024;
+      else if (!strcmp(argv[i], "--compressed-textures"))    compressed_textures = true;
+      else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replay_file_name = argv[++i];
+      else if (!strcmp(argv[i], "--frame") && i + 1 < argc)  replay_frame = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) replay_repeat_count = atoi(argv[++i]);
+      else throw Exception::format("Unknown command line argument '%s'", argv[i]);
+    }
+
+    if (replay_file_name)
+    {
+      replay_trace(replay_file_name, render_options, replay_frame, replay_repeat_count);
+      return 0;
+    }
+
       //components loading
 
     ComponentScope components("engine::render::scene::passes::*");
@@ -77,79 +166,88 @@ int main(void)
     math::vec3f camera_move_direction(0.f);
 
     Application app;
-    Window window("Render test");
 
-    window.set_keyboard_handler([&](Key key, bool pressed) {
-      math::vec3f direction_change;
+      //null and software backends render without window and GL context
 
-      bool camera_position_changed = false;
+    std::unique_ptr<Window> window;
 
-      switch (key)
-      {
-        case Key_Up:
-        case Key_W:
-          direction_change = math::vec3f(0.f,0.f,pressed ? 1.f : -1.f);
-          camera_position_changed = true;
-          break;
-        case Key_Down:
-        case Key_S:
-          direction_change = math::vec3f(0.f,0.f,pressed ? -1.f : 1.f);
-          camera_position_changed = true;
-          break;
-        case Key_Right:
-        case Key_D:
-          direction_change = math::vec3f(pressed ? -1.f : 1.f,0.f,0.f);
-          camera_position_changed = true;
-          break;
-        case Key_Left:
-        case Key_A:
-          direction_change = math::vec3f(pressed ? 1.f : -1.f,0.f,0.f);
-          camera_position_changed = true;
-          break;
-        case Key_Escape:
-          engine_log_info("Escape pressed. Exiting...");
-          window.close();
-          break;
-        default:
-          break;
-      }
-
-      camera_move_direction += direction_change;
-    });
+    if (render_options.backend == DeviceBackend_OpenGL)
+      window = std::make_unique<Window>("Render test");
 
     bool left_mouse_button_pressed = false;
     double last_mouse_x;
     double last_mouse_y;
 
-    window.set_mouse_move_handler([&](double x, double y) {
-      //double relative_x = x / window.width();
-      //double relative_y = y / window.height();
-
-      //engine_log_info("mouse move pos=(%.1f, %.1f) <-> (%.2f, %.2f)", x, y, relative_x, relative_y);
-
-      if (left_mouse_button_pressed)
-      {
-        double dx = x - last_mouse_x;
-        double dy = y - last_mouse_y;
-
-        camera_pitch += math::degree(dy * CAMERA_ROTATE_SPEED);
-        camera_yaw -= math::degree(dx * CAMERA_ROTATE_SPEED);
-
-        camera->set_orientation(math::to_quat(camera_pitch, camera_yaw, camera_roll));
-      }
-
-      last_mouse_x = x;
-      last_mouse_y = y;
-    });
-
-    window.set_mouse_button_handler([&](MouseButton button, bool pressed) {
-      //engine_log_info("mouse button=%d pressed=%d", button, pressed);
-
-      if (button == MouseButton_Left)
-        left_mouse_button_pressed = pressed;
-    });
+    if (window)
+    {
+      window->set_keyboard_handler([&](Key key, bool pressed) {
+        math::vec3f direction_change;
+
+        bool camera_position_changed = false;
+
+        switch (key)
+        {
+          case Key_Up:
+          case Key_W:
+            direction_change = math::vec3f(0.f,0.f,pressed ? 1.f : -1.f);
+            camera_position_changed = true;
+            break;
+          case Key_Down:
+          case Key_S:
+            direction_change = math::vec3f(0.f,0.f,pressed ? -1.f : 1.f);
+            camera_position_changed = true;
+            break;
+          case Key_Right:
+          case Key_D:
+            direction_change = math::vec3f(pressed ? -1.f : 1.f,0.f,0.f);
+            camera_position_changed = true;
+            break;
+          case Key_Left:
+          case Key_A:
+            direction_change = math::vec3f(pressed ? 1.f : -1.f,0.f,0.f);
+            camera_position_changed = true;
+            break;
+          case Key_Escape:
+            engine_log_info("Escape pressed. Exiting...");
+            window->close();
+            break;
+          default:
+            break;
+        }
+
+        camera_move_direction += direction_change;
+      });
+
+      window->set_mouse_move_handler([&](double x, double y) {
+        //double relative_x = x / window->width();
+        //double relative_y = y / window->height();
+
+        //engine_log_info("mouse move pos=(%.1f, %.1f) <-> (%.2f, %.2f)", x, y, relative_x, relative_y);
+
+        if (left_mouse_button_pressed)
+        {
+          double dx = x - last_mouse_x;
+          double dy = y - last_mouse_y;
+
+          camera_pitch += math::degree(dy * CAMERA_ROTATE_SPEED);
+          camera_yaw -= math::degree(dx * CAMERA_ROTATE_SPEED);
+
+          camera->set_orientation(math::to_quat(camera_pitch, camera_yaw, camera_roll));
+        }
+
+        last_mouse_x = x;
+        last_mouse_y = y;
+      });
+
+      window->set_mouse_button_handler([&](MouseButton button, bool pressed) {
+        //engine_log_info("mouse button=%d pressed=%d", button, pressed);
+
+        if (button == MouseButton_Left)
+          left_mouse_button_pressed = pressed;
+      });
+    }
 
-    float window_ratio = window.width() / (float) window.height();
+    float window_ratio = window ? window->width() / (float)window->height() : HEADLESS_FRAME_BUFFER_WIDTH / (float)HEADLESS_FRAME_BUFFER_HEIGHT;
 
       //scene setup
 
@@ -259,9 +357,11 @@ int main(void)
 
       //render setup
 
-    DeviceOptions render_options;
 
-    SceneRenderer scene_renderer(window, render_options);
+    std::unique_ptr<SceneRenderer> scene_renderer_holder = window ?
+      std::make_unique<SceneRenderer>(*window, render_options, scene_render_options) :
+      std::make_unique<SceneRenderer>(HEADLESS_FRAME_BUFFER_WIDTH, HEADLESS_FRAME_BUFFER_HEIGHT, render_options, scene_render_options);
+    SceneRenderer& scene_renderer = *scene_renderer_holder;
     Device render_device = scene_renderer.device();
 
     scene_renderer.add_pass("Deferred Lighting");
@@ -269,9 +369,9 @@ int main(void)
 
       //resources creation
 
-    Texture model_diffuse_texture = render_device.create_texture2d("media/textures/brickwall_diffuse.jpg");
-    Texture model_normal_texture = render_device.create_texture2d("media/textures/brickwall_normal.jpg");
-    Texture model_specular_texture = render_device.create_texture2d("media/textures/brickwall_specular.jpg");
+    Texture model_diffuse_texture = render_device.create_texture2d("media/textures/brickwall_diffuse.jpg", compressed_textures ? PixelFormat_BC1 : PixelFormat_RGBA8);
+    Texture model_normal_texture = render_device.create_texture2d("media/textures/brickwall_normal.jpg", compressed_textures ? PixelFormat_BC5 : PixelFormat_RGBA8);
+    Texture model_specular_texture = render_device.create_texture2d("media/textures/brickwall_specular.jpg", compressed_textures ? PixelFormat_BC1 : PixelFormat_RGBA8);
 
     model_diffuse_texture.set_min_filter(TextureFilter_LinearMipLinear);
     model_normal_texture.set_min_filter(TextureFilter_LinearMipLinear);
@@ -308,7 +408,7 @@ int main(void)
 
     app.main_loop([&]()
     {
-      if (window.should_close())
+      if (window && window->should_close())
         app.exit();
 
       double new_time = app.time();
@@ -351,7 +451,8 @@ int main(void)
 
         //image presenting
 
-      window.swap_buffers();
+      if (window)
+        window->swap_buffers();
 
         //wait for next frame
 
@@ -360,6 +461,24 @@ int main(void)
       return TIMEOUT_MS;
     });
 
+    if (scene_render_options.depth_prepass)
+    {
+      const SceneRendererStatistics& statistics = scene_renderer.statistics();
+
+      engine_log_info("Depth pre-pass: %u G-buffer samples shaded, %u samples saved",
+        (unsigned int)statistics.g_buffer_samples_count, (unsigned int)statistics.saved_g_buffer_samples_count());
+    }
+
+    const SceneRendererStatistics& statistics = scene_renderer.statistics();
+
+    engine_log_info("Shadow maps: %u rendered, %u reused, %u static casters depth updates",
+      (unsigned int)statistics.shadow_map_updates_count, (unsigned int)statistics.shadow_map_skips_count,
+      (unsigned int)statistics.shadow_static_updates_count);
+    engine_log_info("Shadow casters: %u drawn, %u culled, %u caster passes",
+      (unsigned int)statistics.shadow_caster_draws_count, (unsigned int)statistics.shadow_culled_casters_count,
+      (unsigned int)statistics.shadow_caster_passes_count);
+    engine_log_info("Shadow map texels in the last frame: %u", (unsigned int)statistics.shadow_map_texels_count);
+
     engine_log_info("Exiting from application...");
 
     return 0;
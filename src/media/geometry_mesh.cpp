@@ -3,12 +3,29 @@
 
 #include <media/geometry.h>
 
+#include <limits>
 #include <vector>
 
 using namespace engine::media::geometry;
 using namespace engine::common;
 
 typedef std::vector<Primitive> PrimitiveArray;
+typedef std::vector<Vertex> VertexArray;
+typedef std::vector<Mesh::index_type> IndexArray;
+
+namespace
+{
+
+/// Check that sum of counts fits 32-bit mesh counters
+uint32_t checked_sum(size_t count1, size_t count2, const char* what)
+{
+  if (count1 + count2 > std::numeric_limits<uint32_t>::max())
+    throw Exception::format("Mesh %s count overflow: %zu + %zu", what, count1, count2);
+
+  return static_cast<uint32_t>(count1 + count2);
+}
+
+}
 
 /// Mesh implementation
 struct Mesh::Impl
@@ -37,22 +54,20 @@ struct Mesh::Impl
     return (uint32_t)primitives.size() - 1;
   }
 
-  uint32_t add_primitive(const char* material, PrimitiveType type, const Vertex* vertices, index_type vertices_count, const index_type* indices, uint32_t indices_count)
+  uint32_t add_primitive(const char* material, PrimitiveType type, const Vertex* vertices, uint32_t vertices_count, const index_type* indices, uint32_t indices_count)
   {
     engine_check_null(material);
 
-      //TODO check vertices/indices count limit
-
     uint32_t current_vertices_count = static_cast<uint32_t>(vertices_data.size());
     uint32_t current_indices_count = static_cast<uint32_t>(indices_data.size());
 
       //resize buffers to store additional data
 
-    vertices_data.resize(current_vertices_count + vertices_count);
+    vertices_data.resize(checked_sum(current_vertices_count, vertices_count, "vertices"));
 
     try
     {
-      indices_data.resize(current_indices_count + indices_count);
+      indices_data.resize(checked_sum(current_indices_count, indices_count, "indices"));
     }
     catch (...)
     {
@@ -73,7 +88,6 @@ struct Mesh::Impl
 
   Mesh merge(const Mesh& mesh)
   {
-      //TODO check vertices/indices count limit
       //TODO code can be optimized - copy larger mesh first and smaller mesh second
 
     Mesh return_value;
@@ -85,8 +99,8 @@ struct Mesh::Impl
 
       //allocate memory
 
-    return_value.vertices_resize(vertices_count + second_mesh_vertices_count);
-    return_value.indices_resize(indices_count + second_mesh_indices_count);
+    return_value.vertices_resize(checked_sum(vertices_count, second_mesh_vertices_count, "vertices"));
+    return_value.indices_resize(checked_sum(indices_count, second_mesh_indices_count, "indices"));
 
       //copy buffers
 
@@ -118,9 +132,14 @@ struct Mesh::Impl
   {
     Mesh return_value;
 
-    uint32_t vertices_count = static_cast<uint32_t>(vertices_data.size()),
+      //vertices of primitives may overlap, so merged vertices count may exceed source vertices count
+
+    uint32_t vertices_count = 0,
              indices_count  = static_cast<uint32_t>(indices_data.size());
 
+    for (const Primitive& primitive : primitives)
+      vertices_count = checked_sum(vertices_count, primitive_vertices_count(primitive), "vertices");
+
       //allocate memory
 
     return_value.vertices_resize(vertices_count);
@@ -150,20 +169,16 @@ struct Mesh::Impl
         if (primitive.material != current_material || primitive.type != current_primitive_type)
           continue;
 
-        size_t primitive_vertices_count = 0;
+        size_t primitive_vertices_count = this->primitive_vertices_count(primitive);
         size_t primitive_indices_count = primitive.count * 3;
 
         index_type* first_primitive_index = indices_data.data() + primitive.first * 3;
-        index_type* source_index = first_primitive_index;
-
-        for (size_t j = 0; j < primitive_indices_count; j++, source_index++)
-          primitive_vertices_count = std::max((size_t)*source_index + 1, primitive_vertices_count);
 
         memcpy(current_vertex, vertices_data.data() + primitive.base_vertex, primitive_vertices_count * sizeof(Vertex));
         memcpy(current_index, first_primitive_index, primitive_indices_count * sizeof(index_type));
 
         for (size_t j = 0; j < primitive_indices_count; j++, current_index++)
-          *current_index += copied_vertices_count;
+          *current_index += static_cast<index_type>(copied_vertices_count);
 
         copied_vertices_count += primitive_vertices_count;
         current_vertex += primitive_vertices_count;
@@ -173,9 +188,133 @@ struct Mesh::Impl
         primitives_to_process.erase(primitives_to_process.begin() + i);
       }
 
-      return_value.add_primitive(current_material.c_str(), current_primitive_type, (uint32_t)current_index_index, (uint32_t)copied_triangles_count, (uint32_t)current_vertex_index);
+      return_value.add_primitive(current_material.c_str(), current_primitive_type, (uint32_t)(current_index_index / 3), (uint32_t)copied_triangles_count, (uint32_t)current_vertex_index);
+    }
+
+    return return_value;
+  }
+
+  uint32_t primitive_vertices_count(const Primitive& primitive)
+  {
+    size_t result = 0;
+    const index_type* index = indices_data.data() + primitive.first * 3;
+
+    for (size_t i = 0, count = primitive.count * 3; i < count; i++, index++)
+      result = std::max((size_t)*index + 1, result);
+
+    return static_cast<uint32_t>(result);
+  }
+
+  index_type max_index()
+  {
+    index_type result = 0;
+
+    for (const Primitive& primitive : primitives)
+    {
+      uint32_t vertices_count = primitive_vertices_count(primitive);
+
+      if (vertices_count)
+        result = std::max(result, vertices_count - 1);
+    }
+
+    return result;
+  }
+
+  Mesh split(uint32_t max_vertices_count)
+  {
+    static const index_type NO_INDEX = std::numeric_limits<index_type>::max();
+
+    if (max_vertices_count < 3)
+      throw Exception::format("Can't split mesh to primitives with %u vertices", max_vertices_count);
+
+    VertexArray result_vertices;
+    IndexArray result_indices;
+    PrimitiveArray result_primitives;
+    IndexArray remap; //primitive vertex -> chunk vertex
+    IndexArray chunk_vertices; //primitive vertices of the current chunk
+
+    result_vertices.reserve(vertices_data.size());
+    result_indices.reserve(indices_data.size());
+
+    for (const Primitive& primitive : primitives)
+    {
+      const index_type* indices = indices_data.data() + primitive.first * 3;
+      size_t indices_count = primitive.count * 3;
+      size_t chunk_first_index = result_indices.size();
+
+      remap.assign(primitive_vertices_count(primitive), NO_INDEX);
+      chunk_vertices.clear();
+
+      auto flush_chunk = [&]()
+      {
+        if (chunk_vertices.empty())
+          return;
+
+        Primitive chunk = primitive;
+
+        chunk.first = static_cast<uint32_t>(chunk_first_index / 3);
+        chunk.count = static_cast<uint32_t>((result_indices.size() - chunk_first_index) / 3);
+        chunk.base_vertex = static_cast<uint32_t>(result_vertices.size());
+
+        for (index_type vertex : chunk_vertices)
+        {
+          result_vertices.push_back(vertices_data.data()[primitive.base_vertex + vertex]);
+          remap[vertex] = NO_INDEX;
+        }
+
+        result_primitives.push_back(chunk);
+
+        chunk_vertices.clear();
+        chunk_first_index = result_indices.size();
+      };
+
+      for (size_t i = 0; i < indices_count; i += 3)
+      {
+          //start new chunk if triangle vertices don't fit the current one
+
+        const index_type* triangle = indices + i;
+        size_t new_vertices_count = 0;
+
+        for (size_t j = 0; j < 3; j++)
+          if (remap[triangle[j]] == NO_INDEX && (j < 1 || triangle[j] != triangle[0]) && (j < 2 || triangle[j] != triangle[1]))
+            new_vertices_count++;
+
+        if (chunk_vertices.size() + new_vertices_count > max_vertices_count)
+          flush_chunk();
+
+        for (size_t j = 0; j < 3; j++)
+        {
+          index_type& chunk_index = remap[triangle[j]];
+
+          if (chunk_index == NO_INDEX)
+          {
+            chunk_index = static_cast<index_type>(chunk_vertices.size());
+            chunk_vertices.push_back(triangle[j]);
+          }
+
+          result_indices.push_back(chunk_index);
+        }
+      }
+
+      flush_chunk();
     }
 
+      //build result mesh
+
+    Mesh return_value;
+
+    return_value.vertices_resize(static_cast<uint32_t>(result_vertices.size()));
+    return_value.indices_resize(static_cast<uint32_t>(result_indices.size()));
+
+    if (!result_vertices.empty())
+      memcpy(return_value.vertices_data(), result_vertices.data(), result_vertices.size() * sizeof(Vertex));
+
+    if (!result_indices.empty())
+      memcpy(return_value.indices_data(), result_indices.data(), result_indices.size() * sizeof(index_type));
+
+    for (const Primitive& primitive : result_primitives)
+      return_value.add_primitive(primitive.material.c_str(), primitive.type, primitive.first, primitive.count, primitive.base_vertex);
+
     return return_value;
   }
 };
@@ -279,7 +418,7 @@ uint32_t Mesh::add_primitive(const char* material, PrimitiveType type, uint32_t
   return impl->add_primitive(material, type, first, count, base_vertex);
 }
 
-uint32_t Mesh::add_primitive(const char* material, PrimitiveType type, const Vertex* vertices, index_type vertices_count, const index_type* indices, uint32_t indices_count)
+uint32_t Mesh::add_primitive(const char* material, PrimitiveType type, const Vertex* vertices, uint32_t vertices_count, const index_type* indices, uint32_t indices_count)
 {
   return impl->add_primitive(material, type, vertices, vertices_count, indices, indices_count);
 }
@@ -307,6 +446,16 @@ Mesh Mesh::merge_primitives() const
   return impl->merge_primitives();
 }
 
+Mesh::index_type Mesh::max_index() const
+{
+  return impl->max_index();
+}
+
+Mesh Mesh::split(uint32_t max_vertices_count) const
+{
+  return impl->split(max_vertices_count);
+}
+
 void Mesh::clear()
 {
   remove_all_primitives();
@@ -0,0 +1,103 @@
+#include <common/exception.h>
+
+#include <media/geometry.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace engine::media::geometry;
+
+namespace
+{
+
+/// Convert float to half float (round to nearest even)
+uint16_t float_to_half(float value)
+{
+  uint32_t bits;
+
+  memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign = (bits >> 16) & 0x8000, mantissa = bits & 0x7fffff;
+  int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+
+  if (((bits >> 23) & 0xff) == 0xff)
+    return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0)); //infinity or NaN
+
+  if (exponent >= 31)
+    return static_cast<uint16_t>(sign | 0x7c00); //overflow
+
+  uint32_t shift = 13;
+
+  if (exponent <= 0)
+  {
+      //denormalized half
+
+    if (exponent < -10)
+      return static_cast<uint16_t>(sign);
+
+    mantissa |= 0x800000;
+    shift = 14 - exponent;
+    exponent = 0;
+  }
+
+  uint32_t result = (uint32_t(exponent) << 10) | (mantissa >> shift),
+           remainder = mantissa & ((1u << shift) - 1),
+           halfway = 1u << (shift - 1);
+
+  if (remainder > halfway || (remainder == halfway && (result & 1)))
+    result++; //carry to exponent is a correct rounding
+
+  return static_cast<uint16_t>(sign | result);
+}
+
+/// Convert [-1;1] float to signed normalized integer with specified bits count
+uint32_t float_to_snorm(float value, uint32_t bits)
+{
+  float max_value = float((1 << (bits - 1)) - 1);
+  int32_t result = static_cast<int32_t>(std::round(std::min(std::max(value, -1.0f), 1.0f) * max_value));
+
+  return static_cast<uint32_t>(result) & ((1u << bits) - 1);
+}
+
+/// Convert [0;1] float to unsigned normalized byte
+uint8_t float_to_unorm8(float value)
+{
+  return static_cast<uint8_t>(std::round(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+}
+
+namespace engine {
+namespace media {
+namespace geometry {
+
+PackedVertex pack_vertex(const Vertex& vertex)
+{
+  PackedVertex result;
+
+  result.position = vertex.position;
+  result.normal = float_to_snorm(vertex.normal.x, 10) | (float_to_snorm(vertex.normal.y, 10) << 10) | (float_to_snorm(vertex.normal.z, 10) << 20);
+
+  for (size_t i = 0; i < 4; i++)
+    result.color[i] = float_to_unorm8(vertex.color[i]);
+
+  result.tex_coord[0] = float_to_half(vertex.tex_coord.x);
+  result.tex_coord[1] = float_to_half(vertex.tex_coord.y);
+
+  return result;
+}
+
+void pack_vertices(const Vertex* vertices, size_t count, PackedVertex* packed_vertices)
+{
+  if (!count)
+    return;
+
+  engine_check_null(vertices);
+  engine_check_null(packed_vertices);
+
+  for (size_t i = 0; i < count; i++)
+    packed_vertices[i] = pack_vertex(vertices[i]);
+}
+
+}}}
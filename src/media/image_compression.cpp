@@ -0,0 +1,538 @@
+#include <common/exception.h>
+
+#include <media/image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace engine::media::image;
+using namespace engine::common;
+
+namespace
+{
+
+/// Constants
+static constexpr unsigned int BLOCK_SIZE = CompressedImage::BLOCK_SIZE; //block width and height in pixels
+static constexpr unsigned int BLOCK_PIXELS_COUNT = BLOCK_SIZE * BLOCK_SIZE; //number of pixels in a block
+static constexpr int PRINCIPAL_AXIS_ITERATIONS = 4; //number of power iterations for colors principal axis
+
+/// Compressed level
+struct Level
+{
+  unsigned int width; //level width
+  unsigned int height; //level height
+  std::vector<uint8_t> data; //compressed blocks
+};
+
+/// Box filtered next level of mip chain
+std::vector<Color> downsample(const std::vector<Color>& pixels, unsigned int width, unsigned int height, unsigned int level_width, unsigned int level_height)
+{
+  std::vector<Color> result(size_t(level_width) * level_height);
+
+  for (unsigned int y=0; y<level_height; y++)
+  {
+    unsigned int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+
+    for (unsigned int x=0; x<level_width; x++)
+    {
+      unsigned int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+
+      const Color& c00 = pixels[y0 * width + x0];
+      const Color& c01 = pixels[y0 * width + x1];
+      const Color& c10 = pixels[y1 * width + x0];
+      const Color& c11 = pixels[y1 * width + x1];
+
+      Color& dst = result[y * level_width + x];
+
+      dst.r = uint8_t((c00.r + c01.r + c10.r + c11.r + 2) / 4);
+      dst.g = uint8_t((c00.g + c01.g + c10.g + c11.g + 2) / 4);
+      dst.b = uint8_t((c00.b + c01.b + c10.b + c11.b + 2) / 4);
+      dst.a = uint8_t((c00.a + c01.a + c10.a + c11.a + 2) / 4);
+    }
+  }
+
+  return result;
+}
+
+/// RGB565 packing
+uint16_t pack_565(const float* color)
+{
+  int r = int(std::round(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+  int g = int(std::round(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+  int b = int(std::round(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+
+  return uint16_t(r << 11 | g << 5 | b);
+}
+
+void unpack_565(uint16_t value, int* color)
+{
+  int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+
+  color[0] = r << 3 | r >> 2;
+  color[1] = g << 2 | g >> 4;
+  color[2] = b << 3 | b >> 2;
+}
+
+/// Colors of BC1 block palette
+void get_color_palette(uint16_t color0, uint16_t color1, bool four_colors, int (*palette)[4])
+{
+  unpack_565(color0, palette[0]);
+  unpack_565(color1, palette[1]);
+
+  palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255; //BC1 is decoded as opaque RGB
+
+  for (int i=0; i<3; i++)
+  {
+    if (four_colors || color0 > color1)
+    {
+      palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+      palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+    }
+    else
+    {
+      palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+      palette[3][i] = 0;
+    }
+  }
+}
+
+/// Encode color block: endpoints are the extreme colors along the principal axis (inset to reduce the quantization error)
+void encode_color_block(const Color* block, bool four_colors, uint8_t* out)
+{
+    //mean & covariance
+
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+
+  for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+  {
+    mean[0] += block[i].r;
+    mean[1] += block[i].g;
+    mean[2] += block[i].b;
+  }
+
+  for (float& value : mean)
+    value /= BLOCK_PIXELS_COUNT;
+
+  float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; //rr, rg, rb, gg, gb, bb
+
+  for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+  {
+    float r = block[i].r - mean[0], g = block[i].g - mean[1], b = block[i].b - mean[2];
+
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+
+    //principal axis by power iteration
+
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+
+  for (int iteration=0; iteration<PRINCIPAL_AXIS_ITERATIONS; iteration++)
+  {
+    float next[3] = {
+      covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+      covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+      covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+    };
+
+    float length = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+
+    if (length <= 0.0f)
+      break;
+
+    for (int i=0; i<3; i++)
+      axis[i] = next[i] / length;
+  }
+
+    //extreme colors along the axis
+
+  float min_projection = 0.0f, max_projection = 0.0f;
+
+  for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+  {
+    float projection = (block[i].r - mean[0]) * axis[0] + (block[i].g - mean[1]) * axis[1] + (block[i].b - mean[2]) * axis[2];
+
+    min_projection = std::min(min_projection, projection);
+    max_projection = std::max(max_projection, projection);
+  }
+
+  float axis_length_square = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  float inset = (max_projection - min_projection) / 16.0f;
+
+  min_projection = (min_projection + inset) / axis_length_square;
+  max_projection = (max_projection - inset) / axis_length_square;
+
+  float max_color[3], min_color[3];
+
+  for (int i=0; i<3; i++)
+  {
+    max_color[i] = mean[i] + axis[i] * max_projection;
+    min_color[i] = mean[i] + axis[i] * min_projection;
+  }
+
+  uint16_t color0 = pack_565(max_color), color1 = pack_565(min_color);
+
+    //four colors mode of BC1 requires color0 > color1
+
+  if (color0 < color1)
+    std::swap(color0, color1);
+
+  int palette[4][4];
+
+  get_color_palette(color0, color1, four_colors, palette);
+
+  uint32_t indices = 0;
+
+  if (color0 != color1)
+  {
+    for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+    {
+      int best_distance = -1, best_index = 0;
+
+      for (int j=0; j<4; j++)
+      {
+        int dr = block[i].r - palette[j][0], dg = block[i].g - palette[j][1], db = block[i].b - palette[j][2];
+        int distance = dr * dr + dg * dg + db * db;
+
+        if (best_distance < 0 || distance < best_distance)
+        {
+          best_distance = distance;
+          best_index = j;
+        }
+      }
+
+      indices |= uint32_t(best_index) << (i * 2);
+    }
+  }
+
+  out[0] = uint8_t(color0);
+  out[1] = uint8_t(color0 >> 8);
+  out[2] = uint8_t(color1);
+  out[3] = uint8_t(color1 >> 8);
+
+  for (int i=0; i<4; i++)
+    out[4 + i] = uint8_t(indices >> (i * 8));
+}
+
+/// Values of BC4 block palette
+void get_channel_palette(int value0, int value1, int* palette)
+{
+  palette[0] = value0;
+  palette[1] = value1;
+
+  if (value0 > value1)
+  {
+    for (int i=1; i<7; i++)
+      palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+  }
+  else
+  {
+    for (int i=1; i<5; i++)
+      palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+/// Encode single channel block (channel is selected by offset of the component in Color)
+void encode_channel_block(const Color* block, size_t channel, uint8_t* out)
+{
+  const uint8_t* values = reinterpret_cast<const uint8_t*>(block) + channel;
+
+  int min_value = 255, max_value = 0;
+
+  for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+  {
+    min_value = std::min(min_value, int(values[i * sizeof(Color)]));
+    max_value = std::max(max_value, int(values[i * sizeof(Color)]));
+  }
+
+  int palette[8];
+
+  get_channel_palette(max_value, min_value, palette);
+
+  uint64_t indices = 0;
+
+  if (max_value != min_value)
+  {
+    for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+    {
+      int value = values[i * sizeof(Color)], best_distance = 256, best_index = 0;
+
+      for (int j=0; j<8; j++)
+      {
+        int distance = std::abs(value - palette[j]);
+
+        if (distance < best_distance)
+        {
+          best_distance = distance;
+          best_index = j;
+        }
+      }
+
+      indices |= uint64_t(best_index) << (i * 3);
+    }
+  }
+
+  out[0] = uint8_t(max_value);
+  out[1] = uint8_t(min_value);
+
+  for (int i=0; i<6; i++)
+    out[2 + i] = uint8_t(indices >> (i * 8));
+}
+
+/// Decode color block
+void decode_color_block(const uint8_t* data, bool four_colors, Color* block)
+{
+  uint16_t color0 = uint16_t(data[0] | data[1] << 8), color1 = uint16_t(data[2] | data[3] << 8);
+  uint32_t indices = uint32_t(data[4]) | uint32_t(data[5]) << 8 | uint32_t(data[6]) << 16 | uint32_t(data[7]) << 24;
+
+  int palette[4][4];
+
+  get_color_palette(color0, color1, four_colors, palette);
+
+  for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+  {
+    const int* color = palette[(indices >> (i * 2)) & 3];
+
+    block[i].r = uint8_t(color[0]);
+    block[i].g = uint8_t(color[1]);
+    block[i].b = uint8_t(color[2]);
+    block[i].a = uint8_t(color[3]);
+  }
+}
+
+/// Decode single channel block
+void decode_channel_block(const uint8_t* data, size_t channel, Color* block)
+{
+  uint64_t indices = 0;
+
+  for (int i=0; i<6; i++)
+    indices |= uint64_t(data[2 + i]) << (i * 8);
+
+  int palette[8];
+
+  get_channel_palette(data[0], data[1], palette);
+
+  uint8_t* values = reinterpret_cast<uint8_t*>(block) + channel;
+
+  for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+    values[i * sizeof(Color)] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+}
+
+/// Compress level
+void compress(CompressionFormat format, const std::vector<Color>& pixels, unsigned int width, unsigned int height, uint8_t* out)
+{
+  size_t block_bytes = CompressedImage::block_bytes(format);
+
+  for (unsigned int block_y=0; block_y<height; block_y+=BLOCK_SIZE)
+  {
+    for (unsigned int block_x=0; block_x<width; block_x+=BLOCK_SIZE, out+=block_bytes)
+    {
+        //pixels outside of the level are replicated from its edges
+
+      Color block[BLOCK_PIXELS_COUNT];
+
+      for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+      {
+        unsigned int x = std::min(block_x + i % BLOCK_SIZE, width - 1), y = std::min(block_y + i / BLOCK_SIZE, height - 1);
+
+        block[i] = pixels[size_t(y) * width + x];
+      }
+
+      switch (format)
+      {
+        case CompressionFormat_BC1:
+          encode_color_block(block, false, out);
+          break;
+        case CompressionFormat_BC3:
+          encode_channel_block(block, offsetof(Color, a), out);
+          encode_color_block(block, true, out + 8);
+          break;
+        case CompressionFormat_BC4:
+          encode_channel_block(block, offsetof(Color, r), out);
+          break;
+        case CompressionFormat_BC5:
+          encode_channel_block(block, offsetof(Color, r), out);
+          encode_channel_block(block, offsetof(Color, g), out + 8);
+          break;
+        default:
+          throw Exception::format("Invalid compression format %d", format);
+      }
+    }
+  }
+}
+
+}
+
+/// Implementation details of compressed image
+struct CompressedImage::Impl
+{
+  CompressionFormat format; //compression format
+  std::vector<Level> levels; //mip chain
+};
+
+CompressedImage::CompressedImage(const Image& image, CompressionFormat format, size_t mips_count)
+  : impl(std::make_shared<Impl>())
+{
+  unsigned int width = image.width(), height = image.height();
+
+  engine_check(width && height);
+
+  block_bytes(format); //check format
+
+  size_t full_mips_count = 1;
+
+  for (unsigned int size=std::max(width, height); size>1; size/=2)
+    full_mips_count++;
+
+  mips_count = std::max(std::min(mips_count, full_mips_count), size_t(1));
+
+  impl->format = format;
+  impl->levels.resize(mips_count);
+
+  std::vector<Color> pixels(image.bitmap(), image.bitmap() + size_t(width) * height);
+
+  for (size_t i=0; i<mips_count; i++)
+  {
+    Level& level = impl->levels[i];
+
+    if (i)
+    {
+      unsigned int level_width = std::max(width / 2, 1u), level_height = std::max(height / 2, 1u);
+
+      pixels = downsample(pixels, width, height, level_width, level_height);
+
+      width = level_width;
+      height = level_height;
+    }
+
+    level.width = width;
+    level.height = height;
+
+    level.data.resize(level_bytes(format, width, height));
+
+    compress(format, pixels, width, height, level.data.data());
+  }
+}
+
+CompressionFormat CompressedImage::format() const
+{
+  return impl->format;
+}
+
+size_t CompressedImage::mips_count() const
+{
+  return impl->levels.size();
+}
+
+unsigned int CompressedImage::width(size_t level) const
+{
+  engine_check_range(level, impl->levels.size());
+
+  return impl->levels[level].width;
+}
+
+unsigned int CompressedImage::height(size_t level) const
+{
+  engine_check_range(level, impl->levels.size());
+
+  return impl->levels[level].height;
+}
+
+const void* CompressedImage::data(size_t level) const
+{
+  engine_check_range(level, impl->levels.size());
+
+  return impl->levels[level].data.data();
+}
+
+size_t CompressedImage::data_size(size_t level) const
+{
+  engine_check_range(level, impl->levels.size());
+
+  return impl->levels[level].data.size();
+}
+
+size_t CompressedImage::block_bytes(CompressionFormat format)
+{
+  switch (format)
+  {
+    case CompressionFormat_BC1:
+    case CompressionFormat_BC4: return 8;
+    case CompressionFormat_BC3:
+    case CompressionFormat_BC5: return 16;
+    default:                    throw Exception::format("Invalid compression format %d", format);
+  }
+}
+
+size_t CompressedImage::level_bytes(CompressionFormat format, unsigned int width, unsigned int height)
+{
+  size_t blocks_count = size_t((width + BLOCK_SIZE - 1) / BLOCK_SIZE) * ((height + BLOCK_SIZE - 1) / BLOCK_SIZE);
+
+  return blocks_count * block_bytes(format);
+}
+
+namespace engine {
+namespace media {
+namespace image {
+
+void decompress(CompressionFormat format, unsigned int width, unsigned int height, const void* data, Color* pixels)
+{
+  engine_check_null(data);
+  engine_check_null(pixels);
+
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  size_t block_bytes = CompressedImage::block_bytes(format);
+
+  for (unsigned int block_y=0; block_y<height; block_y+=BLOCK_SIZE)
+  {
+    for (unsigned int block_x=0; block_x<width; block_x+=BLOCK_SIZE, src+=block_bytes)
+    {
+      Color block[BLOCK_PIXELS_COUNT];
+
+      for (Color& color : block)
+      {
+        color.r = color.g = color.b = 0;
+        color.a = 255;
+      }
+
+      switch (format)
+      {
+        case CompressionFormat_BC1:
+          decode_color_block(src, false, block);
+          break;
+        case CompressionFormat_BC3:
+          decode_color_block(src + 8, true, block);
+          decode_channel_block(src, offsetof(Color, a), block);
+          break;
+        case CompressionFormat_BC4:
+          decode_channel_block(src, offsetof(Color, r), block);
+          break;
+        case CompressionFormat_BC5:
+          decode_channel_block(src, offsetof(Color, r), block);
+          decode_channel_block(src + 8, offsetof(Color, g), block);
+          break;
+        default:
+          throw Exception::format("Invalid compression format %d", format);
+      }
+
+      for (unsigned int i=0; i<BLOCK_PIXELS_COUNT; i++)
+      {
+        unsigned int x = block_x + i % BLOCK_SIZE, y = block_y + i / BLOCK_SIZE;
+
+        if (x < width && y < height)
+          pixels[size_t(y) * width + x] = block[i];
+      }
+    }
+  }
+}
+
+}}}
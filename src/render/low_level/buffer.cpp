@@ -3,6 +3,45 @@
 using namespace engine::render::low_level;
 using namespace engine::common;
 
+namespace
+{
+
+/// Size of vertex / index of the specified format
+size_t get_vertex_size(VertexFormat format)
+{
+  switch (format)
+  {
+    case VertexFormat_Float:    return sizeof(Vertex);
+    case VertexFormat_Packed:   return sizeof(PackedVertex);
+    case VertexFormat_Position: return sizeof(math::vec3f);
+    default:                    throw Exception::format("Unexpected vertex format %d", format);
+  }
+}
+
+/// GL usage mode of a buffer usage hint
+GLenum get_gl_usage(BufferUsage usage)
+{
+  switch (usage)
+  {
+    case BufferUsage_Static:  return GL_STATIC_DRAW;
+    case BufferUsage_Dynamic: return GL_DYNAMIC_DRAW;
+    case BufferUsage_Stream:  return GL_STREAM_DRAW;
+    default:                  throw Exception::format("Unexpected buffer usage %d", usage);
+  }
+}
+
+size_t get_index_size(IndexFormat format)
+{
+  switch (format)
+  {
+    case IndexFormat_UInt16: return sizeof(uint16_t);
+    case IndexFormat_UInt32: return sizeof(uint32_t);
+    default:                 throw Exception::format("Unexpected index format %d", format);
+  }
+}
+
+}
+
 /// Implementation details of buffer
 struct engine::render::low_level::BufferImpl
 { 
@@ -10,13 +49,15 @@ struct engine::render::low_level::BufferImpl
   size_t count; //number of elements
   size_t element_size; //size of one element
   GLenum target; //buffer target
+  GLenum usage_mode; //GL usage mode
   GLuint vbo_id; //vertex buffer object
 
-  BufferImpl(const DeviceContextPtr& context, GLenum target, size_t count, size_t element_size)
+  BufferImpl(const DeviceContextPtr& context, GLenum target, size_t count, size_t element_size, BufferUsage usage)
     : context(context)
     , count(count)
     , element_size(element_size)
     , target(target)
+    , usage_mode(get_gl_usage(usage))
     , vbo_id()
   {
     engine_check(context);
@@ -35,9 +76,7 @@ struct engine::render::low_level::BufferImpl
 
       //allocate buffer
 
-    const GLenum usage_mode = GL_STATIC_DRAW; //TODO: add as parameter
-
-    glBufferData(target, count * element_size, nullptr, usage_mode); 
+    glBufferData(target, count * element_size, nullptr, usage_mode);
 
     context->check_errors();
   }
@@ -48,8 +87,12 @@ struct engine::render::low_level::BufferImpl
     {
       context->make_current();
 
-      glBindBuffer(target, 0);
+      context->vertex_array_cache().on_buffer_deleted(vbo_id);
+      context->state_cache().bind_buffer(target, 0);
+
       glDeleteBuffers(1, &vbo_id);
+
+      context->state_cache().on_buffer_deleted(vbo_id);
     }
     catch (...)
     {
@@ -61,7 +104,10 @@ struct engine::render::low_level::BufferImpl
   {
     bind();
 
-    glBufferSubData(target, offset * element_size, count * element_size, data);
+      //full update of a dynamic buffer orphans the storage, so the upload doesn't wait for draws which still use previous data
+
+    if (usage_mode != GL_STATIC_DRAW && !offset && count == this->count) glBufferData(target, count * element_size, data, usage_mode);
+    else                                                                 glBufferSubData(target, offset * element_size, count * element_size, data);
 
     context->check_errors();
   }
@@ -70,7 +116,12 @@ struct engine::render::low_level::BufferImpl
   {
     context->make_current();
 
-    glBindBuffer(target, vbo_id);
+      //element array binding is a part of vertex array object state; cached objects mustn't be changed
+
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+      context->vertex_array_cache().bind_default();
+
+    context->state_cache().bind_buffer(target, vbo_id);
 
     context->check_errors();
   }
@@ -80,8 +131,9 @@ struct engine::render::low_level::BufferImpl
 /// VertexBuffer
 ///
 
-VertexBuffer::VertexBuffer(const DeviceContextPtr& context, size_t vertices_count)
-  : impl(std::make_shared<BufferImpl>(context, GL_ARRAY_BUFFER, vertices_count, sizeof (Vertex)))
+VertexBuffer::VertexBuffer(const DeviceContextPtr& context, size_t vertices_count, VertexFormat format, BufferUsage usage)
+  : impl(std::make_shared<BufferImpl>(context, GL_ARRAY_BUFFER, vertices_count, get_vertex_size(format), usage))
+  , vertex_format(format)
 {
 }
 
@@ -90,22 +142,49 @@ size_t VertexBuffer::vertices_count() const
   return impl->count;
 }
 
+VertexFormat VertexBuffer::format() const
+{
+  return vertex_format;
+}
+
 void VertexBuffer::set_data(size_t offset, size_t count, const Vertex* vertices)
 {
+  engine_check(vertex_format == VertexFormat_Float);
+
+  impl->set_data(offset, count, vertices);
+}
+
+void VertexBuffer::set_data(size_t offset, size_t count, const PackedVertex* vertices)
+{
+  engine_check(vertex_format == VertexFormat_Packed);
+
   impl->set_data(offset, count, vertices);
 }
 
+void VertexBuffer::set_data(size_t offset, size_t count, const math::vec3f* positions)
+{
+  engine_check(vertex_format == VertexFormat_Position);
+
+  impl->set_data(offset, count, positions);
+}
+
 void VertexBuffer::bind() const
 {
   impl->bind();
 }
 
+size_t VertexBuffer::id() const
+{
+  return impl->vbo_id;
+}
+
 ///
 /// IndexBuffer
 ///
 
-IndexBuffer::IndexBuffer(const DeviceContextPtr& context, size_t indices_count)
-  : impl(std::make_shared<BufferImpl>(context, GL_ELEMENT_ARRAY_BUFFER, indices_count, sizeof(index_type)))
+IndexBuffer::IndexBuffer(const DeviceContextPtr& context, size_t indices_count, IndexFormat format, BufferUsage usage)
+  : impl(std::make_shared<BufferImpl>(context, GL_ELEMENT_ARRAY_BUFFER, indices_count, get_index_size(format), usage))
+  , index_format(format)
 {
 }
 
@@ -114,8 +193,22 @@ size_t IndexBuffer::indices_count() const
   return impl->count;
 }
 
-void IndexBuffer::set_data(size_t offset, size_t count, const index_type* indices)
+IndexFormat IndexBuffer::format() const
+{
+  return index_format;
+}
+
+void IndexBuffer::set_data(size_t offset, size_t count, const uint16_t* indices)
 {
+  engine_check(index_format == IndexFormat_UInt16);
+
+  impl->set_data(offset, count, indices);
+}
+
+void IndexBuffer::set_data(size_t offset, size_t count, const uint32_t* indices)
+{
+  engine_check(index_format == IndexFormat_UInt32);
+
   impl->set_data(offset, count, indices);
 }
 
@@ -123,3 +216,8 @@ void IndexBuffer::bind() const
 {
   impl->bind();
 }
+
+size_t IndexBuffer::id() const
+{
+  return impl->vbo_id;
+}
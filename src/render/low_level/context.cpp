@@ -6,6 +6,10 @@ using namespace engine::common;
 namespace
 {
 
+/// Constants
+static constexpr uint32_t DEFAULT_UNIFORM_BUFFER_OFFSET_ALIGNMENT = 256; //used if the driver doesn't report alignment
+static constexpr size_t UNIFORM_BUFFER_RING_SIZE = 1024 * 1024; //size of the uniform buffer ring
+
 const char* get_gl_debug_source(GLenum value)
 {
   switch (value)
@@ -80,20 +84,68 @@ void APIENTRY glDebugOutput(GLenum source,
 }
 
 DeviceContextImpl::DeviceContextImpl(const Window& window, const DeviceOptions& options)
-  : render_window(window)
+  : render_window(std::make_unique<Window>(window))
   , context(window.handle())
+  , headless_width()
+  , headless_height()
+  , device_options(options)
+{
+  init();
+}
+
+DeviceContextImpl::DeviceContextImpl(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options)
+  : context()
+  , headless_width(int(frame_buffer_width))
+  , headless_height(int(frame_buffer_height))
   , device_options(options)
 {
-  engine_log_info("Initializing OpenGL context...");
+  if (options.backend == DeviceBackend_OpenGL)
+    throw Exception::format("Headless device context requires null or software backend");
+
+  engine_check(frame_buffer_width > 0 && frame_buffer_height > 0);
+
+  init();
+}
+
+void DeviceContextImpl::init()
+{
+  const DeviceOptions& options = device_options;
+
+  engine_log_info("Initializing OpenGL context%s...", render_window ? "" : " (headless)");
 
   make_current();
 
   engine_log_info("...loading OpenGL functions");
 
-  if (!gladLoadGL(glfwGetProcAddress))
+  GLADloadfunc load_function = nullptr;
+
+  switch (options.backend)
+  {
+    case DeviceBackend_OpenGL:
+      load_function = glfwGetProcAddress;
+      break;
+    case DeviceBackend_Null:
+      engine_log_info("...using null driver");
+      load_function = get_null_driver_proc_address;
+      break;
+    case DeviceBackend_Software:
+      engine_log_info("...using software driver");
+      load_function = get_software_driver_proc_address;
+      break;
+    default:
+      throw Exception::format("Unexpected device backend %d", options.backend);
+  }
+
+  if (!gladLoadGL(load_function))
     throw Exception::format("gladLoadGL failed");
 
-  if (options.vsync)
+  if (!options.trace_file_name.empty())
+  {
+    engine_log_info("...enabling commands trace recording");
+    trace_recorder = std::make_unique<TraceRecorder>(options.trace_file_name.c_str());
+  }
+
+  if (options.vsync && options.backend == DeviceBackend_OpenGL)
   {
     engine_log_info("...enabling VSync");
     glfwSwapInterval(1);
@@ -111,12 +163,19 @@ DeviceContextImpl::DeviceContextImpl(const Window& window, const DeviceOptions&
   engine_log_info("...OpenGL extensions:");
 
   GLint extensions_count = 0;
+  bool has_base_instance = false, has_multi_draw_indirect = false;
 
   glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_count);
 
   for (int i=0; i<extensions_count; i++)
   {
-    engine_log_info("......%s", glGetStringi(GL_EXTENSIONS, i));
+    const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+
+    engine_log_info("......%s", extension);
+
+    has_base_instance |= !strcmp(extension, "GL_ARB_base_instance");
+    has_multi_draw_indirect |= !strcmp(extension, "GL_ARB_multi_draw_indirect");
+    device_capabilities.has_texture_compression_s3tc |= !strcmp(extension, "GL_EXT_texture_compression_s3tc");
   }
 
     //enabling debug output
@@ -140,6 +199,43 @@ DeviceContextImpl::DeviceContextImpl(const Window& window, const DeviceOptions&
 
   device_capabilities.active_textures_count = texture_units_count;
 
+  GLint major_version = 0, minor_version = 0;
+
+  glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+  glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+
+  if (major_version > 4 || (major_version == 4 && minor_version >= 3))
+    has_base_instance = has_multi_draw_indirect = true;
+
+  device_capabilities.has_multi_draw_indirect = options.multi_draw_indirect && has_base_instance && has_multi_draw_indirect &&
+    glMultiDrawElementsIndirect;
+
+  if (device_capabilities.has_multi_draw_indirect)
+    engine_log_info("...using multi draw indirect submission");
+
+  GLint uniform_buffer_offset_alignment = 0;
+
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_offset_alignment);
+
+  device_capabilities.uniform_buffer_offset_alignment = uniform_buffer_offset_alignment > 0 ?
+    uint32_t(uniform_buffer_offset_alignment) : DEFAULT_UNIFORM_BUFFER_OFFSET_ALIGNMENT;
+
+    //create vertex array objects cache
+
+  vertex_arrays = std::make_unique<VertexArrayCache>(state);
+
+    //create frame fences
+
+  fences = std::make_unique<FrameFences>();
+
+    //create uniform buffer ring
+
+  uniform_buffers = std::make_unique<UniformBufferRing>(state, *fences, UNIFORM_BUFFER_RING_SIZE, device_capabilities.uniform_buffer_offset_alignment);
+
+    //create texture uploader
+
+  uploader = std::make_unique<TextureUploader>(state, *fences, options.texture_upload_budget);
+
   check_errors();
 }
 
@@ -149,7 +245,14 @@ DeviceContextImpl::~DeviceContextImpl()
   {
     engine_log_info("Destroying OpenGL context...");
 
-    make_current(nullptr);
+    uploader.reset();
+    uniform_buffers.reset();
+    fences.reset();
+    vertex_arrays.reset();
+    trace_recorder.reset();
+
+    if (device_options.backend == DeviceBackend_OpenGL)
+      make_current(nullptr);
   }
   catch (...)
   {
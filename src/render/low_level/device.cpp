@@ -3,100 +3,104 @@
 using namespace engine::render::low_level;
 using namespace engine::common;
 
-///
-/// Utilities
-///
-
-/// Vertex array object
-/// TODO: should be created dynamically for tuple (program, vertex buffer)
-struct VertexArrayObject
-{
-  GLuint id;
-
-  VertexArrayObject()
-    : id()
-  {
-    glGenVertexArrays(1, &id);
-    glBindVertexArray(id);
-  }
-
-  ~VertexArrayObject()
-  {
-    glBindVertexArray(0);
-    glDeleteVertexArrays(1, &id);
-  }
-};
-
 /// Implementation details of device
 struct Device::Impl
 {
   DeviceContextPtr context; //rendering context
-  Window window; //application window
+  std::unique_ptr<Window> window; //application window (null for headless device)
   FrameBuffer window_frame_buffer; //window frame buffer
   std::unique_ptr<Program> default_program; //default program
-  std::unique_ptr<VertexArrayObject> vertex_array_object; //dummy implementation to make OpenGL 4.1 happy; should be integrated with input layouts
+  VertexFormat mesh_vertex_format; //vertex format of meshes
+  bool mesh_position_streams; //create position streams for meshes
 
   Impl(const Window& window, const DeviceOptions& options)
     : context(std::make_shared<DeviceContextImpl>(window, options))
-    , window(window)
+    , window(std::make_unique<Window>(window))
     , window_frame_buffer(context, window)
+    , mesh_vertex_format(options.mesh_vertex_format)
+    , mesh_position_streams(options.mesh_position_streams)
+  {
+    init();
+  }
+
+  Impl(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options)
+    : context(std::make_shared<DeviceContextImpl>(frame_buffer_width, frame_buffer_height, options))
+    , window_frame_buffer(context, frame_buffer_width, frame_buffer_height)
+    , mesh_vertex_format(options.mesh_vertex_format)
+    , mesh_position_streams(options.mesh_position_streams)
+  {
+    init();
+  }
+
+  void init()
   {
     context->make_current();
 
       //common context setup
 
-    vertex_array_object = std::make_unique<VertexArrayObject>();
-
-    glEnable(GL_CULL_FACE);
+    context->state_cache().enable(GL_CULL_FACE, true);
     glCullFace(GL_BACK);
   }
 
-  ~Impl()
+  void create_default_program(Device& device)
   {
-    try
-    {
-      context->make_current();
-
-      vertex_array_object.reset();
-    }
-    catch (...)
-    {
-      //ignore exceptions in destructors
-    }
+    static const char* DEFAULT_PROGRAM_SOURCE_CODE = 
+      "#shader vertex\n"
+      "#version 410 core\n"
+      "in vec4 vColor;\n"
+      "in vec3 vPosition;\n"
+      "out vec4 color;\n"
+      "void main()\n"
+      "{\n"
+      "  gl_Position = vec4(vPosition, 1.0);\n"
+      "  color = vColor;\n"
+      "}\n"
+      "#shader pixel\n"
+      "#version 410 core\n"
+      "in vec4 color;\n"
+      "out vec4 outColor;\n"
+      "void main()\n"
+      "{\n"
+      "  outColor = color;\n"
+      "}\n";
+
+    default_program = std::make_unique<Program>(device.create_program_from_source("default", DEFAULT_PROGRAM_SOURCE_CODE));
   }
 };
 
 Device::Device(const Window& window, const DeviceOptions& options)
   : impl(new Impl(window, options))
 {
-    //initialize default program
-
-  static const char* DEFAULT_PROGRAM_SOURCE_CODE = 
-    "#shader vertex\n"
-    "#version 410 core\n"
-    "in vec4 vColor;\n"
-    "in vec3 vPosition;\n"
-    "out vec4 color;\n"
-    "void main()\n"
-    "{\n"
-    "  gl_Position = vec4(vPosition, 1.0);\n"
-    "  color = vColor;\n"
-    "}\n"
-    "#shader pixel\n"
-    "#version 410 core\n"
-    "in vec4 color;\n"
-    "out vec4 outColor;\n"
-    "void main()\n"
-    "{\n"
-    "  outColor = color;\n"
-    "}\n";
-
-  impl->default_program = std::make_unique<Program>(create_program_from_source("default", DEFAULT_PROGRAM_SOURCE_CODE));
+  impl->create_default_program(*this);
+}
+
+Device::Device(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options)
+  : impl(new Impl(frame_buffer_width, frame_buffer_height, options))
+{
+  impl->create_default_program(*this);
+}
+
+bool Device::has_window() const
+{
+  return impl->window != nullptr;
 }
 
 Window& Device::window() const
 {
-  return impl->window;
+  if (!impl->window)
+    throw Exception::format("Headless device has no window");
+
+  return *impl->window;
+}
+
+int Device::frame_buffer_width() const
+{
+  return impl->context->frame_buffer_width();
+}
+
+int Device::frame_buffer_height() const
+{
+  return impl->context->frame_buffer_height();
 }
 
 FrameBuffer& Device::window_frame_buffer() const
@@ -111,7 +115,14 @@ FrameBuffer Device::create_frame_buffer()
 
 Texture Device::create_texture2d(size_t width, size_t height, PixelFormat format, size_t mips_count)
 {
-  return Texture(impl->context, width, height, 1, format, mips_count);
+  return Texture(impl->context, TextureType_2D, width, height, 1, format, mips_count);
+}
+
+Texture Device::create_texture2d_array(size_t width, size_t height, size_t layers, PixelFormat format, size_t mips_count)
+{
+  engine_check(layers > 0);
+
+  return Texture(impl->context, TextureType_2DArray, width, height, layers, format, mips_count);
 }
 
 Texture Device::create_texture2d(const char* image_path, size_t mips_count)
@@ -119,20 +130,55 @@ Texture Device::create_texture2d(const char* image_path, size_t mips_count)
   media::image::Image image(image_path);
   Texture texture = create_texture2d(image.width(), image.height(), PixelFormat_RGBA8, mips_count);
 
-  texture.set_data(0, 0, 0, image.width(), image.height(), image.bitmap());
+  texture.set_data_async(0, 0, 0, image.width(), image.height(), image.bitmap());
   //texture.generate_mips();
 
   return texture;
 }
 
-VertexBuffer Device::create_vertex_buffer(size_t count)
+Texture Device::create_texture2d(const char* image_path, PixelFormat format, size_t mips_count)
+{
+  if (format == PixelFormat_RGBA8)
+    return create_texture2d(image_path, mips_count);
+
+  media::image::CompressionFormat compression_format;
+
+  if (!get_compression_format(format, compression_format))
+    throw Exception::format("Can't load texture '%s' with uncompressed pixel format %d (only RGBA8 is supported)", image_path, format);
+
+    //S3TC formats are optional for the driver
+
+  if ((format == PixelFormat_BC1 || format == PixelFormat_BC3) && !impl->context->capabilities().has_texture_compression_s3tc)
+  {
+    engine_log_info("S3TC texture compression isn't supported, loading '%s' as RGBA8", image_path);
+
+    return create_texture2d(image_path, mips_count);
+  }
+
+  media::image::Image image(image_path);
+  media::image::CompressedImage compressed_image(image, compression_format, mips_count);
+
+  Texture texture = create_texture2d(image.width(), image.height(), format, compressed_image.mips_count());
+
+  for (size_t level=0, count=compressed_image.mips_count(); level<count; level++)
+    texture.set_level_data_async(0, level, compressed_image.data(level));
+
+  return texture;
+}
+
+VertexBuffer Device::create_vertex_buffer(size_t count, VertexFormat format, BufferUsage usage)
 {
-  return VertexBuffer(impl->context, count);
+  return VertexBuffer(impl->context, count, format, usage);
 }
 
-IndexBuffer Device::create_index_buffer(size_t count)
+IndexBuffer Device::create_index_buffer(size_t count, IndexFormat format, BufferUsage usage)
 {
-  return IndexBuffer(impl->context, count);
+  return IndexBuffer(impl->context, count, format, usage);
+}
+
+GeometryStream Device::create_geometry_stream(size_t vertices_capacity, size_t indices_capacity, VertexFormat vertex_format, IndexFormat index_format)
+{
+  return GeometryStream(impl->context, vertices_capacity, indices_capacity, vertex_format, index_format);
 }
 
 Shader Device::create_vertex_shader(const char* name, const char* source_code)
@@ -140,6 +186,11 @@ Shader Device::create_vertex_shader(const char* name, const char* source_code)
   return Shader(impl->context, ShaderType_Vertex, name, source_code);
 }
 
+Shader Device::create_geometry_shader(const char* name, const char* source_code)
+{
+  return Shader(impl->context, ShaderType_Geometry, name, source_code);
+}
+
 Shader Device::create_pixel_shader(const char* name, const char* source_code)
 {
   return Shader(impl->context, ShaderType_Pixel, name, source_code);
@@ -150,6 +201,11 @@ Program Device::create_program(const char* name, const Shader& vertex_shader, co
   return Program(impl->context, name, vertex_shader, pixel_shader);
 }
 
+Program Device::create_program(const char* name, const Shader& vertex_shader, const Shader& geometry_shader, const Shader& pixel_shader)
+{
+  return Program(impl->context, name, vertex_shader, geometry_shader, pixel_shader);
+}
+
 Program Device::create_program_from_source(const char* name, const char* source_code)
 {
   engine_check_null(name);
@@ -218,6 +274,18 @@ Program Device::create_program_from_source(const char* name, const char* source_
 
   Shader vertex_shader = create_vertex_shader(common::format("vs.%s", name).c_str(), sources["vertex"].c_str());
   Shader pixel_shader = create_pixel_shader(common::format("ps.%s", name).c_str(), sources["pixel"].c_str());
+
+    //geometry stage is optional
+
+  auto geometry_source = sources.find("geometry");
+
+  if (geometry_source != sources.end())
+  {
+    Shader geometry_shader = create_geometry_shader(common::format("gs.%s", name).c_str(), geometry_source->second.c_str());
+
+    return create_program(name, vertex_shader, geometry_shader, pixel_shader);
+  }
+
   Program program = create_program(name, vertex_shader, pixel_shader);
 
   return program;
@@ -250,7 +318,7 @@ Pass Device::create_pass()
 
 Mesh Device::create_mesh(const media::geometry::Mesh& mesh, const MaterialList& materials)
 {
-  return Mesh(impl->context, mesh, materials);
+  return Mesh(impl->context, mesh, materials, impl->mesh_vertex_format, impl->mesh_position_streams);
 }
 
 Primitive Device::create_plane(const Material& material)
@@ -261,7 +329,7 @@ Primitive Device::create_plane(const Material& material)
     {math::vec3f(1.f, 1.f, 0), math::vec3f(0.f, 1.f, 0.f), math::vec4f(1.f, 1.f, 1.f, 1.0f), math::vec2f(1, 1)},
     {math::vec3f(1.f, -1.f, 0), math::vec3f(0.f, 1.f, 0.f), math::vec4f(1.f, 1.f, 1.f, 1.0f), math::vec2f(1, 0)},
   };
-  IndexBuffer::index_type indices [] = {2, 1, 0, 3, 2, 0};
+  uint16_t indices [] = {2, 1, 0, 3, 2, 0};
 
   VertexBuffer vertex_buffer = create_vertex_buffer(4);
   IndexBuffer index_buffer = create_index_buffer(6);
@@ -276,3 +344,18 @@ RenderBuffer Device::create_render_buffer(size_t width, size_t height, PixelForm
 {
   return RenderBuffer(impl->context, width, height, format);
 }
+
+const StateCacheStatistics& Device::state_cache_statistics() const
+{
+  return impl->context->state_cache().statistics();
+}
+
+void Device::end_frame()
+{
+  impl->context->end_frame();
+}
+
+ThreadPool& Device::thread_pool() const
+{
+  return impl->context->thread_pool();
+}
@@ -27,6 +27,7 @@ struct RenderTarget
   std::unique_ptr<RenderBuffer> render_buffer; //render_buffer
   bool is_colored; //is this color render target
   size_t mip_level; //mip level for rendering
+  bool is_layered; //all layers of the texture are attached
   TextureLevelInfo level_info; //texture level info
   RenderBufferInfo render_buffer_info; //texture object
   GLenum attachment; //attachment for this target
@@ -35,6 +36,7 @@ struct RenderTarget
     : type(RenderTargetType_Window)
     , is_colored(true)
     , mip_level()
+    , is_layered()
     , attachment(GL_BACK) //TODO: front/back window buffer rendering support
   {
   }
@@ -43,6 +45,7 @@ struct RenderTarget
     : type(RenderTargetType_Texture2D)
     , is_colored()
     , mip_level(mip_level)
+    , is_layered()
     , attachment()
   {
     engine_check_range(layer, in_texture.layers());
@@ -70,6 +73,7 @@ struct RenderTarget
     : type(RenderTargetType_RenderBuffer)
     , is_colored()
     , mip_level()
+    , is_layered()
     , attachment()
   {
     switch (in_render_buffer.format())
@@ -137,11 +141,7 @@ struct FrameBuffer::Impl
 
   Viewport get_default_viewport() const
   {
-    const Window& window = context->window();
-    int width = window.frame_buffer_width();
-    int height = window.frame_buffer_height();
-
-    return Viewport(0, 0, width, height);
+    return Viewport(0, 0, context->frame_buffer_width(), context->frame_buffer_height());
   }
 
   void bind()
@@ -154,7 +154,7 @@ struct FrameBuffer::Impl
     }
     else
     {
-      glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_id);
+      context->state_cache().bind_frame_buffer(frame_buffer_id);
     }
 
     context->check_errors();
@@ -165,9 +165,12 @@ struct FrameBuffer::Impl
     if (!frame_buffer_id)
       return;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    context->state_cache().bind_frame_buffer(0);
+
     glDeleteFramebuffers(1, &frame_buffer_id);
 
+    context->state_cache().on_frame_buffer_deleted(frame_buffer_id);
+
     frame_buffer_id = 0;
   }
 
@@ -186,7 +189,7 @@ struct FrameBuffer::Impl
     if (!frame_buffer_id)
       throw Exception::format("FBO creation failed");
 
-    glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_id);  
+    context->state_cache().bind_frame_buffer(frame_buffer_id);
 
     try
     {
@@ -203,8 +206,7 @@ struct FrameBuffer::Impl
             engine_check(&texture);
             engine_check(rt.is_colored);
 
-            glFramebufferTexture2D(GL_FRAMEBUFFER, rt.attachment, rt.level_info.target,
-              rt.level_info.texture_id, static_cast<GLint>(rt.mip_level));
+            attach_texture(rt);
 
             break;
           }
@@ -227,8 +229,7 @@ struct FrameBuffer::Impl
 
             engine_check(&texture);
 
-            glFramebufferTexture2D(GL_FRAMEBUFFER, depth_stencil_target->attachment, depth_stencil_target->level_info.target,
-                                   depth_stencil_target->level_info.texture_id, static_cast<GLint>(depth_stencil_target->mip_level));
+            attach_texture(*depth_stencil_target);
 
             break;
           }
@@ -259,6 +260,24 @@ struct FrameBuffer::Impl
     need_reconfigure = false;
   }
 
+  static void attach_texture(const RenderTarget& rt)
+  {
+    const TextureLevelInfo& info = rt.level_info;
+
+    if (rt.is_layered)
+    {
+      glFramebufferTexture(GL_FRAMEBUFFER, rt.attachment, info.texture_id, static_cast<GLint>(rt.mip_level));
+    }
+    else if (info.layer >= 0)
+    {
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, rt.attachment, info.texture_id, static_cast<GLint>(rt.mip_level), info.layer);
+    }
+    else
+    {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, rt.attachment, info.target, info.texture_id, static_cast<GLint>(rt.mip_level));
+    }
+  }
+
   static void check_frame_buffer_status(GLenum status)
   {
     switch (status)
@@ -294,6 +313,15 @@ FrameBuffer::FrameBuffer(const DeviceContextPtr& context, const Window& window)
   impl.reset(new Impl(context, true));
 }
 
+FrameBuffer::FrameBuffer(const DeviceContextPtr& context, size_t width, size_t height)
+{
+  engine_check(context);
+  engine_check(!context->has_window());
+  engine_check(int(width) == context->frame_buffer_width() && int(height) == context->frame_buffer_height());
+
+  impl.reset(new Impl(context, true));
+}
+
 void FrameBuffer::set_viewport(const Viewport& viewport)
 {
   impl->viewport = viewport;
@@ -324,13 +352,32 @@ const Viewport& FrameBuffer::viewport() const
   return impl->viewport;
 }
 
+void FrameBuffer::copy_depth(const FrameBuffer& source, const Viewport& source_rect, const Viewport& target_rect) const
+{
+  engine_check(source.impl->depth_stencil_target && impl->depth_stencil_target);
+
+    //source is bound first so both frame buffers are configured
+
+  source.impl->bind();
+  impl->bind();
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source.impl->frame_buffer_id);
+
+  glBlitFramebuffer(source_rect.x, source_rect.y, source_rect.x + source_rect.width, source_rect.y + source_rect.height,
+    target_rect.x, target_rect.y, target_rect.x + target_rect.width, target_rect.y + target_rect.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, impl->frame_buffer_id);
+
+  impl->context->check_errors();
+}
+
 void FrameBuffer::bind() const
 {
   impl->bind();
 
   const Viewport& v = impl->viewport;
 
-  glViewport(v.x, v.y, v.width, v.height);
+  impl->context->state_cache().set_viewport(v.x, v.y, v.width, v.height);
 
     //configure MRT
 
@@ -425,6 +472,22 @@ void FrameBuffer::attach_depth_buffer(const RenderBuffer& render_buffer)
   impl->need_reconfigure = true;
 }
 
+void FrameBuffer::attach_layered_depth_buffer(const Texture& texture, size_t mip_level)
+{
+  engine_check(!impl->depth_stencil_target);
+
+  std::unique_ptr<RenderTarget> new_target = std::make_unique<RenderTarget>(texture, 0, mip_level, 0);
+
+  engine_check(!new_target->is_colored);
+  engine_check(new_target->level_info.layer >= 0);
+
+  new_target->is_layered = true;
+
+  impl->depth_stencil_target.swap(new_target);
+
+  impl->need_reconfigure = true;
+}
+
 void FrameBuffer::detach_depth_buffer()
 {
   unimplemented();
@@ -0,0 +1,147 @@
+#include "shared.h"
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+namespace
+{
+
+/// Constants
+static constexpr GLuint64 FENCE_WAIT_TIMEOUT = 1000000000; //timeout of one wait attempt (nanoseconds)
+
+}
+
+/// Implementation details of frame fences
+struct FrameFences::Impl
+{
+  GLsync fences[FRAMES_IN_FLIGHT]; //fences of the last frames (null for completed frames)
+  size_t frame; //index of the current frame
+
+  Impl()
+    : frame()
+  {
+    std::fill(fences, fences + FRAMES_IN_FLIGHT, nullptr);
+  }
+
+  ~Impl()
+  {
+    try
+    {
+      for (GLsync fence : fences)
+        if (fence)
+          glDeleteSync(fence);
+    }
+    catch (...)
+    {
+      //ignore exceptions in destructors
+    }
+  }
+
+  /// Frame which fence reports completion of the finished frame (fences of frames which have left the ring are dropped)
+  size_t get_fence_frame(size_t finished_frame) const
+  {
+    return frame - finished_frame > FRAMES_IN_FLIGHT ? frame - FRAMES_IN_FLIGHT : finished_frame;
+  }
+
+  /// Delete fences of the completed frame and older frames (frames are completed in order)
+  void release_fences(size_t completed_frame)
+  {
+    for (size_t i=0; i<FRAMES_IN_FLIGHT && i<frame; i++)
+    {
+      size_t fence_frame = frame - 1 - i;
+
+      if (fence_frame > completed_frame)
+        continue;
+
+      GLsync& fence = fences[fence_frame % FRAMES_IN_FLIGHT];
+
+      if (fence)
+      {
+        glDeleteSync(fence);
+        fence = nullptr;
+      }
+    }
+  }
+};
+
+FrameFences::FrameFences()
+  : impl(std::make_unique<Impl>())
+{
+}
+
+FrameFences::~FrameFences()
+{
+}
+
+size_t FrameFences::current_frame() const
+{
+  return impl->frame;
+}
+
+void FrameFences::end_frame()
+{
+    //fence of the frame which has left the ring is dropped (its resources are reused after waiting for newer frames)
+
+  GLsync& fence = impl->fences[impl->frame % FRAMES_IN_FLIGHT];
+
+  if (fence)
+    glDeleteSync(fence);
+
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  if (!fence)
+    throw Exception::format("Can't create frame fence");
+
+  impl->frame++;
+}
+
+void FrameFences::wait_frame(size_t frame)
+{
+  if (frame >= impl->frame)
+    throw Exception::format("Can't wait for frame %u which hasn't been finished (current frame is %u)", (unsigned int)frame, (unsigned int)impl->frame);
+
+  frame = impl->get_fence_frame(frame);
+
+  GLsync fence = impl->fences[frame % FRAMES_IN_FLIGHT];
+
+  if (!fence)
+    return;
+
+  for (;;)
+  {
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+      break;
+
+    if (status != GL_TIMEOUT_EXPIRED)
+      throw Exception::format("Frame fence wait failed");
+  }
+
+  impl->release_fences(frame);
+}
+
+bool FrameFences::is_frame_completed(size_t frame)
+{
+  if (frame >= impl->frame)
+    return false;
+
+  frame = impl->get_fence_frame(frame);
+
+  GLsync fence = impl->fences[frame % FRAMES_IN_FLIGHT];
+
+  if (!fence)
+    return true;
+
+  GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+  if (status == GL_TIMEOUT_EXPIRED)
+    return false;
+
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    throw Exception::format("Frame fence check failed");
+
+  impl->release_fences(frame);
+
+  return true;
+}
@@ -0,0 +1,120 @@
+#include "shared.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+namespace
+{
+
+/// Constants
+static constexpr size_t NO_FRAME = ~size_t(0); //buffer hasn't been used yet
+
+/// Ring of per-frame buffers; buffer of a frame is reused after the GPU has completed the frame which used it last time
+template <class Buffer, class Format> class BufferRing
+{
+  public:
+    BufferRing(const DeviceContextPtr& context, size_t capacity, Format format, size_t alignment)
+      : context(context)
+      , format(format)
+      , alignment(alignment)
+      , offset()
+      , current_frame(NO_FRAME)
+      , current_buffer()
+    {
+      capacity = align(std::max(capacity, size_t(1)));
+
+      buffers.reserve(FrameFences::FRAMES_IN_FLIGHT);
+
+      for (size_t i=0; i<FrameFences::FRAMES_IN_FLIGHT; i++)
+        buffers.emplace_back(context, capacity, format, BufferUsage_Stream);
+
+      capacities.resize(FrameFences::FRAMES_IN_FLIGHT, capacity);
+      frames.resize(FrameFences::FRAMES_IN_FLIGHT, NO_FRAME);
+    }
+
+    Buffer allocate(size_t count, size_t& first)
+    {
+      FrameFences& fences = context->frame_fences();
+      size_t frame = fences.current_frame();
+
+        //switch to the next buffer of the ring on a new frame; the GPU has to finish the frame which used the buffer before
+
+      if (frame != current_frame)
+      {
+        current_buffer = frame % buffers.size();
+        current_frame = frame;
+        offset = 0;
+
+        if (frames[current_buffer] != NO_FRAME)
+          fences.wait_frame(frames[current_buffer]);
+
+        frames[current_buffer] = frame;
+      }
+
+        //grow buffer of the frame; ranges which have been allocated before stay in the previous buffer object
+
+      size_t range_offset = align(offset);
+      size_t& capacity = capacities[current_buffer];
+
+      if (range_offset + count > capacity)
+      {
+        capacity = std::max(capacity * 2, align(range_offset + count));
+
+        buffers[current_buffer] = Buffer(context, capacity, format, BufferUsage_Stream);
+
+        range_offset = 0;
+      }
+
+      first = range_offset;
+      offset = range_offset + count;
+
+      return buffers[current_buffer];
+    }
+
+  private:
+    size_t align(size_t value) const { return (value + alignment - 1) / alignment * alignment; }
+
+  private:
+    DeviceContextPtr context; //device context
+    Format format; //elements format
+    size_t alignment; //alignment of ranges (in elements)
+    size_t offset; //allocation offset in the current buffer
+    size_t current_frame; //frame of the current buffer
+    size_t current_buffer; //index of the current buffer
+    std::vector<Buffer> buffers; //buffers of the ring
+    std::vector<size_t> capacities; //capacities of buffers (in elements)
+    std::vector<size_t> frames; //frames which have used buffers last time
+};
+
+}
+
+/// Implementation details of geometry stream
+struct GeometryStream::Impl
+{
+  BufferRing<VertexBuffer, VertexFormat> vertices; //vertices ring
+  BufferRing<IndexBuffer, IndexFormat> indices; //indices ring
+
+  Impl(const DeviceContextPtr& context, size_t vertices_capacity, size_t indices_capacity, VertexFormat vertex_format, IndexFormat index_format)
+    : vertices(context, vertices_capacity, vertex_format, 1)
+    , indices(context, indices_capacity, index_format, 3)
+  {
+  }
+};
+
+GeometryStream::GeometryStream(const DeviceContextPtr& context, size_t vertices_capacity, size_t indices_capacity, VertexFormat vertex_format, IndexFormat index_format)
+  : impl(std::make_shared<Impl>(context, vertices_capacity, indices_capacity, vertex_format, index_format))
+{
+}
+
+VertexBuffer GeometryStream::allocate_vertices(size_t count, size_t& first_vertex)
+{
+  return impl->vertices.allocate(count, first_vertex);
+}
+
+IndexBuffer GeometryStream::allocate_indices(size_t count, size_t& first_index)
+{
+  return impl->indices.allocate(count, first_index);
+}
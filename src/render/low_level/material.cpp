@@ -1,12 +1,27 @@
 #include "shared.h"
 
+#include <atomic>
+
 using namespace engine::render::low_level;
 using namespace engine::common;
 
+namespace
+{
+
+std::atomic<size_t> next_material_id(1); //materials identifiers generator
+
+}
+
 struct Material::Impl
 {
   PropertyMap properties; //shader properties
   TextureList textures; //texture maps
+  size_t id; //unique identifier
+
+  Impl()
+    : id(next_material_id++)
+  {
+  }
 };
 
 Material::Material()
@@ -23,3 +38,8 @@ const PropertyMap& Material::properties() const
 {
   return impl->properties;
 }
+
+size_t Material::id() const
+{
+  return impl->id;
+}
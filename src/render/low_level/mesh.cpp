@@ -6,37 +6,123 @@ using namespace engine::render::low_level;
 
 typedef std::vector<Primitive> PrimitiveArray;
 
+static constexpr uint32_t MAX_UINT16_VERTICES_COUNT = 0x10000; //number of vertices addressable with 16-bit indices
+
+namespace
+{
+
+/// Select index format for a mesh; primitives which don't fit 16-bit indices are split into 16-bit chunks when it saves memory
+engine::media::geometry::Mesh prepare_mesh(const engine::media::geometry::Mesh& mesh, size_t vertex_size, IndexFormat& format)
+{
+  format = IndexFormat_UInt16;
+
+  if (mesh.max_index() < MAX_UINT16_VERTICES_COUNT)
+    return mesh;
+
+    //compare size of split mesh with 16-bit indices against size of source mesh with 32-bit indices
+
+  engine::media::geometry::Mesh split_mesh = mesh.split(MAX_UINT16_VERTICES_COUNT);
+
+  size_t split_mesh_size = split_mesh.vertices_count() * vertex_size + split_mesh.indices_count() * sizeof(uint16_t),
+         mesh_size       = mesh.vertices_count() * vertex_size + mesh.indices_count() * sizeof(uint32_t);
+
+  if (split_mesh_size < mesh_size)
+    return split_mesh;
+
+  format = IndexFormat_UInt32;
+
+  return mesh;
+}
+
+}
+
 /// Implementation details of mesh
 struct Mesh::Impl
 {
   DeviceContextPtr context; //device context
   VertexBuffer vertex_buffer; //vertex buffer
+  VertexBuffer position_buffer; //tightly packed positions stream (vertex buffer if there is no separate stream)
   IndexBuffer index_buffer; //index buffer
   PrimitiveArray primitives; //primitives
 
-  Impl(const DeviceContextPtr& context, const media::geometry::Mesh& mesh, const MaterialList& materials)
+  Impl(const DeviceContextPtr& context,
+       const media::geometry::Mesh& mesh,
+       VertexFormat vertex_format,
+       bool position_stream,
+       IndexFormat index_format,
+       const MaterialList& materials)
     : context(context)
-    , vertex_buffer(context, mesh.vertices_count())
-    , index_buffer(context, mesh.indices_count())
+    , vertex_buffer(context, mesh.vertices_count(), vertex_format)
+    , position_buffer(position_stream ? VertexBuffer(context, mesh.vertices_count(), VertexFormat_Position) : vertex_buffer)
+    , index_buffer(context, mesh.indices_count(), index_format)
   {
     primitives.reserve(mesh.primitives_count());
 
-    vertex_buffer.set_data(0, mesh.vertices_count(), mesh.vertices_data());
-    index_buffer.set_data(0, mesh.indices_count(), mesh.indices_data());
+    switch (vertex_format)
+    {
+      case VertexFormat_Float:
+        vertex_buffer.set_data(0, mesh.vertices_count(), mesh.vertices_data());
+        break;
+      case VertexFormat_Packed:
+      {
+        std::vector<PackedVertex> vertices(mesh.vertices_count());
+
+        media::geometry::pack_vertices(mesh.vertices_data(), vertices.size(), vertices.data());
+
+        vertex_buffer.set_data(0, vertices.size(), vertices.data());
+
+        break;
+      }
+      default:
+        throw common::Exception::format("Unexpected vertex format %d", vertex_format);
+    }
+
+    if (position_stream)
+    {
+      std::vector<math::vec3f> positions(mesh.vertices_count());
+      const Vertex* vertex = mesh.vertices_data();
+
+      for (math::vec3f& position : positions)
+        position = (vertex++)->position;
+
+      position_buffer.set_data(0, positions.size(), positions.data());
+    }
+
+    switch (index_format)
+    {
+      case IndexFormat_UInt16:
+      {
+        std::vector<uint16_t> indices(mesh.indices_data(), mesh.indices_data() + mesh.indices_count());
+
+        index_buffer.set_data(0, indices.size(), indices.data());
+
+        break;
+      }
+      case IndexFormat_UInt32:
+        index_buffer.set_data(0, mesh.indices_count(), mesh.indices_data());
+        break;
+      default:
+        throw common::Exception::format("Unexpected index format %d", index_format);
+    }
 
     for (uint32_t i = 0, count = mesh.primitives_count(); i < count; i++)
     {
       const media::geometry::Primitive& src_primitive = mesh.primitive(i);
       Material material = materials.get(src_primitive.material.c_str());
 
-      primitives.emplace_back(Primitive(material, src_primitive.type, vertex_buffer, index_buffer, src_primitive.first, src_primitive.count, src_primitive.base_vertex));
+      primitives.emplace_back(Primitive(material, src_primitive.type, vertex_buffer, position_buffer, index_buffer, src_primitive.first, src_primitive.count, src_primitive.base_vertex));
     }
   }
 };
 
-Mesh::Mesh(const DeviceContextPtr& context, const media::geometry::Mesh& mesh, const MaterialList& materials)
-  : impl(std::make_shared<Impl>(context, mesh, materials))
+Mesh::Mesh(const DeviceContextPtr& context, const media::geometry::Mesh& mesh, const MaterialList& materials, VertexFormat vertex_format, bool position_stream)
 {
+  size_t vertex_size = (vertex_format == VertexFormat_Packed ? sizeof(PackedVertex) : sizeof(Vertex)) + (position_stream ? sizeof(math::vec3f) : 0);
+
+  IndexFormat index_format = IndexFormat_UInt16;
+  media::geometry::Mesh prepared_mesh = prepare_mesh(mesh, vertex_size, index_format);
+
+  impl = std::make_shared<Impl>(context, prepared_mesh, vertex_format, position_stream, index_format, materials);
 }
 
 size_t Mesh::primitives_count() const
@@ -0,0 +1,1044 @@
+#include "shared.h"
+
+#include <cctype>
+#include <cstdlib>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+///
+/// Constants
+///
+
+static const char* NULL_DRIVER_VERSION = "4.1 Null Driver";
+static const char* NULL_DRIVER_VENDOR = "engine";
+static const char* NULL_DRIVER_RENDERER = "Null Driver";
+static const char* NULL_DRIVER_SHADING_LANGUAGE_VERSION = "4.10";
+static constexpr GLint NULL_DRIVER_TEXTURE_UNITS_COUNT = 16; //number of emulated texture units
+static constexpr GLint NULL_DRIVER_UNIFORM_BUFFER_OFFSET_ALIGNMENT = 256; //alignment of uniform buffer ranges
+static const char* NULL_DRIVER_EXTENSIONS [] = {"GL_ARB_base_instance", "GL_ARB_multi_draw_indirect", "GL_EXT_texture_compression_s3tc"}; //emulated extensions
+
+///
+/// Shader sources reflection
+///
+
+namespace
+{
+
+/// Reflected shader variable (uniform or vertex attribute)
+struct ShaderVariable
+{
+  std::string name; //variable name
+  GLenum type; //GL type of the variable
+  GLint elements_count; //number of array elements
+  GLint location; //location of the variable
+  GLint block_index; //index of the uniform block (-1 for default block uniforms)
+  GLint offset; //offset in the uniform block
+  GLint array_stride; //stride of array elements in the uniform block
+  GLint matrix_stride; //stride of matrix columns in the uniform block
+
+  ShaderVariable(const std::string& name, GLenum type, GLint elements_count)
+    : name(name)
+    , type(type)
+    , elements_count(elements_count)
+    , location(-1)
+    , block_index(-1)
+    , offset(-1)
+    , array_stride()
+    , matrix_stride()
+  {
+  }
+};
+
+typedef std::vector<ShaderVariable> ShaderVariableArray;
+
+/// Reflected uniform block (std140 layout)
+struct ShaderUniformBlock
+{
+  std::string name; //block name
+  ShaderVariableArray members; //block members
+  GLint data_size; //size of the block data
+  GLint binding; //uniform buffer binding point
+
+  ShaderUniformBlock(const std::string& name)
+    : name(name)
+    , data_size()
+    , binding()
+  {
+  }
+};
+
+typedef std::vector<ShaderUniformBlock> ShaderUniformBlockArray;
+
+typedef std::unordered_map<std::string, std::string> MacroMap;
+
+/// Very basic GLSL declarations parser (global scope declarations only)
+class ShaderSourceParser
+{
+  public:
+    ShaderSourceParser(const std::string& source)
+    {
+      tokenize(source);
+    }
+
+    /// Parse global declarations with a given storage qualifier ("uniform", "in")
+    void parse_declarations(const char* qualifier, ShaderVariableArray& out_variables) const
+    {
+      size_t depth = 0, statement_start = 0;
+
+      for (size_t i=0, count=tokens.size(); i<count; i++)
+      {
+        const std::string& token = tokens[i];
+
+        if (token == "{" || token == "(") depth++;
+        else if (token == "}" || token == ")")
+        {
+          if (depth)
+            depth--;
+
+          if (!depth && token == "}")
+            statement_start = i + 1;
+        }
+        else if (token == ";" && !depth)
+        {
+          parse_statement(qualifier, statement_start, i, out_variables);
+
+          statement_start = i + 1;
+        }
+      }
+    }
+
+    /// Parse global uniform blocks declarations; members offsets are assigned by std140 rules
+    void parse_uniform_blocks(ShaderUniformBlockArray& out_blocks) const
+    {
+      size_t depth = 0;
+
+      for (size_t i=0, count=tokens.size(); i<count; i++)
+      {
+        const std::string& token = tokens[i];
+
+        if (token == "{" || token == "(") depth++;
+        else if ((token == "}" || token == ")") && depth) depth--;
+        else if (token == "uniform" && !depth && i + 2 < count && tokens[i + 2] == "{")
+        {
+          ShaderUniformBlock block(tokens[i + 1]);
+          size_t statement_start = i + 3;
+
+          for (i+=3; i<count && tokens[i] != "}"; i++)
+          {
+            if (tokens[i] != ";")
+              continue;
+
+            parse_statement(nullptr, statement_start, i, block.members);
+
+            statement_start = i + 1;
+          }
+
+          assign_std140_layout(block);
+
+          out_blocks.emplace_back(std::move(block));
+        }
+      }
+    }
+
+  private:
+    static GLint align(GLint value, GLint alignment)
+    {
+      return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static void assign_std140_layout(ShaderUniformBlock& block)
+    {
+      GLint offset = 0;
+
+      for (auto& member : block.members)
+      {
+        GLint alignment = 4, size = 4;
+
+        switch (member.type)
+        {
+          case GL_FLOAT_VEC2: alignment = 8; size = 8; break;
+          case GL_FLOAT_VEC3: alignment = 16; size = 12; break;
+          case GL_FLOAT_VEC4: alignment = 16; size = 16; break;
+          case GL_FLOAT_MAT3: alignment = 16; size = 48; member.matrix_stride = 16; break;
+          case GL_FLOAT_MAT4: alignment = 16; size = 64; member.matrix_stride = 16; break;
+          default:            break;
+        }
+
+          //array elements are aligned to vec4
+
+        if (member.elements_count > 1)
+        {
+          alignment = 16;
+          member.array_stride = align(size, 16);
+          size = member.array_stride * member.elements_count;
+        }
+
+        member.offset = align(offset, alignment);
+        offset = member.offset + size;
+      }
+
+      block.data_size = align(offset, 16);
+    }
+
+    void tokenize(const std::string& source)
+    {
+      const char* pos = source.c_str();
+
+      while (*pos)
+      {
+          //skip spaces and comments
+
+        if (isspace(*pos))
+        {
+          pos++;
+          continue;
+        }
+
+        if (pos[0] == '/' && pos[1] == '/')
+        {
+          for (; *pos && *pos != '\n'; pos++);
+          continue;
+        }
+
+        if (pos[0] == '/' && pos[1] == '*')
+        {
+          const char* end = strstr(pos + 2, "*/");
+          pos = end ? end + 2 : pos + strlen(pos);
+          continue;
+        }
+
+          //preprocessor lines
+
+        if (*pos == '#')
+        {
+          const char* line_end = pos;
+
+          for (; *line_end && *line_end != '\n'; line_end++);
+
+          std::vector<std::string> words = split(std::string(pos + 1, line_end).c_str());
+
+          if (words.size() >= 3 && words[0] == "define")
+            macros[words[1]] = words[2];
+
+          pos = line_end;
+
+          continue;
+        }
+
+          //identifiers and numbers
+
+        if (isalnum(*pos) || *pos == '_')
+        {
+          const char* start = pos;
+
+          for (; isalnum(*pos) || *pos == '_' || *pos == '.'; pos++);
+
+          tokens.emplace_back(start, pos);
+
+          continue;
+        }
+
+          //punctuation
+
+        tokens.emplace_back(pos, pos + 1);
+
+        pos++;
+      }
+    }
+
+    GLint resolve_array_size(const std::string& token) const
+    {
+      auto it = macros.find(token);
+
+      const std::string& value = it != macros.end() ? it->second : token;
+
+      GLint size = atoi(value.c_str());
+
+      return size > 0 ? size : 1;
+    }
+
+    static GLenum get_type(const std::string& type)
+    {
+      static const struct
+      {
+        const char* name;
+        GLenum type;
+      } TYPES[] = {
+        {"int", GL_INT},
+        {"float", GL_FLOAT},
+        {"vec2", GL_FLOAT_VEC2},
+        {"vec3", GL_FLOAT_VEC3},
+        {"vec4", GL_FLOAT_VEC4},
+        {"mat3", GL_FLOAT_MAT3},
+        {"mat4", GL_FLOAT_MAT4},
+        {"sampler1D", GL_SAMPLER_1D},
+        {"sampler2D", GL_SAMPLER_2D},
+        {"sampler3D", GL_SAMPLER_3D},
+        {"samplerCube", GL_SAMPLER_CUBE},
+        {"sampler1DShadow", GL_SAMPLER_1D_SHADOW},
+        {"sampler2DShadow", GL_SAMPLER_2D_SHADOW},
+        {"sampler2DRect", GL_SAMPLER_2D_RECT},
+        {"sampler2DRectShadow", GL_SAMPLER_2D_RECT_SHADOW},
+        {"sampler2DArray", GL_SAMPLER_2D_ARRAY},
+        {"sampler2DArrayShadow", GL_SAMPLER_2D_ARRAY_SHADOW},
+      };
+
+      for (const auto& desc : TYPES)
+        if (type == desc.name)
+          return desc.type;
+
+      return GL_NONE;
+    }
+
+    static bool is_skipped_qualifier(const std::string& token)
+    {
+      return token == "lowp" || token == "mediump" || token == "highp" || token == "flat" || token == "smooth" || token == "noperspective";
+    }
+
+    void parse_statement(const char* qualifier, size_t first, size_t last, ShaderVariableArray& out_variables) const
+    {
+      size_t pos = first;
+
+        //skip layout qualifiers
+
+      if (pos < last && tokens[pos] == "layout")
+      {
+        size_t depth = 0;
+
+        for (pos++; pos < last; pos++)
+        {
+          if (tokens[pos] == "(") depth++;
+          else if (tokens[pos] == ")" && !--depth)
+          {
+            pos++;
+            break;
+          }
+        }
+      }
+
+      for (; pos < last && is_skipped_qualifier(tokens[pos]); pos++);
+
+        //block members have no storage qualifier
+
+      if (qualifier)
+      {
+        if (pos >= last || tokens[pos] != qualifier)
+          return;
+
+        for (pos++; pos < last && is_skipped_qualifier(tokens[pos]); pos++);
+      }
+
+      if (pos >= last)
+        return;
+
+      GLenum type = get_type(tokens[pos++]);
+
+        //parse declarators list
+
+      while (pos < last)
+      {
+        const std::string& name = tokens[pos++];
+        GLint elements_count = 1;
+
+        if (pos < last && tokens[pos] == "[")
+        {
+          if (pos + 1 < last)
+            elements_count = resolve_array_size(tokens[pos + 1]);
+
+          for (; pos < last && tokens[pos] != "]"; pos++);
+
+          pos++;
+        }
+
+        out_variables.emplace_back(name, type, elements_count);
+
+        for (; pos < last && tokens[pos] != ","; pos++); //skip initializers
+
+        pos++;
+      }
+    }
+
+  private:
+    std::vector<std::string> tokens;
+    MacroMap macros;
+};
+
+///
+/// Driver objects
+///
+
+/// Shader object
+struct NullShader
+{
+  GLenum type; //shader type
+  std::string source; //shader source code
+};
+
+/// Program object
+struct NullProgram
+{
+  std::vector<GLuint> shaders; //attached shaders
+  ShaderVariableArray uniforms; //active uniforms
+  ShaderVariableArray attributes; //active vertex attributes
+  ShaderVariableArray outputs; //pixel shader outputs
+  ShaderUniformBlockArray uniform_blocks; //active uniform blocks
+
+  const ShaderVariable* find(const ShaderVariableArray& variables, const char* name) const
+  {
+    if (!name)
+      return nullptr;
+
+    std::string name_string = name;
+
+    if (name_string.size() > 3 && name_string.compare(name_string.size() - 3, 3, "[0]") == 0)
+      name_string.resize(name_string.size() - 3);
+
+    for (const auto& variable : variables)
+      if (variable.name == name_string)
+        return &variable;
+
+    return nullptr;
+  }
+};
+
+/// Null driver state
+struct NullDriver
+{
+  GLuint next_object_id; //next free object name
+  std::unordered_map<GLuint, NullShader> shaders; //shaders
+  std::unordered_map<GLuint, NullProgram> programs; //programs
+  std::vector<char> mapped_data; //storage of mapped buffer ranges (written data is discarded)
+
+  NullDriver()
+    : next_object_id(1)
+  {
+  }
+
+  static NullDriver& instance()
+  {
+    static NullDriver driver;
+    return driver;
+  }
+};
+
+/// Number of vertex attribute locations occupied by a variable of the type
+GLint get_attribute_locations_count(GLenum type)
+{
+  switch (type)
+  {
+    case GL_FLOAT_MAT3: return 3;
+    case GL_FLOAT_MAT4: return 4;
+    default:            return 1;
+  }
+}
+
+/// Link program: reflect uniforms and attributes from the attached shaders sources
+void link_program(NullProgram& program)
+{
+  NullDriver& driver = NullDriver::instance();
+
+  program.uniforms.clear();
+  program.attributes.clear();
+  program.outputs.clear();
+  program.uniform_blocks.clear();
+
+  for (GLuint shader_id : program.shaders)
+  {
+    auto it = driver.shaders.find(shader_id);
+
+    if (it == driver.shaders.end())
+      continue;
+
+    ShaderSourceParser parser(it->second.source);
+    ShaderVariableArray uniforms;
+
+    parser.parse_declarations("uniform", uniforms);
+
+    for (auto& uniform : uniforms)
+      if (!program.find(program.uniforms, uniform.name.c_str()))
+        program.uniforms.push_back(uniform);
+
+      //blocks with the same name are shared between stages
+
+    ShaderUniformBlockArray blocks;
+
+    parser.parse_uniform_blocks(blocks);
+
+    for (auto& block : blocks)
+    {
+      bool is_found = false;
+
+      for (const auto& program_block : program.uniform_blocks)
+        is_found |= program_block.name == block.name;
+
+      if (!is_found)
+        program.uniform_blocks.emplace_back(std::move(block));
+    }
+
+    if (it->second.type == GL_VERTEX_SHADER)
+      parser.parse_declarations("in", program.attributes);
+
+    if (it->second.type == GL_FRAGMENT_SHADER)
+      parser.parse_declarations("out", program.outputs);
+  }
+
+    //assign locations (block members have no locations)
+
+  GLint location = 0;
+
+  for (auto& uniform : program.uniforms)
+  {
+    uniform.location = location;
+    location += uniform.elements_count;
+  }
+
+  for (size_t i=0; i<program.uniform_blocks.size(); i++)
+  {
+    for (auto member : program.uniform_blocks[i].members)
+    {
+      member.block_index = static_cast<GLint>(i);
+
+      program.uniforms.push_back(member);
+    }
+  }
+
+  location = 0;
+
+  for (auto& attribute : program.attributes)
+  {
+    attribute.location = location;
+    location += get_attribute_locations_count(attribute.type) * attribute.elements_count;
+  }
+
+  location = 0;
+
+  for (auto& output : program.outputs)
+    output.location = location++;
+}
+
+NullProgram* find_program(GLuint program)
+{
+  NullDriver& driver = NullDriver::instance();
+
+  auto it = driver.programs.find(program);
+
+  return it != driver.programs.end() ? &it->second : nullptr;
+}
+
+///
+/// Driver entry points
+///
+
+/// Calls which are accepted and ignored
+template <class Fn> struct IgnoredCall;
+
+template <class Ret, class... Args> struct IgnoredCall<Ret (APIENTRY*)(Args...)>
+{
+  static Ret APIENTRY call(Args...) { return Ret(); }
+};
+
+void APIENTRY gen_objects(GLsizei count, GLuint* ids)
+{
+  NullDriver& driver = NullDriver::instance();
+
+  for (GLsizei i=0; i<count; i++)
+    ids[i] = driver.next_object_id++;
+}
+
+GLsync APIENTRY fence_sync(GLenum, GLbitfield)
+{
+  NullDriver& driver = NullDriver::instance();
+
+  return reinterpret_cast<GLsync>(static_cast<uintptr_t>(driver.next_object_id++));
+}
+
+GLenum APIENTRY client_wait_sync(GLsync, GLbitfield, GLuint64)
+{
+  return GL_ALREADY_SIGNALED;
+}
+
+void* APIENTRY map_buffer_range(GLenum, GLintptr, GLsizeiptr length, GLbitfield)
+{
+  NullDriver& driver = NullDriver::instance();
+
+  if (driver.mapped_data.size() < size_t(length))
+    driver.mapped_data.resize(size_t(length));
+
+  return driver.mapped_data.data();
+}
+
+GLboolean APIENTRY unmap_buffer(GLenum)
+{
+  return GL_TRUE;
+}
+
+GLenum APIENTRY get_error()
+{
+  return GL_NO_ERROR;
+}
+
+const GLubyte* APIENTRY get_string(GLenum name)
+{
+  switch (name)
+  {
+    case GL_VERSION:                  return reinterpret_cast<const GLubyte*>(NULL_DRIVER_VERSION);
+    case GL_VENDOR:                   return reinterpret_cast<const GLubyte*>(NULL_DRIVER_VENDOR);
+    case GL_RENDERER:                 return reinterpret_cast<const GLubyte*>(NULL_DRIVER_RENDERER);
+    case GL_SHADING_LANGUAGE_VERSION: return reinterpret_cast<const GLubyte*>(NULL_DRIVER_SHADING_LANGUAGE_VERSION);
+    default:                          return reinterpret_cast<const GLubyte*>("");
+  }
+}
+
+const GLubyte* APIENTRY get_string_indexed(GLenum name, GLuint index)
+{
+  if (name == GL_EXTENSIONS && index < sizeof(NULL_DRIVER_EXTENSIONS) / sizeof(*NULL_DRIVER_EXTENSIONS))
+    return reinterpret_cast<const GLubyte*>(NULL_DRIVER_EXTENSIONS[index]);
+
+  return reinterpret_cast<const GLubyte*>("");
+}
+
+void APIENTRY get_integer(GLenum name, GLint* value)
+{
+  switch (name)
+  {
+    case GL_MAJOR_VERSION:            *value = 4; break;
+    case GL_MINOR_VERSION:            *value = 1; break;
+    case GL_MAX_TEXTURE_IMAGE_UNITS:  *value = NULL_DRIVER_TEXTURE_UNITS_COUNT; break;
+    case GL_NUM_EXTENSIONS:           *value = GLint(sizeof(NULL_DRIVER_EXTENSIONS) / sizeof(*NULL_DRIVER_EXTENSIONS)); break;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *value = NULL_DRIVER_UNIFORM_BUFFER_OFFSET_ALIGNMENT; break;
+    default:                          *value = 0; break;
+  }
+}
+
+void APIENTRY get_query_object(GLuint, GLenum name, GLuint* value)
+{
+    //queries are completed immediately and nothing is rendered
+
+  *value = name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+GLenum APIENTRY check_frame_buffer_status(GLenum)
+{
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+GLuint APIENTRY create_shader(GLenum type)
+{
+  NullDriver& driver = NullDriver::instance();
+  GLuint id = driver.next_object_id++;
+
+  driver.shaders[id].type = type;
+
+  return id;
+}
+
+void APIENTRY delete_shader(GLuint shader)
+{
+  NullDriver::instance().shaders.erase(shader);
+}
+
+void APIENTRY shader_source(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+{
+  NullDriver& driver = NullDriver::instance();
+
+  auto it = driver.shaders.find(shader);
+
+  if (it == driver.shaders.end())
+    return;
+
+  std::string& source = it->second.source;
+
+  source.clear();
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    if (lengths && lengths[i] >= 0) source.append(strings[i], lengths[i]);
+    else                            source.append(strings[i]);
+  }
+}
+
+void APIENTRY get_shader(GLuint, GLenum name, GLint* value)
+{
+  switch (name)
+  {
+    case GL_COMPILE_STATUS: *value = GL_TRUE; break;
+    default:                *value = 0; break;
+  }
+}
+
+GLuint APIENTRY create_program()
+{
+  NullDriver& driver = NullDriver::instance();
+  GLuint id = driver.next_object_id++;
+
+  driver.programs[id];
+
+  return id;
+}
+
+void APIENTRY delete_program(GLuint program)
+{
+  NullDriver::instance().programs.erase(program);
+}
+
+void APIENTRY attach_shader(GLuint program, GLuint shader)
+{
+  if (NullProgram* null_program = find_program(program))
+    null_program->shaders.push_back(shader);
+}
+
+void APIENTRY detach_shader(GLuint program, GLuint shader)
+{
+  if (NullProgram* null_program = find_program(program))
+  {
+    auto& shaders = null_program->shaders;
+
+    shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+  }
+}
+
+void APIENTRY link_program(GLuint program)
+{
+  if (NullProgram* null_program = find_program(program))
+    link_program(*null_program);
+}
+
+void APIENTRY get_program(GLuint program, GLenum name, GLint* value)
+{
+  NullProgram* null_program = find_program(program);
+
+  *value = 0;
+
+  if (!null_program)
+    return;
+
+  switch (name)
+  {
+    case GL_LINK_STATUS:
+      *value = GL_TRUE;
+      break;
+    case GL_ACTIVE_UNIFORMS:
+      *value = static_cast<GLint>(null_program->uniforms.size());
+      break;
+    case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+      for (const auto& uniform : null_program->uniforms)
+        *value = std::max(*value, static_cast<GLint>(uniform.name.size() + sizeof("[0]")));
+      break;
+    case GL_ACTIVE_UNIFORM_BLOCKS:
+      *value = static_cast<GLint>(null_program->uniform_blocks.size());
+      break;
+    case GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH:
+      for (const auto& block : null_program->uniform_blocks)
+        *value = std::max(*value, static_cast<GLint>(block.name.size() + 1));
+      break;
+    default:
+      break;
+  }
+}
+
+void APIENTRY get_active_uniform(GLuint program, GLuint index, GLsizei buffer_size, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program || index >= null_program->uniforms.size() || buffer_size <= 0)
+    return;
+
+  const ShaderVariable& uniform = null_program->uniforms[index];
+  std::string uniform_name = uniform.elements_count > 1 ? uniform.name + "[0]" : uniform.name;
+
+  GLsizei name_length = std::min(static_cast<GLsizei>(uniform_name.size()), buffer_size - 1);
+
+  memcpy(name, uniform_name.c_str(), name_length);
+
+  name[name_length] = '\0';
+
+  if (length) *length = name_length;
+  if (size)   *size = uniform.elements_count;
+  if (type)   *type = uniform.type;
+}
+
+GLint APIENTRY get_uniform_location(GLuint program, const GLchar* name)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program)
+    return -1;
+
+  const ShaderVariable* uniform = null_program->find(null_program->uniforms, name);
+
+  return uniform ? uniform->location : -1;
+}
+
+void APIENTRY get_active_uniforms(GLuint program, GLsizei count, const GLuint* indices, GLenum name, GLint* values)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program)
+    return;
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    if (indices[i] >= null_program->uniforms.size())
+      continue;
+
+    const ShaderVariable& uniform = null_program->uniforms[indices[i]];
+
+    switch (name)
+    {
+      case GL_UNIFORM_TYPE:          values[i] = static_cast<GLint>(uniform.type); break;
+      case GL_UNIFORM_SIZE:          values[i] = uniform.elements_count; break;
+      case GL_UNIFORM_BLOCK_INDEX:   values[i] = uniform.block_index; break;
+      case GL_UNIFORM_OFFSET:        values[i] = uniform.offset; break;
+      case GL_UNIFORM_ARRAY_STRIDE:  values[i] = uniform.array_stride; break;
+      case GL_UNIFORM_MATRIX_STRIDE: values[i] = uniform.matrix_stride; break;
+      default:                       values[i] = 0; break;
+    }
+  }
+}
+
+GLuint APIENTRY get_uniform_block_index(GLuint program, const GLchar* name)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program || !name)
+    return GL_INVALID_INDEX;
+
+  for (size_t i=0; i<null_program->uniform_blocks.size(); i++)
+    if (null_program->uniform_blocks[i].name == name)
+      return static_cast<GLuint>(i);
+
+  return GL_INVALID_INDEX;
+}
+
+void APIENTRY get_active_uniform_block(GLuint program, GLuint index, GLenum name, GLint* value)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program || index >= null_program->uniform_blocks.size())
+    return;
+
+  const ShaderUniformBlock& block = null_program->uniform_blocks[index];
+
+  switch (name)
+  {
+    case GL_UNIFORM_BLOCK_DATA_SIZE:       *value = block.data_size; break;
+    case GL_UNIFORM_BLOCK_BINDING:         *value = block.binding; break;
+    case GL_UNIFORM_BLOCK_NAME_LENGTH:     *value = static_cast<GLint>(block.name.size() + 1); break;
+    case GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS: *value = static_cast<GLint>(block.members.size()); break;
+    default:                               break;
+  }
+}
+
+void APIENTRY get_active_uniform_block_name(GLuint program, GLuint index, GLsizei buffer_size, GLsizei* length, GLchar* name)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program || index >= null_program->uniform_blocks.size() || buffer_size <= 0)
+    return;
+
+  const std::string& block_name = null_program->uniform_blocks[index].name;
+  GLsizei name_length = std::min(static_cast<GLsizei>(block_name.size()), buffer_size - 1);
+
+  memcpy(name, block_name.c_str(), name_length);
+
+  name[name_length] = '\0';
+
+  if (length)
+    *length = name_length;
+}
+
+void APIENTRY uniform_block_binding(GLuint program, GLuint index, GLuint binding)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (null_program && index < null_program->uniform_blocks.size())
+    null_program->uniform_blocks[index].binding = static_cast<GLint>(binding);
+}
+
+GLint APIENTRY get_attribute_location(GLuint program, const GLchar* name)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program)
+    return -1;
+
+  const ShaderVariable* attribute = null_program->find(null_program->attributes, name);
+
+  return attribute ? attribute->location : -1;
+}
+
+GLint APIENTRY get_frag_data_location(GLuint program, const GLchar* name)
+{
+  NullProgram* null_program = find_program(program);
+
+  if (!null_program)
+    return -1;
+
+  const ShaderVariable* output = null_program->find(null_program->outputs, name);
+
+  return output ? output->location : -1;
+}
+
+/// Entry points table
+struct DriverFunction
+{
+  const char* name;
+  GLADapiproc function;
+};
+
+#define NULL_DRIVER_FUNCTION(NAME, PFN, FN) {#NAME, reinterpret_cast<GLADapiproc>(static_cast<PFN>(FN))}
+#define NULL_DRIVER_IGNORE(NAME, PFN) {#NAME, reinterpret_cast<GLADapiproc>(&IgnoredCall<PFN>::call)}
+
+const DriverFunction NULL_DRIVER_FUNCTIONS[] = {
+    //state queries
+
+  NULL_DRIVER_FUNCTION(glGetError, PFNGLGETERRORPROC, &get_error),
+  NULL_DRIVER_FUNCTION(glGetString, PFNGLGETSTRINGPROC, &get_string),
+  NULL_DRIVER_FUNCTION(glGetStringi, PFNGLGETSTRINGIPROC, &get_string_indexed),
+  NULL_DRIVER_FUNCTION(glGetIntegerv, PFNGLGETINTEGERVPROC, &get_integer),
+
+    //objects creation
+
+  NULL_DRIVER_FUNCTION(glGenBuffers, PFNGLGENBUFFERSPROC, &gen_objects),
+  NULL_DRIVER_FUNCTION(glGenTextures, PFNGLGENTEXTURESPROC, &gen_objects),
+  NULL_DRIVER_FUNCTION(glGenFramebuffers, PFNGLGENFRAMEBUFFERSPROC, &gen_objects),
+  NULL_DRIVER_FUNCTION(glGenRenderbuffers, PFNGLGENRENDERBUFFERSPROC, &gen_objects),
+  NULL_DRIVER_FUNCTION(glGenVertexArrays, PFNGLGENVERTEXARRAYSPROC, &gen_objects),
+  NULL_DRIVER_FUNCTION(glGenQueries, PFNGLGENQUERIESPROC, &gen_objects),
+  NULL_DRIVER_IGNORE(glDeleteBuffers, PFNGLDELETEBUFFERSPROC),
+  NULL_DRIVER_IGNORE(glDeleteTextures, PFNGLDELETETEXTURESPROC),
+  NULL_DRIVER_IGNORE(glDeleteFramebuffers, PFNGLDELETEFRAMEBUFFERSPROC),
+  NULL_DRIVER_IGNORE(glDeleteRenderbuffers, PFNGLDELETERENDERBUFFERSPROC),
+  NULL_DRIVER_IGNORE(glDeleteVertexArrays, PFNGLDELETEVERTEXARRAYSPROC),
+  NULL_DRIVER_IGNORE(glDeleteQueries, PFNGLDELETEQUERIESPROC),
+
+    //shaders & programs
+
+  NULL_DRIVER_FUNCTION(glCreateShader, PFNGLCREATESHADERPROC, &create_shader),
+  NULL_DRIVER_FUNCTION(glDeleteShader, PFNGLDELETESHADERPROC, &delete_shader),
+  NULL_DRIVER_FUNCTION(glShaderSource, PFNGLSHADERSOURCEPROC, &shader_source),
+  NULL_DRIVER_IGNORE(glCompileShader, PFNGLCOMPILESHADERPROC),
+  NULL_DRIVER_FUNCTION(glGetShaderiv, PFNGLGETSHADERIVPROC, &get_shader),
+  NULL_DRIVER_IGNORE(glGetShaderInfoLog, PFNGLGETSHADERINFOLOGPROC),
+  NULL_DRIVER_FUNCTION(glCreateProgram, PFNGLCREATEPROGRAMPROC, &create_program),
+  NULL_DRIVER_FUNCTION(glDeleteProgram, PFNGLDELETEPROGRAMPROC, &delete_program),
+  NULL_DRIVER_FUNCTION(glAttachShader, PFNGLATTACHSHADERPROC, &attach_shader),
+  NULL_DRIVER_FUNCTION(glDetachShader, PFNGLDETACHSHADERPROC, &detach_shader),
+  NULL_DRIVER_FUNCTION(glLinkProgram, PFNGLLINKPROGRAMPROC, &link_program),
+  NULL_DRIVER_FUNCTION(glGetProgramiv, PFNGLGETPROGRAMIVPROC, &get_program),
+  NULL_DRIVER_IGNORE(glGetProgramInfoLog, PFNGLGETPROGRAMINFOLOGPROC),
+  NULL_DRIVER_FUNCTION(glGetActiveUniform, PFNGLGETACTIVEUNIFORMPROC, &get_active_uniform),
+  NULL_DRIVER_FUNCTION(glGetUniformLocation, PFNGLGETUNIFORMLOCATIONPROC, &get_uniform_location),
+  NULL_DRIVER_FUNCTION(glGetActiveUniformsiv, PFNGLGETACTIVEUNIFORMSIVPROC, &get_active_uniforms),
+  NULL_DRIVER_FUNCTION(glGetUniformBlockIndex, PFNGLGETUNIFORMBLOCKINDEXPROC, &get_uniform_block_index),
+  NULL_DRIVER_FUNCTION(glGetActiveUniformBlockiv, PFNGLGETACTIVEUNIFORMBLOCKIVPROC, &get_active_uniform_block),
+  NULL_DRIVER_FUNCTION(glGetActiveUniformBlockName, PFNGLGETACTIVEUNIFORMBLOCKNAMEPROC, &get_active_uniform_block_name),
+  NULL_DRIVER_FUNCTION(glUniformBlockBinding, PFNGLUNIFORMBLOCKBINDINGPROC, &uniform_block_binding),
+  NULL_DRIVER_FUNCTION(glGetAttribLocation, PFNGLGETATTRIBLOCATIONPROC, &get_attribute_location),
+  NULL_DRIVER_FUNCTION(glGetFragDataLocation, PFNGLGETFRAGDATALOCATIONPROC, &get_frag_data_location),
+  NULL_DRIVER_IGNORE(glUseProgram, PFNGLUSEPROGRAMPROC),
+  NULL_DRIVER_IGNORE(glUniform1i, PFNGLUNIFORM1IPROC),
+  NULL_DRIVER_IGNORE(glUniform1iv, PFNGLUNIFORM1IVPROC),
+  NULL_DRIVER_IGNORE(glUniform1fv, PFNGLUNIFORM1FVPROC),
+  NULL_DRIVER_IGNORE(glUniform2fv, PFNGLUNIFORM2FVPROC),
+  NULL_DRIVER_IGNORE(glUniform3fv, PFNGLUNIFORM3FVPROC),
+  NULL_DRIVER_IGNORE(glUniform4fv, PFNGLUNIFORM4FVPROC),
+  NULL_DRIVER_IGNORE(glUniformMatrix4fv, PFNGLUNIFORMMATRIX4FVPROC),
+
+    //buffers & vertex input
+
+  NULL_DRIVER_IGNORE(glBindBuffer, PFNGLBINDBUFFERPROC),
+  NULL_DRIVER_IGNORE(glBufferData, PFNGLBUFFERDATAPROC),
+  NULL_DRIVER_IGNORE(glBufferSubData, PFNGLBUFFERSUBDATAPROC),
+  NULL_DRIVER_FUNCTION(glMapBufferRange, PFNGLMAPBUFFERRANGEPROC, &map_buffer_range),
+  NULL_DRIVER_FUNCTION(glUnmapBuffer, PFNGLUNMAPBUFFERPROC, &unmap_buffer),
+  NULL_DRIVER_IGNORE(glBindBufferRange, PFNGLBINDBUFFERRANGEPROC),
+  NULL_DRIVER_IGNORE(glBindVertexArray, PFNGLBINDVERTEXARRAYPROC),
+  NULL_DRIVER_IGNORE(glEnableVertexAttribArray, PFNGLENABLEVERTEXATTRIBARRAYPROC),
+  NULL_DRIVER_IGNORE(glDisableVertexAttribArray, PFNGLDISABLEVERTEXATTRIBARRAYPROC),
+  NULL_DRIVER_IGNORE(glVertexAttribPointer, PFNGLVERTEXATTRIBPOINTERPROC),
+  NULL_DRIVER_IGNORE(glVertexAttribDivisor, PFNGLVERTEXATTRIBDIVISORPROC),
+
+    //textures
+
+  NULL_DRIVER_IGNORE(glActiveTexture, PFNGLACTIVETEXTUREPROC),
+  NULL_DRIVER_IGNORE(glBindTexture, PFNGLBINDTEXTUREPROC),
+  NULL_DRIVER_IGNORE(glTexImage2D, PFNGLTEXIMAGE2DPROC),
+  NULL_DRIVER_IGNORE(glTexSubImage2D, PFNGLTEXSUBIMAGE2DPROC),
+  NULL_DRIVER_IGNORE(glCompressedTexImage2D, PFNGLCOMPRESSEDTEXIMAGE2DPROC),
+  NULL_DRIVER_IGNORE(glCompressedTexSubImage2D, PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC),
+  NULL_DRIVER_IGNORE(glTexImage3D, PFNGLTEXIMAGE3DPROC),
+  NULL_DRIVER_IGNORE(glGetTexImage, PFNGLGETTEXIMAGEPROC),
+  NULL_DRIVER_IGNORE(glTexParameteri, PFNGLTEXPARAMETERIPROC),
+  NULL_DRIVER_IGNORE(glGenerateMipmap, PFNGLGENERATEMIPMAPPROC),
+
+    //frame buffers
+
+  NULL_DRIVER_IGNORE(glBindFramebuffer, PFNGLBINDFRAMEBUFFERPROC),
+  NULL_DRIVER_IGNORE(glBlitFramebuffer, PFNGLBLITFRAMEBUFFERPROC),
+  NULL_DRIVER_IGNORE(glFramebufferTexture, PFNGLFRAMEBUFFERTEXTUREPROC),
+  NULL_DRIVER_IGNORE(glFramebufferTexture2D, PFNGLFRAMEBUFFERTEXTURE2DPROC),
+  NULL_DRIVER_IGNORE(glFramebufferTextureLayer, PFNGLFRAMEBUFFERTEXTURELAYERPROC),
+  NULL_DRIVER_IGNORE(glFramebufferRenderbuffer, PFNGLFRAMEBUFFERRENDERBUFFERPROC),
+  NULL_DRIVER_FUNCTION(glCheckFramebufferStatus, PFNGLCHECKFRAMEBUFFERSTATUSPROC, &check_frame_buffer_status),
+  NULL_DRIVER_IGNORE(glBindRenderbuffer, PFNGLBINDRENDERBUFFERPROC),
+  NULL_DRIVER_IGNORE(glRenderbufferStorage, PFNGLRENDERBUFFERSTORAGEPROC),
+  NULL_DRIVER_IGNORE(glDrawBuffer, PFNGLDRAWBUFFERPROC),
+  NULL_DRIVER_IGNORE(glDrawBuffers, PFNGLDRAWBUFFERSPROC),
+  NULL_DRIVER_IGNORE(glViewport, PFNGLVIEWPORTPROC),
+  NULL_DRIVER_IGNORE(glViewportIndexedf, PFNGLVIEWPORTINDEXEDFPROC),
+  NULL_DRIVER_IGNORE(glScissor, PFNGLSCISSORPROC),
+
+    //render states
+
+  NULL_DRIVER_IGNORE(glEnable, PFNGLENABLEPROC),
+  NULL_DRIVER_IGNORE(glDisable, PFNGLDISABLEPROC),
+  NULL_DRIVER_IGNORE(glCullFace, PFNGLCULLFACEPROC),
+  NULL_DRIVER_IGNORE(glDepthFunc, PFNGLDEPTHFUNCPROC),
+  NULL_DRIVER_IGNORE(glDepthMask, PFNGLDEPTHMASKPROC),
+  NULL_DRIVER_IGNORE(glBlendFunc, PFNGLBLENDFUNCPROC),
+  NULL_DRIVER_IGNORE(glClearColor, PFNGLCLEARCOLORPROC),
+  NULL_DRIVER_IGNORE(glClear, PFNGLCLEARPROC),
+
+    //drawing
+
+  NULL_DRIVER_IGNORE(glDrawElements, PFNGLDRAWELEMENTSPROC),
+  NULL_DRIVER_IGNORE(glDrawElementsInstanced, PFNGLDRAWELEMENTSINSTANCEDPROC),
+  NULL_DRIVER_IGNORE(glMultiDrawElementsIndirect, PFNGLMULTIDRAWELEMENTSINDIRECTPROC),
+
+    //queries
+
+  NULL_DRIVER_IGNORE(glBeginQuery, PFNGLBEGINQUERYPROC),
+  NULL_DRIVER_IGNORE(glEndQuery, PFNGLENDQUERYPROC),
+  NULL_DRIVER_FUNCTION(glGetQueryObjectuiv, PFNGLGETQUERYOBJECTUIVPROC, &get_query_object),
+
+    //sync objects
+
+  NULL_DRIVER_FUNCTION(glFenceSync, PFNGLFENCESYNCPROC, &fence_sync),
+  NULL_DRIVER_FUNCTION(glClientWaitSync, PFNGLCLIENTWAITSYNCPROC, &client_wait_sync),
+  NULL_DRIVER_IGNORE(glDeleteSync, PFNGLDELETESYNCPROC),
+};
+
+#undef NULL_DRIVER_IGNORE
+#undef NULL_DRIVER_FUNCTION
+
+}
+
+namespace engine {
+namespace render {
+namespace low_level {
+
+GLADapiproc get_null_driver_proc_address(const char* name)
+{
+  if (!name)
+    return nullptr;
+
+  for (const auto& desc : NULL_DRIVER_FUNCTIONS)
+    if (!strcmp(desc.name, name))
+      return desc.function;
+
+  return nullptr;
+}
+
+}}}
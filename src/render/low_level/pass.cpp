@@ -2,17 +2,21 @@
 
 #include <vector>
 
+#include <common/linear_allocator.h>
+#include <common/thread_pool.h>
+
 using namespace engine::render::low_level;
 using namespace engine::common;
 
-#if defined (_MSC_VER) || defined (__APPLE_CC__)
-  #define engine_offsetof(X,Y) offsetof(X,Y)
-#else
-  #define engine_offsetof(X,Y) (reinterpret_cast<size_t> (&(static_cast<X*> (0)->*(&X::Y))))
-#endif
-
 /// Constants
 static constexpr size_t PRIMITIVES_RESERVE_SIZE = 128; //number of reserved primitives per frame
+static constexpr uint32_t DEFAULT_PROPERTIES_INDEX = uint32_t(-1); //property block index for Pass::default_primitive_properties
+static constexpr size_t SORT_RADIX_BITS = 8; //number of key bits processed by one radix sort pass
+static constexpr size_t SORT_RADIX_SIZE = 1 << SORT_RADIX_BITS; //number of radix sort buckets
+static constexpr size_t MAX_CACHED_LAYOUTS = 4096; //max number of cached layouts in a binding plan
+static constexpr size_t TRANSFORMS_JOB_SIZE = 1024; //number of transforms processed by one worker job
+static constexpr size_t TRANSFORMS_PARALLEL_THRESHOLD = 4 * TRANSFORMS_JOB_SIZE; //min number of transforms for parallel processing
+static constexpr size_t SAMPLES_QUERIES_COUNT = 3; //number of samples queries in flight
 
 ///
 /// Internal structures
@@ -21,13 +25,10 @@ static constexpr size_t PRIMITIVES_RESERVE_SIZE = 128; //number of reserved prim
 namespace
 {
 
-/// Arrays layout
+/// Arrays layout; vertex attribute arrays state is kept in cached vertex array objects
 struct InputLayout
 {
-  GLint position_attribute_location; //location of vertex position
-  GLint normal_attribute_location; //location of vertex normal
-  GLint color_attribute_location; //location of vertex color
-  GLint texcoord_attribute_location; //location of vertex texcoord
+  GLint locations[VertexArrayCache::ATTRIBUTES_COUNT]; //locations of program attributes
 
   InputLayout(Program& program)
   {
@@ -37,112 +38,913 @@ struct InputLayout
     static const char* NORMAL_ATTRIBUTE_NAME = "vNormal";
     static const char* COLOR_ATTRIBUTE_NAME = "vColor";
     static const char* TEXCOORD_ATTRIBUTE_NAME = "vTexCoord";
+    static const char* INSTANCE_TRANSFORM_ATTRIBUTE_NAME = "vInstanceModelMatrix";
 
       //search attributes in a program
 
-    position_attribute_location = program.find_attribute_location(POSITION_ATTRIBUTE_NAME);
-    normal_attribute_location = program.find_attribute_location(NORMAL_ATTRIBUTE_NAME);
-    color_attribute_location = program.find_attribute_location(COLOR_ATTRIBUTE_NAME);
-    texcoord_attribute_location = program.find_attribute_location(TEXCOORD_ATTRIBUTE_NAME);
+    locations[VertexArrayCache::Attribute_Position] = program.find_attribute_location(POSITION_ATTRIBUTE_NAME);
+    locations[VertexArrayCache::Attribute_Normal] = program.find_attribute_location(NORMAL_ATTRIBUTE_NAME);
+    locations[VertexArrayCache::Attribute_Color] = program.find_attribute_location(COLOR_ATTRIBUTE_NAME);
+    locations[VertexArrayCache::Attribute_TexCoord] = program.find_attribute_location(TEXCOORD_ATTRIBUTE_NAME);
+    locations[VertexArrayCache::Attribute_InstanceTransform] = program.find_attribute_location(INSTANCE_TRANSFORM_ATTRIBUTE_NAME);
+  }
 
-      //bind
+  /// Program takes model matrices from the instance stream
+  bool is_instanced() const { return locations[VertexArrayCache::Attribute_InstanceTransform] >= 0; }
 
-    enable_attribute(position_attribute_location);
-    enable_attribute(normal_attribute_location);
-    enable_attribute(color_attribute_location);
-    enable_attribute(texcoord_attribute_location);
+  /// Program fetches only positions (position streams of primitives are bound)
+  bool is_position_only() const
+  {
+    return locations[VertexArrayCache::Attribute_Normal] < 0 && locations[VertexArrayCache::Attribute_Color] < 0 &&
+      locations[VertexArrayCache::Attribute_TexCoord] < 0;
   }
 
-  ~InputLayout()
+};
+
+/// Draw packet; POD which refers to resources of a primitive retained by the caller until Pass::render
+struct DrawPacket
+{
+  const VertexBuffer* vertex_buffer; //vertex buffer
+  const VertexBuffer* position_buffer; //position stream
+  const IndexBuffer* index_buffer; //index buffer
+  const Material* material; //material
+  PrimitiveType type; //type of primitive
+  uint32_t base_vertex; //base vertex offset
+  uint32_t first; //first primitive
+  uint32_t count; //number of primitives for rendering
+  uint32_t transform_index; //index in per-frame transforms array
+  uint32_t properties_index; //index in per-frame property blocks array
+  DrawPacket* next; //next packet of the pass
+};
+
+static_assert(std::is_trivially_copyable<DrawPacket>::value, "DrawPacket must be POD");
+
+/// Fill draw packet from a primitive
+void fill_packet(DrawPacket& packet, const Primitive& primitive, uint32_t transform_index, uint32_t properties_index)
+{
+  packet.vertex_buffer = &primitive.vertex_buffer;
+  packet.position_buffer = &primitive.position_buffer;
+  packet.index_buffer = &primitive.index_buffer;
+  packet.material = &primitive.material;
+  packet.type = primitive.type;
+  packet.base_vertex = static_cast<uint32_t>(primitive.base_vertex);
+  packet.first = static_cast<uint32_t>(primitive.first);
+  packet.count = static_cast<uint32_t>(primitive.count);
+  packet.transform_index = transform_index;
+  packet.properties_index = properties_index;
+  packet.next = nullptr;
+}
+
+/// Vertex buffer of a packet which is bound for a program input layout
+const VertexBuffer& get_vertex_buffer(const DrawPacket& packet, const InputLayout& input_layout)
+{
+  return input_layout.is_position_only() ? *packet.position_buffer : *packet.vertex_buffer;
+}
+
+/// Check if packets may be folded into one instanced draw (differ only in model transforms)
+bool is_same_primitive(const DrawPacket& packet1, const DrawPacket& packet2)
+{
+  return packet1.vertex_buffer->id() == packet2.vertex_buffer->id() && packet1.position_buffer->id() == packet2.position_buffer->id() &&
+    packet1.index_buffer->id() == packet2.index_buffer->id() && packet1.material == packet2.material && packet1.type == packet2.type &&
+    packet1.base_vertex == packet2.base_vertex && packet1.first == packet2.first && packet1.count == packet2.count && packet1.properties_index == packet2.properties_index;
+}
+
+/// Check if batches may be submitted with one multi draw indirect call (share bindings & input layout)
+bool is_same_bucket(const DrawPacket& packet1, const DrawPacket& packet2)
+{
+  return packet1.vertex_buffer->id() == packet2.vertex_buffer->id() && packet1.position_buffer->id() == packet2.position_buffer->id() &&
+    packet1.index_buffer->id() == packet2.index_buffer->id() && packet1.material == packet2.material && packet1.type == packet2.type &&
+    packet1.properties_index == packet2.properties_index;
+}
+
+/// Convert primitive range to GL primitive type and indices range
+void get_gl_primitive_range(const DrawPacket& primitive, GLenum& gl_primitive_type, GLsizei& gl_first, GLsizei& gl_count)
+{
+  switch (primitive.type)
   {
-      //unbind
+    case engine::media::geometry::PrimitiveType_TriangleList:
+      gl_primitive_type = GL_TRIANGLES;
+      gl_first = static_cast<GLsizei>(primitive.first * 3);
+      gl_count = static_cast<GLsizei>(primitive.count * 3);
+      break;
+    default:
+      throw Exception::format("Unexpected primitive type %d", primitive.type);
+  }
+}
 
-    disable_attribute(position_attribute_location);
-    disable_attribute(normal_attribute_location);
-    disable_attribute(color_attribute_location);
-    disable_attribute(texcoord_attribute_location);
+/// Convert index format to GL index type and index size
+void get_gl_index_type(IndexFormat format, GLenum& gl_index_type, size_t& index_size)
+{
+  switch (format)
+  {
+    case IndexFormat_UInt16:
+      gl_index_type = GL_UNSIGNED_SHORT;
+      index_size = sizeof(uint16_t);
+      break;
+    case IndexFormat_UInt32:
+      gl_index_type = GL_UNSIGNED_INT;
+      index_size = sizeof(uint32_t);
+      break;
+    default:
+      throw Exception::format("Unexpected index format %d", format);
   }
+}
+
+/// Draw batch; instances of a batch are stored sequentially in the instance stream
+struct DrawBatch
+{
+  const DrawPacket* packet; //packet of the first instance
+  uint32_t first_instance; //index of the first instance in the instance stream
+  uint32_t instances_count; //number of instances
+};
+
+/// Sort entry of a draw packet
+struct DrawSortEntry
+{
+  uint64_t key; //sort key
+  const DrawPacket* packet; //packet
+};
+
+/// Monotonic 32-bit representation of a view depth (positive float bits are ordered as integers)
+uint32_t get_depth_bits(float depth)
+{
+  if (!(depth > 0.0f))
+    return 0;
+
+  uint32_t bits;
+
+  memcpy(&bits, &depth, sizeof(bits));
+
+  return bits;
+}
+
+/// Pack value into a bit field of a key (identifiers are wrapped; collisions only affect ordering quality)
+uint64_t get_key_field(size_t value, size_t offset, size_t bits)
+{
+  return (uint64_t(value) & ((uint64_t(1) << bits) - 1)) << offset;
+}
+
+/// Build sort key:
+///   state: material(20) | vertex buffer(12) | index buffer(12) | depth(20)
+///   depth: depth(32) | material(16) | vertex buffer(8) | index buffer(8)
+/// the program is fixed for a pass so it isn't a part of the key
+uint64_t get_sort_key(PassSortMode mode, const DrawPacket& packet, float depth)
+{
+  uint32_t depth_bits = get_depth_bits(depth);
+  size_t material_id = packet.material->id(), vb_id = packet.vertex_buffer->id(), ib_id = packet.index_buffer->id();
 
-  static void enable_attribute(GLint attribute)
+  switch (mode)
   {
-    if (attribute < 0)
-      return;
+    case PassSortMode_State:
+      return get_key_field(material_id, 44, 20) | get_key_field(vb_id, 32, 12) | get_key_field(ib_id, 20, 12) | get_key_field(depth_bits >> 12, 0, 20);
+    case PassSortMode_BackToFront:
+      depth_bits = ~depth_bits;
+      //fall through
+    case PassSortMode_FrontToBack:
+      return get_key_field(depth_bits, 32, 32) | get_key_field(material_id, 16, 16) | get_key_field(vb_id, 8, 8) | get_key_field(ib_id, 0, 8);
+    default:
+      return 0;
+  }
+}
+
+/// Stable LSD radix sort of entries; bytes which are equal for all keys are skipped
+DrawSortEntry* radix_sort(DrawSortEntry* entries, DrawSortEntry* temp, size_t count)
+{
+  uint64_t all_ones = ~uint64_t(0), all_zeros = 0;
 
-    glEnableVertexAttribArray(attribute);
+  for (size_t i=0; i<count; i++)
+  {
+    all_ones &= entries[i].key;
+    all_zeros |= entries[i].key;
   }
 
-  static void disable_attribute(GLint attribute)
+  uint64_t varying_bits = all_ones ^ all_zeros;
+
+  for (size_t shift=0; shift<64; shift+=SORT_RADIX_BITS)
   {
-    if (attribute < 0)
-      return;
+    if (!((varying_bits >> shift) & (SORT_RADIX_SIZE - 1)))
+      continue;
+
+    size_t offsets[SORT_RADIX_SIZE] = {};
+
+    for (size_t i=0; i<count; i++)
+      offsets[(entries[i].key >> shift) & (SORT_RADIX_SIZE - 1)]++;
+
+    for (size_t i=0, sum=0; i<SORT_RADIX_SIZE; i++)
+    {
+      size_t bucket_size = offsets[i];
+
+      offsets[i] = sum;
+      sum += bucket_size;
+    }
+
+    for (size_t i=0; i<count; i++)
+      temp[offsets[(entries[i].key >> shift) & (SORT_RADIX_SIZE - 1)]++] = entries[i];
+
+    std::swap(entries, temp);
+  }
+
+  return entries;
+}
+
+/// Program parameters binding plan:
+///   - parameters which are not overridden per draw are resolved once per Pass::render through the binding contexts chain;
+///   - per draw sources (material & primitive) are resolved once per layout of their property maps / texture lists
+class BindingPlan
+{
+  public:
+    typedef std::vector<const Property*> PropertySlots;
+    typedef std::vector<const Texture*> TextureSlots;
+
+    BindingPlan()
+      : parameters()
+      , parameters_count()
+    {
+    }
+
+    /// Resolve parameters of the program through pass level bindings
+    void prepare(const Program& program, const BindingContext& bindings)
+    {
+      if (program.parameters() != parameters || program.parameters_count() != parameters_count)
+      {
+          //program has been changed
+
+        parameters = program.parameters();
+        parameters_count = program.parameters_count();
+
+        property_layouts.clear();
+        texture_layouts.clear();
+      }
+
+        //layouts of destroyed or changed sources are never requested again, so the cache is simply dropped when it grows;
+        //this is done only between draws because slots returned by resolve are referenced until the draw is bound
+
+      if (property_layouts.size() >= MAX_CACHED_LAYOUTS)
+        property_layouts.clear();
+
+      if (texture_layouts.size() >= MAX_CACHED_LAYOUTS)
+        texture_layouts.clear();
+
+      pass_properties.assign(parameters_count, nullptr);
+      pass_textures.assign(parameters_count, nullptr);
+
+      for (size_t i=0; i<parameters_count; i++)
+      {
+        const ProgramParameter& param = parameters[i];
+
+        if (param.is_sampler) pass_textures[i] = bindings.find_texture(param.name.c_str());
+        else                  pass_properties[i] = bindings.find_property(param.name.c_str());
+      }
+    }
+
+    /// Pass level slots
+    const PropertySlots& pass_level_properties() const { return pass_properties; }
+    const TextureSlots& pass_level_textures() const { return pass_textures; }
+
+    /// Parameters resolved for a property map (valid until the next prepare)
+    const PropertySlots& resolve(const PropertyMap& properties)
+    {
+      return resolve(properties, property_layouts, [&](const ProgramParameter& param) -> const Property* {
+        return param.is_sampler ? nullptr : properties.find(param.name.c_str());
+      });
+    }
+
+    /// Parameters resolved for a texture list (valid until the next prepare)
+    const TextureSlots& resolve(const TextureList& textures)
+    {
+      return resolve(textures, texture_layouts, [&](const ProgramParameter& param) -> const Texture* {
+        return param.is_sampler ? textures.find(param.name.c_str()) : nullptr;
+      });
+    }
+
+  private:
+    template <class Source, class T, class Finder>
+    const std::vector<const T*>& resolve(const Source& source, std::unordered_map<size_t, std::vector<const T*>>& layouts, Finder finder)
+    {
+      size_t layout_id = source.layout_id();
+      auto it = layouts.find(layout_id);
 
-    glDisableVertexAttribArray(attribute); 
+      if (it != layouts.end())
+        return it->second;
+
+        //slots are never evicted here: references to slots of other sources are still held by the current draw
+
+      std::vector<const T*>& slots = layouts[layout_id];
+
+      slots.resize(parameters_count);
+
+      for (size_t i=0; i<parameters_count; i++)
+        slots[i] = source.count() ? finder(parameters[i]) : nullptr;
+
+      return slots;
+    }
+
+  private:
+    const ProgramParameter* parameters; //parameters of the program
+    size_t parameters_count; //number of parameters
+    PropertySlots pass_properties; //pass level properties
+    TextureSlots pass_textures; //pass level textures
+    std::unordered_map<size_t, PropertySlots> property_layouts; //properties resolved per layout
+    std::unordered_map<size_t, TextureSlots> texture_layouts; //textures resolved per layout
+};
+
+/// Per draw dynamic properties
+struct DynamicProperties
+{
+  Property& mvp; //model-view-projection matrix
+  Property& model_tm; //model matrix
+  Property& model_view_tm; //model-view matrix
+
+  DynamicProperties(PropertyMap& properties)
+    : mvp(insert(properties, "MVP"))
+    , model_tm(insert(properties, "modelMatrix"))
+    , model_view_tm(insert(properties, "modelViewMatrix"))
+  {
   }
 
-  static void bind_vertex_float_attrib(GLint attribute, size_t offset, size_t size)
+  /// Insert all properties before taking references (insertion may reallocate properties)
+  static Property& insert(PropertyMap& properties, const char* name)
   {
-    if (attribute < 0)
-      return;
+    static const char* NAMES [] = {"MVP", "modelMatrix", "modelViewMatrix"};
+
+    for (const char* property_name : NAMES)
+      if (!properties.find(property_name))
+        properties.set(property_name, math::mat4f(1.0f));
 
-    glVertexAttribPointer(attribute, static_cast<GLint>(size / sizeof(float)), GL_FLOAT, GL_FALSE, sizeof(Vertex),
-      reinterpret_cast<void*>(offset));
+    return properties.get(name);
   }
 };
 
-struct PassPrimitive: public Primitive
+typedef std::vector<math::mat4f> TransformArray;
+
+/// Per-frame model transforms and matrices derived from them for the whole draw list;
+/// matrices are stored as SoA (one contiguous stream per matrix element) so products are vectorized across draws
+class TransformStreams
 {
-  math::mat4f model_tm;
-  PropertyMap properties;
+  public:
+    /// Constants
+    static constexpr size_t MATRIX_ELEMENTS = 16; //number of elements of a matrix
+
+    TransformStreams()
+      : count()
+    {
+    }
+
+    /// Number of transforms
+    size_t size() const { return count; }
+
+    /// Reserve space for transforms
+    void reserve(size_t capacity)
+    {
+      for (auto& stream : model_streams)
+        stream.reserve(capacity);
+    }
+
+    /// Add model transform
+    uint32_t add(const math::mat4f& model_tm)
+    {
+      for (size_t row=0; row<4; row++)
+        for (size_t column=0; column<4; column++)
+          model_streams[row * 4 + column].push_back(model_tm[row][column]);
+
+      return static_cast<uint32_t>(count++);
+    }
+
+    /// Append transforms of other streams
+    void append(const TransformStreams& other)
+    {
+      for (size_t i=0; i<MATRIX_ELEMENTS; i++)
+        model_streams[i].insert(model_streams[i].end(), other.model_streams[i].begin(), other.model_streams[i].end());
+
+      count += other.count;
+    }
+
+    /// Remove all transforms
+    void clear()
+    {
+      for (auto& stream : model_streams)
+        stream.clear();
+
+      count = 0;
+    }
+
+    /// Compute model-view and model-view-projection matrices of all transforms
+    void compute(const math::mat4f& view_tm, const math::mat4f& view_projection_tm, bool need_model_view, bool need_mvp, ThreadPool& pool)
+    {
+      if (!need_model_view && !need_mvp)
+        return;
+
+      if (need_model_view)
+        resize(model_view_streams, count);
+
+      if (need_mvp)
+        resize(mvp_streams, count);
+
+      auto job = [&](size_t first, size_t last)
+      {
+        if (need_model_view)
+          multiply(view_tm, model_streams, model_view_streams, first, last);
+
+        if (need_mvp)
+          multiply(view_projection_tm, model_streams, mvp_streams, first, last);
+      };
+
+      if (count < TRANSFORMS_PARALLEL_THRESHOLD)
+      {
+        job(0, count);
+        return;
+      }
+
+      pool.parallel_for((count + TRANSFORMS_JOB_SIZE - 1) / TRANSFORMS_JOB_SIZE, [&](size_t index)
+      {
+        size_t first = index * TRANSFORMS_JOB_SIZE;
+
+        job(first, std::min(first + TRANSFORMS_JOB_SIZE, count));
+      });
+    }
+
+    /// Matrices of a transform
+    math::mat4f model(size_t index) const { return gather(model_streams, index); }
+    math::mat4f model_view(size_t index) const { return gather(model_view_streams, index); }
+    math::mat4f mvp(size_t index) const { return gather(mvp_streams, index); }
+
+    /// Transposed model matrix (GLSL column-major layout of instance stream)
+    math::mat4f transposed_model(size_t index) const
+    {
+      math::mat4f result;
+
+      for (size_t row=0; row<4; row++)
+        for (size_t column=0; column<4; column++)
+          result[column][row] = model_streams[row * 4 + column][index];
+
+      return result;
+    }
+
+    /// View depth of transform origin (valid after model-view matrices computation)
+    float view_depth(size_t index) const { return model_view_streams[2 * 4 + 3][index]; }
+
+  private:
+    typedef std::vector<float> Stream;
+
+    static void resize(Stream* streams, size_t size)
+    {
+      for (size_t i=0; i<MATRIX_ELEMENTS; i++)
+        streams[i].resize(size);
+    }
+
+    static math::mat4f gather(const Stream* streams, size_t index)
+    {
+      math::mat4f result;
+
+      for (size_t row=0; row<4; row++)
+        for (size_t column=0; column<4; column++)
+          result[row][column] = streams[row * 4 + column][index];
+
+      return result;
+    }
+
+    /// result[i] = left * right[i] for transforms [first; last)
+    static void multiply(const math::mat4f& left, const Stream* right, Stream* result, size_t first, size_t last)
+    {
+      for (size_t row=0; row<4; row++)
+      {
+        float l0 = left[row][0], l1 = left[row][1], l2 = left[row][2], l3 = left[row][3];
+
+        for (size_t column=0; column<4; column++)
+        {
+          const float* r0 = right[0 * 4 + column].data();
+          const float* r1 = right[1 * 4 + column].data();
+          const float* r2 = right[2 * 4 + column].data();
+          const float* r3 = right[3 * 4 + column].data();
+          float* dst = result[row * 4 + column].data();
+
+          for (size_t i=first; i<last; i++)
+            dst[i] = l0 * r0[i] + l1 * r1[i] + l2 * r2[i] + l3 * r3[i];
+        }
+      }
+    }
+
+  private:
+    Stream model_streams[MATRIX_ELEMENTS]; //model matrices
+    Stream model_view_streams[MATRIX_ELEMENTS]; //model-view matrices
+    Stream mvp_streams[MATRIX_ELEMENTS]; //model-view-projection matrices
+    size_t count; //number of transforms
+};
+
+typedef std::vector<const PropertyMap*> PropertyBlockArray;
+typedef std::vector<std::vector<char>> UniformBlockDataArray;
+
+/// Add property block to an array; properties are referenced without copying the map handle
+uint32_t add_property_block(PropertyBlockArray& property_blocks, const PropertyMap& properties)
+{
+  if (&properties == &Pass::default_primitive_properties())
+    return DEFAULT_PROPERTIES_INDEX;
+
+  property_blocks.push_back(&properties);
+
+  return static_cast<uint32_t>(property_blocks.size() - 1);
+}
+
+/// Write array elements to uniform block data with a given stride
+template <class T>
+void write_block_elements(char* dst, const T* src, size_t count, size_t array_stride)
+{
+  for (size_t i=0; i<count; i++, dst+=array_stride)
+    memcpy(dst, &src[i], sizeof(T));
+}
+
+/// Write matrices to uniform block data (column-major layout of uniform blocks)
+void write_block_matrices(char* dst, const math::mat4f* src, size_t count, size_t array_stride, size_t matrix_stride)
+{
+  for (size_t i=0; i<count; i++, dst+=array_stride)
+  {
+    const math::mat4f& tm = src[i];
+
+    for (size_t column=0; column<4; column++)
+    {
+      float* column_data = reinterpret_cast<float*>(dst + column * matrix_stride);
+
+      for (size_t row=0; row<4; row++)
+        column_data[row] = tm[row][column];
+    }
+  }
+}
+
+/// Per-frame stream buffer (instance matrices, indirect draw arguments)
+class StreamBuffer
+{
+  public:
+    StreamBuffer(const DeviceContextPtr& context, GLenum target)
+      : context(context)
+      , target(target)
+      , buffer_id()
+      , capacity()
+    {
+    }
+
+    ~StreamBuffer()
+    {
+      try
+      {
+        if (!buffer_id)
+          return;
+
+        context->make_current();
+        context->state_cache().bind_buffer(target, 0);
+
+        glDeleteBuffers(1, &buffer_id);
+
+        context->state_cache().on_buffer_deleted(buffer_id);
+      }
+      catch (...)
+      {
+        //ignore exceptions in destructors
+      }
+    }
+
+    /// Upload data; returns buffer object which is left bound to the target
+    GLuint update(const void* data, size_t size)
+    {
+      if (!buffer_id)
+      {
+        glGenBuffers(1, &buffer_id);
+
+        engine_check(buffer_id);
+      }
+
+      context->state_cache().bind_buffer(target, buffer_id);
+
+        //buffer is orphaned on each update so draws of the previous frame don't stall the upload
+
+      capacity = std::max(capacity, size);
+
+      glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+      glBufferSubData(target, 0, size, data);
+
+      context->check_errors();
+
+      return buffer_id;
+    }
+
+  private:
+    DeviceContextPtr context; //device context
+    GLenum target; //buffer target
+    GLuint buffer_id; //buffer object
+    size_t capacity; //buffer size in bytes
+};
+
+/// Ring of occlusion queries for counting of passed samples without waiting for query results
+class SamplesCounter
+{
+  public:
+    SamplesCounter(const DeviceContextPtr& context)
+      : context(context)
+      , next_query()
+      , samples_count()
+    {
+      memset(queries, 0, sizeof(queries));
+      memset(pending, 0, sizeof(pending));
+    }
+
+    ~SamplesCounter()
+    {
+      try
+      {
+        if (!queries[0])
+          return;
+
+        context->make_current();
+
+        glDeleteQueries(SAMPLES_QUERIES_COUNT, queries);
+      }
+      catch (...)
+      {
+        //ignore exceptions in destructors
+      }
+    }
+
+    /// Number of samples of the latest completed query
+    size_t samples_passed() const { return samples_count; }
+
+    /// Begin counting; returns false if all queries are still in flight
+    bool begin()
+    {
+      if (!queries[0])
+      {
+        glGenQueries(SAMPLES_QUERIES_COUNT, queries);
+
+        engine_check(queries[0]);
+      }
+
+      read_results();
+
+      if (pending[next_query])
+        return false;
+
+      glBeginQuery(GL_SAMPLES_PASSED, queries[next_query]);
+
+      return true;
+    }
+
+    /// End counting
+    void end()
+    {
+      glEndQuery(GL_SAMPLES_PASSED);
+
+      pending[next_query] = true;
+      next_query = (next_query + 1) % SAMPLES_QUERIES_COUNT;
+
+      context->check_errors();
+    }
+
+  private:
+    /// Read results of completed queries from the oldest one (queries are completed in the issue order)
+    void read_results()
+    {
+      for (size_t i=0; i<SAMPLES_QUERIES_COUNT; i++)
+      {
+        size_t index = (next_query + i) % SAMPLES_QUERIES_COUNT;
+
+        if (!pending[index])
+          continue;
+
+        GLuint available = GL_FALSE, result = 0;
+
+        glGetQueryObjectuiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+          return;
+
+        glGetQueryObjectuiv(queries[index], GL_QUERY_RESULT, &result);
+
+        samples_count = result;
+        pending[index] = false;
+      }
+    }
+
+  private:
+    DeviceContextPtr context; //device context
+    GLuint queries[SAMPLES_QUERIES_COUNT]; //query objects
+    bool pending[SAMPLES_QUERIES_COUNT]; //queries which results haven't been read yet
+    size_t next_query; //index of the next query to issue
+    size_t samples_count; //latest read result
+};
+
+}
+
+/// Implementation details of draw list
+struct DrawList::Impl
+{
+  LinearAllocator packets_allocator; //draw packets arena (packets are linked to a pass in place)
+  DrawPacket* first_packet; //first draw packet
+  DrawPacket* last_packet; //last draw packet
+  size_t packets_count; //number of draw packets
+  TransformStreams transforms; //model transforms
+  PropertyBlockArray property_blocks; //primitive properties
+  bool is_merged; //packets are linked to a pass which hasn't been rendered yet
+
+  Impl()
+    : packets_allocator(PRIMITIVES_RESERVE_SIZE * sizeof(DrawPacket))
+    , first_packet()
+    , last_packet()
+    , packets_count()
+    , is_merged()
+  {
+    transforms.reserve(PRIMITIVES_RESERVE_SIZE);
+  }
+
+  uint32_t add_transform(const math::mat4f& model_tm)
+  {
+    return transforms.add(model_tm);
+  }
+
+  void add_packet(const Primitive& primitive, uint32_t transform_index, uint32_t properties_index)
+  {
+    DrawPacket* packet = packets_allocator.allocate<DrawPacket>();
+
+    fill_packet(*packet, primitive, transform_index, properties_index);
+
+    if (last_packet) last_packet->next = packet;
+    else             first_packet = packet;
+
+    last_packet = packet;
+
+    packets_count++;
+  }
+
+  void clear()
+  {
+    first_packet = last_packet = nullptr;
+    packets_count = 0;
+
+    transforms.clear();
+    property_blocks.clear();
+    packets_allocator.reset();
+  }
+};
+
+/// Implementation details of pass
+struct Pass::Impl
+{
+  DeviceContextPtr context; //device context
+  LinearAllocator packets_allocator; //per-frame allocator of draw packets
+  DrawPacket* first_packet; //first draw packet
+  DrawPacket* last_packet; //last draw packet
+  size_t packets_count; //number of draw packets
+  std::vector<std::shared_ptr<DrawList::Impl>> merged_lists; //draw lists which packets are linked to the pass
+  TransformStreams transforms; //per-frame model transforms & derived matrices
+  PropertyBlockArray property_blocks; //per-frame primitive properties
+  UniformBlockDataArray uniform_blocks_data; //staging data of program uniform blocks
+  TransformArray instances; //per-frame instance stream data
+  StreamBuffer instance_stream; //instance stream buffer
+  StreamBuffer indirect_stream; //indirect draw arguments buffer
+  SamplesCounter samples_counter; //passed samples counter
+  bool samples_counting; //samples counting is enabled
+  common::PropertyMap dynamic_properties; //dynamic property map
+  BindingPlan binding_plan; //program parameters binding plan
+  Program program; //program for this pass
+  FrameBuffer frame_buffer; //frame buffer for this pass
+  Viewport viewport; //viewport of the pass
+  bool has_viewport; //viewport of the frame buffer is overridden
+  std::vector<Viewport> indexed_viewports; //viewports with indices starting from 1 (selected by gl_ViewportIndex)
+  FrameBuffer depth_source; //frame buffer which depth is copied to the pass viewport instead of clearing
+  Viewport depth_source_rect; //region of the depth source
+  bool has_depth_source; //depth is copied from the depth source
+  math::vec4f clear_color; //clear color  
+  ClearFlags clear_flags; //clear flags
+  DepthStencilState depth_stencil_state; //depth stencil state
+  BlendState blend_state; //blend state
+  PassSortMode sort_mode; //draws ordering
+  PropertyMap properties; //pass properties
+  TextureList textures; //pass textures
+
+  Impl(const DeviceContextPtr& context, const FrameBuffer& frame_buffer, const Program& program)
+    : context(context)
+    , packets_allocator(PRIMITIVES_RESERVE_SIZE * sizeof(DrawPacket))
+    , first_packet()
+    , last_packet()
+    , packets_count()
+    , instance_stream(context, GL_ARRAY_BUFFER)
+    , indirect_stream(context, GL_DRAW_INDIRECT_BUFFER)
+    , samples_counter(context)
+    , samples_counting()
+    , program(program)
+    , frame_buffer(frame_buffer)
+    , has_viewport()
+    , depth_source(frame_buffer)
+    , has_depth_source()
+    , clear_flags(Clear_All)
+    , depth_stencil_state(false, false, CompareMode_AlwaysPass)
+    , blend_state(false, BlendArgument_One, BlendArgument_Zero)
+    , sort_mode(PassSortMode_None)
+  {
+    engine_check_null(context);
+
+    transforms.reserve(PRIMITIVES_RESERVE_SIZE);
+    instances.reserve(PRIMITIVES_RESERVE_SIZE);
+  }
+
+  uint32_t add_transform(const math::mat4f& model_tm)
+  {
+    return transforms.add(model_tm);
+  }
+
+  uint32_t add_property_block(const PropertyMap& properties)
+  {
+    return ::add_property_block(property_blocks, properties);
+  }
+
+  void add_packet(const Primitive& primitive, uint32_t transform_index, uint32_t properties_index)
+  {
+    DrawPacket* packet = packets_allocator.allocate<DrawPacket>();
+
+    fill_packet(*packet, primitive, transform_index, properties_index);
+
+    link_packet(packet);
+  }
+
+  void link_packet(DrawPacket* packet)
+  {
+    if (last_packet) last_packet->next = packet;
+    else             first_packet = packet;
+
+    last_packet = packet;
+
+    packets_count++;
+  }
+
+  void add_draw_list(const std::shared_ptr<DrawList::Impl>& list)
+  {
+    if (!list->packets_count)
+      return;
+
+    if (list->is_merged)
+      throw Exception::format("Draw list has been already added to a pass which hasn't been rendered");
+
+      //indices of the list are rebased to the pass arrays; the first list of the pass keeps its indices
+
+    uint32_t base_transform = static_cast<uint32_t>(transforms.size());
+    uint32_t base_properties = static_cast<uint32_t>(property_blocks.size());
+
+    transforms.append(list->transforms);
+    property_blocks.insert(property_blocks.end(), list->property_blocks.begin(), list->property_blocks.end());
+
+    if (base_transform || base_properties)
+    {
+      for (DrawPacket* packet=list->first_packet; packet; packet=packet->next)
+      {
+        packet->transform_index += base_transform;
+
+        if (packet->properties_index != DEFAULT_PROPERTIES_INDEX)
+          packet->properties_index += base_properties;
+      }
+    }
 
-  PassPrimitive(const Primitive& primitive, const math::mat4f& tm, const PropertyMap& properties)
-    : Primitive(primitive)
-    , model_tm(tm)
-    , properties(properties)
-  {
+      //packets stay in the arena of the list, which is retained until the pass is rendered
 
-  }
-};
+    if (last_packet) last_packet->next = list->first_packet;
+    else             first_packet = list->first_packet;
 
-typedef std::vector<PassPrimitive> PrimitiveArray;
+    last_packet = list->last_packet;
+    packets_count += list->packets_count;
 
-}
+    list->is_merged = true;
 
-/// Implementation details of pass
-struct Pass::Impl
-{
-  DeviceContextPtr context; //device context
-  PrimitiveArray primitives; //primitives
-  common::PropertyMap dynamic_properties; //dynamic property map
-  Program program; //program for this pass
-  FrameBuffer frame_buffer; //frame buffer for this pass
-  math::vec4f clear_color; //clear color  
-  ClearFlags clear_flags; //clear flags
-  DepthStencilState depth_stencil_state; //depth stencil state
-  BlendState blend_state; //blend state
-  PropertyMap properties; //pass properties
-  TextureList textures; //pass textures
+    merged_lists.push_back(list);
+  }
 
-  Impl(const DeviceContextPtr& context, const FrameBuffer& frame_buffer, const Program& program)
-    : context(context)
-    , program(program)
-    , frame_buffer(frame_buffer)
-    , clear_flags(Clear_All)
-    , depth_stencil_state(false, false, CompareMode_AlwaysPass)
-    , blend_state(false, BlendArgument_One, BlendArgument_Zero)
+  void remove_all_packets()
   {
-    engine_check_null(context);
+    first_packet = last_packet = nullptr;
+    packets_count = 0;
+
+    transforms.clear();
+    instances.clear();
+    property_blocks.clear();
+    packets_allocator.reset();
 
-    primitives.reserve(PRIMITIVES_RESERVE_SIZE);
+    for (auto& list : merged_lists)
+      list->is_merged = false;
+
+    merged_lists.clear();
   }
 
   void render(const BindingContext* parent_bindings)
   {
-    engine_check(sizeof(IndexBuffer::index_type) == 2); //change glDrawElements call for different sizes
-
       //setup frame buffer
 
     frame_buffer.bind();
 
+    if (has_viewport)
+      context->state_cache().set_viewport(viewport.x, viewport.y, viewport.width, viewport.height);
+
+    for (size_t i=0, count=indexed_viewports.size(); i<count; i++)
+    {
+      const Viewport& indexed_viewport = indexed_viewports[i];
+
+      context->state_cache().set_viewport(GLuint(i + 1), indexed_viewport.x, indexed_viewport.y, indexed_viewport.width, indexed_viewport.height);
+    }
+
     clear();
 
       //bind states
@@ -174,71 +976,150 @@ struct Pass::Impl
 
     BindingContext bindings(&static_bindings, dynamic_properties);
 
+      //compute per draw matrices for all draws at once; programs with instance stream need only view depths for sorting
+
+    bool is_instanced = input_layout.is_instanced();
+
+    transforms.compute(view_tm, view_projection_tm, !is_instanced || sort_mode != PassSortMode_None, !is_instanced, context->thread_pool());
+
     dynamic_properties.set("viewProjectionMatrix", view_projection_tm);
 
-      //draw primitives
+      //per draw dynamic properties are added before the binding plan is prepared so their slots stay valid
+
+    DynamicProperties draw_properties(dynamic_properties);
+
+    binding_plan.prepare(program, bindings);
+
+      //build draw batches
 
     context->check_errors();
 
-    for (auto& primitive : primitives)
+    DrawBatch* batches = packets_allocator.allocate<DrawBatch>(packets_count);
+    size_t batches_count = 0;
+
+    if (sort_mode == PassSortMode_None || packets_count < 2)
+    {
+      for (const DrawPacket* packet=first_packet; packet; packet=packet->next)
+        add_to_batch(*packet, is_instanced, batches, batches_count);
+    }
+    else
+    {
+      const DrawSortEntry* entries = sort_packets();
+
+      for (size_t i=0; i<packets_count; i++)
+        add_to_batch(*entries[i].packet, is_instanced, batches, batches_count);
+    }
+
+      //upload instance stream
+
+    GLuint instance_buffer = is_instanced && batches_count ? instance_stream.update(instances.data(), instances.size() * sizeof(math::mat4f)) : 0;
+
+      //draw batches
+
+    bool is_counting = samples_counting && samples_counter.begin();
+
+    if (instance_buffer && context->capabilities().has_multi_draw_indirect)
+    {
+      render_indirect(batches, batches_count, program, input_layout, instance_buffer);
+    }
+    else
     {
-      render_primitive(primitive, view_tm, view_projection_tm, program, input_layout, bindings);
+      for (size_t i=0; i<batches_count; i++)
+      {
+        render_batch(batches[i], program, input_layout, instance_buffer, draw_properties);
+      }
     }
 
+    if (is_counting)
+      samples_counter.end();
+
+      //buffers updates after the pass mustn't change cached vertex array objects
+
+    context->vertex_array_cache().bind_default();
+
       //clear pass
 
-    primitives.clear();
+    remove_all_packets();
+  }
+
+  const DrawSortEntry* sort_packets()
+  {
+      //sort entries are allocated in the frame arena together with packets
+
+    DrawSortEntry* entries = packets_allocator.allocate<DrawSortEntry>(packets_count);
+    DrawSortEntry* temp = packets_allocator.allocate<DrawSortEntry>(packets_count);
+    DrawSortEntry* entry = entries;
+
+    for (const DrawPacket* packet=first_packet; packet; packet=packet->next, entry++)
+    {
+        //view depth of the primitive origin (camera looks along +Z, see compute_perspective_proj_tm)
+
+      float depth = transforms.view_depth(packet->transform_index);
+
+      entry->key = get_sort_key(sort_mode, *packet, depth);
+      entry->packet = packet;
+    }
+
+    return radix_sort(entries, temp, packets_count);
+  }
+
+  void add_to_batch(const DrawPacket& packet, bool is_instanced, DrawBatch* batches, size_t& batches_count)
+  {
+    if (is_instanced)
+    {
+        //consecutive draws of the same primitive are folded into one instanced draw
+
+      instances.push_back(transforms.transposed_model(packet.transform_index));
+
+      if (batches_count && is_same_primitive(*batches[batches_count - 1].packet, packet))
+      {
+        batches[batches_count - 1].instances_count++;
+        return;
+      }
+    }
+
+    DrawBatch& batch = batches[batches_count++];
+
+    batch.packet = &packet;
+    batch.first_instance = static_cast<uint32_t>(is_instanced ? instances.size() - 1 : 0);
+    batch.instances_count = 1;
   }
 
-  void render_primitive(
-    PassPrimitive& primitive,
-    const math::mat4f& view_tm,
-    const math::mat4f& view_projection_tm,
+  void render_batch(
+    const DrawBatch& batch,
     const Program& program,
-    InputLayout& input_layout,
-    BindingContext& parent_bindings)
+    const InputLayout& input_layout,
+    GLuint instance_buffer,
+    DynamicProperties& draw_properties)
   {
       //setup bindings
 
-    BindingContext material_bindings(&parent_bindings, primitive.material);
-    BindingContext bindings(&material_bindings, primitive.properties);
+    const DrawPacket& primitive = *batch.packet;
+    const PropertyMap& properties = primitive.properties_index == DEFAULT_PROPERTIES_INDEX ?
+      default_primitive_properties() : *property_blocks[primitive.properties_index];
 
-    math::mat4f mvp = view_projection_tm * primitive.model_tm;
-
-    dynamic_properties.set("MVP", mvp);
-    dynamic_properties.set("modelMatrix", primitive.model_tm);
-    dynamic_properties.set("modelViewMatrix", view_tm * primitive.model_tm);
+    if (!instance_buffer)
+    {
+      draw_properties.mvp.set(transforms.mvp(primitive.transform_index));
+      draw_properties.model_tm.set(transforms.model(primitive.transform_index));
+      draw_properties.model_view_tm.set(transforms.model_view(primitive.transform_index));
+    }
 
       //setup shader parameters and textures
 
-    bind_program_parameters(program, bindings);
+    bind_program_parameters(program, *primitive.material, properties);
 
-      //setup buffers
+      //setup buffers & input layout
 
-    primitive.vertex_buffer.bind();
-    primitive.index_buffer.bind();
+    VertexArrayCache& vertex_arrays = context->vertex_array_cache();
 
-      //setup input layout
-      //TODO: VAO
+    const VertexBuffer& vertex_buffer = get_vertex_buffer(primitive, input_layout);
 
-    size_t vb_offset = primitive.base_vertex * sizeof(Vertex);
+    vertex_arrays.bind(input_layout.locations, vertex_buffer.format(), static_cast<GLuint>(vertex_buffer.id()),
+      static_cast<GLuint>(primitive.index_buffer->id()), primitive.base_vertex);
 
-    InputLayout::bind_vertex_float_attrib(
-      input_layout.position_attribute_location,
-      vb_offset + engine_offsetof(Vertex, position),
-      sizeof(Vertex::position));
-    InputLayout::bind_vertex_float_attrib(
-      input_layout.normal_attribute_location,
-      vb_offset + engine_offsetof(Vertex, normal),
-      sizeof(Vertex::normal));
-    InputLayout::bind_vertex_float_attrib(
-      input_layout.color_attribute_location,
-      vb_offset + engine_offsetof(Vertex, color),
-      sizeof(Vertex::color));
-    InputLayout::bind_vertex_float_attrib(
-      input_layout.texcoord_attribute_location,
-      vb_offset + engine_offsetof(Vertex, tex_coord),
-      sizeof(Vertex::tex_coord));    
+    if (instance_buffer)
+      vertex_arrays.bind_instance_stream(input_layout.locations, instance_buffer, batch.first_instance * sizeof(math::mat4f));
 
       //convert to GL primitive type and offsets
 
@@ -246,27 +1127,88 @@ struct Pass::Impl
     GLsizei gl_first = 0;
     GLsizei gl_count = 0;
 
-    switch (primitive.type)
+    get_gl_primitive_range(primitive, gl_primitive_type, gl_first, gl_count);
+
+      //draw primitive
+
+    GLenum gl_index_type = GL_NONE;
+    size_t index_size = 0;
+
+    get_gl_index_type(primitive.index_buffer->format(), gl_index_type, index_size);
+
+    size_t offset = gl_first * index_size;
+
+    if (instance_buffer) glDrawElementsInstanced(gl_primitive_type, gl_count, gl_index_type, reinterpret_cast<void*>(offset), static_cast<GLsizei>(batch.instances_count));
+    else                 glDrawElements(gl_primitive_type, gl_count, gl_index_type, reinterpret_cast<void*>(offset));
+
+    context->check_errors();
+  }
+
+  void render_indirect(const DrawBatch* batches, size_t batches_count, const Program& program, const InputLayout& input_layout, GLuint instance_buffer)
+  {
+      //pack draw arguments; base vertex & base instance are taken from arguments so a bucket shares one vertex array object
+
+    DrawElementsIndirectCommand* commands = packets_allocator.allocate<DrawElementsIndirectCommand>(batches_count);
+
+    for (size_t i=0; i<batches_count; i++)
     {
-      case media::geometry::PrimitiveType_TriangleList:
-        gl_primitive_type = GL_TRIANGLES;
-        gl_first = static_cast<GLsizei>(primitive.first * 3);
-        gl_count = static_cast<GLsizei>(primitive.count * 3);
-        break;
-      default:
-        throw Exception::format("Unexpected primitive type %d", primitive.type);
+      const DrawBatch& batch = batches[i];
+      DrawElementsIndirectCommand& command = commands[i];
+      GLenum gl_primitive_type = GL_NONE;
+      GLsizei gl_first = 0, gl_count = 0;
+
+      get_gl_primitive_range(*batch.packet, gl_primitive_type, gl_first, gl_count);
+
+      command.count = static_cast<GLuint>(gl_count);
+      command.instances_count = batch.instances_count;
+      command.first_index = static_cast<GLuint>(gl_first);
+      command.base_vertex = static_cast<GLint>(batch.packet->base_vertex);
+      command.base_instance = batch.first_instance;
     }
 
-      //draw primitive
+    GLuint indirect_buffer = indirect_stream.update(commands, batches_count * sizeof(DrawElementsIndirectCommand));
+
+      //submit buckets of batches with the same bindings
+
+    VertexArrayCache& vertex_arrays = context->vertex_array_cache();
+
+    for (size_t first=0, last=0; first<batches_count; first=last)
+    {
+      const DrawPacket& primitive = *batches[first].packet;
+
+      for (last=first+1; last<batches_count && is_same_bucket(primitive, *batches[last].packet); last++);
+
+      const PropertyMap& properties = primitive.properties_index == DEFAULT_PROPERTIES_INDEX ?
+        default_primitive_properties() : *property_blocks[primitive.properties_index];
+
+      bind_program_parameters(program, *primitive.material, properties);
+
+      const VertexBuffer& vertex_buffer = get_vertex_buffer(primitive, input_layout);
+
+      vertex_arrays.bind(input_layout.locations, vertex_buffer.format(), static_cast<GLuint>(vertex_buffer.id()),
+        static_cast<GLuint>(primitive.index_buffer->id()), 0);
+      vertex_arrays.bind_instance_stream(input_layout.locations, instance_buffer, 0);
+
+      context->state_cache().bind_buffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+
+      GLenum gl_primitive_type = GL_NONE;
+      GLsizei gl_first = 0, gl_count = 0;
 
-    size_t offset = gl_first * sizeof(IndexBuffer::index_type);
+      get_gl_primitive_range(primitive, gl_primitive_type, gl_first, gl_count);
 
-    glDrawElements(gl_primitive_type, gl_count, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(offset));
+      GLenum gl_index_type = GL_NONE;
+      size_t index_size = 0;
+
+      get_gl_index_type(primitive.index_buffer->format(), gl_index_type, index_size);
+
+      glMultiDrawElementsIndirect(gl_primitive_type, gl_index_type, reinterpret_cast<void*>(first * sizeof(DrawElementsIndirectCommand)),
+        static_cast<GLsizei>(last - first), 0);
+    }
 
     context->check_errors();
   }
 
-  void bind_program_parameters(const Program& program, const BindingContext& bindings)
+  void bind_program_parameters(const Program& program, const Material& material, const PropertyMap& primitive_properties)
   {
     size_t parameters_count = program.parameters_count();
     const ProgramParameter* parameters = program.parameters();
@@ -274,6 +1216,25 @@ struct Pass::Impl
     if (!parameters_count)
       return;
 
+      //prepare uniform blocks staging data
+
+    size_t uniform_blocks_count = program.uniform_blocks_count();
+    const ProgramUniformBlock* uniform_blocks = program.uniform_blocks();
+
+    if (uniform_blocks_data.size() < uniform_blocks_count)
+      uniform_blocks_data.resize(uniform_blocks_count);
+
+    for (size_t i=0; i<uniform_blocks_count; i++)
+      uniform_blocks_data[i].resize(uniform_blocks[i].data_size);
+
+      //lookup order: primitive properties, material, pass level bindings
+
+    const BindingPlan::PropertySlots& primitive_slots = binding_plan.resolve(primitive_properties);
+    const BindingPlan::PropertySlots& material_property_slots = binding_plan.resolve(material.properties());
+    const BindingPlan::TextureSlots& material_texture_slots = binding_plan.resolve(material.textures());
+    const BindingPlan::PropertySlots& pass_property_slots = binding_plan.pass_level_properties();
+    const BindingPlan::TextureSlots& pass_texture_slots = binding_plan.pass_level_textures();
+
     GLint active_texture = 0, active_textures_count = static_cast<GLint>(context->capabilities().active_textures_count);
 
     const ProgramParameter* param = parameters;
@@ -284,7 +1245,7 @@ struct Pass::Impl
 
       if (param->is_sampler)
       {
-        const Texture* texture = bindings.find_texture(param->name.c_str());
+        const Texture* texture = material_texture_slots[i] ? material_texture_slots[i] : pass_texture_slots[i];
 
         if (!texture)
           throw Exception::format("Can't find shader program '%s' texture '%s'", program.name(), param->name.c_str());          
@@ -301,21 +1262,35 @@ struct Pass::Impl
       {
           //otherwise it is a uniform
 
-        const Property* property = bindings.find_property(param->name.c_str());
+        const Property* property = primitive_slots[i] ? primitive_slots[i] :
+          material_property_slots[i] ? material_property_slots[i] : pass_property_slots[i];
 
         if (!property)
           throw Exception::format("Can't find shader program '%s' parameter '%s'", program.name(), param->name.c_str());
 
-        bind_uniform_parameter(program, *param, *property);
+        if (param->block_index >= 0) write_block_parameter(program, *param, *property, uniform_blocks_data[param->block_index]);
+        else                         bind_uniform_parameter(program, *param, *property);
       }
     }
+
+      //upload uniform blocks; unchanged blocks are reused from the ring and their bindings are filtered by the state cache
+
+    UniformBufferRing& uniform_buffer_ring = context->uniform_buffer_ring();
+
+    for (size_t i=0; i<uniform_blocks_count; i++)
+    {
+      const std::vector<char>& data = uniform_blocks_data[i];
+
+      if (!data.empty())
+        uniform_buffer_ring.bind(uniform_blocks[i].binding, &data[0], data.size());
+    }
   }
 
   void bind_sampler(const Program& program, const ProgramParameter& param, const Texture& texture, GLint active_texture)
   {
       //bind texture
 
-    glActiveTexture(GL_TEXTURE0 + active_texture);
+    context->state_cache().active_texture(active_texture);
 
     texture.bind();
 
@@ -336,11 +1311,72 @@ struct Pass::Impl
     }
   };
 
-  void bind_uniform_parameter(const Program& program, const ProgramParameter& param, const Property& property)
+  static void check_parameter_type(const Program& program, const ProgramParameter& param, const Property& property)
   {
     if (property.type() != param.type)
       throw Exception::format("Program '%s' parameter '%s' type mismatch: expected %s, got %s",
         program.name(), param.name.c_str(), Property::get_type_name(param.type), Property::get_type_name(property.type()));
+  }
+
+  void write_block_parameter(const Program& program, const ProgramParameter& param, const Property& property, std::vector<char>& block_data)
+  {
+    check_parameter_type(program, param, property);
+
+    char* dst = &block_data[param.block_offset];
+
+    switch (param.type)
+    {
+      case PropertyType_Int:
+        write_block_elements(dst, &property.get<int>(), 1, param.array_stride);
+        break;
+      case PropertyType_Float:
+        write_block_elements(dst, &property.get<float>(), 1, param.array_stride);
+        break;
+      case PropertyType_Vec2f:
+        write_block_elements(dst, &property.get<math::vec2f>(), 1, param.array_stride);
+        break;
+      case PropertyType_Vec3f:
+        write_block_elements(dst, &property.get<math::vec3f>(), 1, param.array_stride);
+        break;
+      case PropertyType_Vec4f:
+        write_block_elements(dst, &property.get<math::vec4f>(), 1, param.array_stride);
+        break;
+      case PropertyType_Mat4f:
+        write_block_matrices(dst, &property.get<math::mat4f>(), 1, param.array_stride, param.matrix_stride);
+        break;
+      case PropertyType_IntArray:
+        ArrayChecker<int>::check(program, property, param);
+        write_block_elements(dst, &property.get<std::vector<int>>()[0], param.elements_count, param.array_stride);
+        break;
+      case PropertyType_FloatArray:
+        ArrayChecker<float>::check(program, property, param);
+        write_block_elements(dst, &property.get<std::vector<float>>()[0], param.elements_count, param.array_stride);
+        break;
+      case PropertyType_Vec2fArray:
+        ArrayChecker<math::vec2f>::check(program, property, param);
+        write_block_elements(dst, &property.get<std::vector<math::vec2f>>()[0], param.elements_count, param.array_stride);
+        break;
+      case PropertyType_Vec3fArray:
+        ArrayChecker<math::vec3f>::check(program, property, param);
+        write_block_elements(dst, &property.get<std::vector<math::vec3f>>()[0], param.elements_count, param.array_stride);
+        break;
+      case PropertyType_Vec4fArray:
+        ArrayChecker<math::vec4f>::check(program, property, param);
+        write_block_elements(dst, &property.get<std::vector<math::vec4f>>()[0], param.elements_count, param.array_stride);
+        break;
+      case PropertyType_Mat4fArray:
+        ArrayChecker<math::mat4f>::check(program, property, param);
+        write_block_matrices(dst, &property.get<std::vector<math::mat4f>>()[0], param.elements_count, param.array_stride, param.matrix_stride);
+        break;
+      default:
+        throw Exception::format("Unexpected program '%s' block parameter '%s' type %s",
+          program.name(), param.name.c_str(), Property::get_type_name(param.type));
+    }
+  }
+
+  void bind_uniform_parameter(const Program& program, const ProgramParameter& param, const Property& property)
+  {
+    check_parameter_type(program, param, property);
 
     GLsizei elements_count = static_cast<GLsizei>(param.elements_count);
 
@@ -398,12 +1434,17 @@ struct Pass::Impl
   {
     GLuint gl_flags = 0;
 
+    ClearFlags clear_flags = this->clear_flags;
+
+    if (has_depth_source)
+      clear_flags = static_cast<ClearFlags>(clear_flags & ~Clear_Depth);
+
     if (clear_flags & Clear_Color)   gl_flags |= GL_COLOR_BUFFER_BIT;
     if (clear_flags & Clear_Depth)   gl_flags |= GL_DEPTH_BUFFER_BIT;
     if (clear_flags & Clear_Stencil) gl_flags |= GL_STENCIL_BUFFER_BIT;
 
     if (clear_flags & Clear_Depth)
-      glDepthMask(true);
+      context->state_cache().set_depth_mask(true);
 
     if (clear_flags)
     {
@@ -411,24 +1452,49 @@ struct Pass::Impl
     }
 
     if (gl_flags)
+    {
+        //frame buffer may be shared by several passes with different viewports (e.g. atlas regions)
+
+      if (has_viewport)
+      {
+        context->state_cache().enable(GL_SCISSOR_TEST, true);
+
+        glScissor(viewport.x, viewport.y, viewport.width, viewport.height);
+      }
+
       glClear(gl_flags);
 
+      if (has_viewport)
+        context->state_cache().enable(GL_SCISSOR_TEST, false);
+    }
+
+      //depth is copied outside of the scissor test (it affects blits)
+
+    if (has_depth_source)
+    {
+      const Viewport& target_rect = has_viewport ? viewport : frame_buffer.viewport();
+
+      frame_buffer.copy_depth(depth_source, depth_source_rect, target_rect);
+    }
+
     context->check_errors();
   }
 
   void bind_depth_stencil_state()
   {
+    DeviceStateCache& state_cache = context->state_cache();
+
     if (depth_stencil_state.depth_test_enable)
     {
-      glEnable(GL_DEPTH_TEST);
-      glDepthFunc(get_gl_compare_mode(depth_stencil_state.depth_compare_mode));
+      state_cache.enable(GL_DEPTH_TEST, true);
+      state_cache.set_depth_func(get_gl_compare_mode(depth_stencil_state.depth_compare_mode));
     }
     else
     {
-      glDisable(GL_DEPTH_TEST);
+      state_cache.enable(GL_DEPTH_TEST, false);
     }
 
-    glDepthMask(depth_stencil_state.depth_write_enable);
+    state_cache.set_depth_mask(depth_stencil_state.depth_write_enable);
 
     context->check_errors();
   }
@@ -476,11 +1542,11 @@ struct Pass::Impl
       GLenum src_arg = get_gl_blend_argument(blend_state.blend_source_argument),
              dst_arg = get_gl_blend_argument(blend_state.blend_destination_argument);
 
-      glEnable(GL_BLEND);
-      glBlendFunc(src_arg, dst_arg);
+      context->state_cache().enable(GL_BLEND, true);
+      context->state_cache().blend_func(src_arg, dst_arg);
     }
     else
-      glDisable(GL_BLEND);
+      context->state_cache().enable(GL_BLEND, false);
 
     context->check_errors();
   }
@@ -511,6 +1577,49 @@ FrameBuffer& Pass::frame_buffer() const
   return impl->frame_buffer;
 }
 
+void Pass::set_viewport(const Viewport& viewport)
+{
+  impl->viewport = viewport;
+  impl->has_viewport = true;
+
+  impl->indexed_viewports.clear();
+}
+
+void Pass::reset_viewport()
+{
+  impl->has_viewport = false;
+
+  impl->indexed_viewports.clear();
+}
+
+void Pass::set_viewports(const Viewport* viewports, size_t count)
+{
+  engine_check_null(viewports);
+  engine_check(count > 0 && count <= DeviceStateCache::MAX_VIEWPORTS);
+
+  set_viewport(viewports[0]);
+
+  impl->indexed_viewports.assign(viewports + 1, viewports + count);
+}
+
+const Viewport& Pass::viewport() const
+{
+  return impl->has_viewport ? impl->viewport : impl->frame_buffer.viewport();
+}
+
+void Pass::set_depth_source(const FrameBuffer& frame_buffer, const Viewport& rect)
+{
+  impl->depth_source = frame_buffer;
+  impl->depth_source_rect = rect;
+  impl->has_depth_source = true;
+}
+
+void Pass::reset_depth_source()
+{
+  impl->depth_source = impl->frame_buffer;
+  impl->has_depth_source = false;
+}
+
 void Pass::set_program(const Program& program)
 {
   impl->program = program;
@@ -561,9 +1670,36 @@ const BlendState& Pass::blend_state() const
   return impl->blend_state;
 }
 
+void Pass::set_sort_mode(PassSortMode mode)
+{
+  engine_check_range(mode, PassSortMode_Num);
+
+  impl->sort_mode = mode;
+}
+
+PassSortMode Pass::sort_mode() const
+{
+  return impl->sort_mode;
+}
+
+void Pass::set_samples_counting(bool enabled)
+{
+  impl->samples_counting = enabled;
+}
+
+bool Pass::samples_counting() const
+{
+  return impl->samples_counting;
+}
+
+size_t Pass::samples_passed() const
+{
+  return impl->samples_counter.samples_passed();
+}
+
 size_t Pass::primitives_count() const
 {
-  return impl->primitives.size();
+  return impl->packets_count;
 }
 
 PropertyMap& Pass::default_primitive_properties()
@@ -574,32 +1710,94 @@ PropertyMap& Pass::default_primitive_properties()
 
 void Pass::add_primitive(const Primitive& primitive, const math::mat4f& model_tm, const PropertyMap& properties)
 {
-  impl->primitives.push_back(PassPrimitive(primitive, model_tm, properties));
+  impl->add_packet(primitive, impl->add_transform(model_tm), impl->add_property_block(properties));
 }
 
 /// Add mesh to a pass
 void Pass::add_mesh(const Mesh& mesh, const math::mat4f& model_tm, const PropertyMap& properties)
 {
-  for (size_t i = 0, count = mesh.primitives_count(); i < count; i++)
-    add_primitive(mesh.primitive(i), model_tm, properties);
+  size_t count = mesh.primitives_count();
+
+  if (!count)
+    return;
+
+    //all primitives of the mesh share transform & properties
+
+  uint32_t transform_index = impl->add_transform(model_tm);
+  uint32_t properties_index = impl->add_property_block(properties);
+  const Primitive* primitives = mesh.primitives();
+
+  for (size_t i=0; i<count; i++)
+    impl->add_packet(primitives[i], transform_index, properties_index);
+}
+
+void Pass::add_draw_list(DrawList& list)
+{
+  impl->add_draw_list(list.impl);
 }
 
 void Pass::remove_all_primitives()
 {
-  impl->primitives.clear();
+  impl->remove_all_packets();
 }
 
 void Pass::reserve_primitives(size_t count)
 {
-  impl->primitives.reserve(count);
+  impl->packets_allocator.reserve(count * sizeof(DrawPacket));
+  impl->transforms.reserve(count);
 }
 
 size_t Pass::primitives_capacity() const
 {
-  return impl->primitives.capacity();
+  return impl->packets_allocator.capacity() / sizeof(DrawPacket);
 }
 
 void Pass::render(const BindingContext* bindings)
 {
   impl->render(bindings);
 }
+
+DrawList::DrawList()
+  : impl(std::make_shared<Impl>())
+{
+}
+
+size_t DrawList::primitives_count() const
+{
+  return impl->packets_count;
+}
+
+void DrawList::add_primitive(const Primitive& primitive, const math::mat4f& model_tm, const PropertyMap& properties)
+{
+  impl->add_packet(primitive, impl->add_transform(model_tm), add_property_block(impl->property_blocks, properties));
+}
+
+void DrawList::add_mesh(const Mesh& mesh, const math::mat4f& model_tm, const PropertyMap& properties)
+{
+  size_t count = mesh.primitives_count();
+
+  if (!count)
+    return;
+
+    //all primitives of the mesh share transform & properties
+
+  uint32_t transform_index = impl->add_transform(model_tm);
+  uint32_t properties_index = add_property_block(impl->property_blocks, properties);
+  const Primitive* primitives = mesh.primitives();
+
+  for (size_t i=0; i<count; i++)
+    impl->add_packet(primitives[i], transform_index, properties_index);
+}
+
+void DrawList::clear()
+{
+    //packets of the list may still be linked to a pass, so the list gets new storage in this case
+
+  if (impl->is_merged)
+  {
+    impl = std::make_shared<Impl>();
+    return;
+  }
+
+  impl->clear();
+}
@@ -23,7 +23,7 @@ struct RenderBuffer::Impl
 
     try
     {
-      glBindRenderbuffer(GL_RENDERBUFFER, render_buffer_id);
+      context->state_cache().bind_render_buffer(render_buffer_id);
 
       GLenum gl_internal_format;
 
@@ -63,9 +63,12 @@ struct RenderBuffer::Impl
     if (!render_buffer_id)
       return;
 
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    context->state_cache().bind_render_buffer(0);
+
     glDeleteRenderbuffers(1, &render_buffer_id);
 
+    context->state_cache().on_render_buffer_deleted(render_buffer_id);
+
     render_buffer_id = 0;
   }
 
@@ -73,7 +76,7 @@ struct RenderBuffer::Impl
   {
     engine_check(context);
 
-    glBindRenderbuffer(GL_RENDERBUFFER, render_buffer_id);
+    context->state_cache().bind_render_buffer(render_buffer_id);
 
     context->check_errors();
   }
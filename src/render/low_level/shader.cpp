@@ -35,6 +35,10 @@ struct engine::render::low_level::ShaderImpl
         gl_type = GL_VERTEX_SHADER;
         shader_type_string = "vertex";
         break;
+      case ShaderType_Geometry:
+        gl_type = GL_GEOMETRY_SHADER;
+        shader_type_string = "geometry";
+        break;
       case ShaderType_Pixel:
         gl_type = GL_FRAGMENT_SHADER;
         shader_type_string = "pixel";
@@ -136,20 +140,21 @@ ShaderImpl& Shader::get_impl() const
 ///
 
 typedef std::vector<ProgramParameter> ProgramParameterArray;
+typedef std::vector<ProgramUniformBlock> ProgramUniformBlockArray;
+typedef std::vector<Shader> ShaderArray;
 
 struct Program::Impl
 {
   DeviceContextPtr context; //device context
-  Shader vertex_shader; //vertex shader
-  Shader pixel_shader; //pixel shader
+  ShaderArray shaders; //attached shaders
   std::string name; //program name
   GLuint program_id; //GL program ID
   ProgramParameterArray parameters;
+  ProgramUniformBlockArray uniform_blocks;
 
-  Impl(const DeviceContextPtr& context, const char* name, const Shader& vertex_shader, const Shader& pixel_shader)
+  Impl(const DeviceContextPtr& context, const char* name, const ShaderArray& shaders)
     : context(context)
-    , vertex_shader(vertex_shader)
-    , pixel_shader(pixel_shader)
+    , shaders(shaders)
     , name(name)
     , program_id()
   {
@@ -166,8 +171,9 @@ struct Program::Impl
 
       //link program
 
-    glAttachShader(program_id, vertex_shader.get_impl().shader_id);
-    glAttachShader(program_id, pixel_shader.get_impl().shader_id);
+    for (const Shader& shader : shaders)
+      glAttachShader(program_id, shader.get_impl().shader_id);
+
     glLinkProgram(program_id);
 
       //check status
@@ -240,6 +246,25 @@ struct Program::Impl
       parameter.elements_count = (unsigned int)elements_count;
       parameter.is_sampler     = false;
       parameter.location       = glGetUniformLocation(program_id, parameter_name.c_str());
+
+        //uniform block layout
+
+      GLuint uniform_index = static_cast<GLuint>(i);
+      GLint block_index = -1, block_offset = 0, array_stride = 0, matrix_stride = 0;
+
+      glGetActiveUniformsiv(program_id, 1, &uniform_index, GL_UNIFORM_BLOCK_INDEX, &block_index);
+
+      if (block_index >= 0)
+      {
+        glGetActiveUniformsiv(program_id, 1, &uniform_index, GL_UNIFORM_OFFSET, &block_offset);
+        glGetActiveUniformsiv(program_id, 1, &uniform_index, GL_UNIFORM_ARRAY_STRIDE, &array_stride);
+        glGetActiveUniformsiv(program_id, 1, &uniform_index, GL_UNIFORM_MATRIX_STRIDE, &matrix_stride);
+
+        parameter.block_index   = block_index;
+        parameter.block_offset  = static_cast<size_t>(block_offset);
+        parameter.array_stride  = static_cast<size_t>(array_stride);
+        parameter.matrix_stride = static_cast<size_t>(matrix_stride);
+      }
       
       switch (type)
       {
@@ -269,6 +294,8 @@ struct Program::Impl
         case GL_SAMPLER_2D_SHADOW:
         case GL_SAMPLER_2D_RECT:
         case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
           parameter.is_sampler = true;
           parameter.type = PropertyType_Int;
           break;                
@@ -277,7 +304,12 @@ struct Program::Impl
             parameter.name.c_str (), name, type, elements_count);
       }
 
-      if (elements_count > 1)
+      if (parameter.block_index >= 0)
+      {
+        engine_log_debug("...block %d+%03u: uniform '%s' type %s[%u] (gl_type=0x%04x)",
+          parameter.block_index, (unsigned int)parameter.block_offset, parameter.name.c_str(), Property::get_type_name(parameter.type), elements_count, type);
+      }
+      else if (elements_count > 1)
       {
         engine_log_debug("...%03d: uniform '%s' type %s[%u] (gl_type=0x%04x)",
           parameter.location, parameter.name.c_str(), Property::get_type_name(parameter.type), elements_count, type);
@@ -291,6 +323,38 @@ struct Program::Impl
       parameters.emplace_back(std::move(parameter));
     }
 
+      //get uniform blocks; each block is bound to the binding point equal to its index
+
+    GLint blocks_count = 0, max_block_name_length = 0;
+
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_BLOCKS, &blocks_count);
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_block_name_length);
+
+    uniform_blocks.reserve(size_t(blocks_count));
+
+    for (GLint i=0; i<blocks_count; i++)
+    {
+      ProgramUniformBlock block;
+      GLint data_size = 0;
+      GLsizei name_length = 0;
+
+      block.name.resize(size_t(std::max(max_block_name_length, 1)));
+
+      glGetActiveUniformBlockName(program_id, GLuint(i), (GLsizei)block.name.size(), &name_length, &block.name[0]);
+      glGetActiveUniformBlockiv(program_id, GLuint(i), GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+
+      block.name.resize(size_t(std::max(name_length, 0)));
+
+      block.data_size = size_t(data_size);
+      block.binding   = (unsigned int)i;
+
+      glUniformBlockBinding(program_id, GLuint(i), block.binding);
+
+      engine_log_debug("...block %d: uniform block '%s' size %u", i, block.name.c_str(), (unsigned int)block.data_size);
+
+      uniform_blocks.emplace_back(std::move(block));
+    }
+
       //check errors
 
     context->check_errors();
@@ -302,9 +366,12 @@ struct Program::Impl
     {
       context->make_current();
 
-      glDetachShader(program_id, vertex_shader.get_impl().shader_id);
-      glDetachShader(program_id, pixel_shader.get_impl().shader_id);
+      for (const Shader& shader : shaders)
+        glDetachShader(program_id, shader.get_impl().shader_id);
+
       glDeleteProgram(program_id);
+
+      context->state_cache().on_program_deleted(program_id);
     }
     catch (...)
     {
@@ -318,7 +385,15 @@ Program::Program(const DeviceContextPtr& context, const char* name, const Shader
   engine_check_null(name);
   engine_check_null(context);
 
-  impl = std::make_shared<Impl>(context, name, vertex_shader, pixel_shader);
+  impl = std::make_shared<Impl>(context, name, ShaderArray {vertex_shader, pixel_shader});
+}
+
+Program::Program(const DeviceContextPtr& context, const char* name, const Shader& vertex_shader, const Shader& geometry_shader, const Shader& pixel_shader)
+{
+  engine_check_null(name);
+  engine_check_null(context);
+
+  impl = std::make_shared<Impl>(context, name, ShaderArray {vertex_shader, geometry_shader, pixel_shader});
 }
 
 const char* Program::name() const
@@ -372,7 +447,7 @@ void Program::bind() const
 {
   impl->context->make_current();
 
-  glUseProgram(impl->program_id);
+  impl->context->state_cache().use_program(impl->program_id);
 }
 
 size_t Program::parameters_count() const
@@ -387,3 +462,16 @@ const ProgramParameter* Program::parameters() const
 
   return &impl->parameters[0];
 }
+
+size_t Program::uniform_blocks_count() const
+{
+  return impl->uniform_blocks.size();
+}
+
+const ProgramUniformBlock* Program::uniform_blocks() const
+{
+  if (impl->uniform_blocks.empty())
+    return nullptr;
+
+  return &impl->uniform_blocks[0];
+}
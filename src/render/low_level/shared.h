@@ -8,6 +8,7 @@
 #include <common/string.h>
 #include <common/file.h>
 #include <common/named_dictionary.h>
+#include <common/thread_pool.h>
 
 #include <string>
 #include <vector>
@@ -21,10 +22,29 @@ extern "C"
 #include <GLFW/glfw3.h>
 }
 
+  //GL_EXT_texture_compression_s3tc formats aren't part of the core profile headers
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 namespace engine {
 namespace render {
 namespace low_level {
 
+/// Null driver entry points lookup (see null_driver.cpp)
+GLADapiproc get_null_driver_proc_address(const char* name);
+
+/// Software driver entry points lookup (see software_driver.cpp)
+GLADapiproc get_software_driver_proc_address(const char* name);
+
+/// Block compression format of a pixel format; returns false for uncompressed formats (see texture.cpp)
+bool get_compression_format(PixelFormat format, media::image::CompressionFormat& out_format);
+
 /// Basic class for internal render objects
 class BaseObject
 {
@@ -38,17 +58,576 @@ class BaseObject
     BaseObject& operator = (BaseObject&&) = delete;
 };
 
+/// Indirect draw arguments (layout of GL DrawElementsIndirectCommand)
+struct DrawElementsIndirectCommand
+{
+  GLuint count; //number of indices
+  GLuint instances_count; //number of instances
+  GLuint first_index; //first index
+  GLint base_vertex; //base vertex
+  GLuint base_instance; //base instance (offset for instanced attributes)
+};
+
+/// Commands trace recorder (intercepts driver entry points, see trace.cpp)
+class TraceRecorder: BaseObject
+{
+  public:
+    /// Constructor
+    TraceRecorder(const char* file_name);
+
+    /// Destructor
+    ~TraceRecorder();
+
+    /// Write frame marker
+    void end_frame();
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
 /// Context capabilities
 struct DeviceContextCapabilities
 {
-  uint32_t active_textures_count;
+  uint32_t active_textures_count; //number of texture units
+  bool has_multi_draw_indirect; //glMultiDrawElementsIndirect with base instance is supported
+  uint32_t uniform_buffer_offset_alignment; //alignment of uniform buffer range offsets
+  bool has_texture_compression_s3tc; //BC1 and BC3 (DXT1 and DXT5) compressed textures are supported
 
   DeviceContextCapabilities()
     : active_textures_count()
+    , has_multi_draw_indirect()
+    , uniform_buffer_offset_alignment()
+    , has_texture_compression_s3tc()
   {
   }
 };
 
+/// Shadow copy of the driver state; redundant binding & state commands are filtered
+class DeviceStateCache: BaseObject
+{
+  public:
+    /// Constants
+    static constexpr size_t MAX_TEXTURE_UNITS = 32; //number of tracked texture units
+    static constexpr size_t MAX_UNIFORM_BUFFER_BINDINGS = 16; //number of tracked uniform buffer binding points
+    static constexpr size_t MAX_VIEWPORTS = 16; //number of tracked viewports (GL_MAX_VIEWPORTS is at least 16)
+    static constexpr GLuint UNKNOWN_OBJECT = GLuint(-1); //binding is unknown (forces the command)
+
+    /// Constructor
+    DeviceStateCache()
+      : program(UNKNOWN_OBJECT)
+      , array_buffer(UNKNOWN_OBJECT)
+      , element_array_buffer(UNKNOWN_OBJECT)
+      , draw_indirect_buffer(UNKNOWN_OBJECT)
+      , uniform_buffer(UNKNOWN_OBJECT)
+      , pixel_unpack_buffer(UNKNOWN_OBJECT)
+      , frame_buffer(UNKNOWN_OBJECT)
+      , render_buffer(UNKNOWN_OBJECT)
+      , active_texture_unit(UNKNOWN_OBJECT)
+      , blend_source(GL_NONE)
+      , blend_destination(GL_NONE)
+      , depth_func(GL_NONE)
+      , depth_mask(UNKNOWN_OBJECT)
+      , vertex_array(UNKNOWN_OBJECT)
+    {
+      for (GLuint& texture : textures)
+        texture = UNKNOWN_OBJECT;
+
+      for (GLint* indexed_viewport : viewports)
+        for (size_t i=0; i<4; i++)
+          indexed_viewport[i] = -1;
+
+      for (UniformBufferRange& range : uniform_buffer_ranges)
+        range.buffer = UNKNOWN_OBJECT;
+    }
+
+    /// Statistics
+    const StateCacheStatistics& statistics() const { return cache_statistics; }
+
+    /// Program binding
+    void use_program(GLuint id)
+    {
+      if (filter(program, id))
+        return;
+
+      glUseProgram(id);
+    }
+
+    /// Buffer binding
+    void bind_buffer(GLenum target, GLuint id)
+    {
+      GLuint* binding = find_buffer_binding(target);
+
+      if (binding && filter(*binding, id))
+        return;
+
+      if (!binding)
+        cache_statistics.issued_commands_count++;
+
+      glBindBuffer(target, id);
+    }
+
+    /// Uniform buffer range binding
+    void bind_uniform_buffer_range(GLuint index, GLuint buffer, size_t offset, size_t size)
+    {
+      if (index >= MAX_UNIFORM_BUFFER_BINDINGS)
+      {
+        cache_statistics.issued_commands_count++;
+
+        uniform_buffer = buffer;
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+
+        return;
+      }
+
+      UniformBufferRange& range = uniform_buffer_ranges[index];
+
+      if (range.buffer == buffer && range.offset == offset && range.size == size)
+      {
+        cache_statistics.filtered_commands_count++;
+        return;
+      }
+
+      range.buffer = buffer;
+      range.offset = offset;
+      range.size = size;
+
+      cache_statistics.issued_commands_count++;
+
+        //indexed binding also changes the generic GL_UNIFORM_BUFFER binding
+
+      uniform_buffer = buffer;
+
+      glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+    }
+
+    /// Texture binding (GL_TEXTURE_2D bindings are tracked per unit)
+    void bind_texture(GLenum target, GLuint id)
+    {
+      if (target != GL_TEXTURE_2D || active_texture_unit >= MAX_TEXTURE_UNITS)
+      {
+        cache_statistics.issued_commands_count++;
+
+        if (active_texture_unit < MAX_TEXTURE_UNITS)
+          textures[active_texture_unit] = UNKNOWN_OBJECT;
+
+        glBindTexture(target, id);
+
+        return;
+      }
+
+      if (filter(textures[active_texture_unit], id))
+        return;
+
+      glBindTexture(target, id);
+    }
+
+    /// Active texture unit
+    void active_texture(GLuint unit)
+    {
+      if (filter(active_texture_unit, unit))
+        return;
+
+      glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    /// Vertex array object binding
+    void bind_vertex_array(GLuint id)
+    {
+      if (filter(vertex_array, id))
+        return;
+
+      glBindVertexArray(id);
+
+      on_vertex_array_changed();
+    }
+
+    /// Check if vertex array object is bound
+    bool is_vertex_array_bound(GLuint id) const { return vertex_array == id; }
+
+    /// Frame buffer binding
+    void bind_frame_buffer(GLuint id)
+    {
+      if (filter(frame_buffer, id))
+        return;
+
+      glBindFramebuffer(GL_FRAMEBUFFER, id);
+    }
+
+    /// Render buffer binding
+    void bind_render_buffer(GLuint id)
+    {
+      if (filter(render_buffer, id))
+        return;
+
+      glBindRenderbuffer(GL_RENDERBUFFER, id);
+    }
+
+    /// Enable / disable capability
+    void enable(GLenum capability, bool state)
+    {
+      auto it = capabilities.find(capability);
+
+      if (it != capabilities.end() && it->second == state)
+      {
+        cache_statistics.filtered_commands_count++;
+        return;
+      }
+
+      capabilities[capability] = state;
+
+      cache_statistics.issued_commands_count++;
+
+      if (state) glEnable(capability);
+      else       glDisable(capability);
+    }
+
+    /// Blending function
+    void blend_func(GLenum source, GLenum destination)
+    {
+      if (blend_source == source && blend_destination == destination)
+      {
+        cache_statistics.filtered_commands_count++;
+        return;
+      }
+
+      blend_source = source;
+      blend_destination = destination;
+
+      cache_statistics.issued_commands_count++;
+
+      glBlendFunc(source, destination);
+    }
+
+    /// Depth compare function
+    void set_depth_func(GLenum func)
+    {
+      if (filter(depth_func, func))
+        return;
+
+      glDepthFunc(func);
+    }
+
+    /// Depth write mask
+    void set_depth_mask(bool state)
+    {
+      if (filter(depth_mask, GLuint(state)))
+        return;
+
+      glDepthMask(state);
+    }
+
+    /// Viewport (all indexed viewports are changed)
+    void set_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+      bool is_changed = false;
+
+      for (GLint* indexed_viewport : viewports)
+        is_changed |= !is_equal(indexed_viewport, x, y, width, height);
+
+      if (!is_changed)
+      {
+        cache_statistics.filtered_commands_count++;
+        return;
+      }
+
+      for (GLint* indexed_viewport : viewports)
+        assign(indexed_viewport, x, y, width, height);
+
+      cache_statistics.issued_commands_count++;
+
+      glViewport(x, y, width, height);
+    }
+
+    /// Viewport selected by gl_ViewportIndex
+    void set_viewport(GLuint index, GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+      engine_check_range(index, MAX_VIEWPORTS);
+
+      if (is_equal(viewports[index], x, y, width, height))
+      {
+        cache_statistics.filtered_commands_count++;
+        return;
+      }
+
+      assign(viewports[index], x, y, width, height);
+
+      cache_statistics.issued_commands_count++;
+
+      glViewportIndexedf(index, GLfloat(x), GLfloat(y), GLfloat(width), GLfloat(height));
+    }
+
+    /// Objects deletion notifications (deleted objects are unbound by the driver and their names may be reused)
+    void on_program_deleted(GLuint id) { reset(program, id); }
+    void on_frame_buffer_deleted(GLuint id) { reset(frame_buffer, id); }
+    void on_render_buffer_deleted(GLuint id) { reset(render_buffer, id); }
+    void on_vertex_array_deleted(GLuint id)
+    {
+      if (vertex_array != id)
+        return;
+
+      vertex_array = 0;
+
+      on_vertex_array_changed();
+    }
+
+    void on_buffer_deleted(GLuint id)
+    {
+      reset(array_buffer, id);
+      reset(element_array_buffer, id);
+      reset(draw_indirect_buffer, id);
+      reset(uniform_buffer, id);
+      reset(pixel_unpack_buffer, id);
+
+      for (UniformBufferRange& range : uniform_buffer_ranges)
+        reset(range.buffer, id);
+    }
+
+    void on_texture_deleted(GLuint id)
+    {
+      for (GLuint& texture : textures)
+        reset(texture, id);
+    }
+
+    /// Vertex array object has been changed (element array buffer binding is a part of VAO state)
+    void on_vertex_array_changed()
+    {
+      element_array_buffer = UNKNOWN_OBJECT;
+    }
+
+  private:
+    bool filter(GLuint& cached_value, GLuint value)
+    {
+      if (cached_value == value)
+      {
+        cache_statistics.filtered_commands_count++;
+        return true;
+      }
+
+      cached_value = value;
+
+      cache_statistics.issued_commands_count++;
+
+      return false;
+    }
+
+    static void reset(GLuint& binding, GLuint id)
+    {
+      if (binding == id)
+        binding = 0;
+    }
+
+    static bool is_equal(const GLint* viewport, GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+      return viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height;
+    }
+
+    static void assign(GLint* viewport, GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+      viewport[0] = x;
+      viewport[1] = y;
+      viewport[2] = width;
+      viewport[3] = height;
+    }
+
+    GLuint* find_buffer_binding(GLenum target)
+    {
+      switch (target)
+      {
+        case GL_ARRAY_BUFFER:         return &array_buffer;
+        case GL_ELEMENT_ARRAY_BUFFER: return &element_array_buffer;
+        case GL_DRAW_INDIRECT_BUFFER: return &draw_indirect_buffer;
+        case GL_UNIFORM_BUFFER:       return &uniform_buffer;
+        case GL_PIXEL_UNPACK_BUFFER:  return &pixel_unpack_buffer;
+        default:                      return nullptr;
+      }
+    }
+
+  private:
+    struct UniformBufferRange
+    {
+      GLuint buffer; //buffer object
+      size_t offset; //offset of the range
+      size_t size; //size of the range
+
+      UniformBufferRange() : buffer(), offset(), size() {}
+    };
+
+  private:
+    GLuint program; //current program
+    GLuint array_buffer; //GL_ARRAY_BUFFER binding
+    GLuint element_array_buffer; //GL_ELEMENT_ARRAY_BUFFER binding
+    GLuint draw_indirect_buffer; //GL_DRAW_INDIRECT_BUFFER binding
+    GLuint uniform_buffer; //GL_UNIFORM_BUFFER generic binding
+    UniformBufferRange uniform_buffer_ranges[MAX_UNIFORM_BUFFER_BINDINGS]; //indexed GL_UNIFORM_BUFFER bindings
+    GLuint pixel_unpack_buffer; //GL_PIXEL_UNPACK_BUFFER binding
+    GLuint frame_buffer; //GL_FRAMEBUFFER binding
+    GLuint render_buffer; //GL_RENDERBUFFER binding
+    GLuint active_texture_unit; //active texture unit
+    GLuint textures[MAX_TEXTURE_UNITS]; //GL_TEXTURE_2D bindings per unit
+    std::unordered_map<GLenum, bool> capabilities; //enabled capabilities
+    GLenum blend_source; //blending source argument
+    GLenum blend_destination; //blending destination argument
+    GLenum depth_func; //depth compare function
+    GLuint depth_mask; //depth write mask
+    GLint viewports[MAX_VIEWPORTS][4]; //indexed viewports
+    GLuint vertex_array; //vertex array object binding
+    StateCacheStatistics cache_statistics; //statistics
+};
+
+/// Cache of vertex array objects for (program input layout, vertex buffer, index buffer, base vertex) tuples
+class VertexArrayCache: BaseObject
+{
+  public:
+    /// Program attributes
+    enum Attribute
+    {
+      Attribute_Position,
+      Attribute_Normal,
+      Attribute_Color,
+      Attribute_TexCoord,
+      Attribute_InstanceTransform, //per instance model matrix (mat4; 4 locations)
+
+      ATTRIBUTES_COUNT
+    };
+
+    /// Constructor
+    VertexArrayCache(DeviceStateCache& state_cache);
+
+    /// Destructor
+    ~VertexArrayCache();
+
+    /// Bind vertex array object for draw (attribute_locations has ATTRIBUTES_COUNT elements; -1 for unused attributes)
+    void bind(const GLint* attribute_locations, VertexFormat vertex_format, GLuint vertex_buffer, GLuint index_buffer, size_t base_vertex);
+
+    /// Set per instance model matrices stream for the bound vertex array object (instance stream isn't a part of a key)
+    void bind_instance_stream(const GLint* attribute_locations, GLuint instance_buffer, size_t offset);
+
+    /// Bind vertex array object which isn't used for draws (buffers updates mustn't change cached objects)
+    void bind_default();
+
+    /// Remove vertex array objects which refer to a deleted buffer
+    void on_buffer_deleted(GLuint buffer);
+
+    /// Number of cached objects
+    size_t size() const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+/// Ring of per-frame fences; data written by the CPU for a frame may be overwritten after the GPU has completed the frame
+class FrameFences: BaseObject
+{
+  public:
+    /// Constants
+    static constexpr size_t FRAMES_IN_FLIGHT = 3; //number of frames which may be queued before waiting for the GPU
+
+    /// Constructor
+    FrameFences();
+
+    /// Destructor
+    ~FrameFences();
+
+    /// Index of the frame which is being recorded
+    size_t current_frame() const;
+
+    /// Insert fence for the current frame and start the next frame
+    void end_frame();
+
+    /// Wait until the GPU completes the frame (returns immediately if the frame has been completed)
+    void wait_frame(size_t frame);
+
+    /// Check whether the GPU has completed the frame (doesn't wait)
+    bool is_frame_completed(size_t frame);
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+/// Asynchronous texture uploads; data is staged in a pool of pixel buffers and transferred within per-frame bytes budget
+class TextureUploader: BaseObject
+{
+  public:
+    /// Constructor
+    TextureUploader(DeviceStateCache& state_cache, FrameFences& fences, size_t frame_budget);
+
+    /// Destructor
+    ~TextureUploader();
+
+    /// Queue upload of a texture region (data is copied); returns ticket of the upload
+    size_t upload(GLenum target,
+                  GLuint texture,
+                  GLint level,
+                  size_t x,
+                  size_t y,
+                  size_t width,
+                  size_t height,
+                  GLenum format,
+                  GLenum type,
+                  size_t pixel_size,
+                  const void* data);
+
+    /// Queue upload of a block compressed texture region (data is copied); returns ticket of the upload
+    size_t upload_compressed(GLenum target,
+                             GLuint texture,
+                             GLint level,
+                             size_t x,
+                             size_t y,
+                             size_t width,
+                             size_t height,
+                             GLenum internal_format,
+                             size_t block_bytes,
+                             const void* data);
+
+    /// Queue mipmaps generation after the previously queued uploads of the texture; returns ticket
+    size_t generate_mips(GLenum target, GLuint texture);
+
+    /// Check whether the upload has been transferred by the GPU
+    bool is_completed(size_t ticket);
+
+    /// Issue queued uploads of the texture immediately (before synchronous access to the texture)
+    void flush(GLuint texture);
+
+    /// Issue queued uploads of the texture before synchronous write to the region; overwritten uploads are dropped
+    void flush(GLuint texture, GLint level, size_t x, size_t y, size_t width, size_t height);
+
+    /// Remove queued uploads of a deleted texture
+    void on_texture_deleted(GLuint texture);
+
+    /// Issue queued uploads within bytes budget of the current frame
+    void update();
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+/// Uniform buffer suballocated as a ring; blocks data is written once to unsynchronized mapped ranges and bound by range,
+/// ranges of the previous lap are reused after the GPU has completed frames which used them
+class UniformBufferRing: BaseObject
+{
+  public:
+    /// Constructor
+    UniformBufferRing(DeviceStateCache& state_cache, FrameFences& fences, size_t capacity, size_t alignment);
+
+    /// Destructor
+    ~UniformBufferRing();
+
+    /// Upload block data and bind it to a binding point (identical data which is still in the ring is reused)
+    void bind(GLuint binding, const void* data, size_t size);
+
+    /// Ring capacity
+    size_t capacity() const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
 /// Device context implementation
 class DeviceContextImpl: BaseObject
 {
@@ -56,14 +635,30 @@ class DeviceContextImpl: BaseObject
     /// Constructor
     DeviceContextImpl(const Window& window, const DeviceOptions& options);
 
+    /// Constructor of headless context for null and software backends (no window and GL context are created)
+    DeviceContextImpl(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options);
+
     /// Destructor
     ~DeviceContextImpl();
 
-    /// Window handle
+    /// Window handle (null for headless context)
     GLFWwindow* handle() const { return context; }
 
+    /// Has render window
+    bool has_window() const { return render_window != nullptr; }
+
     /// Access to a render window
-    const Window& window() const { return render_window; }
+    const Window& window() const
+    {
+      if (!render_window)
+        throw common::Exception::format("Headless device context has no window");
+
+      return *render_window;
+    }
+
+    /// Size of the window frame buffer
+    int frame_buffer_width() const { return render_window ? render_window->frame_buffer_width() : headless_width; }
+    int frame_buffer_height() const { return render_window ? render_window->frame_buffer_height() : headless_height; }
 
     /// Options
     const DeviceOptions& options() const { return device_options; }
@@ -71,12 +666,44 @@ class DeviceContextImpl: BaseObject
     /// Context capabilities
     const DeviceContextCapabilities& capabilities() const { return device_capabilities; }
 
+    /// Driver state cache
+    DeviceStateCache& state_cache() { return state; }
+
+    /// Vertex array objects cache
+    VertexArrayCache& vertex_array_cache() { return *vertex_arrays; }
+
+    /// Uniform buffer ring for program uniform blocks
+    UniformBufferRing& uniform_buffer_ring() { return *uniform_buffers; }
+
+    /// Per-frame fences
+    FrameFences& frame_fences() { return *fences; }
+
+    /// Asynchronous texture uploads
+    TextureUploader& texture_uploader() { return *uploader; }
+
+    /// Worker threads for CPU side frame preparation
+    common::ThreadPool& thread_pool() { return workers; }
+
     /// Make context current
     void make_current()
     {
+      if (device_options.backend != DeviceBackend_OpenGL)
+        return;
+
       make_current(context);
     }
 
+    /// Frame completion
+    void end_frame()
+    {
+      fences->end_frame();
+
+      if (trace_recorder)
+        trace_recorder->end_frame();
+
+      uploader->update();
+    }
+
     /// Check errors
     void check_errors()
     {
@@ -93,6 +720,8 @@ class DeviceContextImpl: BaseObject
     }    
 
   private:
+    void init();
+
     static void make_current(GLFWwindow* context)
     {
       static GLFWwindow* current_context = 0;
@@ -142,10 +771,18 @@ class DeviceContextImpl: BaseObject
     }
 
   private:
-    Window render_window; //target window
+    std::unique_ptr<Window> render_window; //target window (null for headless context)
     GLFWwindow* context; //context
+    int headless_width, headless_height; //size of the window frame buffer of headless context
     DeviceOptions device_options; //device options
     DeviceContextCapabilities device_capabilities; //device context capabilities
+    DeviceStateCache state; //driver state cache
+    std::unique_ptr<VertexArrayCache> vertex_arrays; //vertex array objects cache
+    std::unique_ptr<UniformBufferRing> uniform_buffers; //uniform buffer ring
+    std::unique_ptr<FrameFences> fences; //per-frame fences
+    std::unique_ptr<TextureUploader> uploader; //asynchronous texture uploads
+    std::unique_ptr<TraceRecorder> trace_recorder; //commands trace recorder
+    common::ThreadPool workers; //worker threads
 };
 
 /// Texture level info
@@ -155,12 +792,14 @@ struct TextureLevelInfo
   GLenum target; //target
   GLint width; //layer width
   GLint height; //layer height
+  GLint layer; //layer of texture array (-1 for non-layered textures)
 
   TextureLevelInfo()
     : texture_id()
     , target()
     , width()
     , height()
+    , layer(-1)
   {
   }
 };
@@ -185,6 +824,10 @@ struct ProgramParameter
   size_t elements_count; //number of elements (for arrays)
   bool is_sampler; //is this parameter a sampler
   int location; //location of the parameter
+  int block_index; //index of the uniform block (-1 for default block parameters)
+  size_t block_offset; //offset of the parameter in the uniform block
+  size_t array_stride; //stride between array elements in the uniform block
+  size_t matrix_stride; //stride between matrix columns in the uniform block
 
   ProgramParameter()
     : type()
@@ -192,6 +835,23 @@ struct ProgramParameter
     , elements_count()
     , is_sampler()
     , location(-1)
+    , block_index(-1)
+    , block_offset()
+    , array_stride()
+    , matrix_stride()
+  { }
+};
+
+/// Program uniform block
+struct ProgramUniformBlock
+{
+  std::string name; //block name
+  size_t data_size; //size of the block data
+  unsigned int binding; //uniform buffer binding point
+
+  ProgramUniformBlock()
+    : data_size()
+    , binding()
   { }
 };
 
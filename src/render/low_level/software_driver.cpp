@@ -0,0 +1,3064 @@
+#include "shared.h"
+
+#include <functional>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+
+#include <common/thread_pool.h>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+///
+/// Constants
+///
+
+static constexpr int SOFTWARE_TILE_SIZE = 64; //size of screen tile processed by one worker
+static constexpr size_t SOFTWARE_MAX_VERTEX_ATTRIBUTES = 16; //number of vertex attributes
+static constexpr size_t SOFTWARE_MAX_TEXTURE_UNITS = 16; //number of texture units
+static constexpr size_t SOFTWARE_MAX_DRAW_BUFFERS = 8; //number of draw buffers
+static constexpr size_t SOFTWARE_MAX_UNIFORM_BUFFER_BINDINGS = 16; //number of uniform buffer binding points
+static constexpr size_t SOFTWARE_MAX_VIEWPORTS = 16; //number of indexed viewports
+static constexpr size_t SOFTWARE_MAX_VARYINGS = 16; //number of interpolated floats per vertex
+static constexpr size_t SOFTWARE_VERTICES_BATCH_SIZE = 1024; //number of vertices / triangles processed by one worker job
+static constexpr float SOFTWARE_NEAR_CLIP_EPSILON = 1e-5f; //minimal clip w
+static constexpr float SHININESS_NORMALIZER = 1000.0f; //see phong_gbuffer.glsl / lighting.glsl
+static constexpr float MIN_DIFFUSE_AMOUNT = 0.1f; //see lighting.glsl
+static constexpr float SHADOW_DEPTH_BIAS = 0.0001f; //see lighting.glsl
+
+///
+/// Software driver:
+///   - built on top of the null driver (objects names, shaders reflection)
+///   - keeps buffers, textures, render buffers and frame buffers in system memory
+///   - programs are not interpreted; instead program is matched by its interface to one of the built-in C++ kernels
+///     (G-buffer, deferred lighting, depth only); draws with other programs are skipped
+///   - primitives are rasterized by screen tiles in parallel worker threads
+///
+
+namespace
+{
+
+/// Color / depth surface (texture level or render buffer); 4 float channels per pixel
+struct Surface
+{
+  GLenum internal_format; //internal format
+  GLint width; //width
+  GLint height; //height
+  bool is_normalized; //values are quantized to 8-bit unorm on write
+  std::vector<float> pixels; //pixels
+
+  Surface()
+    : internal_format()
+    , width()
+    , height()
+    , is_normalized()
+  {
+  }
+
+  void resize(GLenum format, GLint new_width, GLint new_height)
+  {
+    internal_format = format;
+    width = new_width;
+    height = new_height;
+    is_normalized = format == GL_RGBA8 || format == GL_RGBA || format == GL_RGB8;
+
+    pixels.assign(size_t(width) * height * 4, 0.0f);
+  }
+
+  float* pixel(GLint x, GLint y) { return &pixels[(size_t(y) * width + x) * 4]; }
+  const float* pixel(GLint x, GLint y) const { return &pixels[(size_t(y) * width + x) * 4]; }
+
+  void write(GLint x, GLint y, const float* value)
+  {
+    float* dst = pixel(x, y);
+
+    if (is_normalized)
+    {
+      for (int i=0; i<4; i++)
+        dst[i] = std::round(std::min(std::max(value[i], 0.0f), 1.0f) * 255.0f) / 255.0f;
+    }
+    else
+    {
+      for (int i=0; i<4; i++)
+        dst[i] = value[i];
+    }
+  }
+};
+
+/// Texture object
+struct SoftwareTexture
+{
+  std::vector<Surface> levels; //mip levels (level-major for texture arrays)
+  GLint layers; //number of array layers (1 for 2D textures)
+  GLint min_filter; //minification filter
+  GLint mag_filter; //magnification filter
+  GLint max_level; //max mip level
+
+  SoftwareTexture()
+    : layers(1)
+    , min_filter(GL_NEAREST_MIPMAP_LINEAR)
+    , mag_filter(GL_LINEAR)
+    , max_level(1000)
+  {
+  }
+
+  GLint levels_count() const { return GLint(levels.size()) / layers; }
+
+  Surface& surface(GLint level, GLint layer) { return levels[size_t(level) * layers + layer]; }
+  const Surface& surface(GLint level, GLint layer) const { return levels[size_t(level) * layers + layer]; }
+};
+
+/// Frame buffer attachment
+struct Attachment
+{
+  GLuint texture; //texture object
+  GLint level; //texture level
+  GLint layer; //texture array layer (-1 - all layers are attached)
+  GLuint render_buffer; //render buffer object
+
+  Attachment()
+    : texture()
+    , level()
+    , layer()
+    , render_buffer()
+  {
+  }
+};
+
+/// Frame buffer object
+struct SoftwareFrameBuffer
+{
+  Attachment colors[SOFTWARE_MAX_DRAW_BUFFERS]; //color attachments
+  Attachment depth; //depth attachment
+};
+
+/// Vertex attribute pointer
+struct VertexAttribute
+{
+  bool enabled; //is attribute enabled
+  GLint size; //number of components
+  GLenum type; //component type
+  bool normalized; //is normalized
+  GLsizei stride; //stride
+  size_t offset; //offset in buffer
+  GLuint buffer; //buffer object
+  GLuint divisor; //instance divisor (0 - per vertex attribute)
+
+  VertexAttribute()
+    : enabled()
+    , size(4)
+    , type(GL_FLOAT)
+    , normalized()
+    , stride()
+    , offset()
+    , buffer()
+    , divisor()
+  {
+  }
+};
+
+/// Vertex array object
+struct SoftwareVertexArray
+{
+  VertexAttribute attributes[SOFTWARE_MAX_VERTEX_ATTRIBUTES]; //vertex attributes
+  GLuint element_array_buffer; //GL_ELEMENT_ARRAY_BUFFER binding
+
+  SoftwareVertexArray()
+    : element_array_buffer()
+  {
+  }
+};
+
+/// Built-in program kernels
+enum Kernel
+{
+  Kernel_Unsupported, //draws are skipped
+  Kernel_GBuffer, //phong_gbuffer.glsl
+  Kernel_Lighting, //lighting.glsl
+  Kernel_Depth, //shadow.glsl
+  Kernel_LayeredDepth, //shadow_layered.glsl
+};
+
+/// Uniform reflection
+struct UniformInfo
+{
+  GLint location; //location (uniform block members get slots after default block uniforms)
+  GLint elements_count; //number of array elements
+  GLenum type; //GL type
+  GLint block_index; //uniform block index (-1 for default block uniforms)
+  GLint offset; //offset in the uniform block
+  GLint array_stride; //stride of array elements in the uniform block
+  GLint matrix_stride; //stride of matrix columns in the uniform block
+
+  UniformInfo()
+    : location(-1)
+    , elements_count()
+    , type(GL_NONE)
+    , block_index(-1)
+    , offset()
+    , array_stride()
+    , matrix_stride()
+  {
+  }
+};
+
+/// Indexed uniform buffer binding
+struct UniformBufferBinding
+{
+  GLuint buffer; //buffer object
+  size_t offset; //offset of the range
+  size_t size; //size of the range
+
+  UniformBufferBinding()
+    : buffer()
+    , offset()
+    , size()
+  {
+  }
+};
+
+/// Uniform slot (up to mat4, row-major)
+typedef std::array<float, 16> UniformSlot;
+
+/// Program object
+struct SoftwareProgram
+{
+  Kernel kernel; //built-in kernel
+  std::unordered_map<std::string, UniformInfo> uniforms; //uniforms
+  std::vector<UniformSlot> slots; //uniform values
+  std::vector<UniformInfo> block_uniforms; //uniform blocks members (values are fetched from uniform buffers before draws)
+  std::vector<GLuint> block_bindings; //uniform buffer binding points of uniform blocks
+  GLint position_attribute; //vPosition location
+  GLint normal_attribute; //vNormal location
+  GLint color_attribute; //vColor location
+  GLint texcoord_attribute; //vTexCoord location
+  GLint instance_transform_attribute; //vInstanceModelMatrix location (4 locations)
+  GLint outputs[4]; //locations of kernel outputs
+  bool is_unsupported_reported; //was unsupported program reported
+
+  SoftwareProgram()
+    : kernel(Kernel_Unsupported)
+    , position_attribute(-1)
+    , normal_attribute(-1)
+    , color_attribute(-1)
+    , texcoord_attribute(-1)
+    , instance_transform_attribute(-1)
+    , is_unsupported_reported()
+  {
+    for (GLint& output : outputs)
+      output = -1;
+  }
+
+  UniformInfo find_uniform(const char* name) const
+  {
+    auto it = uniforms.find(name);
+
+    return it != uniforms.end() ? it->second : UniformInfo();
+  }
+
+  const float* get(const UniformInfo& uniform, size_t index = 0) const
+  {
+    static const UniformSlot EMPTY_SLOT = {};
+
+    if (uniform.location < 0 || index >= size_t(uniform.elements_count) || uniform.location + index >= slots.size())
+      return EMPTY_SLOT.data();
+
+    return slots[uniform.location + index].data();
+  }
+
+  UniformSlot* slot(GLint location)
+  {
+    if (location < 0)
+      return nullptr;
+
+    if (size_t(location) >= slots.size())
+      slots.resize(location + 1, UniformSlot());
+
+    return &slots[location];
+  }
+};
+
+/// Transformed vertex
+struct ShadedVertex
+{
+  float position[4]; //clip position
+  float varyings[SOFTWARE_MAX_VARYINGS]; //interpolated attributes
+};
+
+/// Triangle prepared for rasterization
+struct SetupTriangle
+{
+  float x[3], y[3]; //window coordinates
+  float z[3]; //depth
+  float inv_w[3]; //1 / clip w (for perspective correct interpolation)
+  float inv_area; //1 / doubled area
+  int min_x, min_y, max_x, max_y; //bounding box
+  const float* varyings[3]; //vertices varyings
+};
+
+/// G-buffer kernel varyings layout
+enum GBufferVarying
+{
+  GBufferVarying_Position = 0, //world position (3)
+  GBufferVarying_Normal = 3, //world normal (3)
+  GBufferVarying_Color = 6, //vertex color (4)
+  GBufferVarying_TexCoord = 10, //texture coordinates (2)
+  GBufferVarying_EyeDirection = 12, //eye direction (3)
+
+  GBufferVarying_Num = 15
+};
+
+static_assert(GBufferVarying_Num <= SOFTWARE_MAX_VARYINGS, "Too many varyings");
+
+/// Half float conversion
+float half_to_float(uint16_t value)
+{
+  uint32_t sign = (value >> 15) & 1, exponent = (value >> 10) & 0x1f, mantissa = value & 0x3ff;
+
+  float result;
+
+  if (!exponent)          result = std::ldexp(float(mantissa), -24);
+  else if (exponent < 31) result = std::ldexp(float(mantissa | 0x400), int(exponent) - 25);
+  else                    result = mantissa ? NAN : INFINITY;
+
+  return sign ? -result : result;
+}
+
+/// Pixel transfer helpers
+size_t get_components_count(GLenum format)
+{
+  switch (format)
+  {
+    case GL_RED:
+    case GL_DEPTH_COMPONENT: return 1;
+    case GL_RG:              return 2;
+    case GL_RGB:             return 3;
+    case GL_RGBA:            return 4;
+    default:
+      throw Exception::format("Unsupported pixel format 0x%04x in software driver", format);
+  }
+}
+
+size_t get_component_size(GLenum type)
+{
+  switch (type)
+  {
+    case GL_UNSIGNED_BYTE:  return 1;
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:     return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:          return 4;
+    default:
+      throw Exception::format("Unsupported pixel type 0x%04x in software driver", type);
+  }
+}
+
+float read_component(const char* src, GLenum type)
+{
+  switch (type)
+  {
+    case GL_UNSIGNED_BYTE:  return *reinterpret_cast<const uint8_t*>(src) / 255.0f;
+    case GL_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, src, sizeof(v)); return v / 65535.0f; }
+    case GL_HALF_FLOAT:     { uint16_t v; memcpy(&v, src, sizeof(v)); return half_to_float(v); }
+    case GL_UNSIGNED_INT:   { uint32_t v; memcpy(&v, src, sizeof(v)); return float(double(v) / 4294967295.0); }
+    case GL_FLOAT:          { float v; memcpy(&v, src, sizeof(v)); return v; }
+    default:                return 0.0f;
+  }
+}
+
+void write_component(char* dst, GLenum type, float value)
+{
+  float clamped = std::min(std::max(value, 0.0f), 1.0f);
+
+  switch (type)
+  {
+    case GL_UNSIGNED_BYTE:  *reinterpret_cast<uint8_t*>(dst) = uint8_t(std::round(clamped * 255.0f)); break;
+    case GL_UNSIGNED_SHORT: { uint16_t v = uint16_t(std::round(clamped * 65535.0f)); memcpy(dst, &v, sizeof(v)); break; }
+    case GL_UNSIGNED_INT:   { uint32_t v = uint32_t(std::round(double(clamped) * 4294967295.0)); memcpy(dst, &v, sizeof(v)); break; }
+    case GL_FLOAT:          memcpy(dst, &value, sizeof(value)); break;
+    default:                throw Exception::format("Unsupported pixel read type 0x%04x in software driver", type);
+  }
+}
+
+size_t get_row_size(GLenum format, GLenum type, GLsizei width)
+{
+  static constexpr size_t ALIGNMENT = 4; //default GL_UNPACK_ALIGNMENT / GL_PACK_ALIGNMENT
+
+  return (width * get_components_count(format) * get_component_size(type) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/// Attribute fetch
+void fetch_attribute(const VertexAttribute& attribute, const char* base, size_t index, float* out)
+{
+  out[0] = out[1] = out[2] = 0.0f;
+  out[3] = 1.0f;
+
+  size_t component_size = 4;
+
+  switch (attribute.type)
+  {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:  component_size = 1; break;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:     component_size = 2; break;
+    default:                break;
+  }
+
+  bool is_packed = attribute.type == GL_INT_2_10_10_10_REV;
+  size_t stride = attribute.stride ? attribute.stride : is_packed ? sizeof(uint32_t) : component_size * attribute.size;
+  const char* src = base + attribute.offset + stride * index;
+
+  if (is_packed)
+  {
+      //signed 10:10:10:2 components in one word
+
+    uint32_t value;
+    memcpy(&value, src, sizeof(value));
+
+    for (GLint i=0; i<attribute.size && i<4; i++)
+    {
+      int bits = i < 3 ? 10 : 2;
+      int32_t component = int32_t(value << (32 - bits - 10 * i)) >> (32 - bits);
+
+      out[i] = attribute.normalized ? std::max(component / float((1 << (bits - 1)) - 1), -1.0f) : float(component);
+    }
+
+    return;
+  }
+
+  for (GLint i=0; i<attribute.size && i<4; i++, src += component_size)
+  {
+    switch (attribute.type)
+    {
+      case GL_FLOAT:
+        memcpy(&out[i], src, sizeof(float));
+        break;
+      case GL_HALF_FLOAT:
+      {
+        uint16_t value;
+        memcpy(&value, src, sizeof(value));
+        out[i] = half_to_float(value);
+        break;
+      }
+      case GL_BYTE:
+      {
+        int8_t value = *reinterpret_cast<const int8_t*>(src);
+        out[i] = attribute.normalized ? std::max(value / 127.0f, -1.0f) : value;
+        break;
+      }
+      case GL_UNSIGNED_BYTE:
+      {
+        uint8_t value = *reinterpret_cast<const uint8_t*>(src);
+        out[i] = attribute.normalized ? value / 255.0f : value;
+        break;
+      }
+      case GL_SHORT:
+      {
+        int16_t value;
+        memcpy(&value, src, sizeof(value));
+        out[i] = attribute.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        break;
+      }
+      case GL_UNSIGNED_SHORT:
+      {
+        uint16_t value;
+        memcpy(&value, src, sizeof(value));
+        out[i] = attribute.normalized ? value / 65535.0f : value;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+/// Vector helpers
+inline float dot3(const float* a, const float* b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline void cross3(const float* a, const float* b, float* out)
+{
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+inline void normalize3(float* v)
+{
+  float length_square = dot3(v, v);
+
+  if (length_square <= 0.0f)
+    return;
+
+  float inv_length = 1.0f / std::sqrt(length_square);
+
+  v[0] *= inv_length;
+  v[1] *= inv_length;
+  v[2] *= inv_length;
+}
+
+/// Row-major matrix by column vector multiplication
+inline void transform(const float* m, const float* v, float* out)
+{
+  for (int i=0; i<4; i++)
+    out[i] = m[i * 4] * v[0] + m[i * 4 + 1] * v[1] + m[i * 4 + 2] * v[2] + m[i * 4 + 3] * v[3];
+}
+
+/// Row-major matrices multiplication
+inline void multiply(const float* a, const float* b, float* out)
+{
+  for (int i=0; i<4; i++)
+    for (int j=0; j<4; j++)
+      out[i * 4 + j] = a[i * 4] * b[j] + a[i * 4 + 1] * b[4 + j] + a[i * 4 + 2] * b[8 + j] + a[i * 4 + 3] * b[12 + j];
+}
+
+/// Software driver state
+struct SoftwareDriver
+{
+  std::unordered_map<GLuint, std::vector<char>> buffers; //buffers data
+  std::unordered_map<GLuint, SoftwareTexture> textures; //textures
+  std::unordered_map<GLuint, Surface> render_buffers; //render buffers
+  std::unordered_map<GLuint, SoftwareFrameBuffer> frame_buffers; //frame buffers
+  std::unordered_map<GLuint, SoftwareProgram> programs; //programs
+  Surface window_color; //default frame buffer color
+  Surface window_depth; //default frame buffer depth
+  GLuint array_buffer; //GL_ARRAY_BUFFER binding
+  GLuint draw_indirect_buffer; //GL_DRAW_INDIRECT_BUFFER binding
+  GLuint uniform_buffer; //GL_UNIFORM_BUFFER generic binding
+  GLuint pixel_unpack_buffer; //GL_PIXEL_UNPACK_BUFFER binding
+  UniformBufferBinding uniform_buffers[SOFTWARE_MAX_UNIFORM_BUFFER_BINDINGS]; //GL_UNIFORM_BUFFER indexed bindings
+  GLuint render_buffer; //GL_RENDERBUFFER binding
+  GLuint frame_buffer; //GL_DRAW_FRAMEBUFFER binding
+  GLuint read_frame_buffer; //GL_READ_FRAMEBUFFER binding
+  GLuint current_program; //current program
+  size_t active_texture; //active texture unit
+  GLuint texture_units[SOFTWARE_MAX_TEXTURE_UNITS]; //GL_TEXTURE_2D bindings
+  std::unordered_map<GLuint, SoftwareVertexArray> vertex_arrays; //vertex array objects (0 - default)
+  GLuint vertex_array; //current vertex array object
+  GLenum draw_buffers[SOFTWARE_MAX_DRAW_BUFFERS]; //draw buffers
+  GLint viewport[4]; //viewport
+  GLint viewports[SOFTWARE_MAX_VIEWPORTS][4]; //indexed viewports (selected by gl_ViewportIndex; viewport 0 is the same as viewport)
+  GLint layer; //layer of layered attachments (selected by gl_Layer)
+  bool scissor_test; //scissor test enabled (applied to clears only, draws are bounded by the viewport)
+  GLint scissor[4]; //scissor box
+  bool depth_test; //depth test enabled
+  bool depth_write; //depth write enabled
+  GLenum depth_func; //depth compare function
+  bool cull_face; //face culling enabled
+  GLenum cull_mode; //culled faces
+  bool blend; //blending enabled
+  float clear_color[4]; //clear color
+  GLuint samples_query; //active GL_SAMPLES_PASSED query (0 - no query)
+  std::atomic<size_t> samples_passed; //number of samples passed during the active query
+  std::unordered_map<GLuint, GLuint> query_results; //results of ended queries
+  ThreadPool pool; //worker threads
+
+  SoftwareDriver()
+    : array_buffer()
+    , draw_indirect_buffer()
+    , uniform_buffer()
+    , pixel_unpack_buffer()
+    , render_buffer()
+    , frame_buffer()
+    , read_frame_buffer()
+    , current_program()
+    , active_texture()
+    , vertex_array()
+    , layer()
+    , scissor_test()
+    , depth_test()
+    , depth_write(true)
+    , depth_func(GL_LESS)
+    , cull_face()
+    , cull_mode(GL_BACK)
+    , blend()
+    , samples_query()
+    , samples_passed()
+  {
+    memset(texture_units, 0, sizeof(texture_units));
+    memset(viewport, 0, sizeof(viewport));
+    memset(viewports, 0, sizeof(viewports));
+    memset(scissor, 0, sizeof(scissor));
+    memset(clear_color, 0, sizeof(clear_color));
+
+    draw_buffers[0] = GL_BACK;
+
+    for (size_t i=1; i<SOFTWARE_MAX_DRAW_BUFFERS; i++)
+      draw_buffers[i] = GL_NONE;
+
+    engine_log_debug("Software driver has been created: %u worker threads", pool.workers_count());
+  }
+
+  static SoftwareDriver& instance()
+  {
+    static SoftwareDriver driver;
+    return driver;
+  }
+
+  /// Current vertex array object
+  SoftwareVertexArray& current_vertex_array()
+  {
+    return vertex_arrays[vertex_array];
+  }
+
+  /// Objects lookup
+  SoftwareTexture* bound_texture(size_t unit)
+  {
+    if (unit >= SOFTWARE_MAX_TEXTURE_UNITS)
+      return nullptr;
+
+    auto it = textures.find(texture_units[unit]);
+
+    return it != textures.end() ? &it->second : nullptr;
+  }
+
+  SoftwareProgram* find_program(GLuint program)
+  {
+    auto it = programs.find(program);
+
+    return it != programs.end() ? &it->second : nullptr;
+  }
+
+  Surface* resolve(const Attachment& attachment)
+  {
+    if (attachment.render_buffer)
+    {
+      auto it = render_buffers.find(attachment.render_buffer);
+
+      return it != render_buffers.end() ? &it->second : nullptr;
+    }
+
+    auto it = textures.find(attachment.texture);
+    GLint attachment_layer = attachment.layer < 0 ? layer : attachment.layer;
+
+    if (it == textures.end() || attachment.level >= it->second.levels_count() || attachment_layer >= it->second.layers)
+      return nullptr;
+
+    return &it->second.surface(attachment.level, attachment_layer);
+  }
+
+  /// Current frame buffer surfaces
+  Surface* color_target(size_t output)
+  {
+    if (output >= SOFTWARE_MAX_DRAW_BUFFERS)
+      return nullptr;
+
+    GLenum buffer = draw_buffers[output];
+
+    if (!frame_buffer)
+    {
+      update_window_surfaces();
+
+      return buffer == GL_BACK || buffer == GL_FRONT || buffer == GL_BACK_LEFT ? &window_color : nullptr;
+    }
+
+    if (buffer < GL_COLOR_ATTACHMENT0 || buffer >= GL_COLOR_ATTACHMENT0 + SOFTWARE_MAX_DRAW_BUFFERS)
+      return nullptr;
+
+    auto it = frame_buffers.find(frame_buffer);
+
+    return it != frame_buffers.end() ? resolve(it->second.colors[buffer - GL_COLOR_ATTACHMENT0]) : nullptr;
+  }
+
+  Surface* depth_target()
+  {
+    if (!frame_buffer)
+    {
+      update_window_surfaces();
+
+      return &window_depth;
+    }
+
+    auto it = frame_buffers.find(frame_buffer);
+
+    return it != frame_buffers.end() ? resolve(it->second.depth) : nullptr;
+  }
+
+  /// Read frame buffer surfaces
+  Surface* read_target(GLbitfield buffer)
+  {
+    if (!read_frame_buffer)
+    {
+      update_window_surfaces();
+
+      return buffer == GL_DEPTH_BUFFER_BIT ? &window_depth : &window_color;
+    }
+
+    auto it = frame_buffers.find(read_frame_buffer);
+
+    if (it == frame_buffers.end())
+      return nullptr;
+
+    return resolve(buffer == GL_DEPTH_BUFFER_BIT ? it->second.depth : it->second.colors[0]);
+  }
+
+  /// Window surfaces are resized on use, since redundant viewport changes may be filtered while other frame buffer is bound
+  void update_window_surfaces()
+  {
+    GLint width = std::max(viewport[0] + viewport[2], window_color.width);
+    GLint height = std::max(viewport[1] + viewport[3], window_color.height);
+
+    if (width == window_color.width && height == window_color.height)
+      return;
+
+    window_color.resize(GL_RGBA8, width, height);
+    window_depth.resize(GL_DEPTH_COMPONENT, width, height);
+
+    for (size_t i=0, count=window_depth.pixels.size(); i<count; i++)
+      window_depth.pixels[i] = 1.0f;
+  }
+};
+
+/// Null driver entry points (used for objects names & reflection)
+template <class Fn> Fn get_null_function(const char* name)
+{
+  Fn fn = reinterpret_cast<Fn>(get_null_driver_proc_address(name));
+
+  if (!fn)
+    throw Exception::format("Null driver function '%s' not found", name);
+
+  return fn;
+}
+
+///
+/// Texture sampling
+///
+
+/// Wrap coordinate (GL_REPEAT)
+inline int wrap(int coord, int size)
+{
+  coord %= size;
+
+  return coord < 0 ? coord + size : coord;
+}
+
+void sample_nearest(const Surface& surface, float u, float v, float* out)
+{
+  int x = wrap(int(std::floor(u * surface.width)), surface.width);
+  int y = wrap(int(std::floor(v * surface.height)), surface.height);
+
+  memcpy(out, surface.pixel(x, y), sizeof(float) * 4);
+}
+
+void sample_linear(const Surface& surface, float u, float v, float* out)
+{
+  float fx = u * surface.width - 0.5f, fy = v * surface.height - 0.5f;
+  float x0f = std::floor(fx), y0f = std::floor(fy);
+  float tx = fx - x0f, ty = fy - y0f;
+  int x0 = wrap(int(x0f), surface.width), y0 = wrap(int(y0f), surface.height);
+  int x1 = wrap(x0 + 1, surface.width), y1 = wrap(y0 + 1, surface.height);
+
+  const float* p00 = surface.pixel(x0, y0);
+  const float* p10 = surface.pixel(x1, y0);
+  const float* p01 = surface.pixel(x0, y1);
+  const float* p11 = surface.pixel(x1, y1);
+
+  for (int i=0; i<4; i++)
+  {
+    float top = p00[i] + (p10[i] - p00[i]) * tx;
+    float bottom = p01[i] + (p11[i] - p01[i]) * tx;
+
+    out[i] = top + (bottom - top) * ty;
+  }
+}
+
+/// Sample texture with given level of detail (log2 of texels per pixel)
+void sample(const SoftwareTexture* texture, float u, float v, float lod, float* out, GLint layer = 0)
+{
+  if (!texture || texture->levels.empty() || !texture->levels[0].width)
+  {
+    out[0] = out[1] = out[2] = 0.0f;
+    out[3] = 1.0f;
+    return;
+  }
+
+  layer = std::min(std::max(layer, 0), texture->layers - 1);
+
+  bool is_magnification = lod <= 0.0f;
+  GLint filter = is_magnification ? texture->mag_filter : texture->min_filter;
+  GLint max_level = std::min(texture->max_level, texture->levels_count() - 1);
+
+  switch (filter)
+  {
+    case GL_NEAREST:
+      sample_nearest(texture->surface(0, layer), u, v, out);
+      break;
+    case GL_LINEAR:
+      sample_linear(texture->surface(0, layer), u, v, out);
+      break;
+    case GL_NEAREST_MIPMAP_NEAREST:
+    case GL_LINEAR_MIPMAP_NEAREST:
+    {
+      GLint level = std::min(GLint(std::round(lod)), max_level);
+
+      if (filter == GL_NEAREST_MIPMAP_NEAREST) sample_nearest(texture->surface(level, layer), u, v, out);
+      else                                     sample_linear(texture->surface(level, layer), u, v, out);
+
+      break;
+    }
+    default:
+    {
+      float level = std::min(lod, float(max_level));
+      GLint level0 = GLint(std::floor(level)), level1 = std::min(level0 + 1, max_level);
+      float t = level - level0;
+      float color0[4], color1[4];
+
+      if (filter == GL_NEAREST_MIPMAP_LINEAR)
+      {
+        sample_nearest(texture->surface(level0, layer), u, v, color0);
+        sample_nearest(texture->surface(level1, layer), u, v, color1);
+      }
+      else
+      {
+        sample_linear(texture->surface(level0, layer), u, v, color0);
+        sample_linear(texture->surface(level1, layer), u, v, color1);
+      }
+
+      for (int i=0; i<4; i++)
+        out[i] = color0[i] + (color1[i] - color0[i]) * t;
+
+      break;
+    }
+  }
+}
+
+float compute_lod(const SoftwareTexture* texture, const float* duv_dx, const float* duv_dy)
+{
+  if (!texture || texture->levels.empty())
+    return 0.0f;
+
+  float width = float(texture->levels[0].width), height = float(texture->levels[0].height);
+  float dx = duv_dx[0] * width, dy = duv_dx[1] * height;
+  float ex = duv_dy[0] * width, ey = duv_dy[1] * height;
+  float rho = std::max(dx * dx + dy * dy, ex * ex + ey * ey);
+
+  return rho > 0.0f ? 0.5f * std::log2(rho) : 0.0f;
+}
+
+///
+/// Draw processing
+///
+
+/// Draw context shared by workers
+struct DrawContext
+{
+  SoftwareDriver* driver; //driver
+  SoftwareProgram* program; //program
+  Surface* color_targets[4]; //targets for kernel outputs
+  Surface* depth_target; //depth target
+  GLint viewport[4]; //viewport clipped by targets
+  GLint window_viewport[4]; //viewport of the clip to window coordinates transform
+  SoftwareTexture* textures[3]; //kernel textures
+  float mvp[16]; //model-view-projection matrix of the current instance (row-major)
+  float model_tm[16]; //model matrix of the current instance (row-major)
+  std::vector<SetupTriangle> triangles; //triangles
+};
+
+/// Vertex stage
+void shade_vertex(const DrawContext& context, const char* const* attribute_data, const VertexAttribute* const* attributes, size_t index, ShadedVertex& out)
+{
+  const SoftwareProgram& program = *context.program;
+
+  float position[4];
+
+  fetch_attribute(*attributes[0], attribute_data[0], index, position);
+
+  transform(context.mvp, position, out.position);
+
+  if (program.kernel != Kernel_GBuffer)
+    return;
+
+  const float* model_tm = context.model_tm;
+  const float* view_position = program.get(program.find_uniform("worldViewPosition"));
+  float world_position[4], normal[4], world_normal[4];
+
+  transform(model_tm, position, world_position);
+
+  if (attributes[1]) fetch_attribute(*attributes[1], attribute_data[1], index, normal);
+  else               normal[0] = normal[1] = normal[2] = 0.0f;
+
+  normal[3] = 0.0f;
+
+  transform(model_tm, normal, world_normal);
+
+  float* varyings = out.varyings;
+
+  memcpy(varyings + GBufferVarying_Position, world_position, sizeof(float) * 3);
+  memcpy(varyings + GBufferVarying_Normal, world_normal, sizeof(float) * 3);
+
+  if (attributes[2]) fetch_attribute(*attributes[2], attribute_data[2], index, varyings + GBufferVarying_Color);
+  else               std::fill(varyings + GBufferVarying_Color, varyings + GBufferVarying_Color + 4, 1.0f);
+
+  float texcoord[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+  if (attributes[3])
+    fetch_attribute(*attributes[3], attribute_data[3], index, texcoord);
+
+  varyings[GBufferVarying_TexCoord] = texcoord[0];
+  varyings[GBufferVarying_TexCoord + 1] = texcoord[1];
+
+  for (int i=0; i<3; i++)
+    varyings[GBufferVarying_EyeDirection + i] = view_position[i] - world_position[i];
+}
+
+/// Clip polygon by near plane (z >= -w)
+size_t clip_near(const ShadedVertex* const* input, ShadedVertex* clipped, const ShadedVertex** output)
+{
+  size_t output_count = 0, clipped_count = 0;
+
+  for (size_t i=0; i<3; i++)
+  {
+    const ShadedVertex& a = *input[i];
+    const ShadedVertex& b = *input[(i + 1) % 3];
+    float da = a.position[2] + a.position[3], db = b.position[2] + b.position[3];
+
+    if (da >= 0.0f)
+      output[output_count++] = &a;
+
+    if ((da >= 0.0f) != (db >= 0.0f))
+    {
+      float t = da / (da - db);
+      ShadedVertex& v = clipped[clipped_count++];
+
+      for (int j=0; j<4; j++)
+        v.position[j] = a.position[j] + (b.position[j] - a.position[j]) * t;
+
+      for (size_t j=0; j<SOFTWARE_MAX_VARYINGS; j++)
+        v.varyings[j] = a.varyings[j] + (b.varyings[j] - a.varyings[j]) * t;
+
+      output[output_count++] = &v;
+    }
+  }
+
+  return output_count;
+}
+
+/// Triangle setup; returns false if triangle is culled
+bool setup_triangle(const DrawContext& context, const ShadedVertex* const* vertices, SetupTriangle& triangle)
+{
+  const GLint* viewport = context.viewport;
+  const SoftwareDriver& driver = *context.driver;
+
+  for (int i=0; i<3; i++)
+  {
+    const float* position = vertices[i]->position;
+    float w = std::max(position[3], SOFTWARE_NEAR_CLIP_EPSILON), inv_w = 1.0f / w;
+
+    triangle.x[i] = (position[0] * inv_w * 0.5f + 0.5f) * context.window_viewport[2] + context.window_viewport[0];
+    triangle.y[i] = (position[1] * inv_w * 0.5f + 0.5f) * context.window_viewport[3] + context.window_viewport[1];
+    triangle.z[i] = position[2] * inv_w * 0.5f + 0.5f;
+    triangle.inv_w[i] = inv_w;
+    triangle.varyings[i] = vertices[i]->varyings;
+  }
+
+  float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+
+  if (area == 0.0f)
+    return false;
+
+  if (driver.cull_face)
+  {
+    bool is_front = area > 0.0f; //counter clockwise in window coordinates
+
+    if (driver.cull_mode == GL_FRONT_AND_BACK)                 return false;
+    if (driver.cull_mode == GL_BACK && !is_front)              return false;
+    if (driver.cull_mode == GL_FRONT && is_front)              return false;
+  }
+
+  if (area < 0.0f) //make winding consistent for edge functions
+  {
+    std::swap(triangle.x[1], triangle.x[2]);
+    std::swap(triangle.y[1], triangle.y[2]);
+    std::swap(triangle.z[1], triangle.z[2]);
+    std::swap(triangle.inv_w[1], triangle.inv_w[2]);
+    std::swap(triangle.varyings[1], triangle.varyings[2]);
+
+    area = -area;
+  }
+
+  triangle.inv_area = 1.0f / area;
+
+  float min_x = std::min(std::min(triangle.x[0], triangle.x[1]), triangle.x[2]);
+  float min_y = std::min(std::min(triangle.y[0], triangle.y[1]), triangle.y[2]);
+  float max_x = std::max(std::max(triangle.x[0], triangle.x[1]), triangle.x[2]);
+  float max_y = std::max(std::max(triangle.y[0], triangle.y[1]), triangle.y[2]);
+
+  triangle.min_x = std::max(int(std::floor(min_x)), viewport[0]);
+  triangle.min_y = std::max(int(std::floor(min_y)), viewport[1]);
+  triangle.max_x = std::min(int(std::ceil(max_x)), viewport[0] + viewport[2] - 1);
+  triangle.max_y = std::min(int(std::ceil(max_y)), viewport[1] + viewport[3] - 1);
+
+  return triangle.min_x <= triangle.max_x && triangle.min_y <= triangle.max_y;
+}
+
+/// Depth test
+inline bool depth_test(GLenum func, float value, float reference)
+{
+  switch (func)
+  {
+    case GL_NEVER:    return false;
+    case GL_LESS:     return value < reference;
+    case GL_EQUAL:    return value == reference;
+    case GL_LEQUAL:   return value <= reference;
+    case GL_GREATER:  return value > reference;
+    case GL_NOTEQUAL: return value != reference;
+    case GL_GEQUAL:   return value >= reference;
+    default:          return true;
+  }
+}
+
+/// Perspective correct interpolation weights for window point
+inline void get_weights(const SetupTriangle& triangle, float px, float py, float* weights, float* screen_weights)
+{
+  float e0 = (triangle.x[2] - triangle.x[1]) * (py - triangle.y[1]) - (triangle.y[2] - triangle.y[1]) * (px - triangle.x[1]);
+  float e1 = (triangle.x[0] - triangle.x[2]) * (py - triangle.y[2]) - (triangle.y[0] - triangle.y[2]) * (px - triangle.x[2]);
+  float e2 = (triangle.x[1] - triangle.x[0]) * (py - triangle.y[0]) - (triangle.y[1] - triangle.y[0]) * (px - triangle.x[0]);
+
+  screen_weights[0] = e0 * triangle.inv_area;
+  screen_weights[1] = e1 * triangle.inv_area;
+  screen_weights[2] = e2 * triangle.inv_area;
+
+  float w0 = screen_weights[0] * triangle.inv_w[0], w1 = screen_weights[1] * triangle.inv_w[1], w2 = screen_weights[2] * triangle.inv_w[2];
+  float inv_sum = 1.0f / (w0 + w1 + w2);
+
+  weights[0] = w0 * inv_sum;
+  weights[1] = w1 * inv_sum;
+  weights[2] = w2 * inv_sum;
+}
+
+inline void interpolate(const SetupTriangle& triangle, const float* weights, size_t first, size_t count, float* out)
+{
+  for (size_t i=0; i<count; i++)
+    out[i] = triangle.varyings[0][first + i] * weights[0] + triangle.varyings[1][first + i] * weights[1] + triangle.varyings[2][first + i] * weights[2];
+}
+
+/// G-buffer fragment kernel (see phong_gbuffer.glsl)
+void shade_gbuffer_fragment(const DrawContext& context, const SetupTriangle& triangle, const float* weights, float px, float py, float outputs[4][4])
+{
+  float varyings[GBufferVarying_Num];
+
+  interpolate(triangle, weights, 0, GBufferVarying_Num, varyings);
+
+    //derivatives of eye direction & texture coordinates (GPU computes them on 2x2 pixel quads)
+
+  float weights_dx[3], weights_dy[3], screen_weights[3];
+
+  get_weights(triangle, px + 1.0f, py, weights_dx, screen_weights);
+  get_weights(triangle, px, py + 1.0f, weights_dy, screen_weights);
+
+  float eye[3], eye_dx[3], eye_dy[3], uv_dx[2], uv_dy[2];
+
+  memcpy(eye, varyings + GBufferVarying_EyeDirection, sizeof(eye));
+  interpolate(triangle, weights_dx, GBufferVarying_EyeDirection, 3, eye_dx);
+  interpolate(triangle, weights_dy, GBufferVarying_EyeDirection, 3, eye_dy);
+  interpolate(triangle, weights_dx, GBufferVarying_TexCoord, 2, uv_dx);
+  interpolate(triangle, weights_dy, GBufferVarying_TexCoord, 2, uv_dy);
+
+  normalize3(eye);
+  normalize3(eye_dx);
+  normalize3(eye_dy);
+
+  const float* uv = varyings + GBufferVarying_TexCoord;
+  float dp1[3], dp2[3], duv1[2], duv2[2];
+
+  for (int i=0; i<3; i++)
+  {
+    dp1[i] = eye_dx[i] - eye[i];
+    dp2[i] = eye_dy[i] - eye[i];
+  }
+
+  for (int i=0; i<2; i++)
+  {
+    duv1[i] = uv_dx[i] - uv[i];
+    duv2[i] = uv_dy[i] - uv[i];
+  }
+
+    //cotangent frame
+
+  float n[3] = {varyings[GBufferVarying_Normal], varyings[GBufferVarying_Normal + 1], varyings[GBufferVarying_Normal + 2]};
+
+  normalize3(n);
+
+  float dp2perp[3], dp1perp[3], t[3], b[3];
+
+  cross3(dp2, n, dp2perp);
+  cross3(n, dp1, dp1perp);
+
+  for (int i=0; i<3; i++)
+  {
+    t[i] = dp2perp[i] * duv1[0] + dp1perp[i] * duv2[0];
+    b[i] = dp2perp[i] * duv1[1] + dp1perp[i] * duv2[1];
+  }
+
+  float max_length_square = std::max(dot3(t, t), dot3(b, b));
+  float invmax = max_length_square > 0.0f ? 1.0f / std::sqrt(max_length_square) : 0.0f;
+
+    //normal mapping
+
+  const SoftwareTexture* diffuse_texture = context.textures[0];
+  const SoftwareTexture* normal_texture = context.textures[1];
+  const SoftwareTexture* specular_texture = context.textures[2];
+
+  float mapped_normal[4], diffuse[4], specular[4];
+
+  sample(normal_texture, uv[0], uv[1], compute_lod(normal_texture, duv1, duv2), mapped_normal);
+  sample(diffuse_texture, uv[0], uv[1], compute_lod(diffuse_texture, duv1, duv2), diffuse);
+  sample(specular_texture, uv[0], uv[1], compute_lod(specular_texture, duv1, duv2), specular);
+
+  float m[3] = {mapped_normal[0] * 2.0f - 1.0f, mapped_normal[1] * 2.0f - 1.0f, mapped_normal[2] * 2.0f - 1.0f};
+
+    //two-channel normal maps (BC5) have no Z, see phong_gbuffer.glsl
+
+  if (m[2] <= -1.0f)
+    m[2] = std::sqrt(std::max(1.0f - m[0] * m[0] - m[1] * m[1], 0.0f));
+
+  float normal[3];
+
+  for (int i=0; i<3; i++)
+    normal[i] = t[i] * invmax * m[0] + b[i] * invmax * m[1] + n[i] * m[2];
+
+  normalize3(normal);
+
+    //outputs
+
+  const float* color = varyings + GBufferVarying_Color;
+  float shininess = context.program->get(context.program->find_uniform("shininess"))[0];
+
+  memcpy(outputs[0], varyings + GBufferVarying_Position, sizeof(float) * 3);
+  outputs[0][3] = 1.0f;
+
+  memcpy(outputs[1], normal, sizeof(float) * 3);
+  outputs[1][3] = 1.0f;
+
+  for (int i=0; i<4; i++)
+    outputs[2][i] = diffuse[i] * color[i];
+
+  for (int i=0; i<3; i++)
+    outputs[3][i] = specular[i] * color[i];
+
+  outputs[3][3] = shininess / SHININESS_NORMALIZER;
+}
+
+/// Rasterize triangles inside of a tile; returns number of samples which passed depth test
+size_t rasterize_tile(const DrawContext& context, int tile_x0, int tile_y0, int tile_x1, int tile_y1)
+{
+  const SoftwareDriver& driver = *context.driver;
+  Surface* depth_target = context.depth_target;
+  bool use_depth_test = driver.depth_test && depth_target;
+  bool use_depth_write = use_depth_test && driver.depth_write;
+  bool is_gbuffer = context.program->kernel == Kernel_GBuffer;
+  size_t samples_passed = 0;
+
+  for (const SetupTriangle& triangle : context.triangles)
+  {
+    int min_x = std::max(triangle.min_x, tile_x0), max_x = std::min(triangle.max_x, tile_x1 - 1);
+    int min_y = std::max(triangle.min_y, tile_y0), max_y = std::min(triangle.max_y, tile_y1 - 1);
+
+    if (min_x > max_x || min_y > max_y)
+      continue;
+
+    for (int y=min_y; y<=max_y; y++)
+    {
+      float py = y + 0.5f;
+
+      for (int x=min_x; x<=max_x; x++)
+      {
+        float px = x + 0.5f;
+        float weights[3], screen_weights[3];
+
+        get_weights(triangle, px, py, weights, screen_weights);
+
+        if (screen_weights[0] < 0.0f || screen_weights[1] < 0.0f || screen_weights[2] < 0.0f)
+          continue;
+
+        float z = screen_weights[0] * triangle.z[0] + screen_weights[1] * triangle.z[1] + screen_weights[2] * triangle.z[2];
+
+        if (use_depth_test)
+        {
+          float* depth = depth_target->pixel(x, y);
+
+          if (!depth_test(driver.depth_func, z, depth[0]))
+            continue;
+
+          if (use_depth_write)
+            depth[0] = z;
+        }
+
+        samples_passed++;
+
+        if (!is_gbuffer)
+          continue;
+
+        float outputs[4][4];
+
+        shade_gbuffer_fragment(context, triangle, weights, px, py, outputs);
+
+        for (int i=0; i<4; i++)
+          if (Surface* target = context.color_targets[i])
+            target->write(x, y, outputs[i]);
+      }
+    }
+  }
+
+  return samples_passed;
+}
+
+/// Run work over viewport tiles in parallel
+void for_each_tile(SoftwareDriver& driver, const GLint* viewport, const std::function<void (int, int, int, int)>& fn)
+{
+  int tiles_x = (viewport[2] + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+  int tiles_y = (viewport[3] + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+
+  driver.pool.parallel_for(size_t(tiles_x) * tiles_y, [&](size_t index)
+  {
+    int x0 = viewport[0] + int(index % tiles_x) * SOFTWARE_TILE_SIZE;
+    int y0 = viewport[1] + int(index / tiles_x) * SOFTWARE_TILE_SIZE;
+    int x1 = std::min(x0 + SOFTWARE_TILE_SIZE, viewport[0] + viewport[2]);
+    int y1 = std::min(y0 + SOFTWARE_TILE_SIZE, viewport[1] + viewport[3]);
+
+    fn(x0, y0, x1, y1);
+  });
+}
+
+///
+/// Deferred lighting kernel (see lighting.glsl); pixels of a tile row are processed in SoA layout
+///
+
+struct LightingRow
+{
+  float px[SOFTWARE_TILE_SIZE], py[SOFTWARE_TILE_SIZE], pz[SOFTWARE_TILE_SIZE]; //positions
+  float nx[SOFTWARE_TILE_SIZE], ny[SOFTWARE_TILE_SIZE], nz[SOFTWARE_TILE_SIZE]; //normals
+  float ar[SOFTWARE_TILE_SIZE], ag[SOFTWARE_TILE_SIZE], ab[SOFTWARE_TILE_SIZE]; //albedo
+  float sr[SOFTWARE_TILE_SIZE], sg[SOFTWARE_TILE_SIZE], sb[SOFTWARE_TILE_SIZE], sw[SOFTWARE_TILE_SIZE]; //specular & shininess
+  float ex[SOFTWARE_TILE_SIZE], ey[SOFTWARE_TILE_SIZE], ez[SOFTWARE_TILE_SIZE]; //eye directions
+  float cr[SOFTWARE_TILE_SIZE], cg[SOFTWARE_TILE_SIZE], cb[SOFTWARE_TILE_SIZE]; //result color
+};
+
+/// Lighting uniforms resolved once per draw
+struct LightingUniforms
+{
+  const SoftwareTexture* textures[5]; //position, normal, albedo, specular, shadow
+  UniformInfo world_view_position;
+  UniformInfo shadow_map_pixel_size;
+  UniformInfo point_positions, point_colors, point_attenuations, point_ranges;
+  UniformInfo spot_positions, spot_directions, spot_colors, spot_attenuations, spot_ranges, spot_angles, spot_exponents, spot_shadow_matrices;
+  UniformInfo spot_shadow_rects, spot_shadow_layers;
+
+  LightingUniforms(SoftwareDriver& driver, const SoftwareProgram& program)
+  {
+    static const char* TEXTURE_NAMES [] = {"positionTexture", "normalTexture", "albedoTexture", "specularTexture", "shadowTexture"};
+
+    for (size_t i=0; i<5; i++)
+      textures[i] = driver.bound_texture(size_t(program.get(program.find_uniform(TEXTURE_NAMES[i]))[0]));
+
+    world_view_position = program.find_uniform("worldViewPosition");
+    shadow_map_pixel_size = program.find_uniform("shadowMapPixelSize");
+    point_positions = program.find_uniform("pointLightPositions");
+    point_colors = program.find_uniform("pointLightColors");
+    point_attenuations = program.find_uniform("pointLightAttenuations");
+    point_ranges = program.find_uniform("pointLightRanges");
+    spot_positions = program.find_uniform("spotLightPositions");
+    spot_directions = program.find_uniform("spotLightDirections");
+    spot_colors = program.find_uniform("spotLightColors");
+    spot_attenuations = program.find_uniform("spotLightAttenuations");
+    spot_ranges = program.find_uniform("spotLightRanges");
+    spot_angles = program.find_uniform("spotLightAngles");
+    spot_exponents = program.find_uniform("spotLightExponents");
+    spot_shadow_matrices = program.find_uniform("spotLightShadowMatrices");
+    spot_shadow_rects = program.find_uniform("spotLightShadowRects");
+    spot_shadow_layers = program.find_uniform("spotLightShadowLayers");
+  }
+};
+
+inline float compute_specular_factor(float rdote, float shininess)
+{
+  return std::pow(std::min(std::max(rdote, 0.00001f), 1.0f), shininess * SHININESS_NORMALIZER);
+}
+
+float shadow_pcf(const SoftwareTexture* shadow_texture, const float* pixel_size, const float* rect, GLint layer, const float* coord)
+{
+  float sum = 0.0f;
+  float min_u = rect[0] + pixel_size[0] * 0.5f, max_u = rect[0] + rect[2] - pixel_size[0] * 0.5f;
+  float min_v = rect[1] + pixel_size[1] * 0.5f, max_v = rect[1] + rect[3] - pixel_size[1] * 0.5f;
+
+  for (float y=-1.5f; y<=1.5f; y+=1.5f)
+    for (float x=-1.5f; x<=1.5f; x+=1.5f)
+    {
+      float depth[4];
+      float u = std::min(std::max(rect[0] + coord[0] * rect[2] + x * pixel_size[0] * coord[3], min_u), max_u);
+      float v = std::min(std::max(rect[1] + coord[1] * rect[3] + y * pixel_size[1] * coord[3], min_v), max_v);
+
+      sample(shadow_texture, u, v, 0.0f, depth, layer);
+
+      float shadow_depth = depth[0] + SHADOW_DEPTH_BIAS;
+
+      sum += shadow_depth < coord[2] ? coord[2] - shadow_depth : 1.0f;
+    }
+
+  return sum / 9.0f;
+}
+
+void shade_lighting_row(const SoftwareProgram& program, const LightingUniforms& uniforms, LightingRow& row, int count)
+{
+  const float* view_position = program.get(uniforms.world_view_position);
+
+  for (int k=0; k<count; k++)
+  {
+    float dx = view_position[0] - row.px[k], dy = view_position[1] - row.py[k], dz = view_position[2] - row.pz[k];
+    float inv_length = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz);
+
+    row.ex[k] = dx * inv_length;
+    row.ey[k] = dy * inv_length;
+    row.ez[k] = dz * inv_length;
+    row.cr[k] = row.cg[k] = row.cb[k] = 0.0f;
+  }
+
+    //point lights
+
+  for (GLint i=0; i<uniforms.point_positions.elements_count; i++)
+  {
+    const float* light_position = program.get(uniforms.point_positions, i);
+    const float* light_color = program.get(uniforms.point_colors, i);
+    const float* light_attenuation = program.get(uniforms.point_attenuations, i);
+    float light_range = program.get(uniforms.point_ranges, i)[0];
+
+    for (int k=0; k<count; k++)
+    {
+      float lx = light_position[0] - row.px[k], ly = light_position[1] - row.py[k], lz = light_position[2] - row.pz[k];
+      float distance_square = lx * lx + ly * ly + lz * lz;
+      float distance = std::sqrt(distance_square);
+      float attenuation = std::min(1.0f, light_range / (light_attenuation[0] + light_attenuation[1] * distance + light_attenuation[2] * distance_square));
+      float inv_distance = 1.0f / distance;
+
+      lx *= inv_distance;
+      ly *= inv_distance;
+      lz *= inv_distance;
+
+      float ndotl = row.nx[k] * lx + row.ny[k] * ly + row.nz[k] * lz;
+      float diffuse = std::max(ndotl, MIN_DIFFUSE_AMOUNT);
+      float rx = 2.0f * ndotl * row.nx[k] - lx, ry = 2.0f * ndotl * row.ny[k] - ly, rz = 2.0f * ndotl * row.nz[k] - lz; //reflect(-L, N)
+      float specular = compute_specular_factor(rx * row.ex[k] + ry * row.ey[k] + rz * row.ez[k], row.sw[k]);
+
+      row.cr[k] += light_color[0] * attenuation * (row.ar[k] * diffuse + row.sr[k] * specular);
+      row.cg[k] += light_color[1] * attenuation * (row.ag[k] * diffuse + row.sg[k] * specular);
+      row.cb[k] += light_color[2] * attenuation * (row.ab[k] * diffuse + row.sb[k] * specular);
+    }
+  }
+
+    //spot lights
+
+  const float* shadow_map_pixel_size = program.get(uniforms.shadow_map_pixel_size);
+
+  for (GLint i=0; i<uniforms.spot_positions.elements_count; i++)
+  {
+    const float* light_position = program.get(uniforms.spot_positions, i);
+    const float* light_color = program.get(uniforms.spot_colors, i);
+    const float* light_attenuation = program.get(uniforms.spot_attenuations, i);
+    const float* shadow_tm = program.get(uniforms.spot_shadow_matrices, i);
+    const float* shadow_rect = program.get(uniforms.spot_shadow_rects, i);
+    GLint shadow_layer = GLint(program.get(uniforms.spot_shadow_layers, i)[0]);
+    float light_range = program.get(uniforms.spot_ranges, i)[0];
+    float light_angle = program.get(uniforms.spot_angles, i)[0];
+    float light_exponent = program.get(uniforms.spot_exponents, i)[0];
+    float self_direction[3] = {program.get(uniforms.spot_directions, i)[0], program.get(uniforms.spot_directions, i)[1], program.get(uniforms.spot_directions, i)[2]};
+
+    normalize3(self_direction);
+
+    for (int k=0; k<count; k++)
+    {
+      float lx = light_position[0] - row.px[k], ly = light_position[1] - row.py[k], lz = light_position[2] - row.pz[k];
+      float distance_square = lx * lx + ly * ly + lz * lz;
+      float distance = std::sqrt(distance_square);
+      float inv_distance = 1.0f / distance;
+
+      lx *= inv_distance;
+      ly *= inv_distance;
+      lz *= inv_distance;
+
+      float theta = std::acos(std::min(std::max(-(self_direction[0] * lx + self_direction[1] * ly + self_direction[2] * lz), -1.0f), 1.0f));
+
+      if (!(theta < light_angle))
+        continue;
+
+      float attenuation = std::min(1.0f, light_range / (light_attenuation[0] + light_attenuation[1] * distance + light_attenuation[2] * distance_square));
+
+      attenuation *= std::pow(std::max(0.0f, 1.0f - theta / light_angle), light_exponent);
+
+        //shadow
+
+      float world_position[4] = {row.px[k], row.py[k], row.pz[k], 1.0f}, shadow_coord[4];
+      float shadow_attenuation = 1.0f;
+
+      transform(shadow_tm, world_position, shadow_coord);
+
+      if (shadow_coord[3] > 0.0f)
+      {
+        float inv_w = 1.0f / shadow_coord[3];
+
+        for (int j=0; j<4; j++)
+          shadow_coord[j] = shadow_coord[j] * inv_w * 0.5f + 0.5f;
+
+        if (shadow_coord[0] >= 0.0f && shadow_coord[0] <= 1.0f && shadow_coord[1] >= 0.0f && shadow_coord[1] <= 1.0f)
+          shadow_attenuation = shadow_pcf(uniforms.textures[4], shadow_map_pixel_size, shadow_rect, shadow_layer, shadow_coord);
+      }
+
+      float ndotl = row.nx[k] * lx + row.ny[k] * ly + row.nz[k] * lz;
+      float diffuse = std::max(ndotl, MIN_DIFFUSE_AMOUNT);
+      float rx = 2.0f * ndotl * row.nx[k] - lx, ry = 2.0f * ndotl * row.ny[k] - ly, rz = 2.0f * ndotl * row.nz[k] - lz;
+      float specular = compute_specular_factor(rx * row.ex[k] + ry * row.ey[k] + rz * row.ez[k], row.sw[k]);
+      float factor = attenuation * shadow_attenuation;
+
+      row.cr[k] += light_color[0] * factor * (row.ar[k] * diffuse + row.sr[k] * specular);
+      row.cg[k] += light_color[1] * factor * (row.ag[k] * diffuse + row.sg[k] * specular);
+      row.cb[k] += light_color[2] * factor * (row.ab[k] * diffuse + row.sb[k] * specular);
+    }
+  }
+}
+
+/// Lighting pass; lighting program is always drawn with a full screen plane so it's executed over the whole viewport
+void draw_lighting(SoftwareDriver& driver, SoftwareProgram& program, Surface* target, const GLint* viewport)
+{
+  if (!target)
+    return;
+
+  LightingUniforms uniforms(driver, program);
+
+  for_each_tile(driver, viewport, [&](int x0, int y0, int x1, int y1)
+  {
+    LightingRow row;
+    int count = x1 - x0;
+
+    for (int y=y0; y<y1; y++)
+    {
+        //fetch G-buffer
+
+      float v = (y - driver.viewport[1] + 0.5f) / driver.viewport[3];
+
+      for (int k=0; k<count; k++)
+      {
+        float u = (x0 + k - driver.viewport[0] + 0.5f) / driver.viewport[2];
+        float position[4], normal[4], albedo[4], specular[4];
+
+        sample(uniforms.textures[0], u, v, 0.0f, position);
+        sample(uniforms.textures[1], u, v, 0.0f, normal);
+        sample(uniforms.textures[2], u, v, 0.0f, albedo);
+        sample(uniforms.textures[3], u, v, 0.0f, specular);
+
+        row.px[k] = position[0]; row.py[k] = position[1]; row.pz[k] = position[2];
+        row.nx[k] = normal[0]; row.ny[k] = normal[1]; row.nz[k] = normal[2];
+        row.ar[k] = albedo[0]; row.ag[k] = albedo[1]; row.ab[k] = albedo[2];
+        row.sr[k] = specular[0]; row.sg[k] = specular[1]; row.sb[k] = specular[2]; row.sw[k] = specular[3];
+      }
+
+        //shade
+
+      shade_lighting_row(program, uniforms, row, count);
+
+        //write result
+
+      for (int k=0; k<count; k++)
+      {
+        float color[4] = {row.cr[k], row.cg[k], row.cb[k], 1.0f};
+
+        target->write(x0 + k, y, color);
+      }
+    }
+  });
+}
+
+/// Vertex stage, primitive assembly, clipping & setup of one instance
+void process_instance_triangles(
+  SoftwareDriver& driver,
+  DrawContext& context,
+  const char* const* attribute_data,
+  const VertexAttribute* const* attributes,
+  const std::vector<uint32_t>& indices,
+  uint32_t min_index,
+  std::vector<ShadedVertex>& vertices,
+  std::vector<ShadedVertex>* batch_clipped_vertices)
+{
+    //vertex stage
+
+  size_t vertices_count = vertices.size();
+
+  driver.pool.parallel_for((vertices_count + SOFTWARE_VERTICES_BATCH_SIZE - 1) / SOFTWARE_VERTICES_BATCH_SIZE, [&](size_t batch)
+  {
+    size_t first = batch * SOFTWARE_VERTICES_BATCH_SIZE, last = std::min(first + SOFTWARE_VERTICES_BATCH_SIZE, vertices_count);
+
+    for (size_t i=first; i<last; i++)
+      shade_vertex(context, attribute_data, attributes, min_index + i, vertices[i]);
+  });
+
+    //primitive assembly, clipping & setup (clipped vertices are stored per batch to keep triangles order)
+
+  size_t triangles_count = indices.size() / 3;
+  size_t batches_count = (triangles_count + SOFTWARE_VERTICES_BATCH_SIZE - 1) / SOFTWARE_VERTICES_BATCH_SIZE;
+  std::vector<std::vector<SetupTriangle>> batch_triangles(batches_count);
+
+  driver.pool.parallel_for(batches_count, [&](size_t batch)
+  {
+    size_t first = batch * SOFTWARE_VERTICES_BATCH_SIZE, last = std::min(first + SOFTWARE_VERTICES_BATCH_SIZE, triangles_count);
+    std::vector<SetupTriangle>& triangles = batch_triangles[batch];
+    std::vector<ShadedVertex>& clipped_vertices = batch_clipped_vertices[batch];
+
+    triangles.reserve(last - first);
+    clipped_vertices.reserve((last - first) * 2); //each clipped triangle produces up to 2 new vertices; no reallocation allowed
+
+    for (size_t i=first; i<last; i++)
+    {
+      const ShadedVertex* triangle_vertices [] = {&vertices[indices[i * 3] - min_index], &vertices[indices[i * 3 + 1] - min_index], &vertices[indices[i * 3 + 2] - min_index]};
+      const ShadedVertex* polygon[4];
+      size_t polygon_size = 3;
+
+      bool need_clip = false;
+
+      for (const ShadedVertex* vertex : triangle_vertices)
+        need_clip |= vertex->position[2] < -vertex->position[3];
+
+      if (need_clip)
+      {
+        ShadedVertex new_vertices[2];
+
+        polygon_size = clip_near(triangle_vertices, new_vertices, polygon);
+
+        for (size_t j=0; j<polygon_size; j++)
+        {
+          if (polygon[j] == &new_vertices[0] || polygon[j] == &new_vertices[1])
+          {
+            clipped_vertices.push_back(*polygon[j]);
+            polygon[j] = &clipped_vertices.back();
+          }
+        }
+      }
+      else
+      {
+        std::copy(triangle_vertices, triangle_vertices + 3, polygon);
+      }
+
+      for (size_t j=2; j<polygon_size; j++)
+      {
+        const ShadedVertex* fan [] = {polygon[0], polygon[j - 1], polygon[j]};
+        SetupTriangle triangle;
+
+        if (setup_triangle(context, fan, triangle))
+          triangles.push_back(triangle);
+      }
+    }
+  });
+
+  for (auto& triangles : batch_triangles)
+    context.triangles.insert(context.triangles.end(), triangles.begin(), triangles.end());
+}
+
+/// Geometry draw (view >= 0 selects the view of the layered depth kernel)
+void draw_triangles(SoftwareDriver& driver, SoftwareProgram& program, GLsizei count, GLenum type, size_t offset, GLsizei instances_count, GLint base_vertex, GLuint base_instance, const GLint* viewport, GLint view = -1)
+{
+  SoftwareVertexArray& vertex_array = driver.current_vertex_array();
+  auto index_buffer_it = driver.buffers.find(vertex_array.element_array_buffer);
+
+  if (index_buffer_it == driver.buffers.end())
+    return;
+
+  const std::vector<char>& index_buffer = index_buffer_it->second;
+  size_t index_size = type == GL_UNSIGNED_INT ? 4 : type == GL_UNSIGNED_SHORT ? 2 : 1;
+
+  if (offset + count * index_size > index_buffer.size())
+    throw Exception::format("Software driver: index buffer overflow");
+
+    //read indices
+
+  std::vector<uint32_t> indices(count);
+  const char* index_data = index_buffer.data() + offset;
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    switch (index_size)
+    {
+      case 4:  memcpy(&indices[i], index_data + i * 4, 4); break;
+      case 2:  { uint16_t index; memcpy(&index, index_data + i * 2, 2); indices[i] = index; break; }
+      default: indices[i] = uint8_t(index_data[i]); break;
+    }
+
+    indices[i] += base_vertex;
+  }
+
+  if (indices.empty())
+    return;
+
+  uint32_t min_index = *std::min_element(indices.begin(), indices.end());
+  uint32_t max_index = *std::max_element(indices.begin(), indices.end());
+
+    //setup vertex attributes
+
+  GLint locations [] = {program.position_attribute, program.normal_attribute, program.color_attribute, program.texcoord_attribute};
+  const VertexAttribute* attributes[4] = {};
+  const char* attribute_data[4] = {};
+
+  for (size_t i=0; i<4; i++)
+  {
+    if (locations[i] < 0 || size_t(locations[i]) >= SOFTWARE_MAX_VERTEX_ATTRIBUTES || !vertex_array.attributes[locations[i]].enabled)
+      continue;
+
+    const VertexAttribute& attribute = vertex_array.attributes[locations[i]];
+    auto buffer_it = driver.buffers.find(attribute.buffer);
+
+    if (buffer_it == driver.buffers.end())
+      continue;
+
+    attributes[i] = &attribute;
+    attribute_data[i] = buffer_it->second.data();
+  }
+
+  if (!attributes[0])
+    return;
+
+    //setup instance transform stream (mat4 columns)
+
+  const VertexAttribute* instance_columns[4] = {};
+  const char* instance_data[4] = {};
+
+  for (GLint i=0; i<4 && program.instance_transform_attribute >= 0; i++)
+  {
+    size_t location = size_t(program.instance_transform_attribute + i);
+
+    if (location >= SOFTWARE_MAX_VERTEX_ATTRIBUTES || !vertex_array.attributes[location].enabled)
+      break;
+
+    const VertexAttribute& attribute = vertex_array.attributes[location];
+    auto buffer_it = driver.buffers.find(attribute.buffer);
+
+    if (buffer_it == driver.buffers.end())
+      break;
+
+    instance_columns[i] = &attribute;
+    instance_data[i] = buffer_it->second.data();
+  }
+
+  bool is_instanced = instance_columns[3] != nullptr;
+
+  if (program.instance_transform_attribute >= 0 && !is_instanced)
+    return;
+
+  DrawContext context;
+
+  context.driver = &driver;
+  context.program = &program;
+  context.depth_target = driver.depth_target();
+
+  for (size_t i=0; i<4; i++)
+    context.color_targets[i] = program.outputs[i] >= 0 ? driver.color_target(program.outputs[i]) : nullptr;
+
+  memcpy(context.viewport, viewport, sizeof(context.viewport));
+  memcpy(context.window_viewport, view >= 0 ? driver.viewports[view] : driver.viewport, sizeof(context.window_viewport));
+
+  static const char* TEXTURE_NAMES [] = {"diffuseTexture", "normalTexture", "specularTexture"};
+
+  for (size_t i=0; i<3; i++)
+  {
+    UniformInfo sampler = program.find_uniform(TEXTURE_NAMES[i]);
+
+    context.textures[i] = sampler.location >= 0 ? driver.bound_texture(size_t(program.get(sampler)[0])) : nullptr;
+  }
+
+  size_t vertices_count = max_index - min_index + 1;
+  size_t triangles_count = indices.size() / 3;
+  size_t batches_count = (triangles_count + SOFTWARE_VERTICES_BATCH_SIZE - 1) / SOFTWARE_VERTICES_BATCH_SIZE;
+
+    //vertices of all instances are kept until rasterization (setup triangles refer to their varyings)
+
+  std::vector<std::vector<ShadedVertex>> instance_vertices(instances_count);
+  std::vector<std::vector<ShadedVertex>> batch_clipped_vertices(batches_count * instances_count);
+
+  for (GLsizei instance=0; instance<instances_count; instance++)
+  {
+      //instance transforms
+
+    if (is_instanced)
+    {
+      float columns[4][4];
+
+      for (size_t i=0; i<4; i++)
+      {
+        const VertexAttribute& attribute = *instance_columns[i];
+
+        fetch_attribute(attribute, instance_data[i], attribute.divisor ? base_instance + instance / attribute.divisor : 0, columns[i]);
+      }
+
+      for (size_t row=0; row<4; row++)
+        for (size_t column=0; column<4; column++)
+          context.model_tm[row * 4 + column] = columns[column][row];
+
+      if (view >= 0)
+      {
+          //mask of views is packed into the unused element of the model matrix (see shadow_layered.glsl)
+
+        GLuint views_mask = GLuint(context.model_tm[12]);
+
+        if (!(views_mask & (1u << view)))
+          continue;
+
+        context.model_tm[12] = 0.0f;
+
+        multiply(program.get(program.find_uniform("shadowViewProjectionMatrices"), size_t(view)), context.model_tm, context.mvp);
+      }
+      else
+      {
+        multiply(program.get(program.find_uniform("viewProjectionMatrix")), context.model_tm, context.mvp);
+      }
+    }
+    else
+    {
+      memcpy(context.mvp, program.get(program.find_uniform("MVP")), sizeof(context.mvp));
+      memcpy(context.model_tm, program.get(program.find_uniform("modelMatrix")), sizeof(context.model_tm));
+    }
+
+    std::vector<ShadedVertex>& vertices = instance_vertices[instance];
+
+    vertices.resize(vertices_count);
+
+    process_instance_triangles(driver, context, attribute_data, attributes, indices, min_index, vertices,
+      &batch_clipped_vertices[instance * batches_count]);
+  }
+
+    //rasterization
+
+  for_each_tile(driver, viewport, [&](int x0, int y0, int x1, int y1)
+  {
+    size_t samples_passed = rasterize_tile(context, x0, y0, x1, y1);
+
+    if (driver.samples_query)
+      driver.samples_passed += samples_passed;
+  });
+}
+
+/// Clip viewport by render targets; returns false if nothing may be drawn
+bool clip_viewport(SoftwareDriver& driver, const SoftwareProgram& program, const GLint* source_viewport, GLint* viewport)
+{
+  Surface* surfaces [] = {driver.color_target(program.outputs[0] >= 0 ? program.outputs[0] : 0), driver.depth_target()};
+
+  GLint max_x = source_viewport[0] + source_viewport[2], max_y = source_viewport[1] + source_viewport[3];
+  bool has_target = false;
+
+  for (Surface* surface : surfaces)
+  {
+    if (!surface || !surface->width)
+      continue;
+
+    max_x = std::min(max_x, surface->width);
+    max_y = std::min(max_y, surface->height);
+    has_target = true;
+  }
+
+  viewport[0] = std::max(source_viewport[0], 0);
+  viewport[1] = std::max(source_viewport[1], 0);
+  viewport[2] = max_x - viewport[0];
+  viewport[3] = max_y - viewport[1];
+
+  return has_target && viewport[2] > 0 && viewport[3] > 0;
+}
+
+/// Layered depth draw; geometry shader invocations are emulated by drawing each view to its layer and viewport
+void draw_layered_depth(SoftwareDriver& driver, SoftwareProgram& program, GLsizei count, GLenum type, size_t offset, GLsizei instances_count, GLint base_vertex, GLuint base_instance)
+{
+  UniformInfo layers = program.find_uniform("shadowViewLayers");
+  GLint views_count = std::min(GLint(program.get(program.find_uniform("shadowViewsCount"))[0]), std::min(layers.elements_count, GLint(SOFTWARE_MAX_VIEWPORTS)));
+
+  for (GLint view=0; view<views_count; view++)
+  {
+    driver.layer = GLint(program.get(layers, size_t(view))[0]);
+
+    GLint viewport[4];
+
+    if (clip_viewport(driver, program, driver.viewports[view], viewport))
+      draw_triangles(driver, program, count, type, offset, instances_count, base_vertex, base_instance, viewport, view);
+  }
+
+  driver.layer = 0;
+}
+
+///
+/// Driver entry points
+///
+
+void APIENTRY software_bind_buffer(GLenum target, GLuint buffer)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  switch (target)
+  {
+    case GL_ARRAY_BUFFER:         driver.array_buffer = buffer; break;
+    case GL_ELEMENT_ARRAY_BUFFER: driver.current_vertex_array().element_array_buffer = buffer; break;
+    case GL_DRAW_INDIRECT_BUFFER: driver.draw_indirect_buffer = buffer; break;
+    case GL_UNIFORM_BUFFER:       driver.uniform_buffer = buffer; break;
+    case GL_PIXEL_UNPACK_BUFFER:  driver.pixel_unpack_buffer = buffer; break;
+    default:                      break;
+  }
+}
+
+GLuint get_bound_buffer(GLenum target)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  switch (target)
+  {
+    case GL_ARRAY_BUFFER:         return driver.array_buffer;
+    case GL_ELEMENT_ARRAY_BUFFER: return driver.current_vertex_array().element_array_buffer;
+    case GL_DRAW_INDIRECT_BUFFER: return driver.draw_indirect_buffer;
+    case GL_UNIFORM_BUFFER:       return driver.uniform_buffer;
+    case GL_PIXEL_UNPACK_BUFFER:  return driver.pixel_unpack_buffer;
+    default:                      return 0;
+  }
+}
+
+void APIENTRY software_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (target != GL_UNIFORM_BUFFER || index >= SOFTWARE_MAX_UNIFORM_BUFFER_BINDINGS)
+    return;
+
+  UniformBufferBinding& binding = driver.uniform_buffers[index];
+
+  binding.buffer = buffer;
+  binding.offset = size_t(offset);
+  binding.size = size_t(size);
+
+  driver.uniform_buffer = buffer;
+}
+
+void APIENTRY software_buffer_data(GLenum target, GLsizeiptr size, const void* data, GLenum)
+{
+  std::vector<char>& buffer = SoftwareDriver::instance().buffers[get_bound_buffer(target)];
+
+  buffer.assign(size_t(size), 0);
+
+  if (data)
+    memcpy(buffer.data(), data, size_t(size));
+}
+
+void APIENTRY software_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+  std::vector<char>& buffer = SoftwareDriver::instance().buffers[get_bound_buffer(target)];
+
+  if (size_t(offset + size) > buffer.size() || !data)
+    return;
+
+  memcpy(buffer.data() + offset, data, size_t(size));
+}
+
+void* APIENTRY software_map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield)
+{
+    //buffers are read by draws synchronously, so the storage is mapped directly
+
+  std::vector<char>& buffer = SoftwareDriver::instance().buffers[get_bound_buffer(target)];
+
+  if (offset < 0 || size_t(offset + length) > buffer.size())
+    return nullptr;
+
+  return buffer.data() + offset;
+}
+
+GLboolean APIENTRY software_unmap_buffer(GLenum)
+{
+  return GL_TRUE;
+}
+
+void APIENTRY software_delete_buffers(GLsizei count, const GLuint* ids)
+{
+  for (GLsizei i=0; i<count; i++)
+    SoftwareDriver::instance().buffers.erase(ids[i]);
+}
+
+void APIENTRY software_active_texture(GLenum unit)
+{
+  SoftwareDriver::instance().active_texture = unit - GL_TEXTURE0;
+}
+
+void APIENTRY software_bind_texture(GLenum, GLuint texture)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (driver.active_texture < SOFTWARE_MAX_TEXTURE_UNITS)
+    driver.texture_units[driver.active_texture] = texture;
+}
+
+void APIENTRY software_delete_textures(GLsizei count, const GLuint* ids)
+{
+  for (GLsizei i=0; i<count; i++)
+    SoftwareDriver::instance().textures.erase(ids[i]);
+}
+
+const void* resolve_unpack_pixels(const void* pixels, size_t size)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+    //pixels are sourced from the bound unpack buffer at the offset
+
+  if (!driver.pixel_unpack_buffer)
+    return pixels;
+
+  std::vector<char>& buffer = driver.buffers[driver.pixel_unpack_buffer];
+  size_t offset = reinterpret_cast<size_t>(pixels);
+
+  if (offset + size > buffer.size())
+    return nullptr;
+
+  return buffer.data() + offset;
+}
+
+void upload_pixels(Surface& surface, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+  pixels = resolve_unpack_pixels(pixels, get_row_size(format, type, width) * height);
+
+  if (!pixels)
+    return;
+
+  size_t components_count = get_components_count(format), component_size = get_component_size(type);
+  size_t row_size = get_row_size(format, type, width);
+
+  for (GLsizei row=0; row<height; row++)
+  {
+    const char* src = static_cast<const char*>(pixels) + row * row_size;
+
+    for (GLsizei column=0; column<width; column++)
+    {
+      if (x + column >= surface.width || y + row >= surface.height)
+        continue;
+
+      float* dst = surface.pixel(x + column, y + row);
+
+      for (size_t i=0; i<components_count; i++, src += component_size)
+        dst[i] = read_component(src, type);
+    }
+  }
+}
+
+void APIENTRY software_tex_image_2d(GLenum, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint, GLenum format, GLenum type, const void* pixels)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture)
+  {
+    if (driver.active_texture >= SOFTWARE_MAX_TEXTURE_UNITS || !driver.texture_units[driver.active_texture])
+      return;
+
+    texture = &driver.textures[driver.texture_units[driver.active_texture]];
+  }
+
+  if (size_t(level) >= texture->levels.size())
+    texture->levels.resize(level + 1);
+
+  Surface& surface = texture->levels[level];
+
+  surface.resize(internal_format, width, height);
+
+  if (format != GL_DEPTH_COMPONENT)
+    for (size_t i=3, count=surface.pixels.size(); i<count; i+=4)
+      surface.pixels[i] = 1.0f;
+
+  upload_pixels(surface, 0, 0, width, height, format, type, pixels);
+}
+
+void APIENTRY software_tex_sub_image_2d(GLenum, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture || size_t(level) >= texture->levels.size())
+    return;
+
+  upload_pixels(texture->levels[level], x, y, width, height, format, type, pixels);
+}
+
+void APIENTRY software_tex_image_3d(GLenum, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLsizei depth, GLint, GLenum format, GLenum type, const void* pixels)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture)
+  {
+    if (driver.active_texture >= SOFTWARE_MAX_TEXTURE_UNITS || !driver.texture_units[driver.active_texture])
+      return;
+
+    texture = &driver.textures[driver.texture_units[driver.active_texture]];
+  }
+
+    //layers count is defined by the first level; levels are stored level-major
+
+  if (texture->layers != depth)
+  {
+    texture->layers = std::max(depth, 1);
+    texture->levels.clear();
+  }
+
+  if (level >= texture->levels_count())
+    texture->levels.resize(size_t(level + 1) * texture->layers);
+
+  bool has_pixels = pixels || driver.pixel_unpack_buffer;
+  size_t layer_size = get_row_size(format, type, width) * height;
+
+  for (GLint layer=0; layer<texture->layers; layer++)
+  {
+    Surface& surface = texture->surface(level, layer);
+
+    surface.resize(internal_format, width, height);
+
+    if (format != GL_DEPTH_COMPONENT)
+      for (size_t i=3, count=surface.pixels.size(); i<count; i+=4)
+        surface.pixels[i] = 1.0f;
+
+    if (has_pixels)
+      upload_pixels(surface, 0, 0, width, height, format, type, static_cast<const char*>(pixels) + layer * layer_size);
+  }
+}
+
+bool get_block_compression_format(GLenum internal_format, engine::media::image::CompressionFormat& format)
+{
+  switch (internal_format)
+  {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:  format = engine::media::image::CompressionFormat_BC1; return true;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: format = engine::media::image::CompressionFormat_BC3; return true;
+    case GL_COMPRESSED_RED_RGTC1:          format = engine::media::image::CompressionFormat_BC4; return true;
+    case GL_COMPRESSED_RG_RGTC2:           format = engine::media::image::CompressionFormat_BC5; return true;
+    default:                               return false;
+  }
+}
+
+void upload_compressed_pixels(Surface& surface, GLint x, GLint y, GLsizei width, GLsizei height, GLenum internal_format, GLsizei image_size, const void* data)
+{
+  engine::media::image::CompressionFormat format;
+
+  if (!get_block_compression_format(internal_format, format))
+    return;
+
+  if (size_t(image_size) < engine::media::image::CompressedImage::level_bytes(format, width, height))
+    return;
+
+  data = resolve_unpack_pixels(data, size_t(image_size));
+
+  if (!data)
+    return;
+
+    //blocks are decoded to RGBA8 and stored as normalized floats
+
+  std::vector<engine::media::image::Color> pixels(size_t(width) * height);
+
+  engine::media::image::decompress(format, width, height, data, pixels.data());
+
+  const engine::media::image::Color* src = pixels.data();
+
+  for (GLsizei row=0; row<height; row++)
+  {
+    for (GLsizei column=0; column<width; column++, src++)
+    {
+      if (x + column >= surface.width || y + row >= surface.height)
+        continue;
+
+      float* dst = surface.pixel(x + column, y + row);
+
+      dst[0] = src->r / 255.0f;
+      dst[1] = src->g / 255.0f;
+      dst[2] = src->b / 255.0f;
+      dst[3] = src->a / 255.0f;
+    }
+  }
+}
+
+void APIENTRY software_compressed_tex_image_2d(GLenum, GLint level, GLenum internal_format, GLsizei width, GLsizei height, GLint, GLsizei image_size, const void* data)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture)
+  {
+    if (driver.active_texture >= SOFTWARE_MAX_TEXTURE_UNITS || !driver.texture_units[driver.active_texture])
+      return;
+
+    texture = &driver.textures[driver.texture_units[driver.active_texture]];
+  }
+
+  if (size_t(level) >= texture->levels.size())
+    texture->levels.resize(level + 1);
+
+  Surface& surface = texture->levels[level];
+
+  surface.resize(GL_RGBA8, width, height);
+
+  for (size_t i=3, count=surface.pixels.size(); i<count; i+=4)
+    surface.pixels[i] = 1.0f;
+
+  if (data || driver.pixel_unpack_buffer)
+    upload_compressed_pixels(surface, 0, 0, width, height, internal_format, image_size, data);
+}
+
+void APIENTRY software_compressed_tex_sub_image_2d(GLenum, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum internal_format, GLsizei image_size, const void* data)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture || size_t(level) >= texture->levels.size())
+    return;
+
+  upload_compressed_pixels(texture->levels[level], x, y, width, height, internal_format, image_size, data);
+}
+
+void APIENTRY software_get_tex_image(GLenum, GLint level, GLenum format, GLenum type, void* pixels)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture || size_t(level) >= texture->levels.size() || !pixels)
+    return;
+
+  const Surface& surface = texture->levels[level];
+  size_t components_count = get_components_count(format), component_size = get_component_size(type);
+  size_t row_size = get_row_size(format, type, surface.width);
+
+  for (GLint row=0; row<surface.height; row++)
+  {
+    char* dst = static_cast<char*>(pixels) + row * row_size;
+
+    for (GLint column=0; column<surface.width; column++)
+    {
+      const float* src = surface.pixel(column, row);
+
+      for (size_t i=0; i<components_count; i++, dst += component_size)
+        write_component(dst, type, src[i]);
+    }
+  }
+}
+
+void APIENTRY software_tex_parameter(GLenum, GLenum name, GLint value)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture)
+    return;
+
+  switch (name)
+  {
+    case GL_TEXTURE_MIN_FILTER: texture->min_filter = value; break;
+    case GL_TEXTURE_MAG_FILTER: texture->mag_filter = value; break;
+    case GL_TEXTURE_MAX_LEVEL:  texture->max_level = value; break;
+    default:                    break;
+  }
+}
+
+void APIENTRY software_generate_mipmap(GLenum)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareTexture* texture = driver.bound_texture(driver.active_texture);
+
+  if (!texture)
+    return;
+
+  for (GLint level=1; level<texture->levels_count(); level++)
+    for (GLint layer=0; layer<texture->layers; layer++)
+    {
+      const Surface& source = texture->surface(level - 1, layer);
+      Surface& target = texture->surface(level, layer);
+
+      if (!target.width || !target.height || !source.width || !source.height)
+        continue;
+
+      for (GLint y=0; y<target.height; y++)
+        for (GLint x=0; x<target.width; x++)
+        {
+          GLint sx0 = std::min(x * 2, source.width - 1), sx1 = std::min(x * 2 + 1, source.width - 1);
+          GLint sy0 = std::min(y * 2, source.height - 1), sy1 = std::min(y * 2 + 1, source.height - 1);
+          float* dst = target.pixel(x, y);
+
+          for (int i=0; i<4; i++)
+            dst[i] = (source.pixel(sx0, sy0)[i] + source.pixel(sx1, sy0)[i] + source.pixel(sx0, sy1)[i] + source.pixel(sx1, sy1)[i]) * 0.25f;
+        }
+    }
+}
+
+void APIENTRY software_bind_renderbuffer(GLenum, GLuint render_buffer)
+{
+  SoftwareDriver::instance().render_buffer = render_buffer;
+}
+
+void APIENTRY software_renderbuffer_storage(GLenum, GLenum internal_format, GLsizei width, GLsizei height)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (!driver.render_buffer)
+    return;
+
+  driver.render_buffers[driver.render_buffer].resize(internal_format, width, height);
+}
+
+void APIENTRY software_delete_renderbuffers(GLsizei count, const GLuint* ids)
+{
+  for (GLsizei i=0; i<count; i++)
+    SoftwareDriver::instance().render_buffers.erase(ids[i]);
+}
+
+void APIENTRY software_bind_framebuffer(GLenum target, GLuint frame_buffer)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (target != GL_READ_FRAMEBUFFER)
+    driver.frame_buffer = frame_buffer;
+
+  if (target != GL_DRAW_FRAMEBUFFER)
+    driver.read_frame_buffer = frame_buffer;
+}
+
+void APIENTRY software_delete_framebuffers(GLsizei count, const GLuint* ids)
+{
+  for (GLsizei i=0; i<count; i++)
+    SoftwareDriver::instance().frame_buffers.erase(ids[i]);
+}
+
+Attachment* find_attachment(GLenum attachment)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (!driver.frame_buffer)
+    return nullptr;
+
+  SoftwareFrameBuffer& frame_buffer = driver.frame_buffers[driver.frame_buffer];
+
+  if (attachment == GL_DEPTH_ATTACHMENT || attachment == GL_DEPTH_STENCIL_ATTACHMENT)
+    return &frame_buffer.depth;
+
+  if (attachment >= GL_COLOR_ATTACHMENT0 && attachment < GL_COLOR_ATTACHMENT0 + SOFTWARE_MAX_DRAW_BUFFERS)
+    return &frame_buffer.colors[attachment - GL_COLOR_ATTACHMENT0];
+
+  return nullptr;
+}
+
+void APIENTRY software_framebuffer_texture(GLenum, GLenum attachment, GLuint texture, GLint level)
+{
+  if (Attachment* target = find_attachment(attachment))
+  {
+    target->texture = texture;
+    target->level = level;
+    target->layer = -1;
+    target->render_buffer = 0;
+  }
+}
+
+void APIENTRY software_framebuffer_texture_2d(GLenum, GLenum attachment, GLenum, GLuint texture, GLint level)
+{
+  if (Attachment* target = find_attachment(attachment))
+  {
+    target->texture = texture;
+    target->level = level;
+    target->layer = 0;
+    target->render_buffer = 0;
+  }
+}
+
+void APIENTRY software_framebuffer_texture_layer(GLenum, GLenum attachment, GLuint texture, GLint level, GLint layer)
+{
+  if (Attachment* target = find_attachment(attachment))
+  {
+    target->texture = texture;
+    target->level = level;
+    target->layer = layer;
+    target->render_buffer = 0;
+  }
+}
+
+void APIENTRY software_framebuffer_renderbuffer(GLenum, GLenum attachment, GLenum, GLuint render_buffer)
+{
+  if (Attachment* target = find_attachment(attachment))
+  {
+    target->texture = 0;
+    target->level = 0;
+    target->render_buffer = render_buffer;
+  }
+}
+
+void APIENTRY software_draw_buffers(GLsizei count, const GLenum* buffers)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  for (size_t i=0; i<SOFTWARE_MAX_DRAW_BUFFERS; i++)
+    driver.draw_buffers[i] = i < size_t(count) ? buffers[i] : GL_NONE;
+}
+
+void APIENTRY software_draw_buffer(GLenum buffer)
+{
+  software_draw_buffers(1, &buffer);
+}
+
+void APIENTRY software_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  driver.viewport[0] = x;
+  driver.viewport[1] = y;
+  driver.viewport[2] = width;
+  driver.viewport[3] = height;
+
+  for (GLint* indexed_viewport : driver.viewports)
+    std::copy(driver.viewport, driver.viewport + 4, indexed_viewport);
+
+  if (!driver.frame_buffer)
+    driver.update_window_surfaces();
+}
+
+void APIENTRY software_viewport_indexed(GLuint index, GLfloat x, GLfloat y, GLfloat width, GLfloat height)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (index >= SOFTWARE_MAX_VIEWPORTS)
+    return;
+
+  GLint* indexed_viewport = driver.viewports[index];
+
+  indexed_viewport[0] = GLint(x);
+  indexed_viewport[1] = GLint(y);
+  indexed_viewport[2] = GLint(width);
+  indexed_viewport[3] = GLint(height);
+
+  if (index)
+    return;
+
+  std::copy(indexed_viewport, indexed_viewport + 4, driver.viewport);
+
+  if (!driver.frame_buffer)
+    driver.update_window_surfaces();
+}
+
+void APIENTRY software_scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  driver.scissor[0] = x;
+  driver.scissor[1] = y;
+  driver.scissor[2] = width;
+  driver.scissor[3] = height;
+}
+
+void set_capability(GLenum capability, bool state)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  switch (capability)
+  {
+    case GL_DEPTH_TEST:   driver.depth_test = state; break;
+    case GL_CULL_FACE:    driver.cull_face = state; break;
+    case GL_BLEND:        driver.blend = state; break;
+    case GL_SCISSOR_TEST: driver.scissor_test = state; break;
+    default:              break;
+  }
+}
+
+void APIENTRY software_enable(GLenum capability)
+{
+  set_capability(capability, true);
+}
+
+void APIENTRY software_disable(GLenum capability)
+{
+  set_capability(capability, false);
+}
+
+void APIENTRY software_cull_face(GLenum mode)
+{
+  SoftwareDriver::instance().cull_mode = mode;
+}
+
+void APIENTRY software_begin_query(GLenum target, GLuint id)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (target != GL_SAMPLES_PASSED)
+    return;
+
+  driver.samples_query = id;
+  driver.samples_passed = 0;
+}
+
+void APIENTRY software_end_query(GLenum target)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (target != GL_SAMPLES_PASSED || !driver.samples_query)
+    return;
+
+  driver.query_results[driver.samples_query] = static_cast<GLuint>(driver.samples_passed);
+  driver.samples_query = 0;
+}
+
+void APIENTRY software_get_query_object_uiv(GLuint id, GLenum name, GLuint* value)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+    //draws are executed synchronously, so results are always available
+
+  switch (name)
+  {
+    case GL_QUERY_RESULT_AVAILABLE:
+      *value = GL_TRUE;
+      break;
+    case GL_QUERY_RESULT:
+    {
+      auto it = driver.query_results.find(id);
+
+      *value = it != driver.query_results.end() ? it->second : 0;
+
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void APIENTRY software_delete_queries(GLsizei count, const GLuint* ids)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  for (GLsizei i=0; i<count; i++)
+    driver.query_results.erase(ids[i]);
+}
+
+void APIENTRY software_depth_func(GLenum func)
+{
+  SoftwareDriver::instance().depth_func = func;
+}
+
+void APIENTRY software_depth_mask(GLboolean flag)
+{
+  SoftwareDriver::instance().depth_write = flag != GL_FALSE;
+}
+
+void APIENTRY software_clear_color(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+  float* color = SoftwareDriver::instance().clear_color;
+
+  color[0] = red;
+  color[1] = green;
+  color[2] = blue;
+  color[3] = alpha;
+}
+
+/// Clear rectangle of the surface (whole surface or scissor box)
+void get_clear_rect(const SoftwareDriver& driver, const Surface& target, GLint* rect)
+{
+  rect[0] = rect[1] = 0;
+  rect[2] = target.width;
+  rect[3] = target.height;
+
+  if (!driver.scissor_test)
+    return;
+
+  rect[0] = std::min(std::max(driver.scissor[0], 0), target.width);
+  rect[1] = std::min(std::max(driver.scissor[1], 0), target.height);
+  rect[2] = std::min(std::max(driver.scissor[0] + driver.scissor[2], 0), target.width);
+  rect[3] = std::min(std::max(driver.scissor[1] + driver.scissor[3], 0), target.height);
+}
+
+void APIENTRY software_clear(GLbitfield mask)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  GLint rect[4];
+
+  if (mask & GL_COLOR_BUFFER_BIT)
+  {
+    for (size_t i=0; i<SOFTWARE_MAX_DRAW_BUFFERS; i++)
+    {
+      Surface* target = driver.color_target(i);
+
+      if (!target)
+        continue;
+
+      get_clear_rect(driver, *target, rect);
+
+      for (GLint y=rect[1]; y<rect[3]; y++)
+        for (GLint x=rect[0]; x<rect[2]; x++)
+          target->write(x, y, driver.clear_color);
+    }
+  }
+
+  if (mask & GL_DEPTH_BUFFER_BIT)
+  {
+    Surface* target = driver.depth_target();
+
+    if (target && driver.depth_write)
+    {
+      get_clear_rect(driver, *target, rect);
+
+      for (GLint y=rect[1]; y<rect[3]; y++)
+        std::fill(target->pixel(rect[0], y), target->pixel(rect[0], y) + (rect[2] - rect[0]) * 4, 1.0f);
+    }
+  }
+}
+
+void APIENTRY software_blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  GLbitfield buffers [] = {GL_COLOR_BUFFER_BIT, GL_DEPTH_BUFFER_BIT};
+
+  for (GLbitfield buffer : buffers)
+  {
+    if (!(mask & buffer))
+      continue;
+
+    Surface* source = driver.read_target(buffer);
+    Surface* target = buffer == GL_DEPTH_BUFFER_BIT ? driver.depth_target() : driver.color_target(0);
+
+    if (!source || !target || dst_x1 == dst_x0 || dst_y1 == dst_y0)
+      continue;
+
+      //nearest filtering; scissor test is applied like for clears
+
+    GLint rect[4];
+
+    get_clear_rect(driver, *target, rect);
+
+    rect[0] = std::max(rect[0], std::min(dst_x0, dst_x1));
+    rect[1] = std::max(rect[1], std::min(dst_y0, dst_y1));
+    rect[2] = std::min(rect[2], std::max(dst_x0, dst_x1));
+    rect[3] = std::min(rect[3], std::max(dst_y0, dst_y1));
+
+    for (GLint y=rect[1]; y<rect[3]; y++)
+    {
+      GLint source_y = src_y0 + GLint((y - dst_y0 + 0.5f) * (src_y1 - src_y0) / (dst_y1 - dst_y0));
+
+      if (source_y < 0 || source_y >= source->height)
+        continue;
+
+      for (GLint x=rect[0]; x<rect[2]; x++)
+      {
+        GLint source_x = src_x0 + GLint((x - dst_x0 + 0.5f) * (src_x1 - src_x0) / (dst_x1 - dst_x0));
+
+        if (source_x < 0 || source_x >= source->width)
+          continue;
+
+        std::copy(source->pixel(source_x, source_y), source->pixel(source_x, source_y) + 4, target->pixel(x, y));
+      }
+    }
+  }
+}
+
+void APIENTRY software_use_program(GLuint program)
+{
+  SoftwareDriver::instance().current_program = program;
+}
+
+void APIENTRY software_link_program(GLuint program_id)
+{
+  static PFNGLLINKPROGRAMPROC null_link_program = get_null_function<PFNGLLINKPROGRAMPROC>("glLinkProgram");
+  static PFNGLGETPROGRAMIVPROC null_get_program = get_null_function<PFNGLGETPROGRAMIVPROC>("glGetProgramiv");
+  static PFNGLGETACTIVEUNIFORMPROC null_get_active_uniform = get_null_function<PFNGLGETACTIVEUNIFORMPROC>("glGetActiveUniform");
+  static PFNGLGETUNIFORMLOCATIONPROC null_get_uniform_location = get_null_function<PFNGLGETUNIFORMLOCATIONPROC>("glGetUniformLocation");
+  static PFNGLGETATTRIBLOCATIONPROC null_get_attrib_location = get_null_function<PFNGLGETATTRIBLOCATIONPROC>("glGetAttribLocation");
+  static PFNGLGETFRAGDATALOCATIONPROC null_get_frag_data_location = get_null_function<PFNGLGETFRAGDATALOCATIONPROC>("glGetFragDataLocation");
+  static PFNGLGETACTIVEUNIFORMSIVPROC null_get_active_uniforms = get_null_function<PFNGLGETACTIVEUNIFORMSIVPROC>("glGetActiveUniformsiv");
+
+  null_link_program(program_id);
+
+  SoftwareProgram& program = SoftwareDriver::instance().programs[program_id];
+
+  program = SoftwareProgram();
+
+    //reflect uniforms
+
+  GLint uniforms_count = 0, max_name_length = 0;
+
+  null_get_program(program_id, GL_ACTIVE_UNIFORMS, &uniforms_count);
+  null_get_program(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+  std::string name(size_t(max_name_length) + 1, '\0');
+  GLint slots_count = 0;
+
+  for (GLint i=0; i<uniforms_count; i++)
+  {
+    GLsizei name_length = 0;
+    GLint elements_count = 0;
+    GLenum type = GL_NONE;
+
+    null_get_active_uniform(program_id, i, GLsizei(name.size()), &name_length, &elements_count, &type, &name[0]);
+
+    std::string uniform_name(name.c_str(), name_length);
+
+    if (uniform_name.size() > 3 && uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0)
+      uniform_name.resize(uniform_name.size() - 3);
+
+    UniformInfo& uniform = program.uniforms[uniform_name];
+    GLuint index = GLuint(i);
+
+    uniform.location = null_get_uniform_location(program_id, uniform_name.c_str());
+    uniform.elements_count = elements_count;
+    uniform.type = type;
+
+    null_get_active_uniforms(program_id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.block_index);
+    null_get_active_uniforms(program_id, 1, &index, GL_UNIFORM_OFFSET, &uniform.offset);
+    null_get_active_uniforms(program_id, 1, &index, GL_UNIFORM_ARRAY_STRIDE, &uniform.array_stride);
+    null_get_active_uniforms(program_id, 1, &index, GL_UNIFORM_MATRIX_STRIDE, &uniform.matrix_stride);
+
+    if (uniform.location >= 0)
+      slots_count = std::max(slots_count, uniform.location + elements_count);
+  }
+
+    //uniform blocks members are placed to slots after default block uniforms
+
+  GLint blocks_count = 0;
+
+  null_get_program(program_id, GL_ACTIVE_UNIFORM_BLOCKS, &blocks_count);
+
+  program.block_bindings.assign(size_t(blocks_count), 0);
+
+  for (auto& entry : program.uniforms)
+  {
+    UniformInfo& uniform = entry.second;
+
+    if (uniform.block_index < 0)
+      continue;
+
+    uniform.location = slots_count;
+    slots_count += uniform.elements_count;
+
+    program.block_uniforms.push_back(uniform);
+  }
+
+    //reflect attributes & outputs
+
+  program.position_attribute = null_get_attrib_location(program_id, "vPosition");
+  program.normal_attribute = null_get_attrib_location(program_id, "vNormal");
+  program.color_attribute = null_get_attrib_location(program_id, "vColor");
+  program.texcoord_attribute = null_get_attrib_location(program_id, "vTexCoord");
+  program.instance_transform_attribute = null_get_attrib_location(program_id, "vInstanceModelMatrix");
+
+  static const char* GBUFFER_OUTPUTS [] = {"outPosition", "outNormal", "outAlbedo", "outSpecular"};
+
+  bool has_gbuffer_outputs = true;
+
+  for (size_t i=0; i<4; i++)
+  {
+    program.outputs[i] = null_get_frag_data_location(program_id, GBUFFER_OUTPUTS[i]);
+    has_gbuffer_outputs &= program.outputs[i] >= 0;
+  }
+
+    //select kernel
+
+  bool is_layered = program.instance_transform_attribute >= 0 && program.position_attribute >= 0 && program.find_uniform("shadowViewProjectionMatrices").location >= 0;
+  bool is_instanced = program.instance_transform_attribute >= 0 && program.find_uniform("viewProjectionMatrix").location >= 0;
+  bool has_mvp = is_instanced || program.find_uniform("MVP").location >= 0;
+
+  if (is_layered)
+  {
+    program.kernel = Kernel_LayeredDepth;
+  }
+  else if (program.find_uniform("pointLightPositions").location >= 0 && program.find_uniform("positionTexture").location >= 0)
+  {
+    program.kernel = Kernel_Lighting;
+    program.outputs[0] = std::max(null_get_frag_data_location(program_id, "outColor"), 0);
+  }
+  else if (has_mvp && has_gbuffer_outputs && (is_instanced || program.find_uniform("modelMatrix").location >= 0))
+  {
+    program.kernel = Kernel_GBuffer;
+  }
+  else if (has_mvp && program.uniforms.size() == 1 && program.position_attribute >= 0)
+  {
+    program.kernel = Kernel_Depth;
+  }
+}
+
+void APIENTRY software_uniform_block_binding(GLuint program_id, GLuint index, GLuint binding)
+{
+  static PFNGLUNIFORMBLOCKBINDINGPROC null_uniform_block_binding = get_null_function<PFNGLUNIFORMBLOCKBINDINGPROC>("glUniformBlockBinding");
+
+  null_uniform_block_binding(program_id, index, binding);
+
+  SoftwareProgram* program = SoftwareDriver::instance().find_program(program_id);
+
+  if (program && index < program->block_bindings.size())
+    program->block_bindings[index] = binding;
+}
+
+/// Fetch values of uniform blocks members from bound uniform buffers (matrices are stored row-major in slots)
+void fetch_block_uniforms(SoftwareDriver& driver, SoftwareProgram& program)
+{
+  for (const UniformInfo& uniform : program.block_uniforms)
+  {
+    GLuint binding = size_t(uniform.block_index) < program.block_bindings.size() ? program.block_bindings[uniform.block_index] : GLuint(-1);
+
+    if (binding >= SOFTWARE_MAX_UNIFORM_BUFFER_BINDINGS)
+      continue;
+
+    const UniformBufferBinding& range = driver.uniform_buffers[binding];
+    auto buffer_it = driver.buffers.find(range.buffer);
+
+    if (buffer_it == driver.buffers.end())
+      continue;
+
+    const std::vector<char>& buffer = buffer_it->second;
+    bool is_matrix = uniform.type == GL_FLOAT_MAT4;
+    size_t element_size = is_matrix ? sizeof(float) * 16 : uniform.type == GL_FLOAT_VEC4 ? sizeof(float) * 4 :
+      uniform.type == GL_FLOAT_VEC3 ? sizeof(float) * 3 : uniform.type == GL_FLOAT_VEC2 ? sizeof(float) * 2 : sizeof(float);
+
+    for (GLint i=0; i<uniform.elements_count; i++)
+    {
+      size_t offset = range.offset + size_t(uniform.offset) + size_t(i) * size_t(uniform.array_stride);
+
+      if (offset + element_size > buffer.size())
+        break;
+
+      UniformSlot& slot = *program.slot(uniform.location + i);
+      const float* values = reinterpret_cast<const float*>(buffer.data() + offset);
+
+      if (is_matrix)
+      {
+        size_t matrix_stride = size_t(uniform.matrix_stride) / sizeof(float);
+
+        for (size_t row=0; row<4; row++)
+          for (size_t column=0; column<4; column++)
+            slot[row * 4 + column] = values[column * matrix_stride + row];
+      }
+      else if (uniform.type == GL_INT)
+      {
+        slot[0] = float(*reinterpret_cast<const GLint*>(values));
+      }
+      else
+      {
+        memcpy(slot.data(), values, element_size);
+      }
+    }
+  }
+}
+
+void APIENTRY software_delete_program(GLuint program)
+{
+  static PFNGLDELETEPROGRAMPROC null_delete_program = get_null_function<PFNGLDELETEPROGRAMPROC>("glDeleteProgram");
+
+  SoftwareDriver::instance().programs.erase(program);
+
+  null_delete_program(program);
+}
+
+template <size_t Components, class T> void set_uniform(GLint location, GLsizei count, const T* values)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareProgram* program = driver.find_program(driver.current_program);
+
+  if (!program || location < 0)
+    return;
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    UniformSlot& slot = *program->slot(location + i);
+
+    for (size_t j=0; j<Components; j++)
+      slot[j] = float(values[i * Components + j]);
+  }
+}
+
+void APIENTRY software_uniform_1i(GLint location, GLint value)
+{
+  set_uniform<1>(location, 1, &value);
+}
+
+void APIENTRY software_uniform_1iv(GLint location, GLsizei count, const GLint* values)
+{
+  set_uniform<1>(location, count, values);
+}
+
+void APIENTRY software_uniform_1fv(GLint location, GLsizei count, const GLfloat* values)
+{
+  set_uniform<1>(location, count, values);
+}
+
+void APIENTRY software_uniform_2fv(GLint location, GLsizei count, const GLfloat* values)
+{
+  set_uniform<2>(location, count, values);
+}
+
+void APIENTRY software_uniform_3fv(GLint location, GLsizei count, const GLfloat* values)
+{
+  set_uniform<3>(location, count, values);
+}
+
+void APIENTRY software_uniform_4fv(GLint location, GLsizei count, const GLfloat* values)
+{
+  set_uniform<4>(location, count, values);
+}
+
+void APIENTRY software_uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareProgram* program = driver.find_program(driver.current_program);
+
+  if (!program || location < 0)
+    return;
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    UniformSlot& slot = *program->slot(location + i);
+    const GLfloat* matrix = values + i * 16;
+
+    for (size_t row=0; row<4; row++)
+      for (size_t column=0; column<4; column++)
+        slot[row * 4 + column] = transpose ? matrix[row * 4 + column] : matrix[column * 4 + row];
+  }
+}
+
+void set_vertex_attribute_state(GLuint index, bool state)
+{
+  if (index < SOFTWARE_MAX_VERTEX_ATTRIBUTES)
+    SoftwareDriver::instance().current_vertex_array().attributes[index].enabled = state;
+}
+
+void APIENTRY software_enable_vertex_attrib_array(GLuint index)
+{
+  set_vertex_attribute_state(index, true);
+}
+
+void APIENTRY software_disable_vertex_attrib_array(GLuint index)
+{
+  set_vertex_attribute_state(index, false);
+}
+
+void APIENTRY software_vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  if (index >= SOFTWARE_MAX_VERTEX_ATTRIBUTES)
+    return;
+
+  VertexAttribute& attribute = driver.current_vertex_array().attributes[index];
+
+  attribute.size = size;
+  attribute.type = type;
+  attribute.normalized = normalized != GL_FALSE;
+  attribute.stride = stride;
+  attribute.offset = reinterpret_cast<uintptr_t>(pointer);
+  attribute.buffer = driver.array_buffer;
+}
+
+void APIENTRY software_vertex_attrib_divisor(GLuint index, GLuint divisor)
+{
+  if (index < SOFTWARE_MAX_VERTEX_ATTRIBUTES)
+    SoftwareDriver::instance().current_vertex_array().attributes[index].divisor = divisor;
+}
+
+void APIENTRY software_bind_vertex_array(GLuint vertex_array)
+{
+  SoftwareDriver::instance().vertex_array = vertex_array;
+}
+
+void APIENTRY software_delete_vertex_arrays(GLsizei count, const GLuint* ids)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    if (!ids[i])
+      continue;
+
+    driver.vertex_arrays.erase(ids[i]);
+
+    if (driver.vertex_array == ids[i])
+      driver.vertex_array = 0;
+  }
+}
+
+void draw_elements(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instances_count, GLint base_vertex, GLuint base_instance)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  SoftwareProgram* program = driver.find_program(driver.current_program);
+
+  if (!program || mode != GL_TRIANGLES || count <= 0 || instances_count <= 0)
+    return;
+
+  if (program->kernel == Kernel_Unsupported)
+  {
+    if (!program->is_unsupported_reported)
+      engine_log_warning("Software driver: program %u doesn't match any built-in kernel; its draws are skipped", driver.current_program);
+
+    program->is_unsupported_reported = true;
+
+    return;
+  }
+
+  fetch_block_uniforms(driver, *program);
+
+  if (program->kernel == Kernel_LayeredDepth)
+  {
+    draw_layered_depth(driver, *program, count, type, offset, instances_count, base_vertex, base_instance);
+    return;
+  }
+
+    //clip viewport by render targets
+
+  GLint viewport[4];
+
+  if (!clip_viewport(driver, *program, driver.viewport, viewport))
+    return;
+
+  switch (program->kernel)
+  {
+    case Kernel_Lighting:
+      draw_lighting(driver, *program, driver.color_target(program->outputs[0]), viewport);
+      break;
+    default:
+      draw_triangles(driver, *program, count, type, offset, instances_count, base_vertex, base_instance, viewport);
+      break;
+  }
+}
+
+void APIENTRY software_draw_elements_instanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances_count)
+{
+  draw_elements(mode, count, type, reinterpret_cast<uintptr_t>(indices), instances_count, 0, 0);
+}
+
+void APIENTRY software_draw_elements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+  draw_elements(mode, count, type, reinterpret_cast<uintptr_t>(indices), 1, 0, 0);
+}
+
+void APIENTRY software_multi_draw_elements_indirect(GLenum mode, GLenum type, const void* indirect, GLsizei draws_count, GLsizei stride)
+{
+  SoftwareDriver& driver = SoftwareDriver::instance();
+  auto buffer_it = driver.buffers.find(driver.draw_indirect_buffer);
+
+  if (buffer_it == driver.buffers.end())
+    return;
+
+  const std::vector<char>& buffer = buffer_it->second;
+  size_t offset = reinterpret_cast<uintptr_t>(indirect);
+  size_t index_size = type == GL_UNSIGNED_INT ? 4 : type == GL_UNSIGNED_SHORT ? 2 : 1;
+
+  if (!stride)
+    stride = sizeof(DrawElementsIndirectCommand);
+
+  for (GLsizei i=0; i<draws_count; i++, offset += stride)
+  {
+    if (offset + sizeof(DrawElementsIndirectCommand) > buffer.size())
+      throw Exception::format("Software driver: indirect buffer overflow");
+
+    DrawElementsIndirectCommand command;
+
+    memcpy(&command, buffer.data() + offset, sizeof(command));
+
+    draw_elements(mode, GLsizei(command.count), type, command.first_index * index_size, GLsizei(command.instances_count), command.base_vertex, command.base_instance);
+  }
+}
+
+/// Entry points table
+struct DriverFunction
+{
+  const char* name;
+  GLADapiproc function;
+};
+
+#define SOFTWARE_DRIVER_FUNCTION(NAME, PFN, FN) {#NAME, reinterpret_cast<GLADapiproc>(static_cast<PFN>(FN))}
+
+const DriverFunction SOFTWARE_DRIVER_FUNCTIONS[] = {
+  SOFTWARE_DRIVER_FUNCTION(glBindBuffer, PFNGLBINDBUFFERPROC, &software_bind_buffer),
+  SOFTWARE_DRIVER_FUNCTION(glBindBufferRange, PFNGLBINDBUFFERRANGEPROC, &software_bind_buffer_range),
+  SOFTWARE_DRIVER_FUNCTION(glBufferData, PFNGLBUFFERDATAPROC, &software_buffer_data),
+  SOFTWARE_DRIVER_FUNCTION(glBufferSubData, PFNGLBUFFERSUBDATAPROC, &software_buffer_sub_data),
+  SOFTWARE_DRIVER_FUNCTION(glMapBufferRange, PFNGLMAPBUFFERRANGEPROC, &software_map_buffer_range),
+  SOFTWARE_DRIVER_FUNCTION(glUnmapBuffer, PFNGLUNMAPBUFFERPROC, &software_unmap_buffer),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteBuffers, PFNGLDELETEBUFFERSPROC, &software_delete_buffers),
+  SOFTWARE_DRIVER_FUNCTION(glActiveTexture, PFNGLACTIVETEXTUREPROC, &software_active_texture),
+  SOFTWARE_DRIVER_FUNCTION(glBindTexture, PFNGLBINDTEXTUREPROC, &software_bind_texture),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteTextures, PFNGLDELETETEXTURESPROC, &software_delete_textures),
+  SOFTWARE_DRIVER_FUNCTION(glTexImage2D, PFNGLTEXIMAGE2DPROC, &software_tex_image_2d),
+  SOFTWARE_DRIVER_FUNCTION(glTexSubImage2D, PFNGLTEXSUBIMAGE2DPROC, &software_tex_sub_image_2d),
+  SOFTWARE_DRIVER_FUNCTION(glTexImage3D, PFNGLTEXIMAGE3DPROC, &software_tex_image_3d),
+  SOFTWARE_DRIVER_FUNCTION(glCompressedTexImage2D, PFNGLCOMPRESSEDTEXIMAGE2DPROC, &software_compressed_tex_image_2d),
+  SOFTWARE_DRIVER_FUNCTION(glCompressedTexSubImage2D, PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC, &software_compressed_tex_sub_image_2d),
+  SOFTWARE_DRIVER_FUNCTION(glGetTexImage, PFNGLGETTEXIMAGEPROC, &software_get_tex_image),
+  SOFTWARE_DRIVER_FUNCTION(glTexParameteri, PFNGLTEXPARAMETERIPROC, &software_tex_parameter),
+  SOFTWARE_DRIVER_FUNCTION(glGenerateMipmap, PFNGLGENERATEMIPMAPPROC, &software_generate_mipmap),
+  SOFTWARE_DRIVER_FUNCTION(glBindRenderbuffer, PFNGLBINDRENDERBUFFERPROC, &software_bind_renderbuffer),
+  SOFTWARE_DRIVER_FUNCTION(glRenderbufferStorage, PFNGLRENDERBUFFERSTORAGEPROC, &software_renderbuffer_storage),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteRenderbuffers, PFNGLDELETERENDERBUFFERSPROC, &software_delete_renderbuffers),
+  SOFTWARE_DRIVER_FUNCTION(glBindFramebuffer, PFNGLBINDFRAMEBUFFERPROC, &software_bind_framebuffer),
+  SOFTWARE_DRIVER_FUNCTION(glBlitFramebuffer, PFNGLBLITFRAMEBUFFERPROC, &software_blit_framebuffer),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteFramebuffers, PFNGLDELETEFRAMEBUFFERSPROC, &software_delete_framebuffers),
+  SOFTWARE_DRIVER_FUNCTION(glFramebufferTexture, PFNGLFRAMEBUFFERTEXTUREPROC, &software_framebuffer_texture),
+  SOFTWARE_DRIVER_FUNCTION(glFramebufferTexture2D, PFNGLFRAMEBUFFERTEXTURE2DPROC, &software_framebuffer_texture_2d),
+  SOFTWARE_DRIVER_FUNCTION(glFramebufferTextureLayer, PFNGLFRAMEBUFFERTEXTURELAYERPROC, &software_framebuffer_texture_layer),
+  SOFTWARE_DRIVER_FUNCTION(glFramebufferRenderbuffer, PFNGLFRAMEBUFFERRENDERBUFFERPROC, &software_framebuffer_renderbuffer),
+  SOFTWARE_DRIVER_FUNCTION(glDrawBuffer, PFNGLDRAWBUFFERPROC, &software_draw_buffer),
+  SOFTWARE_DRIVER_FUNCTION(glDrawBuffers, PFNGLDRAWBUFFERSPROC, &software_draw_buffers),
+  SOFTWARE_DRIVER_FUNCTION(glViewport, PFNGLVIEWPORTPROC, &software_viewport),
+  SOFTWARE_DRIVER_FUNCTION(glViewportIndexedf, PFNGLVIEWPORTINDEXEDFPROC, &software_viewport_indexed),
+  SOFTWARE_DRIVER_FUNCTION(glScissor, PFNGLSCISSORPROC, &software_scissor),
+  SOFTWARE_DRIVER_FUNCTION(glEnable, PFNGLENABLEPROC, &software_enable),
+  SOFTWARE_DRIVER_FUNCTION(glDisable, PFNGLDISABLEPROC, &software_disable),
+  SOFTWARE_DRIVER_FUNCTION(glCullFace, PFNGLCULLFACEPROC, &software_cull_face),
+  SOFTWARE_DRIVER_FUNCTION(glDepthFunc, PFNGLDEPTHFUNCPROC, &software_depth_func),
+  SOFTWARE_DRIVER_FUNCTION(glDepthMask, PFNGLDEPTHMASKPROC, &software_depth_mask),
+  SOFTWARE_DRIVER_FUNCTION(glBeginQuery, PFNGLBEGINQUERYPROC, &software_begin_query),
+  SOFTWARE_DRIVER_FUNCTION(glEndQuery, PFNGLENDQUERYPROC, &software_end_query),
+  SOFTWARE_DRIVER_FUNCTION(glGetQueryObjectuiv, PFNGLGETQUERYOBJECTUIVPROC, &software_get_query_object_uiv),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteQueries, PFNGLDELETEQUERIESPROC, &software_delete_queries),
+  SOFTWARE_DRIVER_FUNCTION(glClearColor, PFNGLCLEARCOLORPROC, &software_clear_color),
+  SOFTWARE_DRIVER_FUNCTION(glClear, PFNGLCLEARPROC, &software_clear),
+  SOFTWARE_DRIVER_FUNCTION(glUseProgram, PFNGLUSEPROGRAMPROC, &software_use_program),
+  SOFTWARE_DRIVER_FUNCTION(glLinkProgram, PFNGLLINKPROGRAMPROC, &software_link_program),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteProgram, PFNGLDELETEPROGRAMPROC, &software_delete_program),
+  SOFTWARE_DRIVER_FUNCTION(glUniformBlockBinding, PFNGLUNIFORMBLOCKBINDINGPROC, &software_uniform_block_binding),
+  SOFTWARE_DRIVER_FUNCTION(glUniform1i, PFNGLUNIFORM1IPROC, &software_uniform_1i),
+  SOFTWARE_DRIVER_FUNCTION(glUniform1iv, PFNGLUNIFORM1IVPROC, &software_uniform_1iv),
+  SOFTWARE_DRIVER_FUNCTION(glUniform1fv, PFNGLUNIFORM1FVPROC, &software_uniform_1fv),
+  SOFTWARE_DRIVER_FUNCTION(glUniform2fv, PFNGLUNIFORM2FVPROC, &software_uniform_2fv),
+  SOFTWARE_DRIVER_FUNCTION(glUniform3fv, PFNGLUNIFORM3FVPROC, &software_uniform_3fv),
+  SOFTWARE_DRIVER_FUNCTION(glUniform4fv, PFNGLUNIFORM4FVPROC, &software_uniform_4fv),
+  SOFTWARE_DRIVER_FUNCTION(glUniformMatrix4fv, PFNGLUNIFORMMATRIX4FVPROC, &software_uniform_matrix_4fv),
+  SOFTWARE_DRIVER_FUNCTION(glEnableVertexAttribArray, PFNGLENABLEVERTEXATTRIBARRAYPROC, &software_enable_vertex_attrib_array),
+  SOFTWARE_DRIVER_FUNCTION(glDisableVertexAttribArray, PFNGLDISABLEVERTEXATTRIBARRAYPROC, &software_disable_vertex_attrib_array),
+  SOFTWARE_DRIVER_FUNCTION(glVertexAttribPointer, PFNGLVERTEXATTRIBPOINTERPROC, &software_vertex_attrib_pointer),
+  SOFTWARE_DRIVER_FUNCTION(glVertexAttribDivisor, PFNGLVERTEXATTRIBDIVISORPROC, &software_vertex_attrib_divisor),
+  SOFTWARE_DRIVER_FUNCTION(glBindVertexArray, PFNGLBINDVERTEXARRAYPROC, &software_bind_vertex_array),
+  SOFTWARE_DRIVER_FUNCTION(glDeleteVertexArrays, PFNGLDELETEVERTEXARRAYSPROC, &software_delete_vertex_arrays),
+  SOFTWARE_DRIVER_FUNCTION(glDrawElements, PFNGLDRAWELEMENTSPROC, &software_draw_elements),
+  SOFTWARE_DRIVER_FUNCTION(glDrawElementsInstanced, PFNGLDRAWELEMENTSINSTANCEDPROC, &software_draw_elements_instanced),
+  SOFTWARE_DRIVER_FUNCTION(glMultiDrawElementsIndirect, PFNGLMULTIDRAWELEMENTSINDIRECTPROC, &software_multi_draw_elements_indirect),
+};
+
+#undef SOFTWARE_DRIVER_FUNCTION
+
+const char* SOFTWARE_DRIVER_VERSION = "4.1 Software Driver";
+
+const GLubyte* APIENTRY software_get_string(GLenum name)
+{
+  static PFNGLGETSTRINGPROC null_get_string = get_null_function<PFNGLGETSTRINGPROC>("glGetString");
+
+  switch (name)
+  {
+    case GL_VERSION:  return reinterpret_cast<const GLubyte*>(SOFTWARE_DRIVER_VERSION);
+    case GL_RENDERER: return reinterpret_cast<const GLubyte*>("Software Driver");
+    default:          return null_get_string(name);
+  }
+}
+
+}
+
+namespace engine {
+namespace render {
+namespace low_level {
+
+GLADapiproc get_software_driver_proc_address(const char* name)
+{
+  if (!name)
+    return nullptr;
+
+  if (!strcmp(name, "glGetString"))
+    return reinterpret_cast<GLADapiproc>(static_cast<PFNGLGETSTRINGPROC>(&software_get_string));
+
+  for (const auto& desc : SOFTWARE_DRIVER_FUNCTIONS)
+    if (!strcmp(desc.name, name))
+      return desc.function;
+
+  return get_null_driver_proc_address(name);
+}
+
+}}}
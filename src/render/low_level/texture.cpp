@@ -21,12 +21,46 @@ size_t get_mips_count(size_t width, size_t height)
   return get_mips_count(get_max_size(width, height));
 }
 
+size_t get_pixel_size(PixelFormat format)
+{
+  switch (format)
+  {
+    case PixelFormat_RGBA8:  return 4;
+    case PixelFormat_RGB16F: return 3 * sizeof(float);
+    case PixelFormat_D24:    return sizeof(GLuint);
+    case PixelFormat_BC1:
+    case PixelFormat_BC3:
+    case PixelFormat_BC4:
+    case PixelFormat_BC5:    return 4; //block compressed textures are read back as RGBA8
+    default:                 throw Exception::format("Invalid texture pixel format %d", format);
+  }
+}
+
+}
+
+namespace engine {
+namespace render {
+namespace low_level {
+
+bool get_compression_format(PixelFormat format, media::image::CompressionFormat& out_format)
+{
+  switch (format)
+  {
+    case PixelFormat_BC1: out_format = media::image::CompressionFormat_BC1; return true;
+    case PixelFormat_BC3: out_format = media::image::CompressionFormat_BC3; return true;
+    case PixelFormat_BC4: out_format = media::image::CompressionFormat_BC4; return true;
+    case PixelFormat_BC5: out_format = media::image::CompressionFormat_BC5; return true;
+    default:              return false;
+  }
 }
 
+}}}
+
 /// Implementation details of texture
 struct Texture::Impl
 {
   DeviceContextPtr context; //device context
+  TextureType type; //texture type
   size_t width; //texture width
   size_t height; //texture height
   size_t layers; //number of layers
@@ -40,14 +74,19 @@ struct Texture::Impl
   GLenum gl_uncompressed_type; //GL uncompressed type
   GLuint texture_id; //GL texture
   GLenum target; //GL target for this texture
+  media::image::CompressionFormat compression_format; //block compression format
+  bool is_compressed; //texture has block compressed format
+  size_t upload_ticket; //ticket of the last asynchronous upload (0 - no uploads)
 
   Impl(const DeviceContextPtr& context,
+       TextureType type,
        size_t width,
        size_t height,
        size_t layers,
        PixelFormat format,
        size_t mips_count)
     : context(context)
+    , type(type)
     , width(width)
     , height(height)
     , layers(layers)
@@ -60,6 +99,9 @@ struct Texture::Impl
     , gl_uncompressed_type(GL_NONE)
     , texture_id()
     , target()
+    , compression_format(media::image::CompressionFormat_Num)
+    , is_compressed(get_compression_format(format, compression_format))
+    , upload_ticket()
   {
     context->make_current();
 
@@ -85,31 +127,81 @@ struct Texture::Impl
         gl_uncompressed_format = GL_DEPTH_COMPONENT;
         gl_uncompressed_type = GL_UNSIGNED_INT;      
         break;
+      case PixelFormat_BC1:
+      case PixelFormat_BC3:
+        if (!context->capabilities().has_texture_compression_s3tc)
+          throw Exception::format("Can't create texture of pixel format %d: S3TC texture compression isn't supported", format);
+
+        gl_internal_format = format == PixelFormat_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        gl_uncompressed_format = GL_RGBA;
+        gl_uncompressed_type = GL_UNSIGNED_BYTE;
+        break;
+      case PixelFormat_BC4:
+      case PixelFormat_BC5:
+        gl_internal_format = format == PixelFormat_BC4 ? GL_COMPRESSED_RED_RGTC1 : GL_COMPRESSED_RG_RGTC2;
+        gl_uncompressed_format = GL_RGBA;
+        gl_uncompressed_type = GL_UNSIGNED_BYTE;
+        break;
       default:
         throw Exception::format("Invalid texture pixel format %d", format);
     }
 
-    switch (layers)
+    volatile size_t computed_mips_count = get_mips_count(width, height);
+
+    if (mips_count > computed_mips_count || mips_count == (size_t)-1)
+      mips_count = computed_mips_count;
+
+    engine_check(mips_count < 100 && mips_count >= 0);
+
+    this->mips_count = mips_count;
+
+    GLint level_width = static_cast<GLint>(width);
+    GLint level_height = static_cast<GLint>(height);
+
+    switch (type)
     {
-      case 1:
+      case TextureType_2D:
       {
+        engine_check(layers == 1);
+
         target = GL_TEXTURE_2D;
 
         bind();
 
-        volatile size_t computed_mips_count = get_mips_count(width, height);
+        for (GLint level=0; level<mips_count; level++)
+        {
+          if (is_compressed)
+          {
+            size_t level_size = media::image::CompressedImage::level_bytes(compression_format, level_width, level_height);
+
+            glCompressedTexImage2D(target, level, gl_internal_format, level_width, level_height, 0, static_cast<GLsizei>(level_size), nullptr);
+          }
+          else
+          {
+            glTexImage2D(target, level, gl_internal_format, level_width, level_height, 0,
+              gl_uncompressed_format, gl_uncompressed_type, nullptr);
+          }
+
+          level_width = level_width > 1 ? level_width / 2 : 1;
+          level_height = level_height > 1 ? level_height / 2 : 1;
+        }
+
+        break;
+      }
+      case TextureType_2DArray:
+      {
+        engine_check(layers > 0);
 
-        if (mips_count > computed_mips_count || mips_count == (size_t)-1)
-          mips_count = computed_mips_count;
+        if (is_compressed)
+          throw Exception::format("Can't create texture array of block compressed pixel format %d", format);
 
-        engine_check(mips_count < 100 && mips_count >= 0);
+        target = GL_TEXTURE_2D_ARRAY;
 
-        GLint level_width = static_cast<GLint>(width);
-        GLint level_height = static_cast<GLint>(height);
+        bind();
 
         for (GLint level=0; level<mips_count; level++)
         {
-          glTexImage2D(target, level, gl_internal_format, level_width, level_height, 0,
+          glTexImage3D(target, level, gl_internal_format, level_width, level_height, static_cast<GLsizei>(layers), 0,
             gl_uncompressed_format, gl_uncompressed_type, nullptr);
 
           level_width = level_width > 1 ? level_width / 2 : 1;
@@ -119,8 +211,7 @@ struct Texture::Impl
         break;
       }
       default:
-        engine_check(layers == 1); //no support of other textures for now
-        break;
+        throw Exception::format("Invalid texture type %d", type);
     }
 
     glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips_count - 1));
@@ -132,7 +223,11 @@ struct Texture::Impl
   {
     try
     {
+      context->texture_uploader().on_texture_deleted(texture_id);
+
       glDeleteTextures(1, &texture_id);
+
+      context->state_cache().on_texture_deleted(texture_id);
     }
     catch (...)
     {
@@ -140,11 +235,18 @@ struct Texture::Impl
     }
   }
 
+  /// Dimensions of a mip level
+  void get_level_size(size_t level, size_t& level_width, size_t& level_height) const
+  {
+    level_width = get_max_size(width >> level, 1);
+    level_height = get_max_size(height >> level, 1);
+  }
+
   void bind()
   {
     context->make_current();
 
-    glBindTexture(target, texture_id);
+    context->state_cache().bind_texture(target, texture_id);
 
     if (need_reapply_sampler)
     {
@@ -173,11 +275,16 @@ struct Texture::Impl
   }
 };
 
-Texture::Texture(const DeviceContextPtr& context, size_t width, size_t height, size_t layers, PixelFormat format, size_t mips_count)
-  : impl(std::make_shared<Impl>(context, width, height, layers, format, mips_count))
+Texture::Texture(const DeviceContextPtr& context, TextureType type, size_t width, size_t height, size_t layers, PixelFormat format, size_t mips_count)
+  : impl(std::make_shared<Impl>(context, type, width, height, layers, format, mips_count))
 {
 }
 
+TextureType Texture::type() const
+{
+  return impl->type;
+}
+
 size_t Texture::width() const
 {
   return impl->width;
@@ -225,16 +332,120 @@ void Texture::set_mag_filter(TextureFilter filter)
 
 void Texture::set_data(size_t layer, size_t x, size_t y, size_t width, size_t height, const void* data)
 {
+  if (impl->is_compressed)
+    throw Exception::format("Can't set region of block compressed texture; use Texture::set_level_data");
+
+  engine_check(layer == 0 && impl->type == TextureType_2D); //no pixels transfer for texture arrays for now
+
   bind();
 
-  engine_check(layer == 0); //no support of other textures for now
+    //queued asynchronous uploads mustn't overwrite the region later
+
+  impl->context->texture_uploader().flush(impl->texture_id, 0, x, y, width, height);
 
   glTexSubImage2D (GL_TEXTURE_2D, 0, (GLint)x, (GLint)y, (GLint)width, (GLint)height, impl->gl_uncompressed_format, impl->gl_uncompressed_type, data);
 }
 
+void Texture::set_data_async(size_t layer, size_t x, size_t y, size_t width, size_t height, const void* data)
+{
+  engine_check(layer == 0 && impl->type == TextureType_2D); //no pixels transfer for texture arrays for now
+  engine_check(x + width <= impl->width && y + height <= impl->height);
+
+  if (impl->is_compressed)
+    throw Exception::format("Can't set region of block compressed texture; use Texture::set_level_data_async");
+
+  impl->context->make_current();
+
+  impl->upload_ticket = impl->context->texture_uploader().upload(impl->target, impl->texture_id, 0, x, y, width, height,
+    impl->gl_uncompressed_format, impl->gl_uncompressed_type, get_pixel_size(impl->format), data);
+}
+
+void Texture::set_level_data(size_t layer, size_t level, const void* data)
+{
+  engine_check_null(data);
+  engine_check(layer == 0 && impl->type == TextureType_2D); //no pixels transfer for texture arrays for now
+  engine_check_range(level, impl->mips_count);
+
+  size_t width = 0, height = 0;
+
+  impl->get_level_size(level, width, height);
+
+  bind();
+
+    //queued asynchronous uploads mustn't overwrite the level later
+
+  impl->context->texture_uploader().flush(impl->texture_id, (GLint)level, 0, 0, width, height);
+
+  if (impl->is_compressed)
+  {
+    size_t size = media::image::CompressedImage::level_bytes(impl->compression_format, (unsigned int)width, (unsigned int)height);
+
+    glCompressedTexSubImage2D(impl->target, (GLint)level, 0, 0, (GLsizei)width, (GLsizei)height, impl->gl_internal_format, (GLsizei)size, data);
+  }
+  else
+  {
+    glTexSubImage2D(impl->target, (GLint)level, 0, 0, (GLsizei)width, (GLsizei)height, impl->gl_uncompressed_format, impl->gl_uncompressed_type, data);
+  }
+
+  impl->context->check_errors();
+}
+
+void Texture::set_level_data_async(size_t layer, size_t level, const void* data)
+{
+  engine_check(layer == 0 && impl->type == TextureType_2D); //no pixels transfer for texture arrays for now
+  engine_check_range(level, impl->mips_count);
+
+  size_t width = 0, height = 0;
+
+  impl->get_level_size(level, width, height);
+
+  impl->context->make_current();
+
+  TextureUploader& uploader = impl->context->texture_uploader();
+
+  if (impl->is_compressed)
+  {
+    impl->upload_ticket = uploader.upload_compressed(impl->target, impl->texture_id, (GLint)level, 0, 0, width, height,
+      impl->gl_internal_format, media::image::CompressedImage::block_bytes(impl->compression_format), data);
+  }
+  else
+  {
+    impl->upload_ticket = uploader.upload(impl->target, impl->texture_id, (GLint)level, 0, 0, width, height,
+      impl->gl_uncompressed_format, impl->gl_uncompressed_type, get_pixel_size(impl->format), data);
+  }
+}
+
+bool Texture::is_ready() const
+{
+  return impl->context->texture_uploader().is_completed(impl->upload_ticket);
+}
+
 void Texture::get_data(size_t layer, size_t x, size_t y, size_t width, size_t height, void* data)
 {
-  unimplemented();
+  engine_check_null(data);
+  engine_check(layer == 0 && impl->type == TextureType_2D); //no pixels transfer for texture arrays for now
+  engine_check(x + width <= impl->width && y + height <= impl->height);
+
+  bind();
+
+  impl->context->texture_uploader().flush(impl->texture_id);
+
+  size_t pixel_size = get_pixel_size(impl->format);
+
+    //GL reads the whole level, so the requested rectangle is copied from a temporary buffer
+
+  size_t row_size = (impl->width * pixel_size + 3) & ~size_t(3); //GL_PACK_ALIGNMENT is 4
+
+  std::vector<char> level_data(row_size * impl->height);
+
+  glGetTexImage(impl->target, 0, impl->gl_uncompressed_format, impl->gl_uncompressed_type, level_data.data());
+
+  impl->context->check_errors();
+
+  char* dst = static_cast<char*>(data);
+
+  for (size_t row=0; row<height; row++, dst += width * pixel_size)
+    memcpy(dst, level_data.data() + (y + row) * row_size + x * pixel_size, width * pixel_size);
 }
 
 void Texture::bind() const
@@ -244,6 +455,19 @@ void Texture::bind() const
 
 void Texture::generate_mips()
 {
+  TextureUploader& uploader = impl->context->texture_uploader();
+
+    //mipmaps of a texture with pending uploads are generated after the uploads have been issued
+
+  if (!uploader.is_completed(impl->upload_ticket))
+  {
+    impl->context->make_current();
+
+    impl->upload_ticket = uploader.generate_mips(impl->target, impl->texture_id);
+
+    return;
+  }
+
   impl->bind();
 
   glGenerateMipmap(impl->target);
@@ -254,26 +478,13 @@ void Texture::get_level_info(size_t layer, size_t level, TextureLevelInfo& out_i
   engine_check_range(layer, impl->layers);
   engine_check_range(level, impl->mips_count);
 
-  GLint level_width = static_cast<GLint>(impl->width);
-  GLint level_height = static_cast<GLint>(impl->height);
+  size_t level_width = 0, level_height = 0;
 
-  for (GLint level=0; level<impl->mips_count; level++)
-  {
-    level_width = level_width > 1 ? level_width / 2 : 1;
-    level_height = level_height > 1 ? level_height / 2 : 1;
-  }
+  impl->get_level_size(level, level_width, level_height);
 
-  switch (impl->layers)
-  {
-    case 1:
-    {
-      out_info.target = impl->target;
-      out_info.texture_id = impl->texture_id;
-      out_info.width = level_width;
-      out_info.height = level_height;
-      break;
-    }
-    default:
-      unimplemented(); //cubemaps are not supported for now
-  }
+  out_info.target = impl->target;
+  out_info.texture_id = impl->texture_id;
+  out_info.width = static_cast<GLint>(level_width);
+  out_info.height = static_cast<GLint>(level_height);
+  out_info.layer = impl->type == TextureType_2DArray ? static_cast<GLint>(layer) : -1;
 }
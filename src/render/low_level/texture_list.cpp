@@ -1,14 +1,29 @@
 #include "shared.h"
 
+#include <atomic>
+
 using namespace engine::common;
 using namespace engine::render::low_level;
 
 typedef NamedDictionary<Texture> TextureDict;
 
+namespace
+{
+
+std::atomic<size_t> next_layout_id(1); //layout identifiers generator
+
+}
+
 /// Internal implementation of texture library
 struct TextureList::Impl
 {
   TextureDict textures; //dictionary of textures
+  size_t layout_id; //layout identifier
+
+  Impl()
+    : layout_id(next_layout_id++)
+  {
+  }
 };
 
 TextureList::TextureList()
@@ -26,11 +41,15 @@ void TextureList::insert(const char* name, const Texture& texture)
   engine_check_null(name);
 
   impl->textures.insert(name, texture);
+
+  impl->layout_id = next_layout_id++;
 }
 
 void TextureList::remove(const char* name)
 {
   impl->textures.erase(name);
+
+  impl->layout_id = next_layout_id++;
 }
 
 Texture* TextureList::find(const char* name) const
@@ -45,3 +64,8 @@ Texture& TextureList::get(const char* name) const
 
   throw Exception::format("Texture '%s' has not been found", name);
 }
+
+size_t TextureList::layout_id() const
+{
+  return impl->layout_id;
+}
@@ -0,0 +1,489 @@
+#include "shared.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+namespace
+{
+
+/// Constants
+static constexpr size_t PIXEL_BUFFER_SIZE = 1024 * 1024; //minimal size of staging pixel buffer
+static constexpr size_t MAX_PIXEL_BUFFERS_COUNT = 8; //maximal number of staging pixel buffers
+static constexpr size_t UNPACK_ALIGNMENT = 4; //default GL_UNPACK_ALIGNMENT
+static constexpr size_t NO_FRAME = ~size_t(0); //pixel buffer hasn't been used yet
+
+/// Queued texture upload
+struct Upload
+{
+  size_t ticket; //upload ticket
+  GLenum target; //texture target
+  GLuint texture; //texture object
+  GLint level; //mip level
+  size_t x, y, width, height; //texture region
+  GLenum format; //pixels format (internal format for compressed uploads)
+  GLenum type; //pixels type
+  bool is_compressed; //pixels are block compressed
+  size_t row_size; //size of transferred row (in bytes)
+  size_t row_height; //number of pixel rows in transferred row (block height for compressed uploads)
+  size_t rows_count; //number of transferred rows
+  size_t next_row; //first row of the region which hasn't been transferred
+  std::vector<char> data; //staged pixels
+  bool generate_mips; //generate mipmaps instead of pixels transfer
+};
+
+/// Staging pixel buffer
+struct PixelBuffer
+{
+  GLuint id; //buffer object
+  size_t size; //buffer size
+  size_t used_size; //number of bytes used during the frame
+  size_t frame; //frame of the last transfer from the buffer
+};
+
+/// Upload which has been issued and is completed with the frame
+struct IssuedUpload
+{
+  size_t ticket; //upload ticket
+  size_t frame; //frame of the last transfer
+};
+
+size_t align(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+/// Implementation details of texture uploader
+struct TextureUploader::Impl
+{
+  DeviceStateCache& state_cache; //state cache
+  FrameFences& fences; //frame fences
+  size_t frame_budget; //bytes transferred per frame (0 - unlimited)
+  size_t frame; //frame of the transferred bytes counter
+  size_t frame_bytes; //bytes transferred during the frame
+  size_t next_ticket; //ticket of the next upload
+  std::deque<Upload> queue; //queued uploads
+  std::deque<IssuedUpload> issued_uploads; //uploads which wait for completion
+  std::vector<PixelBuffer> buffers; //staging buffers
+
+  Impl(DeviceStateCache& state_cache, FrameFences& fences, size_t frame_budget)
+    : state_cache(state_cache)
+    , fences(fences)
+    , frame_budget(frame_budget)
+    , frame(NO_FRAME)
+    , frame_bytes()
+    , next_ticket(1)
+  {
+  }
+
+  ~Impl()
+  {
+    try
+    {
+      for (PixelBuffer& buffer : buffers)
+      {
+        glDeleteBuffers(1, &buffer.id);
+
+        state_cache.on_buffer_deleted(buffer.id);
+      }
+    }
+    catch (...)
+    {
+      //ignore exceptions in destructors
+    }
+  }
+
+  /// Queue upload
+  size_t push(Upload&& upload)
+  {
+    upload.ticket = next_ticket++;
+
+    queue.push_back(std::move(upload));
+
+    size_t ticket = queue.back().ticket;
+
+    update();
+
+    return ticket;
+  }
+
+  /// Remove completed uploads (uploads are issued in frames order)
+  void poll()
+  {
+    while (!issued_uploads.empty() && fences.is_frame_completed(issued_uploads.front().frame))
+      issued_uploads.pop_front();
+  }
+
+  /// Check whether the upload has been completed; uploads may be issued out of tickets order by flush
+  bool is_completed(size_t ticket)
+  {
+    if (!ticket)
+      return true;
+
+    poll();
+
+    if (!queue.empty() && queue.front().ticket <= ticket) //queue is sorted by tickets
+      return false;
+
+    for (const IssuedUpload& upload : issued_uploads)
+      if (upload.ticket <= ticket)
+        return false;
+
+    return true;
+  }
+
+  /// Issue queued uploads of the texture immediately from client memory; uploads of the level which are
+  /// covered by the region are dropped, since the region is overwritten by the caller
+  void flush(GLuint texture, GLint level, size_t x, size_t y, size_t width, size_t height)
+  {
+    bool has_uploads = false;
+
+    for (const Upload& upload : queue)
+      has_uploads |= upload.texture == texture;
+
+    if (!has_uploads)
+      return;
+
+    size_t current_frame = fences.current_frame();
+
+    state_cache.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    for (auto iter=queue.begin(); iter!=queue.end();)
+    {
+      Upload& upload = *iter;
+
+      if (upload.texture != texture)
+      {
+        ++iter;
+        continue;
+      }
+
+      bool is_covered = !upload.generate_mips && upload.level == level && upload.x >= x && upload.y >= y &&
+        upload.x + upload.width <= x + width && upload.y + upload.height <= y + height;
+
+      if (!is_covered)
+      {
+        state_cache.bind_texture(upload.target, upload.texture);
+
+        if (upload.generate_mips)
+        {
+          glGenerateMipmap(upload.target);
+        }
+        else
+        {
+          size_t first_row = upload.next_row * upload.row_height;
+          size_t height = upload.height - first_row;
+          const char* data = upload.data.data() + upload.next_row * upload.row_size;
+
+          if (upload.is_compressed)
+          {
+            glCompressedTexSubImage2D(upload.target, upload.level, GLint(upload.x), GLint(upload.y + first_row), GLsizei(upload.width), GLsizei(height),
+              upload.format, GLsizei((upload.rows_count - upload.next_row) * upload.row_size), data);
+          }
+          else
+          {
+            glTexSubImage2D(upload.target, upload.level, GLint(upload.x), GLint(upload.y + first_row), GLsizei(upload.width), GLsizei(height),
+              upload.format, upload.type, data);
+          }
+        }
+
+        issued_uploads.push_back(IssuedUpload {upload.ticket, current_frame});
+      }
+
+      iter = queue.erase(iter);
+    }
+  }
+
+  /// Find staging buffer range which may be written without waiting for the GPU
+  PixelBuffer* acquire_buffer(size_t size, size_t& offset)
+  {
+    PixelBuffer* free_buffer = nullptr;
+
+    for (PixelBuffer& buffer : buffers)
+    {
+      if (buffer.frame == frame)
+      {
+        size_t used_size = align(buffer.used_size, UNPACK_ALIGNMENT);
+
+        if (used_size + size <= buffer.size)
+        {
+          offset = used_size;
+          return &buffer;
+        }
+
+        continue;
+      }
+
+      if (buffer.frame != NO_FRAME && !fences.is_frame_completed(buffer.frame))
+        continue;
+
+      if (!free_buffer || (free_buffer->size < size && buffer.size > free_buffer->size))
+        free_buffer = &buffer;
+    }
+
+      //create new buffer if all buffers are in use
+
+    if (!free_buffer && buffers.size() < MAX_PIXEL_BUFFERS_COUNT)
+    {
+      PixelBuffer buffer;
+
+      glGenBuffers(1, &buffer.id);
+
+      if (!buffer.id)
+        throw Exception::format("Can't create GL pixel buffer");
+
+      buffer.size = 0;
+      buffer.frame = NO_FRAME;
+
+      buffers.push_back(buffer);
+
+      free_buffer = &buffers.back();
+    }
+
+    if (!free_buffer)
+      return nullptr;
+
+      //grow storage of the buffer
+
+    if (free_buffer->size < size)
+    {
+      free_buffer->size = std::max(size, PIXEL_BUFFER_SIZE);
+
+      state_cache.bind_buffer(GL_PIXEL_UNPACK_BUFFER, free_buffer->id);
+
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, free_buffer->size, nullptr, GL_STREAM_DRAW);
+    }
+
+    free_buffer->used_size = 0;
+    free_buffer->frame = frame;
+
+    offset = 0;
+
+    return free_buffer;
+  }
+
+  /// Issue queued uploads
+  void update()
+  {
+    size_t current_frame = fences.current_frame();
+
+    if (current_frame != frame)
+    {
+      frame = current_frame;
+      frame_bytes = 0;
+    }
+
+    bool unpack_buffer_bound = false;
+
+    while (!queue.empty())
+    {
+      Upload& upload = queue.front();
+
+      if (upload.generate_mips)
+      {
+        state_cache.bind_texture(upload.target, upload.texture);
+
+        glGenerateMipmap(upload.target);
+      }
+      else
+      {
+        if (frame_budget && frame_bytes >= frame_budget)
+          break;
+
+          //large uploads are split by rows to fit the budget; at least one row is transferred
+
+        size_t rows_count = upload.rows_count - upload.next_row;
+
+        if (frame_budget)
+          rows_count = std::max(size_t(1), std::min(rows_count, (frame_budget - frame_bytes) / upload.row_size));
+
+        size_t size = rows_count * upload.row_size, offset = 0;
+        PixelBuffer* buffer = acquire_buffer(size, offset);
+
+        if (!buffer)
+          break;
+
+        state_cache.bind_buffer(GL_PIXEL_UNPACK_BUFFER, buffer->id);
+
+        unpack_buffer_bound = true;
+
+        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, offset, size, upload.data.data() + upload.next_row * upload.row_size);
+
+        state_cache.bind_texture(upload.target, upload.texture);
+
+        size_t y = upload.next_row * upload.row_height, height = std::min(rows_count * upload.row_height, upload.height - y);
+
+        if (upload.is_compressed)
+        {
+          glCompressedTexSubImage2D(upload.target, upload.level, GLint(upload.x), GLint(upload.y + y), GLsizei(upload.width), GLsizei(height),
+            upload.format, GLsizei(size), reinterpret_cast<const void*>(offset));
+        }
+        else
+        {
+          glTexSubImage2D(upload.target, upload.level, GLint(upload.x), GLint(upload.y + y), GLsizei(upload.width), GLsizei(height),
+            upload.format, upload.type, reinterpret_cast<const void*>(offset));
+        }
+
+        buffer->used_size = offset + size;
+        frame_bytes += size;
+        upload.next_row += rows_count;
+
+        if (upload.next_row < upload.rows_count)
+          continue;
+      }
+
+      issued_uploads.push_back(IssuedUpload {upload.ticket, frame});
+
+      queue.pop_front();
+    }
+
+      //client memory uploads of other textures mustn't be sourced from the pixel buffer
+
+    if (unpack_buffer_bound)
+      state_cache.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+};
+
+TextureUploader::TextureUploader(DeviceStateCache& state_cache, FrameFences& fences, size_t frame_budget)
+  : impl(std::make_unique<Impl>(state_cache, fences, frame_budget))
+{
+}
+
+TextureUploader::~TextureUploader()
+{
+}
+
+size_t TextureUploader::upload
+ (GLenum target,
+  GLuint texture,
+  GLint level,
+  size_t x,
+  size_t y,
+  size_t width,
+  size_t height,
+  GLenum format,
+  GLenum type,
+  size_t pixel_size,
+  const void* data)
+{
+  engine_check_null(data);
+
+  if (!width || !height)
+    return 0;
+
+  Upload upload;
+
+  upload.target = target;
+  upload.texture = texture;
+  upload.level = level;
+  upload.x = x;
+  upload.y = y;
+  upload.width = width;
+  upload.height = height;
+  upload.format = format;
+  upload.type = type;
+  upload.is_compressed = false;
+  upload.row_size = align(width * pixel_size, UNPACK_ALIGNMENT);
+  upload.row_height = 1;
+  upload.rows_count = height;
+  upload.next_row = 0;
+  upload.generate_mips = false;
+
+  const char* pixels = static_cast<const char*>(data);
+
+  upload.data.assign(pixels, pixels + upload.row_size * height);
+
+  return impl->push(std::move(upload));
+}
+
+size_t TextureUploader::upload_compressed
+ (GLenum target,
+  GLuint texture,
+  GLint level,
+  size_t x,
+  size_t y,
+  size_t width,
+  size_t height,
+  GLenum internal_format,
+  size_t block_bytes,
+  const void* data)
+{
+  engine_check_null(data);
+
+  if (!width || !height)
+    return 0;
+
+  static constexpr size_t BLOCK_SIZE = media::image::CompressedImage::BLOCK_SIZE;
+
+  Upload upload;
+
+  upload.target = target;
+  upload.texture = texture;
+  upload.level = level;
+  upload.x = x;
+  upload.y = y;
+  upload.width = width;
+  upload.height = height;
+  upload.format = internal_format;
+  upload.type = GL_NONE;
+  upload.is_compressed = true;
+  upload.row_size = (width + BLOCK_SIZE - 1) / BLOCK_SIZE * block_bytes;
+  upload.row_height = BLOCK_SIZE;
+  upload.rows_count = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  upload.next_row = 0;
+  upload.generate_mips = false;
+
+  const char* blocks = static_cast<const char*>(data);
+
+  upload.data.assign(blocks, blocks + upload.row_size * upload.rows_count);
+
+  return impl->push(std::move(upload));
+}
+
+size_t TextureUploader::generate_mips(GLenum target, GLuint texture)
+{
+  Upload upload;
+
+  upload.target = target;
+  upload.texture = texture;
+  upload.level = 0;
+  upload.x = upload.y = upload.width = upload.height = 0;
+  upload.format = upload.type = GL_NONE;
+  upload.is_compressed = false;
+  upload.row_size = upload.row_height = upload.rows_count = upload.next_row = 0;
+  upload.generate_mips = true;
+
+  return impl->push(std::move(upload));
+}
+
+bool TextureUploader::is_completed(size_t ticket)
+{
+  return impl->is_completed(ticket);
+}
+
+void TextureUploader::flush(GLuint texture)
+{
+  impl->flush(texture, 0, 0, 0, 0, 0);
+}
+
+void TextureUploader::flush(GLuint texture, GLint level, size_t x, size_t y, size_t width, size_t height)
+{
+  impl->flush(texture, level, x, y, width, height);
+}
+
+void TextureUploader::on_texture_deleted(GLuint texture)
+{
+  auto& queue = impl->queue;
+
+  queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const Upload& upload) { return upload.texture == texture; }), queue.end());
+}
+
+void TextureUploader::update()
+{
+  impl->update();
+}
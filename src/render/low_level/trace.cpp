@@ -0,0 +1,1673 @@
+#include "shared.h"
+
+#include <cstdio>
+#include <tuple>
+#include <utility>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+///
+/// Constants
+///
+
+static const char TRACE_SIGNATURE[4] = {'E', 'T', 'R', 'C'}; //trace file signature
+static constexpr uint32_t TRACE_VERSION = 2; //trace file format version
+static constexpr size_t TRACE_FLUSH_SIZE = 4 * 1024 * 1024; //size of recording buffer which causes flush to file
+static constexpr size_t TRACE_UNPACK_ALIGNMENT = 4; //default GL_UNPACK_ALIGNMENT
+
+///
+/// Trace format:
+///   header: signature, version, number of commands, commands names (for command ids resolving)
+///   command: uint16 command id, uint32 arguments size, arguments
+///   scalar arguments are stored as is, pointer arguments (offsets) as uint64, arrays as uint32 size + data
+///   frames are terminated with Command_FrameEnd
+///   data written to a mapped buffer range is recorded with the unmap command
+///
+
+/// Traced commands list:
+///   GENERIC(name, argument kinds...) - scalar arguments, recorded and replayed automatically
+///   CUSTOM(name) - command with pointer arguments or results, recorded and replayed by dedicated functions
+#define TRACE_COMMANDS(GENERIC, CUSTOM) \
+  GENERIC(glActiveTexture, Arg_Value) \
+  GENERIC(glBindBufferRange, Arg_Value, Arg_Value, Arg_Buffer, Arg_Value, Arg_Value) \
+  GENERIC(glBindTexture, Arg_Value, Arg_Texture) \
+  GENERIC(glBindFramebuffer, Arg_Value, Arg_FrameBuffer) \
+  GENERIC(glBindRenderbuffer, Arg_Value, Arg_RenderBuffer) \
+  GENERIC(glBindVertexArray, Arg_VertexArray) \
+  GENERIC(glAttachShader, Arg_Program, Arg_Shader) \
+  GENERIC(glDetachShader, Arg_Program, Arg_Shader) \
+  GENERIC(glCompileShader, Arg_Shader) \
+  GENERIC(glLinkProgram, Arg_Program) \
+  GENERIC(glDeleteShader, Arg_Shader) \
+  GENERIC(glDeleteProgram, Arg_Program) \
+  GENERIC(glUniformBlockBinding, Arg_Program, Arg_Value, Arg_Value) \
+  GENERIC(glEnable, Arg_Value) \
+  GENERIC(glDisable, Arg_Value) \
+  GENERIC(glCullFace, Arg_Value) \
+  GENERIC(glDepthFunc, Arg_Value) \
+  GENERIC(glDepthMask, Arg_Value) \
+  GENERIC(glBlendFunc, Arg_Value, Arg_Value) \
+  GENERIC(glClearColor, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glClear, Arg_Value) \
+  GENERIC(glViewport, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glViewportIndexedf, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glScissor, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glDrawBuffer, Arg_Value) \
+  GENERIC(glUniform1i, Arg_UniformLocation, Arg_Value) \
+  GENERIC(glEnableVertexAttribArray, Arg_AttributeLocation) \
+  GENERIC(glDisableVertexAttribArray, Arg_AttributeLocation) \
+  GENERIC(glVertexAttribPointer, Arg_AttributeLocation, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glVertexAttribDivisor, Arg_AttributeLocation, Arg_Value) \
+  GENERIC(glDrawElements, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glDrawElementsInstanced, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glMultiDrawElementsIndirect, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glTexParameteri, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glGenerateMipmap, Arg_Value) \
+  GENERIC(glFramebufferTexture, Arg_Value, Arg_Value, Arg_Texture, Arg_Value) \
+  GENERIC(glFramebufferTexture2D, Arg_Value, Arg_Value, Arg_Value, Arg_Texture, Arg_Value) \
+  GENERIC(glFramebufferTextureLayer, Arg_Value, Arg_Value, Arg_Texture, Arg_Value, Arg_Value) \
+  GENERIC(glFramebufferRenderbuffer, Arg_Value, Arg_Value, Arg_Value, Arg_RenderBuffer) \
+  GENERIC(glBlitFramebuffer, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glRenderbufferStorage, Arg_Value, Arg_Value, Arg_Value, Arg_Value) \
+  GENERIC(glBeginQuery, Arg_Value, Arg_Query) \
+  GENERIC(glEndQuery, Arg_Value) \
+  CUSTOM(glUseProgram) \
+  CUSTOM(glBindBuffer) \
+  CUSTOM(glGenBuffers) \
+  CUSTOM(glGenTextures) \
+  CUSTOM(glGenFramebuffers) \
+  CUSTOM(glGenRenderbuffers) \
+  CUSTOM(glGenVertexArrays) \
+  CUSTOM(glGenQueries) \
+  CUSTOM(glDeleteBuffers) \
+  CUSTOM(glDeleteTextures) \
+  CUSTOM(glDeleteFramebuffers) \
+  CUSTOM(glDeleteRenderbuffers) \
+  CUSTOM(glDeleteVertexArrays) \
+  CUSTOM(glDeleteQueries) \
+  CUSTOM(glCreateShader) \
+  CUSTOM(glCreateProgram) \
+  CUSTOM(glShaderSource) \
+  CUSTOM(glGetUniformLocation) \
+  CUSTOM(glGetAttribLocation) \
+  CUSTOM(glBufferData) \
+  CUSTOM(glBufferSubData) \
+  CUSTOM(glMapBufferRange) \
+  CUSTOM(glUnmapBuffer) \
+  CUSTOM(glTexImage2D) \
+  CUSTOM(glTexSubImage2D) \
+  CUSTOM(glTexImage3D) \
+  CUSTOM(glCompressedTexImage2D) \
+  CUSTOM(glCompressedTexSubImage2D) \
+  CUSTOM(glUniform1iv) \
+  CUSTOM(glUniform1fv) \
+  CUSTOM(glUniform2fv) \
+  CUSTOM(glUniform3fv) \
+  CUSTOM(glUniform4fv) \
+  CUSTOM(glUniformMatrix4fv) \
+  CUSTOM(glDrawBuffers) \
+  CUSTOM(glFenceSync) \
+  CUSTOM(glClientWaitSync) \
+  CUSTOM(glDeleteSync)
+
+namespace
+{
+
+/// Command identifiers
+enum Command
+{
+  Command_FrameEnd,
+
+#define TRACE_COMMAND_ID(NAME, ...) Command_##NAME,
+  TRACE_COMMANDS(TRACE_COMMAND_ID, TRACE_COMMAND_ID)
+#undef TRACE_COMMAND_ID
+
+  Command_Num
+};
+
+/// Command names
+const char* COMMAND_NAMES[] = {
+  "FrameEnd",
+
+#define TRACE_COMMAND_NAME(NAME, ...) #NAME,
+  TRACE_COMMANDS(TRACE_COMMAND_NAME, TRACE_COMMAND_NAME)
+#undef TRACE_COMMAND_NAME
+};
+
+static_assert(sizeof(COMMAND_NAMES) / sizeof(*COMMAND_NAMES) == Command_Num, "Wrong command names count");
+
+/// Argument kind (used for objects names remapping during replay)
+enum ArgKind
+{
+  Arg_Value, //plain value
+  Arg_Buffer, //buffer object
+  Arg_Texture, //texture object
+  Arg_FrameBuffer, //frame buffer object
+  Arg_RenderBuffer, //render buffer object
+  Arg_VertexArray, //vertex array object
+  Arg_Query, //query object
+  Arg_Shader, //shader object
+  Arg_Program, //program object
+  Arg_UniformLocation, //uniform location of the current program
+  Arg_AttributeLocation, //attribute location of the current program
+
+  Arg_Num
+};
+
+/// Original driver entry point of a traced command
+template <Command Id, class Fn> struct TracedFunction
+{
+  static Fn original;
+};
+
+template <Command Id, class Fn> Fn TracedFunction<Id, Fn>::original = nullptr;
+
+#define TRACE_ORIGINAL(NAME) TracedFunction<Command_##NAME, decltype(glad_##NAME)>::original
+
+///
+/// Recording
+///
+
+/// Mapped buffer range (data, size)
+typedef std::pair<void*, size_t> MappedRange;
+
+/// Trace writer
+class TraceWriter
+{
+  public:
+    TraceWriter(const char* file_name)
+      : file(fopen(file_name, "wb"))
+      , command_offset()
+      , unpack_buffer()
+    {
+      if (!file)
+        throw Exception::format("Can't create trace file '%s'", file_name);
+
+      buffer.reserve(TRACE_FLUSH_SIZE);
+
+        //write header
+
+      write_bytes(TRACE_SIGNATURE, sizeof(TRACE_SIGNATURE));
+      write(TRACE_VERSION);
+      write(static_cast<uint32_t>(Command_Num));
+
+      for (const char* name : COMMAND_NAMES)
+        write_string(name, strlen(name));
+    }
+
+    ~TraceWriter()
+    {
+      flush();
+      fclose(file);
+    }
+
+    /// Current writer
+    static TraceWriter*& instance()
+    {
+      static TraceWriter* writer = nullptr;
+      return writer;
+    }
+
+    /// Commands
+    void begin_command(Command id)
+    {
+      write(static_cast<uint16_t>(id));
+
+      command_offset = buffer.size();
+
+      write(static_cast<uint32_t>(0));
+    }
+
+    void end_command()
+    {
+      uint32_t size = static_cast<uint32_t>(buffer.size() - command_offset - sizeof(uint32_t));
+
+      memcpy(&buffer[command_offset], &size, sizeof(size));
+
+      if (buffer.size() >= TRACE_FLUSH_SIZE)
+        flush();
+    }
+
+    /// Flush recorded commands to file
+    void flush()
+    {
+      if (buffer.empty())
+        return;
+
+      fwrite(buffer.data(), 1, buffer.size(), file);
+      fflush(file);
+
+      buffer.clear();
+    }
+
+    /// Arguments
+    template <class T> void write(T value)
+    {
+      static_assert(std::is_arithmetic<T>::value, "Only scalar arguments are supported");
+
+      write_bytes(&value, sizeof(value));
+    }
+
+    void write(const void* pointer)
+    {
+      write(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer)));
+    }
+
+    void write_array(const void* data, size_t size)
+    {
+      write(static_cast<uint32_t>(data ? size : 0));
+
+      if (data)
+        write_bytes(data, size);
+    }
+
+    void write_string(const char* string, size_t length)
+    {
+      write_array(string, length);
+    }
+
+    /// Pixels of texture commands are offsets in the unpack buffer while it's bound
+    void write_pixels(const void* pixels, size_t size)
+    {
+      write_array(unpack_buffer ? nullptr : pixels, size);
+      write(unpack_buffer ? pixels : nullptr);
+    }
+
+    /// Unpack buffer binding tracking
+    void set_unpack_buffer(GLuint buffer) { unpack_buffer = buffer; }
+
+    /// Mapped buffer ranges tracking (data is recorded on unmap)
+    void set_mapped_range(GLenum target, void* data, size_t size) { mapped_ranges[target] = MappedRange(data, size); }
+
+    MappedRange take_mapped_range(GLenum target)
+    {
+      auto it = mapped_ranges.find(target);
+
+      if (it == mapped_ranges.end())
+        return MappedRange(nullptr, 0);
+
+      MappedRange range = it->second;
+
+      mapped_ranges.erase(it);
+
+      return range;
+    }
+
+  private:
+    void write_bytes(const void* data, size_t size)
+    {
+      const char* bytes = static_cast<const char*>(data);
+
+      buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+  private:
+    FILE* file; //trace file
+    std::vector<char> buffer; //recording buffer
+    size_t command_offset; //offset of the current command size field
+    GLuint unpack_buffer; //GL_PIXEL_UNPACK_BUFFER binding
+    std::unordered_map<GLenum, MappedRange> mapped_ranges; //mapped ranges of buffers (by target)
+};
+
+/// Generic traced command
+template <Command Id, class Fn> struct GenericCall;
+
+template <Command Id, class Ret, class... Args> struct GenericCall<Id, Ret (APIENTRY*)(Args...)>
+{
+  static Ret APIENTRY call(Args... args)
+  {
+    TraceWriter& writer = *TraceWriter::instance();
+
+    writer.begin_command(Id);
+
+    int dummy [] = {0, (writer.write(args), 0)...};
+
+    (void)dummy;
+
+    writer.end_command();
+
+    return TracedFunction<Id, Ret (APIENTRY*)(Args...)>::original(args...);
+  }
+};
+
+/// Helpers for custom commands recording
+size_t get_pixels_size(GLenum format, GLenum type, GLsizei width, GLsizei height)
+{
+  size_t components_count = 1, component_size = 1;
+
+  switch (format)
+  {
+    case GL_RED:
+    case GL_DEPTH_COMPONENT: components_count = 1; break;
+    case GL_RG:              components_count = 2; break;
+    case GL_RGB:             components_count = 3; break;
+    case GL_RGBA:            components_count = 4; break;
+    default:
+      throw Exception::format("Unexpected pixel format 0x%04x in trace recording", format);
+  }
+
+  switch (type)
+  {
+    case GL_UNSIGNED_BYTE:  component_size = 1; break;
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:     component_size = 2; break;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:          component_size = 4; break;
+    default:
+      throw Exception::format("Unexpected pixel type 0x%04x in trace recording", type);
+  }
+
+  size_t row_size = (width * components_count * component_size + TRACE_UNPACK_ALIGNMENT - 1) / TRACE_UNPACK_ALIGNMENT * TRACE_UNPACK_ALIGNMENT;
+
+  return row_size * height;
+}
+
+template <Command Id> void APIENTRY record_gen_objects(GLsizei count, GLuint* ids)
+{
+  TracedFunction<Id, PFNGLGENBUFFERSPROC>::original(count, ids);
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Id);
+  writer.write_array(ids, count * sizeof(GLuint));
+  writer.end_command();
+}
+
+template <Command Id> void APIENTRY record_delete_objects(GLsizei count, const GLuint* ids)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Id);
+  writer.write_array(ids, count * sizeof(GLuint));
+  writer.end_command();
+
+  TracedFunction<Id, PFNGLDELETEBUFFERSPROC>::original(count, ids);
+}
+
+template <Command Id, class T, size_t Components> void APIENTRY record_uniform_array(GLint location, GLsizei count, const T* values)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Id);
+  writer.write(location);
+  writer.write_array(values, count * Components * sizeof(T));
+  writer.end_command();
+
+  TracedFunction<Id, void (APIENTRY*)(GLint, GLsizei, const T*)>::original(location, count, values);
+}
+
+void APIENTRY record_bind_buffer(GLenum target, GLuint buffer)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glBindBuffer);
+  writer.write(target);
+  writer.write(buffer);
+  writer.end_command();
+
+  if (target == GL_PIXEL_UNPACK_BUFFER)
+    writer.set_unpack_buffer(buffer);
+
+  TRACE_ORIGINAL(glBindBuffer)(target, buffer);
+}
+
+void APIENTRY record_use_program(GLuint program)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glUseProgram);
+  writer.write(program);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glUseProgram)(program);
+}
+
+GLuint APIENTRY record_create_shader(GLenum type)
+{
+  GLuint shader = TRACE_ORIGINAL(glCreateShader)(type);
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glCreateShader);
+  writer.write(type);
+  writer.write(shader);
+  writer.end_command();
+
+  return shader;
+}
+
+GLuint APIENTRY record_create_program()
+{
+  GLuint program = TRACE_ORIGINAL(glCreateProgram)();
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glCreateProgram);
+  writer.write(program);
+  writer.end_command();
+
+  return program;
+}
+
+void APIENTRY record_shader_source(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+{
+  std::string source;
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    if (lengths && lengths[i] >= 0) source.append(strings[i], lengths[i]);
+    else                            source.append(strings[i]);
+  }
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glShaderSource);
+  writer.write(shader);
+  writer.write_string(source.c_str(), source.size());
+  writer.end_command();
+
+  TRACE_ORIGINAL(glShaderSource)(shader, count, strings, lengths);
+}
+
+template <Command Id> GLint APIENTRY record_get_location(GLuint program, const GLchar* name)
+{
+  GLint location = TracedFunction<Id, PFNGLGETUNIFORMLOCATIONPROC>::original(program, name);
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Id);
+  writer.write(program);
+  writer.write_string(name, strlen(name));
+  writer.write(location);
+  writer.end_command();
+
+  return location;
+}
+
+void APIENTRY record_buffer_data(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glBufferData);
+  writer.write(target);
+  writer.write(static_cast<uint64_t>(size));
+  writer.write_array(data, size);
+  writer.write(usage);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glBufferData)(target, size, data, usage);
+}
+
+void APIENTRY record_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glBufferSubData);
+  writer.write(target);
+  writer.write(static_cast<uint64_t>(offset));
+  writer.write_array(data, size);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glBufferSubData)(target, offset, size, data);
+}
+
+void* APIENTRY record_map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+  void* data = TRACE_ORIGINAL(glMapBufferRange)(target, offset, length, access);
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glMapBufferRange);
+  writer.write(target);
+  writer.write(static_cast<uint64_t>(offset));
+  writer.write(static_cast<uint64_t>(length));
+  writer.write(access);
+  writer.end_command();
+
+  writer.set_mapped_range(target, data, data ? size_t(length) : 0);
+
+  return data;
+}
+
+GLboolean APIENTRY record_unmap_buffer(GLenum target)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+  MappedRange range = writer.take_mapped_range(target);
+
+  writer.begin_command(Command_glUnmapBuffer);
+  writer.write(target);
+  writer.write_array(range.first, range.second);
+  writer.end_command();
+
+  return TRACE_ORIGINAL(glUnmapBuffer)(target);
+}
+
+void APIENTRY record_tex_image_2d(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glTexImage2D);
+  writer.write(target);
+  writer.write(level);
+  writer.write(internal_format);
+  writer.write(width);
+  writer.write(height);
+  writer.write(border);
+  writer.write(format);
+  writer.write(type);
+  writer.write_pixels(pixels, pixels ? get_pixels_size(format, type, width, height) : 0);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glTexImage2D)(target, level, internal_format, width, height, border, format, type, pixels);
+}
+
+void APIENTRY record_tex_sub_image_2d(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glTexSubImage2D);
+  writer.write(target);
+  writer.write(level);
+  writer.write(x);
+  writer.write(y);
+  writer.write(width);
+  writer.write(height);
+  writer.write(format);
+  writer.write(type);
+  writer.write_pixels(pixels, pixels ? get_pixels_size(format, type, width, height) : 0);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glTexSubImage2D)(target, level, x, y, width, height, format, type, pixels);
+}
+
+void APIENTRY record_tex_image_3d(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glTexImage3D);
+  writer.write(target);
+  writer.write(level);
+  writer.write(internal_format);
+  writer.write(width);
+  writer.write(height);
+  writer.write(depth);
+  writer.write(border);
+  writer.write(format);
+  writer.write(type);
+  writer.write_pixels(pixels, pixels ? get_pixels_size(format, type, width, height) * depth : 0);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glTexImage3D)(target, level, internal_format, width, height, depth, border, format, type, pixels);
+}
+
+void APIENTRY record_compressed_tex_image_2d(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height, GLint border, GLsizei image_size, const void* data)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glCompressedTexImage2D);
+  writer.write(target);
+  writer.write(level);
+  writer.write(internal_format);
+  writer.write(width);
+  writer.write(height);
+  writer.write(border);
+  writer.write(image_size);
+  writer.write_pixels(data, data ? image_size : 0);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glCompressedTexImage2D)(target, level, internal_format, width, height, border, image_size, data);
+}
+
+void APIENTRY record_compressed_tex_sub_image_2d(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum internal_format, GLsizei image_size, const void* data)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glCompressedTexSubImage2D);
+  writer.write(target);
+  writer.write(level);
+  writer.write(x);
+  writer.write(y);
+  writer.write(width);
+  writer.write(height);
+  writer.write(internal_format);
+  writer.write(image_size);
+  writer.write_pixels(data, data ? image_size : 0);
+  writer.end_command();
+
+  TRACE_ORIGINAL(glCompressedTexSubImage2D)(target, level, x, y, width, height, internal_format, image_size, data);
+}
+
+void APIENTRY record_uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glUniformMatrix4fv);
+  writer.write(location);
+  writer.write(transpose);
+  writer.write_array(values, count * 16 * sizeof(GLfloat));
+  writer.end_command();
+
+  TRACE_ORIGINAL(glUniformMatrix4fv)(location, count, transpose, values);
+}
+
+void APIENTRY record_draw_buffers(GLsizei count, const GLenum* buffers)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glDrawBuffers);
+  writer.write_array(buffers, count * sizeof(GLenum));
+  writer.end_command();
+
+  TRACE_ORIGINAL(glDrawBuffers)(count, buffers);
+}
+
+GLsync APIENTRY record_fence_sync(GLenum condition, GLbitfield flags)
+{
+  GLsync sync = TRACE_ORIGINAL(glFenceSync)(condition, flags);
+
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glFenceSync);
+  writer.write(condition);
+  writer.write(flags);
+  writer.write(static_cast<const void*>(sync));
+  writer.end_command();
+
+  return sync;
+}
+
+GLenum APIENTRY record_client_wait_sync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glClientWaitSync);
+  writer.write(static_cast<const void*>(sync));
+  writer.write(flags);
+  writer.write(timeout);
+  writer.end_command();
+
+  return TRACE_ORIGINAL(glClientWaitSync)(sync, flags, timeout);
+}
+
+void APIENTRY record_delete_sync(GLsync sync)
+{
+  TraceWriter& writer = *TraceWriter::instance();
+
+  writer.begin_command(Command_glDeleteSync);
+  writer.write(static_cast<const void*>(sync));
+  writer.end_command();
+
+  TRACE_ORIGINAL(glDeleteSync)(sync);
+}
+
+/// Recording entry points
+template <class Fn> void hook(Fn& entry, Fn& original, Fn recorder)
+{
+  original = entry;
+
+  if (entry)
+    entry = recorder;
+}
+
+template <class Fn> void unhook(Fn& entry, Fn& original)
+{
+  if (original)
+    entry = original;
+
+  original = nullptr;
+}
+
+void hook_entries(bool install)
+{
+#define TRACE_HOOK(NAME, RECORDER) \
+  if (install) hook(glad_##NAME, TracedFunction<Command_##NAME, decltype(glad_##NAME)>::original, static_cast<decltype(glad_##NAME)>(RECORDER)); \
+  else         unhook(glad_##NAME, TracedFunction<Command_##NAME, decltype(glad_##NAME)>::original);
+#define TRACE_HOOK_GENERIC(NAME, ...) \
+  if (install) hook(glad_##NAME, TracedFunction<Command_##NAME, decltype(glad_##NAME)>::original, &GenericCall<Command_##NAME, decltype(glad_##NAME)>::call); \
+  else         unhook(glad_##NAME, TracedFunction<Command_##NAME, decltype(glad_##NAME)>::original);
+#define TRACE_HOOK_CUSTOM(NAME, ...)
+
+  TRACE_COMMANDS(TRACE_HOOK_GENERIC, TRACE_HOOK_CUSTOM)
+
+  TRACE_HOOK(glUseProgram, &record_use_program)
+  TRACE_HOOK(glBindBuffer, &record_bind_buffer)
+  TRACE_HOOK(glGenBuffers, &record_gen_objects<Command_glGenBuffers>)
+  TRACE_HOOK(glGenTextures, &record_gen_objects<Command_glGenTextures>)
+  TRACE_HOOK(glGenFramebuffers, &record_gen_objects<Command_glGenFramebuffers>)
+  TRACE_HOOK(glGenRenderbuffers, &record_gen_objects<Command_glGenRenderbuffers>)
+  TRACE_HOOK(glGenVertexArrays, &record_gen_objects<Command_glGenVertexArrays>)
+  TRACE_HOOK(glGenQueries, &record_gen_objects<Command_glGenQueries>)
+  TRACE_HOOK(glDeleteBuffers, &record_delete_objects<Command_glDeleteBuffers>)
+  TRACE_HOOK(glDeleteTextures, &record_delete_objects<Command_glDeleteTextures>)
+  TRACE_HOOK(glDeleteFramebuffers, &record_delete_objects<Command_glDeleteFramebuffers>)
+  TRACE_HOOK(glDeleteRenderbuffers, &record_delete_objects<Command_glDeleteRenderbuffers>)
+  TRACE_HOOK(glDeleteVertexArrays, &record_delete_objects<Command_glDeleteVertexArrays>)
+  TRACE_HOOK(glDeleteQueries, &record_delete_objects<Command_glDeleteQueries>)
+  TRACE_HOOK(glCreateShader, &record_create_shader)
+  TRACE_HOOK(glCreateProgram, &record_create_program)
+  TRACE_HOOK(glShaderSource, &record_shader_source)
+  TRACE_HOOK(glGetUniformLocation, &record_get_location<Command_glGetUniformLocation>)
+  TRACE_HOOK(glGetAttribLocation, &record_get_location<Command_glGetAttribLocation>)
+  TRACE_HOOK(glBufferData, &record_buffer_data)
+  TRACE_HOOK(glBufferSubData, &record_buffer_sub_data)
+  TRACE_HOOK(glMapBufferRange, &record_map_buffer_range)
+  TRACE_HOOK(glUnmapBuffer, &record_unmap_buffer)
+  TRACE_HOOK(glTexImage2D, &record_tex_image_2d)
+  TRACE_HOOK(glTexSubImage2D, &record_tex_sub_image_2d)
+  TRACE_HOOK(glTexImage3D, &record_tex_image_3d)
+  TRACE_HOOK(glCompressedTexImage2D, &record_compressed_tex_image_2d)
+  TRACE_HOOK(glCompressedTexSubImage2D, &record_compressed_tex_sub_image_2d)
+  TRACE_HOOK(glUniform1iv, (&record_uniform_array<Command_glUniform1iv, GLint, 1>))
+  TRACE_HOOK(glUniform1fv, (&record_uniform_array<Command_glUniform1fv, GLfloat, 1>))
+  TRACE_HOOK(glUniform2fv, (&record_uniform_array<Command_glUniform2fv, GLfloat, 2>))
+  TRACE_HOOK(glUniform3fv, (&record_uniform_array<Command_glUniform3fv, GLfloat, 3>))
+  TRACE_HOOK(glUniform4fv, (&record_uniform_array<Command_glUniform4fv, GLfloat, 4>))
+  TRACE_HOOK(glUniformMatrix4fv, &record_uniform_matrix_4fv)
+  TRACE_HOOK(glDrawBuffers, &record_draw_buffers)
+  TRACE_HOOK(glFenceSync, &record_fence_sync)
+  TRACE_HOOK(glClientWaitSync, &record_client_wait_sync)
+  TRACE_HOOK(glDeleteSync, &record_delete_sync)
+
+#undef TRACE_HOOK_CUSTOM
+#undef TRACE_HOOK_GENERIC
+#undef TRACE_HOOK
+}
+
+///
+/// Replaying
+///
+
+/// Trace reader
+class TraceReader
+{
+  public:
+    TraceReader(const char* begin, const char* end)
+      : pos(begin)
+      , end(end)
+    {
+    }
+
+    bool eof() const { return pos >= end; }
+
+    const char* position() const { return pos; }
+
+    void seek(const char* new_pos) { pos = new_pos; }
+
+    template <class T> T read()
+    {
+      T value;
+
+      read_bytes(&value, sizeof(value));
+
+      return value;
+    }
+
+    const void* read_array(uint32_t& size)
+    {
+      size = read<uint32_t>();
+
+      const char* data = pos;
+
+      skip(size);
+
+      return size ? data : nullptr;
+    }
+
+    std::string read_string()
+    {
+      uint32_t size = 0;
+      const char* data = static_cast<const char*>(read_array(size));
+
+      return std::string(data ? data : "", size);
+    }
+
+    void skip(size_t size)
+    {
+      if (size > size_t(end - pos))
+        throw Exception::format("Unexpected end of trace");
+
+      pos += size;
+    }
+
+  private:
+    void read_bytes(void* data, size_t size)
+    {
+      if (size > size_t(end - pos))
+        throw Exception::format("Unexpected end of trace");
+
+      memcpy(data, pos, size);
+
+      pos += size;
+    }
+
+  private:
+    const char* pos; //current position
+    const char* end; //end of trace data
+};
+
+typedef std::unordered_map<uint64_t, GLint> LocationMap;
+typedef std::unordered_map<GLuint, GLuint> ObjectMap;
+typedef std::unordered_map<uint64_t, GLsync> SyncMap;
+typedef std::unordered_map<GLenum, void*> MappedDataMap;
+typedef std::unordered_map<std::string, std::string> StateMap;
+
+/// Trace replaying state
+struct TraceReplayer
+{
+  TraceReader reader; //trace reader
+  ObjectMap objects[Arg_Num]; //recorded object name -> replayed object name
+  LocationMap locations[Arg_Num]; //(recorded program, recorded location) -> replayed location
+  SyncMap syncs; //recorded sync object -> replayed sync object
+  MappedDataMap mapped_data; //mapped buffer ranges (by target)
+  GLuint current_program; //recorded name of the current program
+  GLenum current_texture_unit; //current texture unit
+  StateMap states; //last values of state commands (for redundancy statistics)
+  TraceStatistics* statistics; //statistics (may be null)
+
+  TraceReplayer(const char* begin, const char* end)
+    : reader(begin, end)
+    , current_program()
+    , current_texture_unit(GL_TEXTURE0)
+    , statistics()
+  {
+  }
+
+  /// Objects remapping
+  GLuint map_object(ArgKind kind, GLuint name)
+  {
+    if (!name)
+      return 0;
+
+    auto it = objects[kind].find(name);
+
+    return it != objects[kind].end() ? it->second : name;
+  }
+
+  GLint map_location(ArgKind kind, GLint location)
+  {
+    if (location < 0)
+      return location;
+
+    auto it = locations[kind].find(get_location_key(current_program, location));
+
+    return it != locations[kind].end() ? it->second : location;
+  }
+
+  static uint64_t get_location_key(GLuint program, GLint location)
+  {
+    return static_cast<uint64_t>(program) << 32 | static_cast<uint32_t>(location);
+  }
+
+  /// Arguments reading
+  template <class T> T read_arg(ArgKind kind)
+  {
+    return remap(reader.read<T>(), kind);
+  }
+
+  template <class T> T remap(T value, ArgKind kind)
+  {
+    switch (kind)
+    {
+      case Arg_Value:
+        return value;
+      case Arg_UniformLocation:
+      case Arg_AttributeLocation:
+        return static_cast<T>(map_location(kind, static_cast<GLint>(value)));
+      default:
+        return static_cast<T>(map_object(kind, static_cast<GLuint>(value)));
+    }
+  }
+
+  GLfloat remap(GLfloat value, ArgKind) { return value; }
+
+  /// Replay command
+  void replay(Command id, const char* args_end);
+
+  /// Statistics update for state commands
+  void update_state_statistics(Command id, const char* args_begin, const char* args_end);
+};
+
+template <> const void* TraceReplayer::read_arg<const void*>(ArgKind)
+{
+  return reinterpret_cast<const void*>(static_cast<uintptr_t>(reader.read<uint64_t>()));
+}
+
+/// Generic command replaying
+template <class Fn> struct GenericReplay;
+
+template <class Ret, class... Args> struct GenericReplay<Ret (APIENTRY*)(Args...)>
+{
+  template <size_t... I> static void replay(TraceReplayer& replayer, const ArgKind* kinds, Ret (APIENTRY* fn)(Args...), std::index_sequence<I...>)
+  {
+    std::tuple<Args...> args {replayer.read_arg<Args>(kinds[I])...}; //braced initialization guarantees left-to-right reading
+
+    fn(std::get<I>(args)...);
+  }
+
+  static void replay(TraceReplayer& replayer, const ArgKind* kinds, size_t kinds_count, Ret (APIENTRY* fn)(Args...))
+  {
+    engine_check(kinds_count == sizeof...(Args));
+
+    replay(replayer, kinds, fn, std::index_sequence_for<Args...>());
+  }
+};
+
+void replay_gen_objects(TraceReplayer& replayer, ArgKind kind, PFNGLGENBUFFERSPROC fn)
+{
+  uint32_t size = 0;
+  const GLuint* recorded_ids = static_cast<const GLuint*>(replayer.reader.read_array(size));
+  GLsizei count = static_cast<GLsizei>(size / sizeof(GLuint));
+
+  std::vector<GLuint> ids(count);
+
+  fn(count, ids.data());
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    GLuint recorded_id = 0;
+
+    memcpy(&recorded_id, recorded_ids + i, sizeof(GLuint));
+
+    replayer.objects[kind][recorded_id] = ids[i];
+  }
+}
+
+void replay_delete_objects(TraceReplayer& replayer, ArgKind kind, PFNGLDELETEBUFFERSPROC fn)
+{
+  uint32_t size = 0;
+  const GLuint* recorded_ids = static_cast<const GLuint*>(replayer.reader.read_array(size));
+  GLsizei count = static_cast<GLsizei>(size / sizeof(GLuint));
+
+  std::vector<GLuint> ids(count);
+
+  for (GLsizei i=0; i<count; i++)
+  {
+    GLuint recorded_id = 0;
+
+    memcpy(&recorded_id, recorded_ids + i, sizeof(GLuint));
+
+    ids[i] = replayer.map_object(kind, recorded_id);
+
+    replayer.objects[kind].erase(recorded_id);
+  }
+
+  fn(count, ids.data());
+}
+
+template <class T, class Fn> void replay_uniform_array(TraceReplayer& replayer, Fn fn, size_t components_count)
+{
+  GLint location = replayer.read_arg<GLint>(Arg_UniformLocation);
+  uint32_t size = 0;
+  const void* data = replayer.reader.read_array(size);
+
+  std::vector<T> values(size / sizeof(T));
+
+  memcpy(values.data(), data, values.size() * sizeof(T)); //trace data is not aligned
+
+  fn(location, static_cast<GLsizei>(values.size() / components_count), values.data());
+}
+
+void replay_get_location(TraceReplayer& replayer, ArgKind kind, PFNGLGETUNIFORMLOCATIONPROC fn)
+{
+  GLuint recorded_program = replayer.reader.read<GLuint>();
+  std::string name = replayer.reader.read_string();
+  GLint recorded_location = replayer.reader.read<GLint>();
+  GLint location = fn(replayer.map_object(Arg_Program, recorded_program), name.c_str());
+
+  replayer.locations[kind][TraceReplayer::get_location_key(recorded_program, recorded_location)] = location;
+}
+
+void TraceReplayer::replay(Command id, const char* args_end)
+{
+  switch (id)
+  {
+    case Command_FrameEnd:
+      break;
+
+#define TRACE_REPLAY_GENERIC(NAME, ...) \
+    case Command_##NAME: \
+    { \
+      static const ArgKind kinds [] = {__VA_ARGS__}; \
+      GenericReplay<decltype(glad_##NAME)>::replay(*this, kinds, sizeof(kinds) / sizeof(*kinds), glad_##NAME); \
+      break; \
+    }
+#define TRACE_REPLAY_CUSTOM(NAME)
+
+    TRACE_COMMANDS(TRACE_REPLAY_GENERIC, TRACE_REPLAY_CUSTOM)
+
+#undef TRACE_REPLAY_CUSTOM
+#undef TRACE_REPLAY_GENERIC
+
+    case Command_glUseProgram:
+      current_program = reader.read<GLuint>();
+      glUseProgram(map_object(Arg_Program, current_program));
+      break;
+    case Command_glBindBuffer:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLuint buffer = read_arg<GLuint>(Arg_Buffer);
+
+      glBindBuffer(target, buffer);
+
+      break;
+    }
+    case Command_glGenBuffers:          replay_gen_objects(*this, Arg_Buffer, glad_glGenBuffers); break;
+    case Command_glGenTextures:         replay_gen_objects(*this, Arg_Texture, glad_glGenTextures); break;
+    case Command_glGenFramebuffers:     replay_gen_objects(*this, Arg_FrameBuffer, glad_glGenFramebuffers); break;
+    case Command_glGenRenderbuffers:    replay_gen_objects(*this, Arg_RenderBuffer, glad_glGenRenderbuffers); break;
+    case Command_glGenVertexArrays:     replay_gen_objects(*this, Arg_VertexArray, glad_glGenVertexArrays); break;
+    case Command_glGenQueries:          replay_gen_objects(*this, Arg_Query, glad_glGenQueries); break;
+    case Command_glDeleteBuffers:       replay_delete_objects(*this, Arg_Buffer, glad_glDeleteBuffers); break;
+    case Command_glDeleteTextures:      replay_delete_objects(*this, Arg_Texture, glad_glDeleteTextures); break;
+    case Command_glDeleteFramebuffers:  replay_delete_objects(*this, Arg_FrameBuffer, glad_glDeleteFramebuffers); break;
+    case Command_glDeleteRenderbuffers: replay_delete_objects(*this, Arg_RenderBuffer, glad_glDeleteRenderbuffers); break;
+    case Command_glDeleteVertexArrays:  replay_delete_objects(*this, Arg_VertexArray, glad_glDeleteVertexArrays); break;
+    case Command_glDeleteQueries:       replay_delete_objects(*this, Arg_Query, glad_glDeleteQueries); break;
+    case Command_glCreateShader:
+    {
+      GLenum type = reader.read<GLenum>();
+      GLuint recorded_shader = reader.read<GLuint>();
+
+      objects[Arg_Shader][recorded_shader] = glCreateShader(type);
+
+      break;
+    }
+    case Command_glCreateProgram:
+    {
+      GLuint recorded_program = reader.read<GLuint>();
+
+      objects[Arg_Program][recorded_program] = glCreateProgram();
+
+      break;
+    }
+    case Command_glShaderSource:
+    {
+      GLuint shader = map_object(Arg_Shader, reader.read<GLuint>());
+      std::string source = reader.read_string();
+      const GLchar* sources [] = {source.c_str()};
+      GLint lengths [] = {static_cast<GLint>(source.size())};
+
+      glShaderSource(shader, 1, sources, lengths);
+
+      break;
+    }
+    case Command_glGetUniformLocation:  replay_get_location(*this, Arg_UniformLocation, glad_glGetUniformLocation); break;
+    case Command_glGetAttribLocation:   replay_get_location(*this, Arg_AttributeLocation, glad_glGetAttribLocation); break;
+    case Command_glBufferData:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLsizeiptr size = static_cast<GLsizeiptr>(reader.read<uint64_t>());
+      uint32_t data_size = 0;
+      const void* data = reader.read_array(data_size);
+      GLenum usage = reader.read<GLenum>();
+
+      glBufferData(target, size, data, usage);
+
+      if (statistics)
+        statistics->uploaded_bytes += data_size;
+
+      break;
+    }
+    case Command_glBufferSubData:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLintptr offset = static_cast<GLintptr>(reader.read<uint64_t>());
+      uint32_t size = 0;
+      const void* data = reader.read_array(size);
+
+      glBufferSubData(target, offset, size, data);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glMapBufferRange:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLintptr offset = static_cast<GLintptr>(reader.read<uint64_t>());
+      GLsizeiptr length = static_cast<GLsizeiptr>(reader.read<uint64_t>());
+      GLbitfield access = reader.read<GLbitfield>();
+
+      mapped_data[target] = glMapBufferRange(target, offset, length, access);
+
+      break;
+    }
+    case Command_glUnmapBuffer:
+    {
+      GLenum target = reader.read<GLenum>();
+      uint32_t size = 0;
+      const void* data = reader.read_array(size);
+      void* mapped_range = mapped_data[target];
+
+      if (mapped_range && data)
+        memcpy(mapped_range, data, size);
+
+      mapped_data.erase(target);
+
+      glUnmapBuffer(target);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glTexImage2D:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLint level = reader.read<GLint>();
+      GLint internal_format = reader.read<GLint>();
+      GLsizei width = reader.read<GLsizei>();
+      GLsizei height = reader.read<GLsizei>();
+      GLint border = reader.read<GLint>();
+      GLenum format = reader.read<GLenum>();
+      GLenum type = reader.read<GLenum>();
+      uint32_t size = 0;
+      const void* pixels = reader.read_array(size);
+      const void* unpack_offset = read_arg<const void*>(Arg_Value);
+
+      glTexImage2D(target, level, internal_format, width, height, border, format, type, size ? pixels : unpack_offset);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glTexSubImage2D:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLint level = reader.read<GLint>();
+      GLint x = reader.read<GLint>();
+      GLint y = reader.read<GLint>();
+      GLsizei width = reader.read<GLsizei>();
+      GLsizei height = reader.read<GLsizei>();
+      GLenum format = reader.read<GLenum>();
+      GLenum type = reader.read<GLenum>();
+      uint32_t size = 0;
+      const void* pixels = reader.read_array(size);
+      const void* unpack_offset = read_arg<const void*>(Arg_Value);
+
+      glTexSubImage2D(target, level, x, y, width, height, format, type, size ? pixels : unpack_offset);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glTexImage3D:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLint level = reader.read<GLint>();
+      GLint internal_format = reader.read<GLint>();
+      GLsizei width = reader.read<GLsizei>();
+      GLsizei height = reader.read<GLsizei>();
+      GLsizei depth = reader.read<GLsizei>();
+      GLint border = reader.read<GLint>();
+      GLenum format = reader.read<GLenum>();
+      GLenum type = reader.read<GLenum>();
+      uint32_t size = 0;
+      const void* pixels = reader.read_array(size);
+      const void* unpack_offset = read_arg<const void*>(Arg_Value);
+
+      glTexImage3D(target, level, internal_format, width, height, depth, border, format, type, size ? pixels : unpack_offset);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glCompressedTexImage2D:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLint level = reader.read<GLint>();
+      GLenum internal_format = reader.read<GLenum>();
+      GLsizei width = reader.read<GLsizei>();
+      GLsizei height = reader.read<GLsizei>();
+      GLint border = reader.read<GLint>();
+      GLsizei image_size = reader.read<GLsizei>();
+      uint32_t size = 0;
+      const void* data = reader.read_array(size);
+      const void* unpack_offset = read_arg<const void*>(Arg_Value);
+
+      glCompressedTexImage2D(target, level, internal_format, width, height, border, image_size, size ? data : unpack_offset);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glCompressedTexSubImage2D:
+    {
+      GLenum target = reader.read<GLenum>();
+      GLint level = reader.read<GLint>();
+      GLint x = reader.read<GLint>();
+      GLint y = reader.read<GLint>();
+      GLsizei width = reader.read<GLsizei>();
+      GLsizei height = reader.read<GLsizei>();
+      GLenum internal_format = reader.read<GLenum>();
+      GLsizei image_size = reader.read<GLsizei>();
+      uint32_t size = 0;
+      const void* data = reader.read_array(size);
+      const void* unpack_offset = read_arg<const void*>(Arg_Value);
+
+      glCompressedTexSubImage2D(target, level, x, y, width, height, internal_format, image_size, size ? data : unpack_offset);
+
+      if (statistics)
+        statistics->uploaded_bytes += size;
+
+      break;
+    }
+    case Command_glUniform1iv: replay_uniform_array<GLint>(*this, glad_glUniform1iv, 1); break;
+    case Command_glUniform1fv: replay_uniform_array<GLfloat>(*this, glad_glUniform1fv, 1); break;
+    case Command_glUniform2fv: replay_uniform_array<GLfloat>(*this, glad_glUniform2fv, 2); break;
+    case Command_glUniform3fv: replay_uniform_array<GLfloat>(*this, glad_glUniform3fv, 3); break;
+    case Command_glUniform4fv: replay_uniform_array<GLfloat>(*this, glad_glUniform4fv, 4); break;
+    case Command_glUniformMatrix4fv:
+    {
+      GLint location = read_arg<GLint>(Arg_UniformLocation);
+      GLboolean transpose = reader.read<GLboolean>();
+      uint32_t size = 0;
+      const void* data = reader.read_array(size);
+
+      std::vector<GLfloat> values(size / sizeof(GLfloat));
+
+      memcpy(values.data(), data, values.size() * sizeof(GLfloat));
+
+      glUniformMatrix4fv(location, static_cast<GLsizei>(values.size() / 16), transpose, values.data());
+
+      break;
+    }
+    case Command_glDrawBuffers:
+    {
+      uint32_t size = 0;
+      const void* data = reader.read_array(size);
+
+      std::vector<GLenum> buffers(size / sizeof(GLenum));
+
+      memcpy(buffers.data(), data, buffers.size() * sizeof(GLenum));
+
+      glDrawBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+
+      break;
+    }
+    case Command_glFenceSync:
+    {
+      GLenum condition = reader.read<GLenum>();
+      GLbitfield flags = reader.read<GLbitfield>();
+      uint64_t recorded_sync = reader.read<uint64_t>();
+
+      syncs[recorded_sync] = glFenceSync(condition, flags);
+
+      break;
+    }
+    case Command_glClientWaitSync:
+    {
+      auto it = syncs.find(reader.read<uint64_t>());
+      GLbitfield flags = reader.read<GLbitfield>();
+      GLuint64 timeout = reader.read<GLuint64>();
+
+      if (it != syncs.end())
+        glClientWaitSync(it->second, flags, timeout);
+
+      break;
+    }
+    case Command_glDeleteSync:
+    {
+      auto it = syncs.find(reader.read<uint64_t>());
+
+      if (it != syncs.end())
+      {
+        glDeleteSync(it->second);
+        syncs.erase(it);
+      }
+
+      break;
+    }
+    default:
+      break;
+  }
+
+  reader.seek(args_end);
+}
+
+void TraceReplayer::update_state_statistics(Command id, const char* args_begin, const char* args_end)
+{
+  size_t key_size = 0; //number of leading argument bytes which select the state
+
+  switch (id)
+  {
+    case Command_glActiveTexture:
+      memcpy(&current_texture_unit, args_begin, sizeof(GLenum));
+      break;
+    case Command_glBindBuffer:
+    case Command_glBindTexture:
+    case Command_glBindFramebuffer:
+    case Command_glBindRenderbuffer:
+    case Command_glEnable:
+    case Command_glDisable:
+    case Command_glUniform1i:
+    case Command_glUniform1iv:
+    case Command_glUniform1fv:
+    case Command_glUniform2fv:
+    case Command_glUniform3fv:
+    case Command_glUniform4fv:
+    case Command_glUniformMatrix4fv:
+    case Command_glViewportIndexedf:
+      key_size = sizeof(GLuint);
+      break;
+    case Command_glUseProgram:
+    case Command_glBindVertexArray:
+    case Command_glCullFace:
+    case Command_glDepthFunc:
+    case Command_glDepthMask:
+    case Command_glBlendFunc:
+    case Command_glClearColor:
+    case Command_glViewport:
+    case Command_glScissor:
+    case Command_glDrawBuffer:
+    case Command_glDrawBuffers:
+      break;
+    default:
+      return;
+  }
+
+  statistics->state_commands_count++;
+
+    //build state key & value
+
+  std::string key, value(args_begin + key_size, args_end);
+
+  switch (id)
+  {
+    case Command_glEnable:
+    case Command_glDisable:
+      key = "glEnable";
+      value = id == Command_glEnable ? "1" : "0";
+      break;
+    case Command_glDrawBuffer:
+    case Command_glDrawBuffers:
+      key = "glDrawBuffers";
+      value = COMMAND_NAMES[id] + value;
+      break;
+    case Command_glBindTexture:
+      key = COMMAND_NAMES[id] + std::string(reinterpret_cast<const char*>(&current_texture_unit), sizeof(current_texture_unit));
+      break;
+    case Command_glUniform1i:
+    case Command_glUniform1iv:
+    case Command_glUniform1fv:
+    case Command_glUniform2fv:
+    case Command_glUniform3fv:
+    case Command_glUniform4fv:
+    case Command_glUniformMatrix4fv:
+      key = "glUniform" + std::string(reinterpret_cast<const char*>(&current_program), sizeof(current_program));
+      break;
+    default:
+      key = COMMAND_NAMES[id];
+      break;
+  }
+
+  key.append(args_begin, key_size);
+
+  std::string& last_value = states[key];
+
+  if (last_value == value)
+  {
+    statistics->redundant_state_commands_count++;
+    return;
+  }
+
+  last_value.swap(value);
+}
+
+}
+
+///
+/// TraceRecorder
+///
+
+struct TraceRecorder::Impl
+{
+  TraceWriter writer; //trace writer
+
+  Impl(const char* file_name)
+    : writer(file_name)
+  {
+  }
+};
+
+TraceRecorder::TraceRecorder(const char* file_name)
+{
+  engine_check_null(file_name);
+
+  if (TraceWriter::instance())
+    throw Exception::format("Trace recording has been already started");
+
+  impl = std::make_unique<Impl>(file_name);
+
+  TraceWriter::instance() = &impl->writer;
+
+  hook_entries(true);
+
+  engine_log_info("Trace recording to '%s' has been started", file_name);
+}
+
+TraceRecorder::~TraceRecorder()
+{
+  try
+  {
+    hook_entries(false);
+
+    TraceWriter::instance() = nullptr;
+
+    impl.reset();
+
+    engine_log_info("Trace recording has been finished");
+  }
+  catch (...)
+  {
+    //ignore exceptions in destructors
+  }
+}
+
+void TraceRecorder::end_frame()
+{
+  impl->writer.begin_command(Command_FrameEnd);
+  impl->writer.end_command();
+
+    //flush each frame to keep trace consistent even if application is terminated
+
+  impl->writer.flush();
+}
+
+///
+/// TracePlayer
+///
+
+/// Implementation details of trace player
+struct TracePlayer::Impl
+{
+  DeviceContextPtr context; //device context
+  std::string trace; //trace data
+  std::vector<Command> commands_map; //recorded command id -> command id
+  std::vector<size_t> frames; //offsets of frames beginnings
+  size_t data_offset; //offset of the first command
+  std::unique_ptr<TraceReplayer> replayer; //replaying state
+  size_t next_frame; //index of next frame for sequential replaying
+
+  Impl(const DeviceContextPtr& context, const char* file_name)
+    : context(context)
+    , data_offset()
+    , next_frame()
+  {
+    engine_check_null(file_name);
+
+    load(file_name);
+
+    replayer = std::make_unique<TraceReplayer>(trace.data(), trace.data() + trace.size());
+  }
+
+  void load(const char* file_name)
+  {
+    FILE* file = fopen(file_name, "rb");
+
+    if (!file)
+      throw Exception::format("Trace file '%s' not found", file_name);
+
+    fseek(file, 0, SEEK_END);
+
+    trace.resize(size_t(ftell(file)));
+
+    fseek(file, 0, SEEK_SET);
+
+    size_t read_size = fread(&trace[0], 1, trace.size(), file);
+
+    fclose(file);
+
+    trace.resize(read_size);
+
+      //parse header
+
+    TraceReader reader(trace.data(), trace.data() + trace.size());
+
+    char signature [sizeof(TRACE_SIGNATURE)];
+
+    for (char& c : signature)
+      c = reader.read<char>();
+
+    if (memcmp(signature, TRACE_SIGNATURE, sizeof(TRACE_SIGNATURE)))
+      throw Exception::format("File '%s' is not a trace file", file_name);
+
+    uint32_t version = reader.read<uint32_t>();
+
+    if (version != TRACE_VERSION)
+      throw Exception::format("Trace file '%s' has unsupported version %u (expected %u)", file_name, version, TRACE_VERSION);
+
+    uint32_t commands_count = reader.read<uint32_t>();
+
+    commands_map.resize(commands_count, Command_Num);
+
+    for (uint32_t i=0; i<commands_count; i++)
+    {
+      std::string name = reader.read_string();
+
+      for (size_t j=0; j<Command_Num; j++)
+        if (name == COMMAND_NAMES[j])
+          commands_map[i] = static_cast<Command>(j);
+
+      if (commands_map[i] == Command_Num)
+        engine_log_warning("Trace command '%s' is not supported and will be ignored", name.c_str());
+    }
+
+    data_offset = reader.position() - trace.data();
+
+      //split trace to frames
+
+    frames.push_back(data_offset);
+
+    while (!reader.eof())
+    {
+      uint16_t recorded_id = reader.read<uint16_t>();
+      uint32_t args_size = reader.read<uint32_t>();
+
+      reader.skip(args_size);
+
+      if (recorded_id < commands_count && commands_map[recorded_id] == Command_FrameEnd)
+        frames.push_back(reader.position() - trace.data());
+    }
+
+    frames.pop_back(); //commands after last frame marker don't form a frame
+
+    engine_log_info("Trace '%s' has been loaded: %u bytes, %u frames", file_name, trace.size(), frames.size());
+  }
+
+  void play_frame(size_t frame_index, TraceStatistics* statistics)
+  {
+    engine_check_range(frame_index, frames.size());
+
+    context->make_current();
+
+    TraceReplayer& replayer = *this->replayer;
+    TraceReader& reader = replayer.reader;
+
+    replayer.statistics = statistics;
+
+    reader.seek(trace.data() + frames[frame_index]);
+
+    for (;;)
+    {
+      uint16_t recorded_id = reader.read<uint16_t>();
+      uint32_t args_size = reader.read<uint32_t>();
+      const char* args_begin = reader.position();
+      const char* args_end = args_begin + args_size;
+      Command id = recorded_id < commands_map.size() ? commands_map[recorded_id] : Command_Num;
+
+      if (id == Command_FrameEnd)
+        break;
+
+      replayer.replay(id, args_end);
+
+      if (statistics)
+      {
+        statistics->commands_count++;
+
+        if (id == Command_glDrawElements || id == Command_glDrawElementsInstanced || id == Command_glMultiDrawElementsIndirect)
+          statistics->draw_calls_count++;
+
+        replayer.update_state_statistics(id, args_begin, args_end);
+      }
+    }
+
+    replayer.statistics = nullptr;
+
+    next_frame = frame_index + 1;
+
+    context->check_errors();
+  }
+};
+
+namespace
+{
+
+/// Replayed commands aren't recorded again
+DeviceOptions get_replay_options(const DeviceOptions& options)
+{
+  DeviceOptions replay_options = options;
+
+  replay_options.trace_file_name.clear();
+
+  return replay_options;
+}
+
+}
+
+TracePlayer::TracePlayer(const Window& window, const DeviceOptions& options, const char* file_name)
+  : impl(std::make_shared<Impl>(std::make_shared<DeviceContextImpl>(window, get_replay_options(options)), file_name))
+{
+}
+
+TracePlayer::TracePlayer(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options, const char* file_name)
+  : impl(std::make_shared<Impl>(std::make_shared<DeviceContextImpl>(frame_buffer_width, frame_buffer_height, get_replay_options(options)), file_name))
+{
+}
+
+size_t TracePlayer::frames_count() const
+{
+  return impl->frames.size();
+}
+
+size_t TracePlayer::next_frame() const
+{
+  return impl->next_frame;
+}
+
+void TracePlayer::play_frame(size_t frame_index, TraceStatistics* statistics)
+{
+  impl->play_frame(frame_index, statistics);
+}
+
+void TracePlayer::play_frames(size_t frames_count, TraceStatistics* statistics)
+{
+  for (size_t i=0; i<frames_count; i++)
+    impl->play_frame(impl->next_frame, statistics);
+}
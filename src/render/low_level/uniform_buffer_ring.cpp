@@ -0,0 +1,231 @@
+#include "shared.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+namespace
+{
+
+/// Range of the ring
+struct RingRange
+{
+  size_t position; //ring position of the range
+  size_t offset; //offset of the range
+  size_t size; //size of the range
+};
+
+typedef std::unordered_map<size_t, RingRange> RingRangeMap;
+
+/// Ranges used by a frame
+struct RingFrame
+{
+  size_t frame; //index of the frame
+  size_t begin; //lowest ring position of ranges which are used by the frame
+};
+
+size_t hash_data(const void* data, size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  size_t hash = 2166136261u;
+
+  for (size_t i=0; i<size; i++)
+    hash = (hash ^ bytes[i]) * 16777619u;
+
+  return hash;
+}
+
+}
+
+/// Implementation details of uniform buffer ring
+struct UniformBufferRing::Impl
+{
+  DeviceStateCache& state_cache; //driver state cache
+  FrameFences& fences; //per-frame fences
+  GLuint buffer_id; //uniform buffer object
+  size_t capacity; //size of the buffer
+  size_t alignment; //alignment of ranges offsets
+  size_t head; //ring position of the next write (grows monotonically, offset in the buffer is head % capacity)
+  std::deque<RingFrame> frames; //frames which ranges may still be used by the GPU
+  std::vector<char> shadow_data; //copy of the buffer content for data reuse checks
+  RingRangeMap ranges; //ranges written since the last wrap (by data hash)
+
+  Impl(DeviceStateCache& state_cache, FrameFences& fences, size_t capacity, size_t alignment)
+    : state_cache(state_cache)
+    , fences(fences)
+    , buffer_id()
+    , capacity(capacity)
+    , alignment(alignment ? alignment : 1)
+    , head()
+    , shadow_data(capacity)
+  {
+    glGenBuffers(1, &buffer_id);
+
+    if (!buffer_id)
+      throw Exception::format("Can't create uniform buffer");
+
+    state_cache.bind_buffer(GL_UNIFORM_BUFFER, buffer_id);
+
+    glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+  }
+
+  ~Impl()
+  {
+    try
+    {
+      glDeleteBuffers(1, &buffer_id);
+
+      state_cache.on_buffer_deleted(buffer_id);
+    }
+    catch (...)
+    {
+      //ignore exceptions in destructors
+    }
+  }
+
+  /// Ring position before which ranges aren't used by the GPU
+  size_t tail() const
+  {
+    size_t position = head;
+
+    for (const RingFrame& frame : frames)
+      position = std::min(position, frame.begin);
+
+    return position;
+  }
+
+  /// Release ranges of the frame which holds the oldest ranges; the GPU is waited only if the frame hasn't been completed yet
+  void release_frame(size_t current_frame)
+  {
+    size_t oldest_frame = std::min_element(frames.begin(), frames.end(), [](const RingFrame& a, const RingFrame& b) {
+      return a.begin < b.begin;
+    })->frame;
+
+    if (oldest_frame == current_frame)
+    {
+        //ranges of the current frame alone exceed the ring, so its storage is orphaned instead of waiting
+
+      glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+
+      frames.clear();
+      ranges.clear();
+
+      return;
+    }
+
+    if (!fences.is_frame_completed(oldest_frame))
+      fences.wait_frame(oldest_frame);
+
+      //frames are completed in order
+
+    while (!frames.empty() && frames.front().frame <= oldest_frame)
+      frames.pop_front();
+  }
+
+  /// Mark range as used by the current frame
+  void use_range(const RingRange& range, size_t current_frame)
+  {
+    if (!frames.empty() && frames.back().frame == current_frame)
+    {
+      frames.back().begin = std::min(frames.back().begin, range.position);
+      return;
+    }
+
+      //forget frames which have been completed by the GPU on the first use of the ring in a frame
+
+    while (!frames.empty() && fences.is_frame_completed(frames.front().frame))
+      frames.pop_front();
+
+    frames.push_back(RingFrame {current_frame, range.position});
+  }
+
+  RingRange write(const void* data, size_t size)
+  {
+    size_t current_frame = fences.current_frame();
+
+      //reuse identical data which has been written since the last wrap
+
+    size_t hash = hash_data(data, size);
+    auto it = ranges.find(hash);
+
+    if (it != ranges.end() && it->second.size == size && !memcmp(&shadow_data[it->second.offset], data, size))
+    {
+      use_range(it->second, current_frame);
+
+      return it->second;
+    }
+
+      //allocate new range; ranges which don't fit to the end of the buffer are moved to the start of the next lap
+
+    size_t position = (head + alignment - 1) / alignment * alignment;
+
+    if (position % capacity + size > capacity)
+    {
+      position = (position / capacity + 1) * capacity;
+
+      ranges.clear();
+    }
+
+    state_cache.bind_buffer(GL_UNIFORM_BUFFER, buffer_id);
+
+      //ranges of the previous lap are overwritten only after the GPU has completed frames which used them
+
+    head = position;
+
+    while (!frames.empty() && position + size > tail() + capacity)
+      release_frame(current_frame);
+
+    RingRange range = {position, position % capacity, size};
+
+    memcpy(&shadow_data[range.offset], data, size);
+
+      //the range isn't used by pending draws, so it is mapped without synchronization with the GPU;
+      //data is rewritten if mapping failed or mapped data has been lost by the driver
+
+    void* mapped_data = glMapBufferRange(GL_UNIFORM_BUFFER, range.offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+    if (mapped_data)
+      memcpy(mapped_data, data, size);
+
+    if (!mapped_data || !glUnmapBuffer(GL_UNIFORM_BUFFER))
+      glBufferSubData(GL_UNIFORM_BUFFER, range.offset, size, data);
+
+    head = position + size;
+
+    use_range(range, current_frame);
+
+    ranges[hash] = range;
+
+    return range;
+  }
+};
+
+UniformBufferRing::UniformBufferRing(DeviceStateCache& state_cache, FrameFences& fences, size_t capacity, size_t alignment)
+  : impl(std::make_unique<Impl>(state_cache, fences, capacity, alignment))
+{
+}
+
+UniformBufferRing::~UniformBufferRing()
+{
+}
+
+void UniformBufferRing::bind(GLuint binding, const void* data, size_t size)
+{
+  engine_check_null(data);
+
+  if (size > impl->capacity)
+    throw Exception::format("Uniform block size %u exceeds uniform buffer ring capacity %u", (unsigned int)size, (unsigned int)impl->capacity);
+
+  RingRange range = impl->write(data, size);
+
+  impl->state_cache.bind_uniform_buffer_range(binding, impl->buffer_id, range.offset, range.size);
+}
+
+size_t UniformBufferRing::capacity() const
+{
+  return impl->capacity;
+}
@@ -0,0 +1,257 @@
+#include "shared.h"
+
+#include <unordered_map>
+
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+#if defined (_MSC_VER) || defined (__APPLE_CC__)
+  #define engine_offsetof(X,Y) offsetof(X,Y)
+#else
+  #define engine_offsetof(X,Y) (reinterpret_cast<size_t> (&(static_cast<X*> (0)->*(&X::Y))))
+#endif
+
+namespace
+{
+
+/// Constants
+static constexpr GLint INSTANCE_TRANSFORM_COLUMNS = 4; //number of attribute locations of a mat4 instance attribute
+
+/// Vertex array object key
+struct VertexArrayKey
+{
+  GLint attribute_locations[VertexArrayCache::ATTRIBUTES_COUNT]; //locations of program attributes
+  VertexFormat vertex_format; //vertex buffer layout
+  GLuint vertex_buffer; //vertex buffer object
+  GLuint index_buffer; //index buffer object
+  size_t base_vertex; //base vertex offset
+
+  bool operator == (const VertexArrayKey& key) const
+  {
+    return vertex_buffer == key.vertex_buffer && index_buffer == key.index_buffer && base_vertex == key.base_vertex && vertex_format == key.vertex_format &&
+      std::equal(attribute_locations, attribute_locations + VertexArrayCache::ATTRIBUTES_COUNT, key.attribute_locations);
+  }
+};
+
+struct VertexArrayKeyHasher
+{
+  size_t operator () (const VertexArrayKey& key) const
+  {
+    size_t hash = std::hash<size_t>()(key.base_vertex);
+
+    auto combine = [&](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+    combine(key.vertex_format);
+    combine(key.vertex_buffer);
+    combine(key.index_buffer);
+
+    for (GLint location : key.attribute_locations)
+      combine(static_cast<size_t>(location));
+
+    return hash;
+  }
+};
+
+typedef std::unordered_map<VertexArrayKey, GLuint, VertexArrayKeyHasher> VertexArrayMap;
+
+void bind_vertex_attrib(GLint attribute, GLint components_count, GLenum type, bool normalized, size_t stride, size_t offset)
+{
+  if (attribute < 0)
+    return;
+
+  glEnableVertexAttribArray(attribute);
+  glVertexAttribPointer(attribute, components_count, type, normalized ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(stride),
+    reinterpret_cast<void*>(offset));
+}
+
+}
+
+/// Implementation details of vertex array objects cache
+struct VertexArrayCache::Impl
+{
+  DeviceStateCache& state_cache; //driver state cache
+  VertexArrayMap vertex_arrays; //cached vertex array objects
+  GLuint default_vertex_array; //vertex array object for buffers updates outside of draws
+
+  Impl(DeviceStateCache& state_cache)
+    : state_cache(state_cache)
+    , default_vertex_array()
+  {
+    glGenVertexArrays(1, &default_vertex_array);
+
+    if (!default_vertex_array)
+      throw Exception::format("Can't create default vertex array object");
+  }
+
+  ~Impl()
+  {
+    try
+    {
+      state_cache.bind_vertex_array(0);
+
+      for (auto& entry : vertex_arrays)
+        glDeleteVertexArrays(1, &entry.second);
+
+      glDeleteVertexArrays(1, &default_vertex_array);
+    }
+    catch (...)
+    {
+      //ignore exceptions in destructors
+    }
+  }
+
+  GLuint create(const VertexArrayKey& key)
+  {
+    GLuint id = 0;
+
+    glGenVertexArrays(1, &id);
+
+    if (!id)
+      throw Exception::format("Can't create vertex array object");
+
+    state_cache.bind_vertex_array(id);
+    state_cache.bind_buffer(GL_ARRAY_BUFFER, key.vertex_buffer);
+    state_cache.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, key.index_buffer);
+
+      //big simplification here due to fixed vertex layouts; packed attributes are expanded to floats by vertex fetch
+
+    const GLint* locations = key.attribute_locations;
+
+    switch (key.vertex_format)
+    {
+      case VertexFormat_Float:
+      {
+        size_t vb_offset = key.base_vertex * sizeof(Vertex);
+
+        bind_vertex_attrib(locations[Attribute_Position], 3, GL_FLOAT, false, sizeof(Vertex), vb_offset + engine_offsetof(Vertex, position));
+        bind_vertex_attrib(locations[Attribute_Normal], 3, GL_FLOAT, false, sizeof(Vertex), vb_offset + engine_offsetof(Vertex, normal));
+        bind_vertex_attrib(locations[Attribute_Color], 4, GL_FLOAT, false, sizeof(Vertex), vb_offset + engine_offsetof(Vertex, color));
+        bind_vertex_attrib(locations[Attribute_TexCoord], 2, GL_FLOAT, false, sizeof(Vertex), vb_offset + engine_offsetof(Vertex, tex_coord));
+
+        break;
+      }
+      case VertexFormat_Packed:
+      {
+        size_t vb_offset = key.base_vertex * sizeof(PackedVertex);
+
+        bind_vertex_attrib(locations[Attribute_Position], 3, GL_FLOAT, false, sizeof(PackedVertex), vb_offset + engine_offsetof(PackedVertex, position));
+        bind_vertex_attrib(locations[Attribute_Normal], 4, GL_INT_2_10_10_10_REV, true, sizeof(PackedVertex), vb_offset + engine_offsetof(PackedVertex, normal));
+        bind_vertex_attrib(locations[Attribute_Color], 4, GL_UNSIGNED_BYTE, true, sizeof(PackedVertex), vb_offset + engine_offsetof(PackedVertex, color));
+        bind_vertex_attrib(locations[Attribute_TexCoord], 2, GL_HALF_FLOAT, false, sizeof(PackedVertex), vb_offset + engine_offsetof(PackedVertex, tex_coord));
+
+        break;
+      }
+      case VertexFormat_Position:
+        bind_vertex_attrib(locations[Attribute_Position], 3, GL_FLOAT, false, sizeof(math::vec3f), key.base_vertex * sizeof(math::vec3f));
+        break;
+      default:
+        throw Exception::format("Unexpected vertex format %d", key.vertex_format);
+    }
+
+      //instance stream pointers are set before each instanced draw
+
+    GLint instance_location = key.attribute_locations[Attribute_InstanceTransform];
+
+    if (instance_location >= 0)
+    {
+      for (GLint i=0; i<INSTANCE_TRANSFORM_COLUMNS; i++)
+      {
+        glEnableVertexAttribArray(instance_location + i);
+        glVertexAttribDivisor(instance_location + i, 1);
+      }
+    }
+
+    return id;
+  }
+};
+
+VertexArrayCache::VertexArrayCache(DeviceStateCache& state_cache)
+  : impl(std::make_unique<Impl>(state_cache))
+{
+  bind_default();
+}
+
+VertexArrayCache::~VertexArrayCache()
+{
+}
+
+void VertexArrayCache::bind(const GLint* attribute_locations, VertexFormat vertex_format, GLuint vertex_buffer, GLuint index_buffer, size_t base_vertex)
+{
+  engine_check_null(attribute_locations);
+
+  VertexArrayKey key;
+
+  std::copy(attribute_locations, attribute_locations + ATTRIBUTES_COUNT, key.attribute_locations);
+
+  key.vertex_format = vertex_format;
+  key.vertex_buffer = vertex_buffer;
+  key.index_buffer = index_buffer;
+  key.base_vertex = base_vertex;
+
+  auto it = impl->vertex_arrays.find(key);
+
+  if (it != impl->vertex_arrays.end())
+  {
+    impl->state_cache.bind_vertex_array(it->second);
+    return;
+  }
+
+  GLuint id = impl->create(key);
+
+  impl->vertex_arrays.insert(std::make_pair(key, id));
+}
+
+void VertexArrayCache::bind_instance_stream(const GLint* attribute_locations, GLuint instance_buffer, size_t offset)
+{
+  engine_check_null(attribute_locations);
+
+  GLint location = attribute_locations[Attribute_InstanceTransform];
+
+  if (location < 0)
+    return;
+
+  impl->state_cache.bind_buffer(GL_ARRAY_BUFFER, instance_buffer);
+
+    //matrices are stored by columns (GLSL mat4 attribute layout)
+
+  for (GLint i=0; i<INSTANCE_TRANSFORM_COLUMNS; i++)
+  {
+    glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, sizeof(math::mat4f),
+      reinterpret_cast<void*>(offset + i * sizeof(math::vec4f)));
+  }
+}
+
+void VertexArrayCache::bind_default()
+{
+  impl->state_cache.bind_vertex_array(impl->default_vertex_array);
+}
+
+void VertexArrayCache::on_buffer_deleted(GLuint buffer)
+{
+  bool need_rebind = false;
+
+  for (auto it=impl->vertex_arrays.begin(); it!=impl->vertex_arrays.end();)
+  {
+    if (it->first.vertex_buffer != buffer && it->first.index_buffer != buffer)
+    {
+      ++it;
+      continue;
+    }
+
+    need_rebind |= impl->state_cache.is_vertex_array_bound(it->second);
+
+    glDeleteVertexArrays(1, &it->second);
+
+    impl->state_cache.on_vertex_array_deleted(it->second);
+
+    it = impl->vertex_arrays.erase(it);
+  }
+
+  if (need_rebind)
+    bind_default();
+}
+
+size_t VertexArrayCache::size() const
+{
+  return impl->vertex_arrays.size();
+}
@@ -1,9 +1,35 @@
 #include "shared.h"
 
+#include <common/thread_pool.h>
+
+#include <exception>
+
 using namespace engine::render::scene;
 using namespace engine::render::low_level;
 using namespace engine::common;
 
+namespace
+{
+
+/// Scheduled draws recording
+struct DrawsRecording
+{
+  Pass pass; //target pass
+  ScenePassContext::DrawsRecorder recorder; //recording function
+  std::exception_ptr exception; //exception thrown by the recorder
+
+  DrawsRecording(const Pass& pass, const ScenePassContext::DrawsRecorder& recorder)
+    : pass(pass)
+    , recorder(recorder)
+  {
+  }
+};
+
+typedef std::vector<DrawsRecording> DrawsRecordingArray;
+typedef std::vector<DrawList> DrawListArray;
+
+}
+
 /// Implementation details of scene pass context
 struct ScenePassContext::Impl
 {
@@ -17,6 +43,8 @@ struct ScenePassContext::Impl
   math::mat4f projection_tm; //projection matrix
   math::mat4f view_projection_tm; //projection * view matrix
   FrameNode root_frame_node; //root frame node
+  DrawsRecordingArray recordings; //draws recordings scheduled for the current viewport
+  DrawListArray draw_lists; //draw lists reused between frames
 
   Impl(ISceneRenderer& renderer)
     : renderer(renderer)
@@ -79,6 +107,16 @@ PropertyMap& ScenePassContext::properties() const
   return impl->renderer.properties();
 }
 
+const SceneRendererOptions& ScenePassContext::options() const
+{
+  return impl->renderer.options();
+}
+
+SceneRendererStatistics& ScenePassContext::statistics() const
+{
+  return impl->renderer.statistics();
+}
+
 TextureList& ScenePassContext::textures() const
 {
   return impl->renderer.textures();
@@ -152,3 +190,54 @@ const math::mat4f& ScenePassContext::view_projection_tm() const
 {
   return impl->view_projection_tm;
 }
+
+void ScenePassContext::record_draws(const low_level::Pass& pass, const DrawsRecorder& recorder)
+{
+  engine_check(recorder);
+
+  impl->recordings.emplace_back(pass, recorder);
+}
+
+void ScenePassContext::flush_draws()
+{
+  DrawsRecordingArray recordings;
+  DrawListArray& draw_lists = impl->draw_lists;
+
+  recordings.swap(impl->recordings);
+
+  size_t count = recordings.size();
+
+  if (!count)
+    return;
+
+  while (draw_lists.size() < count)
+    draw_lists.emplace_back();
+
+    //record draws on worker threads; exceptions are rethrown on the calling thread
+
+  device().thread_pool().parallel_for(count, [&](size_t index)
+  {
+    DrawList& draw_list = draw_lists[index];
+
+    try
+    {
+      draw_list.clear();
+
+      recordings[index].recorder(draw_list);
+    }
+    catch (...)
+    {
+      recordings[index].exception = std::current_exception();
+    }
+  });
+
+    //link packets of draw lists to passes in the scheduling order (packets aren't copied)
+
+  for (size_t i=0; i<count; i++)
+  {
+    if (recordings[i].exception)
+      std::rethrow_exception(recordings[i].exception);
+
+    recordings[i].pass.add_draw_list(draw_lists[i]);
+  }
+}
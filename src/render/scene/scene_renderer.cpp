@@ -113,6 +113,7 @@ struct ScenePassContextImpl: ScenePassContext
 
   using ScenePassContext::bind;
   using ScenePassContext::unbind;
+  using ScenePassContext::flush_draws;
 };
 
 }
@@ -127,10 +128,13 @@ struct SceneRenderer::Impl : ISceneRenderer
   common::PropertyMap shared_properties; //shared propertiess
   ScenePassContextImpl passes_context; //scene rendering context
   PassArray passes; //scene rendering passes
+  SceneRendererOptions renderer_options; //renderer options
+  SceneRendererStatistics renderer_statistics; //renderer statistics
 
-  Impl(const Device& device)
+  Impl(const Device& device, const SceneRendererOptions& options)
     : render_device(device)
     , passes_context(*this)
+    , renderer_options(options)
   {
     passes.reserve(RESERVED_PASSES_COUNT);
   }
@@ -163,13 +167,22 @@ struct SceneRenderer::Impl : ISceneRenderer
   MaterialList& materials() override { return shared_materials; }
   FrameNodeList& frame_nodes() override { return shared_frame_nodes; } 
   Device& device() override { return render_device; }
+  const SceneRendererOptions& options() override { return renderer_options; }
+  SceneRendererStatistics& statistics() override { return renderer_statistics; }
 };
 
-SceneRenderer::SceneRenderer(const Window& window, const DeviceOptions& options)
+SceneRenderer::SceneRenderer(const Window& window, const DeviceOptions& options, const SceneRendererOptions& renderer_options)
 {
   Device device(window, options);
 
-  impl = std::make_shared<Impl>(device);
+  impl = std::make_shared<Impl>(device, renderer_options);
+}
+
+SceneRenderer::SceneRenderer(size_t frame_buffer_width, size_t frame_buffer_height, const DeviceOptions& options, const SceneRendererOptions& renderer_options)
+{
+  Device device(frame_buffer_width, frame_buffer_height, options);
+
+  impl = std::make_shared<Impl>(device, renderer_options);
 }
 
 Device& SceneRenderer::device() const
@@ -177,6 +190,21 @@ Device& SceneRenderer::device() const
   return impl->render_device;
 }
 
+const SceneRendererOptions& SceneRenderer::options() const
+{
+  return impl->renderer_options;
+}
+
+void SceneRenderer::set_options(const SceneRendererOptions& options)
+{
+  impl->renderer_options = options;
+}
+
+const SceneRendererStatistics& SceneRenderer::statistics() const
+{
+  return impl->renderer_statistics;
+}
+
 size_t SceneRenderer::passes_count() const
 {
   return impl->passes.size();
@@ -428,10 +456,18 @@ void SceneRenderer::render(size_t viewports_count, const SceneViewport* viewport
       impl->render_pass(pass_entry);
     }
 
+      //add draws recorded by passes
+
+    context.flush_draws();
+
       //render frame nodes
 
     context.root_frame_node().render(context);
   }
+
+    //notify device about frame completion
+
+  device.end_frame();
 }
 
 PropertyMap& SceneRenderer::properties() const
@@ -32,6 +32,12 @@ class ISceneRenderer
     /// Rendering device
     virtual low_level::Device& device() = 0;
 
+    /// Renderer options
+    virtual const SceneRendererOptions& options() = 0;
+
+    /// Renderer statistics
+    virtual SceneRendererStatistics& statistics() = 0;
+
   protected:
     virtual ~ISceneRenderer() = default;
 };
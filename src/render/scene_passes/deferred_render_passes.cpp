@@ -15,6 +15,8 @@ namespace passes {
 ///
 
 static const char* GBUFFER_PROGRAM_FILE = "media/shaders/phong_gbuffer.glsl";
+static const char* DEPTH_PROGRAM_FILE = "media/shaders/depth.glsl";
+static const int DEPTH_PREPASS_PRIORITY = -1;
 static const char* DEFERRED_LIGHTING_PROGRAM_FILE = "media/shaders/lighting.glsl";
 
 ///
@@ -25,8 +27,8 @@ struct GBufferPass : IScenePass
 {
   public:
     GBufferPass(SceneRenderer& renderer, Device& device)
-      : g_buffer_width(device.window().frame_buffer_width())
-      , g_buffer_height(device.window().frame_buffer_height())
+      : g_buffer_width(device.frame_buffer_width())
+      , g_buffer_height(device.frame_buffer_height())
       , g_buffer_program(device.create_program_from_file(GBUFFER_PROGRAM_FILE))
       , g_buffer_pass(device.create_pass(g_buffer_program))
       , shared_textures(renderer.textures())
@@ -37,6 +39,9 @@ struct GBufferPass : IScenePass
       , specular_texture(device.create_texture2d(g_buffer_width, g_buffer_height, PixelFormat_RGBA8, 1))
       , g_buffer_depth(device.create_render_buffer(g_buffer_width, g_buffer_height, PixelFormat_D24))
       , g_buffer_frame_buffer(device.create_frame_buffer())
+      , depth_program(device.create_program_from_file(DEPTH_PROGRAM_FILE))
+      , depth_pass(device.create_pass(depth_program))
+      , depth_frame_buffer(device.create_frame_buffer())
     {
       engine_log_debug("Creating G-Buffer...");
 
@@ -62,7 +67,18 @@ struct GBufferPass : IScenePass
 
       g_buffer_pass.set_frame_buffer(g_buffer_frame_buffer);
       g_buffer_pass.set_clear_color(0.0f);
-      g_buffer_pass.set_depth_stencil_state(DepthStencilState(true, true, CompareMode_Less));
+      g_buffer_pass.set_samples_counting(true);
+
+        //depth pre-pass shares depth buffer with the G-buffer
+
+      depth_frame_buffer.attach_depth_buffer(g_buffer_depth);
+      depth_frame_buffer.reset_viewport();
+
+      depth_pass.set_frame_buffer(depth_frame_buffer);
+      depth_pass.set_clear_flags(Clear_Depth);
+      depth_pass.set_depth_stencil_state(DepthStencilState(true, true, CompareMode_Less));
+      depth_pass.set_sort_mode(PassSortMode_FrontToBack);
+      depth_pass.set_samples_counting(true);
 
       engine_log_debug("G-Buffer has been created: %ux%u", g_buffer_width, g_buffer_height);
     }
@@ -93,29 +109,80 @@ struct GBufferPass : IScenePass
       if (!root_node)
         return;
 
+        //configure passes
+
+      const SceneRendererOptions& options = context.options();
+
+      configure_passes(options);
+
         //traverse scene
 
       visitor.traverse(*root_node);
 
-        //draw geometry
+        //resolve meshes
+
+      draws.clear();
 
       for (auto& mesh : visitor.meshes())
       {
-        render_mesh(*mesh, context);
+        prepare_mesh(*mesh, context);
       }
 
         //clear data
 
       visitor.reset();
 
+        //draw geometry; draws are recorded on worker threads
+
+      auto recorder = [this](DrawList& draw_list)
+      {
+        for (auto& draw : draws)
+        {
+          draw_list.add_mesh(*draw.mesh, draw.world_tm);
+        }
+      };
+
+      context.record_draws(g_buffer_pass, recorder);
+
+      if (options.depth_prepass)
+        context.record_draws(depth_pass, recorder);
+
         //update frame
 
+      if (options.depth_prepass)
+        frame.add_pass(depth_pass, DEPTH_PREPASS_PRIORITY);
+
       frame.add_pass(g_buffer_pass);
       context.root_frame_node().add_dependency(frame);
+
+        //update statistics
+
+      SceneRendererStatistics& statistics = context.statistics();
+
+      statistics.depth_prepass_samples_count = options.depth_prepass ? depth_pass.samples_passed() : 0;
+      statistics.g_buffer_samples_count = g_buffer_pass.samples_passed();
     }
 
   private:
-    void render_mesh(engine::scene::Mesh& mesh, ScenePassContext& context)
+    void configure_passes(const SceneRendererOptions& options)
+    {
+      if (options.depth_prepass)
+      {
+          //only the nearest fragments pass depth test after the pre-pass, so draws order doesn't affect overdraw
+
+        g_buffer_pass.set_clear_flags(Clear_Color);
+        g_buffer_pass.set_depth_stencil_state(DepthStencilState(true, false, CompareMode_Equal));
+        g_buffer_pass.set_sort_mode(PassSortMode_State);
+      }
+      else
+      {
+        g_buffer_pass.set_clear_flags(Clear_All);
+        g_buffer_pass.set_depth_stencil_state(DepthStencilState(true, true, CompareMode_Less));
+        g_buffer_pass.set_sort_mode(options.front_to_back ? PassSortMode_FrontToBack : PassSortMode_State);
+      }
+    }
+
+    void prepare_mesh(engine::scene::Mesh& mesh, ScenePassContext& context)
     {
         //create mesh data
 
@@ -126,9 +193,9 @@ struct GBufferPass : IScenePass
         renderable_mesh = &mesh.set_user_data(RenderableMesh(mesh, context));
       }
 
-        //add mesh to pass
+        //world transform is cached lazily by the node, so it is resolved here rather than in the recorder
 
-      g_buffer_pass.add_mesh(renderable_mesh->mesh, mesh.world_tm());
+      draws.emplace_back(renderable_mesh->mesh, mesh.world_tm());
     }
 
   private:
@@ -144,7 +211,11 @@ struct GBufferPass : IScenePass
     Texture specular_texture;
     RenderBuffer g_buffer_depth;
     FrameBuffer g_buffer_frame_buffer;
+    Program depth_program;
+    Pass depth_pass;
+    FrameBuffer depth_frame_buffer;
     SceneVisitor visitor;
+    MeshDrawArray draws;
     FrameNode frame;
 };
 
@@ -184,10 +255,12 @@ struct DeferredLightingPass : IScenePass
       if (!g_buffer_frame_initialized)
       {
         g_buffer_frame = context.frame_nodes().get("g_buffer");
+        shadow_maps_frame = context.frame_nodes().get("shadow_maps");
         g_buffer_frame_initialized = true;
       }
 
       frame.add_dependency(g_buffer_frame);
+      frame.add_dependency(shadow_maps_frame);
 
         //traverse scene
 
@@ -232,6 +305,8 @@ struct DeferredLightingPass : IScenePass
       spot_light_angles.clear();
       spot_light_exponents.clear();
       spot_lights_shadow_matrices.clear();
+      spot_light_shadow_rects.clear();
+      spot_light_shadow_layers.clear();
     }
 
   private:
@@ -292,7 +367,7 @@ struct DeferredLightingPass : IScenePass
 
       common::PropertyMap properties = frame.properties();
       
-      static constexpr size_t MAX_LIGHTS_COUNT = 2; //TODO: batch light rendering in several passes
+      static constexpr size_t MAX_LIGHTS_COUNT = 16; //TODO: batch light rendering in several passes
 
       spot_light_positions.reserve(MAX_LIGHTS_COUNT);
       spot_light_directions.reserve(MAX_LIGHTS_COUNT);
@@ -301,6 +376,9 @@ struct DeferredLightingPass : IScenePass
       spot_light_ranges.reserve(MAX_LIGHTS_COUNT);
       spot_light_angles.reserve(MAX_LIGHTS_COUNT);
       spot_light_exponents.reserve(MAX_LIGHTS_COUNT);
+      spot_lights_shadow_matrices.reserve(MAX_LIGHTS_COUNT);
+      spot_light_shadow_rects.reserve(MAX_LIGHTS_COUNT);
+      spot_light_shadow_layers.reserve(MAX_LIGHTS_COUNT);
 
       size_t lights_count = lights.size();
 
@@ -321,20 +399,15 @@ struct DeferredLightingPass : IScenePass
         float angle = math::radian(light->angle()) / 2;
         float exponent = light->exponent();
         Shadow* shadow = light->find_user_data<Shadow>();
-        const math::mat4f& shadow_tm = shadow->shadow_tm;
 
         engine_check(shadow);
-        
-          //TODO: texture arrays binding to shader program
-        deferred_lighting_pass.textures().remove("shadowTexture");
-        deferred_lighting_pass.textures().insert("shadowTexture", shadow->shadow_texture);
 
-        float tex_size_step = 1.0f / shadow->shadow_texture.width();
+          //shadow maps of all lights are packed to the shared atlas ("shadowTexture"), so each light only references its region
 
-        deferred_lighting_pass.properties().set("shadowMapPixelSize", math::vec2f(tex_size_step));
+        const math::mat4f& shadow_tm = shadow->shadow_tm;
+        math::vec4f shadow_rect = shadow->tile.texture_rect();
+        float shadow_layer = (float)shadow->tile.layer();
 
-        frame.add_dependency(shadow->shadow_frame);
-        
         spot_light_positions.push_back(position);
         spot_light_directions.push_back(direction);
         spot_light_colors.push_back(color);
@@ -343,6 +416,8 @@ struct DeferredLightingPass : IScenePass
         spot_light_angles.push_back(angle);
         spot_light_exponents.push_back(exponent);
         spot_lights_shadow_matrices.push_back(shadow_tm);
+        spot_light_shadow_rects.push_back(shadow_rect);
+        spot_light_shadow_layers.push_back(shadow_layer);
       }
 
       for (size_t i=lights.size(); i<MAX_LIGHTS_COUNT; i++)
@@ -355,6 +430,8 @@ struct DeferredLightingPass : IScenePass
         spot_light_angles.push_back(0);
         spot_light_exponents.push_back(1.0f);
         spot_lights_shadow_matrices.push_back(0.0f);
+        spot_light_shadow_rects.push_back(math::vec4f(0.0f, 0.0f, 1.0f, 1.0f));
+        spot_light_shadow_layers.push_back(0.0f);
       }
 
         //bind properties
@@ -367,10 +444,13 @@ struct DeferredLightingPass : IScenePass
       properties.set("spotLightAngles", spot_light_angles);
       properties.set("spotLightExponents", spot_light_exponents);
       properties.set("spotLightShadowMatrices", spot_lights_shadow_matrices);
+      properties.set("spotLightShadowRects", spot_light_shadow_rects);
+      properties.set("spotLightShadowLayers", spot_light_shadow_layers);
     }
 
   private:
     typedef std::vector<math::mat4f> Mat4fArray;
+    typedef std::vector<math::vec4f> Vec4fArray;
     typedef std::vector<math::vec3f> Vec3fArray;
     typedef std::vector<float> FloatArray;
 
@@ -380,6 +460,7 @@ struct DeferredLightingPass : IScenePass
     Primitive plane;
     FrameNode frame;    
     FrameNode g_buffer_frame;
+    FrameNode shadow_maps_frame;
     bool g_buffer_frame_initialized = false;
     SceneVisitor visitor;
     Vec3fArray point_light_positions;
@@ -394,6 +475,8 @@ struct DeferredLightingPass : IScenePass
     FloatArray spot_light_angles;
     FloatArray spot_light_exponents;
     Mat4fArray spot_lights_shadow_matrices;
+    Vec4fArray spot_light_shadow_rects;
+    FloatArray spot_light_shadow_layers;
 };
 
 ///
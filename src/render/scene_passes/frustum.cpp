@@ -0,0 +1,110 @@
+#include "shared.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace engine::render::scene;
+using namespace engine::render::scene::passes;
+using namespace engine::common;
+
+///
+/// BoundBox
+///
+
+BoundBox BoundBox::from_mesh(const media::geometry::Mesh& mesh)
+{
+  BoundBox box;
+  const media::geometry::Vertex* vertices = mesh.vertices_data();
+  size_t vertices_count = mesh.vertices_count();
+
+  if (!vertices_count)
+    return box;
+
+  math::vec3f min = vertices[0].position, max = min;
+
+  for (size_t i=1; i<vertices_count; i++)
+  {
+    const math::vec3f& position = vertices[i].position;
+
+    for (size_t j=0; j<3; j++)
+    {
+      min[j] = std::min(min[j], position[j]);
+      max[j] = std::max(max[j], position[j]);
+    }
+  }
+
+  box.center = (min + max) * 0.5f;
+  box.extent = (max - min) * 0.5f;
+
+  return box;
+}
+
+BoundBox BoundBox::transform(const math::mat4f& tm) const
+{
+  BoundBox box;
+
+  box.center = tm * center;
+
+    //extent of the transformed box is a sum of projections of the transformed axes
+
+  for (size_t i=0; i<3; i++)
+    box.extent[i] = std::fabs(tm[i][0]) * extent[0] + std::fabs(tm[i][1]) * extent[1] + std::fabs(tm[i][2]) * extent[2];
+
+  return box;
+}
+
+void BoundBox::get_corners(math::vec3f (&corners)[8]) const
+{
+  for (size_t i=0; i<8; i++)
+    corners[i] = center + math::vec3f(i & 1 ? extent[0] : -extent[0], i & 2 ? extent[1] : -extent[1], i & 4 ? extent[2] : -extent[2]);
+}
+
+///
+/// Frustum
+///
+
+Frustum::Frustum(const math::mat4f& tm)
+{
+    //clip space point is inside if -w <= x,y,z <= w
+
+  for (size_t i=0; i<3; i++)
+  {
+    planes[i * 2]     = tm[3] + tm[i];
+    planes[i * 2 + 1] = tm[3] - tm[i];
+  }
+}
+
+bool Frustum::intersects(const BoundBox& box) const
+{
+  for (const math::vec4f& plane : planes)
+  {
+    float distance = plane[0] * box.center[0] + plane[1] * box.center[1] + plane[2] * box.center[2] + plane[3];
+    float radius = std::fabs(plane[0]) * box.extent[0] + std::fabs(plane[1]) * box.extent[1] + std::fabs(plane[2]) * box.extent[2];
+
+    if (distance + radius < 0.0f)
+      return false;
+  }
+
+  return true;
+}
+
+bool Frustum::is_outside(const math::vec3f* points, size_t points_count) const
+{
+  for (const math::vec4f& plane : planes)
+  {
+    size_t i = 0;
+
+    for (; i<points_count; i++)
+    {
+      const math::vec3f& point = points[i];
+
+      if (plane[0] * point[0] + plane[1] * point[1] + plane[2] * point[2] + plane[3] >= 0.0f)
+        break;
+    }
+
+    if (i == points_count)
+      return true;
+  }
+
+  return false;
+}
@@ -54,6 +54,7 @@ class ProjectilePass : IScenePass
       if (!g_buffer_frame_initialized)
       {
         g_buffer_frame = context.frame_nodes().get("g_buffer");
+        shadow_maps_frame = context.frame_nodes().get("shadow_maps");
 
         Texture normal_texture = shared_textures.get("normalTexture");
         Texture albedo_texture = shared_textures.get("albedoTexture");
@@ -66,6 +67,7 @@ class ProjectilePass : IScenePass
       }
 
       frame.add_dependency(g_buffer_frame);
+      frame.add_dependency(shadow_maps_frame);
 
         //traverse scene
 
@@ -119,14 +121,16 @@ class ProjectilePass : IScenePass
 
       if (!renderable_projectile)
       {
-        renderable_projectile = &projectile->set_user_data(RenderableProjectile(projectile->image(), shadow->shadow_texture, context.device()));
+        renderable_projectile = &projectile->set_user_data(RenderableProjectile(projectile->image(), context.device()));
       }
 
-        //configure properties
+        //configure properties (the pass references them until rendering, so they are kept by the projectile)
 
-      PropertyMap projectile_properties = renderable_projectile->properties;
+      PropertyMap& projectile_properties = renderable_projectile->properties;
 
       projectile_properties.set("shadowMatrix", shadow->shadow_tm);
+      projectile_properties.set("shadowRect", shadow->tile.texture_rect());
+      projectile_properties.set("shadowLayer", (float)shadow->tile.layer());
       projectile_properties.set("projectileColor", projectile->color() * projectile->intensity());
 
         //render projectile
@@ -143,6 +147,7 @@ class ProjectilePass : IScenePass
     SceneVisitor visitor;
     bool g_buffer_frame_initialized = false;
     FrameNode g_buffer_frame;
+    FrameNode shadow_maps_frame;
 };
 
 struct ProjectilePassComponent : Component
@@ -0,0 +1,313 @@
+#include "shared.h"
+
+#include <algorithm>
+
+using namespace engine::render::scene;
+using namespace engine::render::scene::passes;
+using namespace engine::render::low_level;
+using namespace engine::common;
+
+///
+/// Constants
+///
+
+static constexpr size_t MIN_TILE_SIZE = 128; //minimal size of atlas tile
+
+namespace
+{
+
+/// Free block of the atlas
+struct Block
+{
+  size_t layer; //atlas layer
+  size_t x, y; //offset in the layer
+
+  Block(size_t layer, size_t x, size_t y) : layer(layer), x(x), y(y) {}
+
+  bool operator == (const Block& other) const { return layer == other.layer && x == other.x && y == other.y; }
+};
+
+typedef std::vector<Block> BlockArray;
+
+}
+
+/// Shadow atlas implementation details
+struct ShadowAtlas::Impl
+{
+  Device device; //rendering device
+  size_t layer_size; //size of the layer
+  size_t layers_count; //number of layers
+  Texture texture; //atlas depth texture array
+  std::vector<FrameBuffer> frame_buffers; //frame buffers of the layers
+  FrameBuffer layered_frame_buffer; //frame buffer with all layers attached
+  std::vector<BlockArray> free_blocks; //free blocks of each size (level 0 - whole layer, level N - layer_size >> N)
+
+  Impl(Device& device, size_t layer_size)
+    : device(device)
+    , layer_size(layer_size)
+    , layers_count()
+    , texture(create_texture(device, layer_size, 1))
+    , layered_frame_buffer(device.create_frame_buffer())
+  {
+    size_t levels_count = 1;
+
+    for (size_t size=layer_size; size>MIN_TILE_SIZE; size/=2)
+      levels_count++;
+
+    free_blocks.resize(levels_count);
+
+    grow(1);
+  }
+
+  static Texture create_texture(Device& device, size_t layer_size, size_t layers_count)
+  {
+    Texture texture = device.create_texture2d_array(layer_size, layer_size, layers_count, PixelFormat_D24, 1);
+
+    texture.set_min_filter(TextureFilter_Point);
+
+    return texture;
+  }
+
+  /// Add layers to the atlas; tiles keep their positions, contents of the atlas are lost
+  void grow(size_t new_layers_count)
+  {
+    if (new_layers_count != texture.layers())
+      texture = create_texture(device, layer_size, new_layers_count);
+
+    for (size_t layer=layers_count; layer<new_layers_count; layer++)
+      free_blocks[0].push_back(Block(layer, 0, 0));
+
+    layers_count = new_layers_count;
+
+      //frame buffers reference layers of the old texture, so they are recreated
+
+    frame_buffers.clear();
+    frame_buffers.reserve(layers_count);
+
+    for (size_t layer=0; layer<layers_count; layer++)
+    {
+      FrameBuffer frame_buffer = device.create_frame_buffer();
+
+      frame_buffer.attach_depth_buffer(texture, layer);
+      frame_buffer.set_viewport(Viewport(0, 0, (int)layer_size, (int)layer_size));
+
+      frame_buffers.push_back(frame_buffer);
+    }
+
+    layered_frame_buffer = device.create_frame_buffer();
+
+    layered_frame_buffer.attach_layered_depth_buffer(texture);
+    layered_frame_buffer.set_viewport(Viewport(0, 0, (int)layer_size, (int)layer_size));
+
+    engine_log_debug("Shadow atlas has been resized: %ux%u, %u layers", layer_size, layer_size, layers_count);
+  }
+
+  /// Find level of the block with size not less than requested
+  size_t get_level(size_t size) const
+  {
+    size_t level = 0;
+
+    for (size_t level_size=layer_size; level + 1 < free_blocks.size() && level_size / 2 >= size; level_size/=2)
+      level++;
+
+    return level;
+  }
+
+  /// Allocate block of the level
+  Block allocate(size_t level)
+  {
+      //search for the smallest free block which fits the level
+
+    size_t source_level = level + 1;
+
+    while (source_level > 0 && free_blocks[source_level - 1].empty())
+      source_level--;
+
+    if (!source_level)
+    {
+      grow(layers_count * 2);
+
+      source_level = 1;
+    }
+
+    source_level--;
+
+    Block block = free_blocks[source_level].back();
+
+    free_blocks[source_level].pop_back();
+
+      //split block; the first quadrant is used, others are released to the lower level
+
+    for (; source_level<level; source_level++)
+    {
+      size_t child_size = layer_size >> (source_level + 1);
+
+      free_blocks[source_level + 1].push_back(Block(block.layer, block.x + child_size, block.y));
+      free_blocks[source_level + 1].push_back(Block(block.layer, block.x, block.y + child_size));
+      free_blocks[source_level + 1].push_back(Block(block.layer, block.x + child_size, block.y + child_size));
+    }
+
+    return block;
+  }
+
+  /// Release block of the level; free siblings are merged back into the parent block
+  void release(Block block, size_t level)
+  {
+    for (; level>0; level--)
+    {
+      size_t parent_size = layer_size >> (level - 1), size = parent_size / 2;
+      size_t parent_x = block.x / parent_size * parent_size, parent_y = block.y / parent_size * parent_size;
+      BlockArray& blocks = free_blocks[level];
+      Block siblings [] = {
+        Block(block.layer, parent_x, parent_y),
+        Block(block.layer, parent_x + size, parent_y),
+        Block(block.layer, parent_x, parent_y + size),
+        Block(block.layer, parent_x + size, parent_y + size),
+      };
+
+      size_t free_siblings_count = 0;
+
+      for (const Block& sibling : siblings)
+        if (sibling == block || std::find(blocks.begin(), blocks.end(), sibling) != blocks.end())
+          free_siblings_count++;
+
+      if (free_siblings_count < 4)
+        break;
+
+      for (const Block& sibling : siblings)
+        blocks.erase(std::remove(blocks.begin(), blocks.end(), sibling), blocks.end());
+
+      block = Block(block.layer, parent_x, parent_y);
+    }
+
+    free_blocks[level].push_back(block);
+  }
+};
+
+/// Shadow atlas tile implementation details
+struct ShadowAtlasTile::Impl
+{
+  std::weak_ptr<ShadowAtlas::Impl> atlas; //atlas (tile may outlive the atlas)
+  Block block; //atlas block
+  size_t level; //level of the block
+  size_t size; //size of the block
+  Viewport viewport; //viewport of the tile
+  math::vec4f texture_rect; //normalized texture rectangle
+
+  Impl(const std::shared_ptr<ShadowAtlas::Impl>& atlas, const Block& block, size_t level)
+    : atlas(atlas)
+    , block(block)
+    , level(level)
+    , size(atlas->layer_size >> level)
+    , viewport((int)block.x, (int)block.y, (int)size, (int)size)
+  {
+    float inv_layer_size = 1.0f / atlas->layer_size;
+
+    texture_rect = math::vec4f(block.x * inv_layer_size, block.y * inv_layer_size, size * inv_layer_size, size * inv_layer_size);
+  }
+
+  ~Impl()
+  {
+    try
+    {
+      if (std::shared_ptr<ShadowAtlas::Impl> atlas_impl = atlas.lock())
+        atlas_impl->release(block, level);
+    }
+    catch (...)
+    {
+      //ignore exceptions in destructors
+    }
+  }
+};
+
+///
+/// ShadowAtlasTile
+///
+
+ShadowAtlasTile::ShadowAtlasTile()
+{
+}
+
+ShadowAtlasTile::ShadowAtlasTile(const std::shared_ptr<Impl>& impl)
+  : impl(impl)
+{
+}
+
+bool ShadowAtlasTile::is_allocated() const
+{
+  return impl != nullptr;
+}
+
+size_t ShadowAtlasTile::layer() const
+{
+  engine_check_null(impl);
+
+  return impl->block.layer;
+}
+
+size_t ShadowAtlasTile::size() const
+{
+  engine_check_null(impl);
+
+  return impl->size;
+}
+
+const Viewport& ShadowAtlasTile::viewport() const
+{
+  engine_check_null(impl);
+
+  return impl->viewport;
+}
+
+math::vec4f ShadowAtlasTile::texture_rect() const
+{
+  engine_check_null(impl);
+
+  return impl->texture_rect;
+}
+
+///
+/// ShadowAtlas
+///
+
+ShadowAtlas::ShadowAtlas(Device& device, size_t layer_size)
+{
+  engine_check(layer_size >= MIN_TILE_SIZE && !(layer_size & (layer_size - 1)));
+
+  impl = std::make_shared<Impl>(device, layer_size);
+}
+
+const Texture& ShadowAtlas::texture() const
+{
+  return impl->texture;
+}
+
+size_t ShadowAtlas::layer_size() const
+{
+  return impl->layer_size;
+}
+
+size_t ShadowAtlas::layers_count() const
+{
+  return impl->layers_count;
+}
+
+FrameBuffer& ShadowAtlas::frame_buffer(size_t layer) const
+{
+  engine_check_range(layer, impl->layers_count);
+
+  return impl->frame_buffers[layer];
+}
+
+FrameBuffer& ShadowAtlas::layered_frame_buffer() const
+{
+  return impl->layered_frame_buffer;
+}
+
+ShadowAtlasTile ShadowAtlas::allocate(size_t size)
+{
+  size_t level = impl->get_level(size);
+  Block block = impl->allocate(level);
+
+  return ShadowAtlasTile(std::make_shared<ShadowAtlasTile::Impl>(impl, block, level));
+}
@@ -1,5 +1,10 @@
 #include "shared.h"
 
+#include <common/thread_pool.h>
+
+#include <algorithm>
+#include <climits>
+
 using namespace engine::render;
 using namespace engine::render::low_level;
 using namespace engine::render::scene;
@@ -16,8 +21,95 @@ namespace passes {
 /// Constants
 ///
 
-static const size_t SHADOW_MAP_SIZE = 1024;
+static const size_t MAX_SHADOW_MAP_SIZE = 1024; //resolution of the top tier (lights which cover the screen)
+static const size_t MIN_SHADOW_MAP_SIZE = 128; //resolution of the lowest tier
+static const float SHADOW_TIER_HYSTERESIS = 0.75f; //tier is lowered when projected size drops below this fraction of the lower tier size
+static const size_t SHADOW_ATLAS_LAYER_SIZE = 2048;
+static const FrameId STATIC_CASTER_FRAMES = 16; //number of frames without movement after which caster is considered static
+static const float LIGHT_INSIDE_CASTER_DISTANCE = 0.001f; //caster corner distance to the light below which shadow direction is undefined
+static const size_t MAX_LAYERED_SHADOW_VIEWS = 16; //number of shadow maps rendered by one layered pass (see shadow_layered.glsl)
+static const int LAYERED_SHADOW_PASS_PRIORITY = INT_MAX; //layered passes are rendered after tiles of all shadow maps are cleared
 static const char* SHADOW_PROGRAM_FILE = "media/shaders/shadow.glsl";
+static const char* LAYERED_SHADOW_PROGRAM_FILE = "media/shaders/shadow_layered.glsl";
+
+/// Shadow map update mode
+enum ShadowUpdate
+{
+  ShadowUpdate_None,    //shadow map is up to date
+  ShadowUpdate_All,     //render all casters
+  ShadowUpdate_Dynamic, //copy static casters depth and render dynamic casters
+};
+
+typedef std::vector<size_t> CasterIndexArray;
+
+/// Shadow map of the light in the current frame
+struct ShadowRequest
+{
+  Shadow* shadow; //shadow data
+  Node* light; //light node
+  math::mat4f projection_tm; //light projection
+  math::mat4f view_projection_tm; //light view-projection (resolved before parallel culling, since node caches world_tm lazily)
+  math::vec3f light_position; //world position of the light
+  ShadowUpdate update; //update mode
+  bool is_mandatory; //shadow map has no valid contents, so it is updated regardless of the budget
+  float screen_size; //size of the light frustum projected to the screen (in pixels)
+  size_t size; //shadow map size
+  CasterKeyArray static_keys; //static casters inside the light frustum
+  CasterKeyArray dynamic_keys; //dynamic casters inside the light frustum
+  CasterIndexArray static_casters; //indices of static casters inside the light frustum
+  CasterIndexArray dynamic_casters; //indices of dynamic casters inside the light frustum
+  size_t culled_casters_count; //number of casters outside the light frustum
+};
+
+/// Shadow caster of the current frame
+struct Caster
+{
+  MeshDraw draw; //mesh draw
+  CasterKey key; //caster key
+  BoundBox bounds; //world space bounds
+  bool is_static; //caster hasn't moved for a while
+
+  Caster(const MeshDraw& draw, const CasterKey& key, const BoundBox& bounds, bool is_static)
+    : draw(draw)
+    , key(key)
+    , bounds(bounds)
+    , is_static(is_static)
+  {
+  }
+};
+
+typedef std::vector<Caster> CasterArray;
+
+/// Shadow maps rendered by one layered pass; casters are routed to the tiles by geometry shader
+struct LayeredShadowBatch
+{
+  Pass pass; //layered pass
+  size_t views_count; //number of shadow maps in the current frame
+  Viewport viewports [MAX_LAYERED_SHADOW_VIEWS]; //tiles of the shadow maps
+  std::vector<math::mat4f> view_projection_tms; //view-projection matrices of the shadow maps
+  std::vector<float> layers; //atlas layers of the shadow maps
+  std::vector<uint32_t> casters_masks; //masks of shadow maps affected by each caster of the frame
+  MeshDrawArray draws; //casters with masks packed into transforms
+
+  LayeredShadowBatch(Device& device, const Program& program)
+    : pass(device.create_pass(program))
+    , views_count()
+    , view_projection_tms(MAX_LAYERED_SHADOW_VIEWS, math::mat4f(1.0f))
+    , layers(MAX_LAYERED_SHADOW_VIEWS, 0.0f)
+  {
+      //tiles are cleared by passes of the shadow maps; view transforms are selected per shadow map by geometry shader
+
+    pass.set_clear_flags(Clear_None);
+    pass.set_depth_stencil_state(DepthStencilState(true, true, CompareMode_Less));
+
+    PropertyMap pass_properties = pass.properties();
+
+    pass_properties.set("viewMatrix", math::mat4f(1.0f));
+    pass_properties.set("projectionMatrix", math::mat4f(1.0f));
+  }
+};
+
+typedef std::vector<LayeredShadowBatch> LayeredShadowBatchArray;
 
 /// Shadow map rendering pass
 class ShadowPass : IScenePass
@@ -25,7 +117,31 @@ class ShadowPass : IScenePass
   public:
     ShadowPass(SceneRenderer& renderer)
       : shadow_program(renderer.device().create_program_from_file(SHADOW_PROGRAM_FILE))
+      , layered_shadow_program(renderer.device().create_program_from_file(LAYERED_SHADOW_PROGRAM_FILE))
+      , atlas(renderer.device(), SHADOW_ATLAS_LAYER_SIZE)
+      , atlas_layers_count()
+      , atlas_generation(1)
+      , shared_textures(renderer.textures())
+      , shared_properties(renderer.properties())
+      , shared_frames(renderer.frame_nodes())
     {
+      shared_frames.insert("shadow_maps", frame);
+
+      publish_atlas();
+    }
+
+    ~ShadowPass()
+    {
+      try
+      {
+        shared_textures.remove("shadowTexture");
+        shared_properties.erase("shadowMapPixelSize");
+        shared_frames.remove("shadow_maps");
+      }
+      catch (...)
+      {
+        //ignore exceptions in destructors
+      }
     }
 
     static IScenePass* create(SceneRenderer& renderer, Device&)
@@ -50,76 +166,595 @@ class ShadowPass : IScenePass
 
       visitor.traverse(*root_node);
 
-        //enumerate spot lights and build shadows for them
+        //resolve meshes which are shared by all shadow maps
 
-      for (auto& light : visitor.spot_lights())
+      casters.clear();
+
+      for (auto& mesh : visitor.meshes())
       {
-        render_shadow_map(light, context);
+        prepare_mesh(*mesh, context);
       }
 
-        //enumerate projectiles and build shadows for them
+        //enumerate spot lights and projectiles, cull casters and check which shadow maps are out of date
+
+      requests.clear();
+
+      Frustum receivers_frustum(context.view_projection_tm());
+      const Frustum* receivers = context.options().shadow_receiver_culling ? &receivers_frustum : nullptr;
+
+      for (auto& light : visitor.spot_lights())
+      {
+        add_request(*light, light->projection_matrix(), context);
+      }
 
       for (auto& projectile : visitor.projectiles())
       {
-        render_shadow_map(projectile, context);
+        add_request(*projectile, projectile->projection_matrix(), context);
+      }
+
+      cull_casters(receivers, context);
+
+      for (ShadowRequest& request : requests)
+      {
+        check_update(request);
+      }
+
+      assign_tiers(context);
+
+      schedule_updates(context.options().shadow_updates_per_frame);
+
+        //static casters depth is cached in a separate tile
+
+      for (ShadowRequest& request : requests)
+      {
+        if (request.update == ShadowUpdate_Dynamic && !request.shadow->static_tile.is_allocated())
+          request.shadow->static_tile = atlas.allocate(request.shadow->tile.size());
       }
 
+        //atlas may grow during tiles allocation; contents of all tiles are lost in this case
+
+      if (atlas.layers_count() != atlas_layers_count)
+      {
+        publish_atlas();
+
+        atlas_generation++;
+
+        for (ShadowRequest& request : requests)
+        {
+          request.update = ShadowUpdate_All;
+          request.shadow->has_static_cache = false;
+        }
+      }
+
+        //all shadow maps are rendered with one frame; passes are grouped by atlas layers to reduce frame buffer switches
+
+      SceneRendererStatistics& statistics = context.statistics();
+
+      reset_layered_batches(layered_batches);
+      reset_layered_batches(static_layered_batches);
+
+      for (ShadowRequest& request : requests)
+      {
+        if (request.update == ShadowUpdate_None)
+        {
+          statistics.shadow_map_skips_count++;
+          continue;
+        }
+
+        render_shadow_map(request, context);
+
+        statistics.shadow_map_updates_count++;
+      }
+
+      flush_layered_batches(static_layered_batches, static_frame, context);
+      flush_layered_batches(layered_batches, frame, context);
+
+      if (static_frame.passes_count())
+        frame.add_dependency(static_frame);
+
+      context.root_frame_node().add_dependency(frame);
+
         //clear data
 
       visitor.reset();
+      requests.clear();
+      casters.clear();
     }
 
   private:
-    void render_shadow_map(const SpotLight::Pointer& light, ScenePassContext& context)
+    void add_request(Node& light, const math::mat4f& projection_tm, ScenePassContext& context)
     {
-      render_shadow_map(static_cast<Node&>(*light), light->projection_matrix(), context);
+        //create shadow data
+
+      Shadow* shadow = light.find_user_data<Shadow>();
+
+      if (!shadow)
+      {
+        shadow = &light.set_user_data(Shadow(context.device(), shadow_program));
+      }
+
+      if (shadow->atlas_generation != atlas_generation)
+      {
+        shadow->is_rendered = false;
+        shadow->has_static_cache = false;
+      }
+
+      requests.push_back(ShadowRequest());
+
+      ShadowRequest& request = requests.back();
+
+      request.shadow = shadow;
+      request.light = &light;
+      request.projection_tm = projection_tm;
+      request.view_projection_tm = projection_tm * inverse(light.world_tm());
+      request.light_position = light.world_tm() * math::vec3f(0.0f);
+      request.update = ShadowUpdate_None;
+      request.is_mandatory = !shadow->is_rendered;
+      request.screen_size = get_screen_size(request.view_projection_tm, context);
+      request.size = 0;
+      request.culled_casters_count = 0;
     }
 
-    void render_shadow_map(const Projectile::Pointer& projectile, ScenePassContext& context)
+    /// Cull casters of all shadow maps on worker threads (casters and light transforms are resolved on the rendering thread)
+    void cull_casters(const Frustum* receivers, ScenePassContext& context)
     {
-      render_shadow_map(static_cast<Node&>(*projectile), projectile->projection_matrix(), context);
-    }    
+      context.device().thread_pool().parallel_for(requests.size(), [&](size_t index)
+      {
+        cull_casters(requests[index], receivers);
+      });
 
-    void render_shadow_map(Node& node, const math::mat4f& projection_tm, ScenePassContext& context)
+      for (const ShadowRequest& request : requests)
+        context.statistics().shadow_culled_casters_count += request.culled_casters_count;
+    }
+
+    /// Cull casters against the light frustum and optionally against the frustum of shadow receivers
+    void cull_casters(ShadowRequest& request, const Frustum* receivers)
     {
-        //create shadow data
+      Shadow* shadow = request.shadow;
+      Frustum light_frustum(request.view_projection_tm);
+      float shadow_distance = receivers ? get_shadow_distance(request.view_projection_tm, request.light_position) : 0.0f;
 
-      Shadow* shadow = node.find_user_data<Shadow>();
+      shadow->static_draws.clear();
+      shadow->dynamic_draws.clear();
 
-      if (!shadow)
+      for (size_t i=0, count=casters.size(); i<count; i++)
       {
-        shadow = &node.set_user_data(Shadow(context.device(), shadow_program, SHADOW_MAP_SIZE));
+        const Caster& caster = casters[i];
+
+        if (!light_frustum.intersects(caster.bounds) || (receivers && !casts_visible_shadow(caster.bounds, request.light_position, shadow_distance, *receivers)))
+        {
+          request.culled_casters_count++;
+          continue;
+        }
+
+        (caster.is_static ? shadow->static_draws : shadow->dynamic_draws).push_back(caster.draw);
+        (caster.is_static ? request.static_keys : request.dynamic_keys).push_back(caster.key);
+        (caster.is_static ? request.static_casters : request.dynamic_casters).push_back(i);
       }
+    }
 
-        //configure view
+    /// Check which casters have been changed since the last update
+    void check_update(ShadowRequest& request)
+    {
+      Shadow* shadow = request.shadow;
+      Node& light = *request.light;
+      const math::mat4f& projection_tm = request.projection_tm;
 
-      PropertyMap pass_properties = shadow->shadow_pass.properties();
+      bool is_light_changed = !shadow->is_rendered || shadow->light_version != light.transform_version() || !(shadow->projection_tm == projection_tm);
 
-      math::mat4f view_tm = inverse(node.world_tm());
-      math::mat4f view_projection_tm = projection_tm * view_tm;
-      math::vec3f world_view_position = node.world_tm() * math::vec3f(0.0f);
+      if (is_light_changed || request.static_keys != shadow->static_keys)
+      {
+          //cached static depth is useless while the light or static casters move
 
-      pass_properties.set("viewMatrix", view_tm);
-      pass_properties.set("worldViewPosition", world_view_position);
-      pass_properties.set("projectionMatrix", projection_tm);
+        request.update = ShadowUpdate_All;
+
+        shadow->has_static_cache = false;
+        shadow->static_tile = ShadowAtlasTile();
+      }
+      else if (request.dynamic_keys != shadow->dynamic_keys)
+      {
+        request.update = ShadowUpdate_Dynamic;
+      }
+    }
+
+    /// Size of the light frustum projected to the screen (in pixels); distant lights cover less pixels
+    static float get_screen_size(const math::mat4f& view_projection_tm, ScenePassContext& context)
+    {
+      const Viewport& viewport = context.device().window_frame_buffer().viewport();
+      const math::mat4f& camera_view_projection_tm = context.view_projection_tm();
+      math::mat4f inv_view_projection_tm = inverse(view_projection_tm);
+      math::vec3f corners [8];
+
+      for (size_t i=0; i<8; i++)
+      {
+        math::vec4f corner = inv_view_projection_tm * math::vec4f(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+
+        corners[i] = math::vec3f(corner) / corner.w;
+      }
+
+      if (Frustum(camera_view_projection_tm).is_outside(corners, 8))
+        return 0.0f;
+
+      math::vec2f min(1.0f), max(-1.0f);
+
+      for (const math::vec3f& corner : corners)
+      {
+        math::vec4f position = camera_view_projection_tm * math::vec4f(corner, 1.0f);
+
+          //light frustum crosses the camera plane, so the light may cover the whole screen
+
+        if (position.w <= 0.0f)
+          return float(std::max(viewport.width, viewport.height));
+
+        for (size_t i=0; i<2; i++)
+        {
+          min[i] = std::min(min[i], std::max(position[i] / position.w, -1.0f));
+          max[i] = std::max(max[i], std::min(position[i] / position.w, 1.0f));
+        }
+      }
+
+      return std::max(0.5f * (max[0] - min[0]) * viewport.width, 0.5f * (max[1] - min[1]) * viewport.height);
+    }
+
+    /// Select resolution tiers of shadow maps and reallocate tiles of shadows whose tier has been changed
+    void assign_tiers(ScenePassContext& context)
+    {
+        //resolution follows the projected size of the light; the tier is lowered with hysteresis to avoid reallocations
+
+      size_t texels_count = 0;
+
+      for (ShadowRequest& request : requests)
+      {
+        size_t size = MIN_SHADOW_MAP_SIZE;
+
+        while (size < MAX_SHADOW_MAP_SIZE && size < request.screen_size)
+          size *= 2;
+
+        size_t current_size = request.shadow->tile.is_allocated() ? request.shadow->tile.size() : 0;
+
+        if (size < current_size && request.screen_size > current_size / 2 * SHADOW_TIER_HYSTERESIS)
+          size = current_size;
+
+        request.size = size;
+        texels_count += size * size;
+      }
+
+        //texel budget is enforced by halving maps with the highest texels per screen pixel ratio
+
+      size_t texel_budget = context.options().shadow_texel_budget;
+
+      while (texel_budget && texels_count > texel_budget)
+      {
+        ShadowRequest* reduced_request = nullptr;
+
+        for (ShadowRequest& request : requests)
+        {
+          if (request.size <= MIN_SHADOW_MAP_SIZE)
+            continue;
+
+          if (!reduced_request || request.size * reduced_request->screen_size > reduced_request->size * request.screen_size)
+            reduced_request = &request;
+        }
+
+        if (!reduced_request)
+          break;
+
+        texels_count -= reduced_request->size * reduced_request->size * 3 / 4;
+        reduced_request->size /= 2;
+      }
+
+      context.statistics().shadow_map_texels_count = texels_count;
+
+        //shadow maps of changed tiers are rendered from scratch
+
+      for (ShadowRequest& request : requests)
+      {
+        Shadow& shadow = *request.shadow;
+
+        if (shadow.tile.is_allocated() && shadow.tile.size() == request.size)
+          continue;
+
+        shadow.tile = ShadowAtlasTile();
+        shadow.tile = atlas.allocate(request.size);
+        shadow.static_tile = ShadowAtlasTile();
+        shadow.has_static_cache = false;
+        shadow.is_rendered = false;
+
+        request.update = ShadowUpdate_All;
+        request.is_mandatory = true;
+      }
+    }
+
+    /// Distance from the light to the farthest corner of its frustum
+    static float get_shadow_distance(const math::mat4f& view_projection_tm, const math::vec3f& light_position)
+    {
+      math::mat4f inv_view_projection_tm = inverse(view_projection_tm);
+      float distance = 0.0f;
+
+      for (size_t i=0; i<4; i++)
+      {
+        math::vec4f corner = inv_view_projection_tm * math::vec4f(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, 1.0f, 1.0f);
+
+        distance = std::max(distance, length(math::vec3f(corner) / corner.w - light_position));
+      }
+
+      return distance;
+    }
+
+    /// Check if the shadow of the caster may land inside the receivers frustum; shadow volume is bounded
+    /// by the caster corners and the corners extruded away from the light up to the end of the light frustum
+    static bool casts_visible_shadow(const BoundBox& bounds, const math::vec3f& light_position, float shadow_distance, const Frustum& receivers)
+    {
+      math::vec3f corners [8], points [16];
+
+      bounds.get_corners(corners);
+
+      for (size_t i=0; i<8; i++)
+      {
+        math::vec3f direction = corners[i] - light_position;
+        float distance = length(direction);
+
+        if (distance < LIGHT_INSIDE_CASTER_DISTANCE)
+          return true;
+
+        points[i] = corners[i];
+        points[8 + i] = distance < shadow_distance ? light_position + direction * (shadow_distance / distance) : corners[i];
+      }
+
+      return !receivers.is_outside(points, 16);
+    }
+
+    void schedule_updates(size_t updates_per_frame)
+    {
+      if (!updates_per_frame)
+        return;
+
+        //shadow maps without valid contents are rendered anyway, others are updated starting from the most stale ones
+
+      std::vector<ShadowRequest*> pending_requests;
+
+      for (ShadowRequest& request : requests)
+      {
+        if (request.update != ShadowUpdate_None && !request.is_mandatory)
+          pending_requests.push_back(&request);
+      }
+
+      std::stable_sort(pending_requests.begin(), pending_requests.end(), [](const ShadowRequest* a, const ShadowRequest* b) {
+        return a->shadow->rendered_frame < b->shadow->rendered_frame;
+      });
+
+      for (size_t i=updates_per_frame; i<pending_requests.size(); i++)
+        pending_requests[i]->update = ShadowUpdate_None;
+    }
+
+    void render_shadow_map(ShadowRequest& request, ScenePassContext& context)
+    {
+      Shadow& shadow = *request.shadow;
+      Node& light = *request.light;
+      const ShadowAtlasTile& tile = shadow.tile;
+      bool is_layered = context.options().shadow_layered_rendering;
+
+        //configure view
+
+      math::mat4f view_tm = inverse(light.world_tm());
+      math::mat4f view_projection_tm = request.projection_tm * view_tm;
+      math::vec3f world_view_position = light.world_tm() * math::vec3f(0.0f);
+
+      set_view(shadow.shadow_pass, view_tm, world_view_position, request.projection_tm);
 
         //update shadow matrix
 
-      shadow->shadow_tm = view_projection_tm;
+      shadow.shadow_tm = view_projection_tm;
+      shadow.is_rendered = true;
+      shadow.rendered_frame = context.current_frame_id();
+      shadow.atlas_generation = atlas_generation;
+      shadow.light_version = light.transform_version();
+      shadow.projection_tm = request.projection_tm;
+      shadow.static_keys.swap(request.static_keys);
+      shadow.dynamic_keys.swap(request.dynamic_keys);
 
-        //draw geometry
+      shadow.shadow_pass.set_frame_buffer(atlas.frame_buffer(tile.layer()));
+      shadow.shadow_pass.set_viewport(tile.viewport());
 
-      for (auto& mesh : visitor.meshes())
+      frame.add_pass(shadow.shadow_pass, (int)tile.layer());
+
+      if (request.update == ShadowUpdate_All)
+      {
+        shadow.shadow_pass.reset_depth_source();
+
+          //in layered mode the pass of the shadow map only clears the tile, casters are drawn by the layered pass
+
+        if (is_layered)
+        {
+          LayeredShadowBatch& batch = add_layered_view(layered_batches, tile, view_projection_tm, context);
+
+          mark_casters(batch, request.static_casters);
+          mark_casters(batch, request.dynamic_casters);
+
+          return;
+        }
+
+          //draw geometry; draws of each shadow map are recorded on worker threads
+
+        context.record_draws(shadow.shadow_pass, [&shadow](DrawList& draw_list)
+        {
+          add_draws(shadow.static_draws, draw_list);
+          add_draws(shadow.dynamic_draws, draw_list);
+        });
+
+        context.statistics().shadow_caster_draws_count += shadow.static_draws.size() + shadow.dynamic_draws.size();
+        context.statistics().shadow_caster_passes_count++;
+
+        return;
+      }
+
+        //update static casters depth; it is rendered before shadow maps which copy it
+
+      const ShadowAtlasTile& static_tile = shadow.static_tile;
+
+      if (!shadow.has_static_cache)
       {
-        render_mesh(*mesh, context, shadow->shadow_pass);
+        set_view(shadow.static_pass, view_tm, world_view_position, request.projection_tm);
+
+        shadow.static_pass.set_frame_buffer(atlas.frame_buffer(static_tile.layer()));
+        shadow.static_pass.set_viewport(static_tile.viewport());
+
+        static_frame.add_pass(shadow.static_pass, (int)static_tile.layer());
+
+        if (is_layered)
+        {
+          mark_casters(add_layered_view(static_layered_batches, static_tile, view_projection_tm, context), request.static_casters);
+        }
+        else
+        {
+          context.record_draws(shadow.static_pass, [&shadow](DrawList& draw_list)
+          {
+            add_draws(shadow.static_draws, draw_list);
+          });
+
+          context.statistics().shadow_caster_draws_count += shadow.static_draws.size();
+          context.statistics().shadow_caster_passes_count++;
+        }
+
+        shadow.has_static_cache = true;
+
+        context.statistics().shadow_static_updates_count++;
       }
 
-        //add shadow pass to shadow frame
+      shadow.shadow_pass.set_depth_source(atlas.frame_buffer(static_tile.layer()), static_tile.viewport());
+
+      if (is_layered)
+      {
+        mark_casters(add_layered_view(layered_batches, tile, view_projection_tm, context), request.dynamic_casters);
 
-      shadow->shadow_frame.add_pass(shadow->shadow_pass);
+        return;
+      }
+
+      context.record_draws(shadow.shadow_pass, [&shadow](DrawList& draw_list)
+      {
+        add_draws(shadow.dynamic_draws, draw_list);
+      });
+
+      context.statistics().shadow_caster_draws_count += shadow.dynamic_draws.size();
+      context.statistics().shadow_caster_passes_count++;
+    }
+
+    static void reset_layered_batches(LayeredShadowBatchArray& batches)
+    {
+      for (LayeredShadowBatch& batch : batches)
+        batch.views_count = 0;
+    }
+
+    /// Add shadow map to the first layered batch with free views; batches are kept between frames to reuse their passes
+    LayeredShadowBatch& add_layered_view(LayeredShadowBatchArray& batches, const ShadowAtlasTile& tile, const math::mat4f& view_projection_tm, ScenePassContext& context)
+    {
+      auto it = std::find_if(batches.begin(), batches.end(), [](const LayeredShadowBatch& batch) {
+        return batch.views_count < MAX_LAYERED_SHADOW_VIEWS;
+      });
+
+      if (it == batches.end())
+      {
+        batches.emplace_back(context.device(), layered_shadow_program);
+
+        it = batches.end() - 1;
+      }
+
+      LayeredShadowBatch& batch = *it;
+
+      if (!batch.views_count)
+        batch.casters_masks.assign(casters.size(), 0);
+
+      size_t view = batch.views_count++;
+
+      batch.viewports[view] = tile.viewport();
+      batch.view_projection_tms[view] = view_projection_tm;
+      batch.layers[view] = float(tile.layer());
+
+      return batch;
     }
 
-    void render_mesh(engine::scene::Mesh& mesh, ScenePassContext& context, Pass& shadow_pass)
+    /// Mark casters as affecting the last added shadow map of the batch
+    static void mark_casters(LayeredShadowBatch& batch, const CasterIndexArray& caster_indices)
+    {
+      uint32_t view_bit = 1u << (batch.views_count - 1);
+
+      for (size_t index : caster_indices)
+        batch.casters_masks[index] |= view_bit;
+    }
+
+    /// Schedule layered passes; each caster is submitted once per batch with the mask of shadow maps it affects
+    void flush_layered_batches(LayeredShadowBatchArray& batches, FrameNode& frame_node, ScenePassContext& context)
+    {
+      for (LayeredShadowBatch& batch : batches)
+      {
+        if (!batch.views_count)
+          continue;
+
+          //mask is packed into the bottom row of the transform which is always (0, 0, 0, 1) for casters
+
+        batch.draws.clear();
+
+        for (size_t i=0, count=casters.size(); i<count; i++)
+        {
+          uint32_t mask = batch.casters_masks[i];
+
+          if (!mask)
+            continue;
+
+          batch.draws.push_back(casters[i].draw);
+
+          batch.draws.back().world_tm[3][0] = float(mask);
+        }
+
+        PropertyMap pass_properties = batch.pass.properties();
+
+        pass_properties.set("shadowViewProjectionMatrices", batch.view_projection_tms);
+        pass_properties.set("shadowViewLayers", batch.layers);
+        pass_properties.set("shadowViewsCount", int(batch.views_count));
+
+        batch.pass.set_frame_buffer(atlas.layered_frame_buffer());
+        batch.pass.set_viewports(batch.viewports, batch.views_count);
+
+        frame_node.add_pass(batch.pass, LAYERED_SHADOW_PASS_PRIORITY);
+
+        context.record_draws(batch.pass, [&batch](DrawList& draw_list)
+        {
+          add_draws(batch.draws, draw_list);
+        });
+
+        context.statistics().shadow_caster_draws_count += batch.draws.size();
+        context.statistics().shadow_caster_passes_count++;
+      }
+    }
+
+    static void set_view(Pass& pass, const math::mat4f& view_tm, const math::vec3f& world_view_position, const math::mat4f& projection_tm)
+    {
+      PropertyMap pass_properties = pass.properties();
+
+      pass_properties.set("viewMatrix", view_tm);
+      pass_properties.set("worldViewPosition", world_view_position);
+      pass_properties.set("projectionMatrix", projection_tm);
+    }
+
+    static void add_draws(const MeshDrawArray& draws, DrawList& draw_list)
+    {
+      for (auto& draw : draws)
+      {
+        draw_list.add_mesh(*draw.mesh, draw.world_tm);
+      }
+    }
+
+    void publish_atlas()
+    {
+      shared_textures.remove("shadowTexture");
+      shared_textures.insert("shadowTexture", atlas.texture());
+
+      shared_properties.set("shadowMapPixelSize", math::vec2f(1.0f / atlas.layer_size()));
+
+      atlas_layers_count = atlas.layers_count();
+    }
+
+    void prepare_mesh(engine::scene::Mesh& mesh, ScenePassContext& context)
     {
         //create mesh data
 
@@ -130,14 +765,49 @@ class ShadowPass : IScenePass
         renderable_mesh = &mesh.set_user_data(RenderableMesh(mesh, context));
       }
 
-        //add mesh to pass
+        //track caster movement
+
+      FrameId current_frame = context.current_frame_id();
+      size_t transform_version = mesh.transform_version();
+      ShadowCaster* caster = mesh.find_user_data<ShadowCaster>();
+
+      if (!caster)
+      {
+        caster = &mesh.set_user_data(ShadowCaster(transform_version, current_frame));
+      }
+
+      if (caster->transform_version != transform_version)
+      {
+        caster->transform_version = transform_version;
+        caster->moved_frame = current_frame;
+      }
+
+      bool is_static = current_frame - caster->moved_frame >= STATIC_CASTER_FRAMES;
+
+        //world transform is cached lazily by the node, so it is resolved here rather than in recorders
+
+      const math::mat4f& world_tm = mesh.world_tm();
 
-      shadow_pass.add_mesh(renderable_mesh->mesh, mesh.world_tm());
+      casters.emplace_back(MeshDraw(renderable_mesh->mesh, world_tm), CasterKey(&mesh, transform_version),
+        renderable_mesh->bounds.transform(world_tm), is_static);
     }
 
   private:
     low_level::Program shadow_program;
+    low_level::Program layered_shadow_program; //program of layered passes
+    ShadowAtlas atlas;
+    size_t atlas_layers_count;
+    size_t atlas_generation; //incremented each time the atlas contents are lost
+    TextureList shared_textures;
+    PropertyMap shared_properties;
+    FrameNodeList shared_frames;
+    FrameNode frame;
+    FrameNode static_frame; //static casters depth rendering
+    LayeredShadowBatchArray layered_batches; //layered passes of shadow maps
+    LayeredShadowBatchArray static_layered_batches; //layered passes of static casters depth
+    std::vector<ShadowRequest> requests;
     SceneVisitor visitor;
+    CasterArray casters; //casters of the current frame
 };
 
 struct ShadowPassComponent : Component
@@ -24,39 +24,196 @@ typedef std::vector<engine::scene::PointLight::Pointer> PointLightArray;
 typedef std::vector<engine::scene::SpotLight::Pointer> SpotLightArray;
 typedef std::vector<engine::scene::Projectile::Pointer> ProjectileArray;
 
+/// Axis aligned bounding box
+struct BoundBox
+{
+  math::vec3f center; //center of the box
+  math::vec3f extent; //half size of the box
+
+  /// Bounds of the mesh vertices
+  static BoundBox from_mesh(const media::geometry::Mesh& mesh);
+
+  /// Bounds of the transformed box
+  BoundBox transform(const math::mat4f& tm) const;
+
+  /// Corners of the box
+  void get_corners(math::vec3f (&corners)[8]) const;
+};
+
+/// View frustum for conservative visibility tests
+class Frustum
+{
+  public:
+    /// Constructor (planes are extracted from view-projection matrix)
+    Frustum(const math::mat4f& view_projection_tm);
+
+    /// Check if the box intersects the frustum
+    bool intersects(const BoundBox& box) const;
+
+    /// Check if all points lie outside of one frustum plane (so their convex hull doesn't intersect the frustum)
+    bool is_outside(const math::vec3f* points, size_t points_count) const;
+
+  private:
+    math::vec4f planes[6]; //planes with normals pointing inside
+};
+
 /// Rendering mesh data
 struct RenderableMesh
 {
   low_level::Mesh mesh;
+  BoundBox bounds; //local space bounds
 
   RenderableMesh(engine::scene::Mesh& mesh, ScenePassContext& context)
     : mesh(context.device().create_mesh(mesh.mesh(), context.materials()))
+    , bounds(BoundBox::from_mesh(mesh.mesh()))
   {
   }
 };
 
+/// Mesh draw resolved on the rendering thread; it is read by draws recorders on worker threads
+struct MeshDraw
+{
+  const low_level::Mesh* mesh; //rendering mesh
+  math::mat4f world_tm; //world transform of the mesh
+
+  MeshDraw(const low_level::Mesh& mesh, const math::mat4f& world_tm)
+    : mesh(&mesh)
+    , world_tm(world_tm)
+  {
+  }
+};
+
+typedef std::vector<MeshDraw> MeshDrawArray;
+
+/// Region of the shadow atlas; the region is released when the last tile handle is destroyed
+class ShadowAtlasTile
+{
+  friend class ShadowAtlas;
+  public:
+    /// Constructor
+    ShadowAtlasTile();
+
+    /// Tile has been allocated
+    bool is_allocated() const;
+
+    /// Layer of the atlas texture array
+    size_t layer() const;
+
+    /// Tile size (in texels)
+    size_t size() const;
+
+    /// Viewport of the tile in the atlas layer
+    const low_level::Viewport& viewport() const;
+
+    /// Normalized texture rectangle of the tile: offset (xy) and scale (zw)
+    math::vec4f texture_rect() const;
+
+  private:
+    struct Impl;
+    ShadowAtlasTile(const std::shared_ptr<Impl>&);
+
+  private:
+    std::shared_ptr<Impl> impl;
+};
+
+/// Shadow atlas; packs power of two shadow maps into layers of depth texture array
+class ShadowAtlas
+{
+  friend class ShadowAtlasTile;
+  public:
+    /// Constructor
+    ShadowAtlas(low_level::Device& device, size_t layer_size);
+
+    /// Atlas texture (recreated with more layers when the atlas grows)
+    const low_level::Texture& texture() const;
+
+    /// Size of the atlas layer
+    size_t layer_size() const;
+
+    /// Number of layers
+    size_t layers_count() const;
+
+    /// Frame buffer for rendering to the atlas layer
+    low_level::FrameBuffer& frame_buffer(size_t layer) const;
+
+    /// Frame buffer for rendering to all layers (layer is selected by geometry shader)
+    low_level::FrameBuffer& layered_frame_buffer() const;
+
+    /// Allocate tile (size is rounded up to power of two)
+    ShadowAtlasTile allocate(size_t size);
+
+  private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+/// Caster key for casters sets comparison
+struct CasterKey
+{
+  const engine::scene::Mesh* mesh; //mesh node
+  size_t transform_version; //transform version of the mesh node
+
+  CasterKey(const engine::scene::Mesh* mesh, size_t transform_version) : mesh(mesh), transform_version(transform_version) {}
+
+  bool operator == (const CasterKey& other) const { return mesh == other.mesh && transform_version == other.transform_version; }
+};
+
+typedef std::vector<CasterKey> CasterKeyArray;
+
 /// Shadow
 struct Shadow
 {
-  low_level::Texture shadow_texture;
+  ShadowAtlasTile tile; //shadow map tile (allocated by the shadow pass according to the resolution tier)
   low_level::Pass shadow_pass;
-  low_level::FrameBuffer shadow_frame_buffer;
-  FrameNode shadow_frame;
   math::mat4f shadow_tm;
+  bool is_rendered; //shadow map contents are valid
+  FrameId rendered_frame; //frame of the last shadow map update
+  size_t atlas_generation; //atlas generation of the shadow map contents
+  size_t light_version; //transform version of the light for the rendered shadow map
+  math::mat4f projection_tm; //projection of the light for the rendered shadow map
+  ShadowAtlasTile static_tile; //cached depth of static casters (allocated when only dynamic casters move)
+  low_level::Pass static_pass; //static casters rendering pass
+  bool has_static_cache; //static casters depth is valid
+  CasterKeyArray static_keys; //static casters of the rendered shadow map
+  CasterKeyArray dynamic_keys; //dynamic casters of the rendered shadow map
+  MeshDrawArray static_draws; //static casters of the current frame inside the light frustum
+  MeshDrawArray dynamic_draws; //dynamic casters of the current frame inside the light frustum
 
-  Shadow(engine::render::low_level::Device& device, const low_level::Program& program, size_t shadow_map_size)
-    : shadow_texture(device.create_texture2d(shadow_map_size, shadow_map_size, low_level::PixelFormat_D24, 1))
-    , shadow_pass(device.create_pass(program))
-    , shadow_frame_buffer(device.create_frame_buffer())
+  Shadow(engine::render::low_level::Device& device, const low_level::Program& program)
+    : shadow_pass(create_pass(device, program))
     , shadow_tm(1.0f)
+    , is_rendered()
+    , rendered_frame()
+    , atlas_generation()
+    , light_version()
+    , projection_tm(1.0f)
+    , static_pass(create_pass(device, program))
+    , has_static_cache()
+  {
+  }
+
+  static low_level::Pass create_pass(engine::render::low_level::Device& device, const low_level::Program& program)
   {
-    shadow_texture.set_min_filter(low_level::TextureFilter_Point);
+    low_level::Pass pass = device.create_pass(program);
 
-    shadow_frame_buffer.attach_depth_buffer(shadow_texture);
-    shadow_frame_buffer.set_viewport(low_level::Viewport(0, 0, (int)shadow_map_size, (int)shadow_map_size));
+    pass.set_clear_flags(low_level::Clear_Depth);
+    pass.set_depth_stencil_state(low_level::DepthStencilState(true, true, low_level::CompareMode_Less));
+    pass.set_sort_mode(low_level::PassSortMode_FrontToBack);
 
-    shadow_pass.set_frame_buffer(shadow_frame_buffer);
-    shadow_pass.set_depth_stencil_state(low_level::DepthStencilState(true, true, low_level::CompareMode_Less));
+    return pass;
+  }
+};
+
+/// Shadow caster data
+struct ShadowCaster
+{
+  size_t transform_version; //transform version of the mesh node
+  FrameId moved_frame; //frame when the mesh has been moved last time
+
+  ShadowCaster(size_t transform_version, FrameId moved_frame)
+    : transform_version(transform_version)
+    , moved_frame(moved_frame)
+  {
   }
 };
 
@@ -68,7 +225,7 @@ struct RenderableProjectile
   low_level::Primitive plane;
   common::PropertyMap properties;
 
-  RenderableProjectile(const char* image_name, const low_level::Texture& shadow_texture, engine::render::low_level::Device& device)
+  RenderableProjectile(const char* image_name, engine::render::low_level::Device& device)
     : texture(device.create_texture2d(image_name))
     , plane(device.create_plane(material))
   {
@@ -79,11 +236,6 @@ struct RenderableProjectile
     low_level::TextureList textures = material.textures();
 
     textures.insert("projectileTexture", texture);
-    textures.insert("shadowTexture", shadow_texture);
-
-    float tex_size_step = 1.0f / shadow_texture.width();
-
-    properties.set("shadowMapPixelSize", math::vec2f(tex_size_step));
   }
 };
 
@@ -25,6 +25,7 @@ struct Node::Impl
   math::mat4f world_tm; //world transformation matrix
   bool is_local_tm_dirty; //is local transformation matrix needs update
   bool is_world_tm_dirty; //is world transformation matrix needs update
+  size_t transform_version; //version of world transformations
   UserDataMap user_data_map;
 
   /// Constructor
@@ -33,21 +34,24 @@ struct Node::Impl
     , scale(1.f)
     , is_local_tm_dirty(true)
     , is_world_tm_dirty(true)
+    , transform_version()
   {
   }
 
-  /// Mark transformations as dirty
-  void invalidate_matrix()
+  /// Mark transformations as dirty; already dirty subtrees are skipped unless propagation is forced
+  void invalidate_matrix(bool force_propagation = false)
   {    
     is_local_tm_dirty = true;
 
-    if (!is_world_tm_dirty)
+    transform_version++;
+
+    if (!is_world_tm_dirty || force_propagation)
     {
       is_world_tm_dirty = true;
 
       for (Node::Pointer it=first_child; it; it=it->impl->next_child)
-        if (!it->impl->is_world_tm_dirty)
-          it->impl->invalidate_matrix();
+        if (!it->impl->is_world_tm_dirty || force_propagation)
+          it->impl->invalidate_matrix(force_propagation);
     }
   }
 
@@ -103,7 +107,9 @@ struct Node::Impl
       prev_child = next_child = 0;
     }
 
-    is_world_tm_dirty = true;
+      //world transforms and versions of the whole subtree are changed with the parent
+
+    invalidate_matrix(true);
   }
 };
 
@@ -179,6 +185,9 @@ void Node::unbind_all_children()
 
 void Node::set_position(const math::vec3f& position)
 {
+  if (impl->position == position)
+    return;
+
   impl->position = position;
 
   impl->invalidate_matrix();
@@ -191,6 +200,9 @@ const math::vec3f& Node::position() const
 
 void Node::set_orientation(const math::quatf& orientation)
 {
+  if (impl->orientation == orientation)
+    return;
+
   impl->orientation = orientation;
 
   impl->invalidate_matrix();
@@ -203,6 +215,9 @@ const math::quatf& Node::orientation() const
 
 void Node::set_scale(const math::vec3f& scale)
 {
+  if (impl->scale == scale)
+    return;
+
   impl->scale = scale;
 
   impl->invalidate_matrix();
@@ -266,7 +281,13 @@ const math::mat4f& Node::world_tm() const
   Pointer current_parent = parent();
     
   if (!current_parent)
+  {
+      //root node is considered up to date, so its movement invalidates children
+
+    impl->is_world_tm_dirty = false;
+
     return local_tm();
+  }
 
   if (impl->is_world_tm_dirty)
   {
@@ -277,6 +298,11 @@ const math::mat4f& Node::world_tm() const
   return impl->world_tm;
 }
 
+size_t Node::transform_version() const
+{
+  return impl->transform_version;
+}
+
 void Node::traverse(ISceneVisitor& visitor) const
 { 
   const_cast<Node&>(*this).visit(visitor);